@@ -0,0 +1,47 @@
+#include "AudioBackend.h"
+
+#include <string_view>
+
+#ifdef _WIN32
+#include "WasapiBackend.h"
+#else
+#include "VirtualBackend.h"
+#endif
+
+namespace {
+    constexpr std::wstring_view kProcessPrefix = L"process:";
+    constexpr std::wstring_view kExcludeSuffix = L":exclude";
+}
+
+std::wstring processLoopbackId(const std::uint32_t processId, const bool excludeTree) {
+    std::wstring id(kProcessPrefix);
+    id += std::to_wstring(processId);
+    if (excludeTree) id += kExcludeSuffix;
+    return id;
+}
+
+bool parseProcessLoopbackId(const std::wstring &id, std::uint32_t &processId, bool &excludeTree) {
+    std::wstring_view rest(id);
+    if (rest.substr(0, kProcessPrefix.size()) != kProcessPrefix) return false;
+    rest.remove_prefix(kProcessPrefix.size());
+    excludeTree = rest.size() > kExcludeSuffix.size() && rest.substr(rest.size() - kExcludeSuffix.size()) == kExcludeSuffix;
+    if (excludeTree) rest.remove_suffix(kExcludeSuffix.size());
+    // 十进制、不为 0、不溢出
+    if (rest.empty() || rest.size() > 10) return false;
+    std::uint64_t value = 0;
+    for (const wchar_t c : rest) {
+        if (c < L'0' || c > L'9') return false;
+        value = value * 10 + static_cast<std::uint64_t>(c - L'0');
+    }
+    if (value == 0 || value > 0xFFFFFFFFull) return false;
+    processId = static_cast<std::uint32_t>(value);
+    return true;
+}
+
+std::unique_ptr<AudioBackend> createPlatformBackend() {
+#ifdef _WIN32
+    return std::make_unique<WasapiBackend>();
+#else
+    return VirtualBackend::withDefaultDevices();
+#endif
+}
@@ -0,0 +1,173 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "SampleConvert.h"
+
+// 音频后端接口：引擎核心只依赖这里的抽象，不直接接触 WASAPI 等平台 API
+// 核心内部统一使用交错 float32 样本，设备使用整数格式时由流在内部转换
+
+// 流格式
+struct StreamFormat {
+    std::uint32_t sampleRate = 0;
+    std::uint32_t channels = 0;
+    // 设备侧的样本编码（仅供显示；流的读写接口始终是 float32）
+    SampleType sample = SampleType::Float32;
+};
+
+// 端点信息
+// 除端点外，正在播放声音的进程也作为 loopback 来源出现（processId 不为 0，isRender 为 false），
+// ID 由 processLoopbackId 生成，只能作为来源，不能作为输出
+struct DeviceInfo {
+    std::wstring id;        // 后端内稳定的端点 ID
+    std::wstring name;      // 友好名称（可能重名）；进程来源为进程名
+    bool isRender = true;   // render 端点：可作为输出，也可作为 loopback 来源；否则为物理 capture 端点或进程来源
+    bool isDefault = false; // 该方向的默认端点（控制台角色）
+    std::uint32_t processId = 0;      // 进程来源的目标进程
+    bool excludeProcessTree = false;  // 进程来源：true 为捕获除该进程树以外的全部声音，false 为只捕获该进程树
+};
+
+// 能否作为 loopback 来源（render 端点或进程）
+inline bool isLoopbackSource(const DeviceInfo &device) { return device.isRender || device.processId != 0; }
+
+// 进程来源的 ID："process:<pid>" 只捕获该进程及其子进程播放的声音，"process:<pid>:exclude" 捕获除它们以外的全部声音
+std::wstring processLoopbackId(std::uint32_t processId, bool excludeTree);
+// 解析进程来源的 ID；不是进程来源时返回 false
+bool parseProcessLoopbackId(const std::wstring &id, std::uint32_t &processId, bool &excludeTree);
+
+// 端点变化通知
+struct DeviceChange {
+    enum class Type {
+        Added,            // 新增或重新变为可用；名称等属性变化也按此上报，由接收方重新查询
+        Removed,          // 移除或变为不可用
+        DefaultChanged,   // isRender 方向的默认端点改为 id（为空表示没有默认端点）
+    };
+    Type type = Type::Added;
+    std::wstring id;
+    bool isRender = true;
+};
+
+// 流实际采用的工作模式
+enum class StreamMode {
+    Shared,             // 普通共享模式（缓冲长度按 bufferMs）
+    SharedLowLatency,   // 共享模式 + 引擎最小周期（IAudioClient3）
+    Exclusive,          // 独占模式，周期取设备最小周期
+};
+
+// 打开流时的参数
+struct StreamConfig {
+    std::uint32_t bufferMs = 150;
+    // 低延迟模式：优先独占模式（若允许且设备支持），其次共享模式最小周期；都不可用时退回普通共享模式
+    bool lowLatency = false;
+    bool allowExclusive = false;
+    // 写入 16 / 24 位整数格式的设备时叠加 TPDF 抖动
+    bool dither = true;
+    // 自适应缓冲：目标排队量从最低值开始，按实测的 capture 包到达抖动自动加减，最多到 bufferMs 对应的排队量
+    // （低延迟模式下同样按 bufferMs 封顶）
+    bool adaptiveBuffer = false;
+    // 上次在该端点上实际协商到的格式与模式（从会话恢复时由引擎逐个端点填入），sampleRate 为 0 表示没有
+    // 仍然有效（与端点当前的 mix format 一致）时后端把它作为第一次尝试，省去逐个格式的试探；
+    // 它不限制协商结果：失败或上次的模式弱于本次配置允许的模式时，照常从最强的模式开始协商
+    StreamFormat cachedFormat;
+    StreamMode cachedMode = StreamMode::Shared;
+};
+
+// 一个 capture 数据包（指针在 releasePacket 之前有效）
+struct CapturePacket {
+    const float *data = nullptr;
+    std::uint32_t frames = 0;
+    bool silent = false;          // 对应 AUDCLNT_BUFFERFLAGS_SILENT
+    bool discontinuity = false;   // 对应 AUDCLNT_BUFFERFLAGS_DATA_DISCONTINUITY
+    std::uint64_t devicePosition = 0;
+    std::uint64_t timestampNs = 0;  // 首帧被设备采集的时刻（AudioBackend::nowNs 时基），0 表示后端不提供
+};
+
+class AudioStream {
+public:
+    virtual ~AudioStream() = default;
+
+    virtual StreamFormat format() const = 0;
+    // 设备缓冲大小（帧）
+    virtual std::uint32_t bufferFrames() const = 0;
+    // 设备周期，即事件间隔（帧）
+    virtual std::uint32_t periodFrames() const = 0;
+    // 实际协商到的模式
+    virtual StreamMode mode() const = 0;
+
+    virtual bool start() = 0;
+    virtual void stop() = 0;
+
+    // 人为触发该流的事件，用于唤醒正在 waitAny 中等待的线程（例如停止时）
+    virtual void signal() = 0;
+
+    // 设备已被移除、禁用或格式改变（AUDCLNT_E_DEVICE_INVALIDATED）：此后的调用都会失败，事件也不再触发，
+    // 只能重新打开。在某次调用失败之后检查，音频线程可调用
+    virtual bool invalidated() const = 0;
+};
+
+class CaptureStream : public AudioStream {
+public:
+    // 取下一个包；暂无数据时返回 true 且 packet.frames == 0，出错返回 false
+    virtual bool readPacket(CapturePacket &packet) = 0;
+    virtual void releasePacket(std::uint32_t frames) = 0;
+};
+
+class RenderStream : public AudioStream {
+public:
+    // 设备缓冲中尚未播放的帧数
+    virtual bool padding(std::uint32_t &frames) = 0;
+    // 取得可写入 frames 帧的缓冲（交错 float32），失败返回 nullptr
+    virtual float *acquire(std::uint32_t frames) = 0;
+    // 提交 acquire 得到的缓冲
+    virtual bool commit(std::uint32_t frames) = 0;
+};
+
+class AudioBackend {
+public:
+    static constexpr int kWaitTimeout = -1;
+    static constexpr int kWaitFailed = -2;
+
+    virtual ~AudioBackend() = default;
+
+    // 完整枚举所有可用端点与当前有音频会话的进程（较慢，界面与启动路径应经由 DeviceRegistry 的缓存）
+    // 进程只列出 processLoopbackId(pid, false) 一项，排除进程树的来源按 ID 经 describe 查询
+    virtual std::vector<DeviceInfo> enumerate() = 0;
+    // 查询单个端点或进程来源；不存在或不可用时返回 false
+    virtual bool describe(const std::wstring &deviceId, DeviceInfo &info) = 0;
+
+    // 端点变化回调：在后端的通知线程上调用，必须尽快返回，回调中不能再调用后端
+    // 传入空函数取消监听；返回后不会再有回调在执行
+    using DeviceChangeCallback = std::function<void(const DeviceChange &)>;
+    virtual void setDeviceChangeCallback(DeviceChangeCallback callback) = 0;
+
+    // 在 render 端点上以 loopback 方式打开 capture 流
+    virtual std::unique_ptr<CaptureStream> openLoopback(const std::wstring &deviceId, const StreamConfig &config) = 0;
+    virtual std::unique_ptr<RenderStream> openRender(const std::wstring &deviceId, const StreamConfig &config) = 0;
+
+    // 以进程 loopback 方式打开 capture 流：只捕获 processId 所在进程树播放的声音（excludeTree 时反过来，捕获除它以外的全部声音），
+    // 与它在哪个端点上播放无关。进程 loopback 没有自己的混音格式，按 format 的采样率与声道数交付（通常取输出的格式，省去重采样）
+    // 后端不支持时返回 nullptr
+    virtual std::unique_ptr<CaptureStream> openProcessLoopback(std::uint32_t /*processId*/, bool /*excludeTree*/,
+                                                               const StreamFormat & /*format*/, const StreamConfig & /*config*/) {
+        return nullptr;
+    }
+
+    // 等待任一流的事件：返回就绪流的下标，超时返回 kWaitTimeout，出错返回 kWaitFailed
+    // streams 必须都由本后端打开
+    virtual int waitAny(AudioStream *const *streams, std::size_t count, std::uint32_t timeoutMs) = 0;
+
+    // 后端时基的当前时间（纳秒），与 CapturePacket::timestampNs 可比
+    virtual std::uint64_t nowNs() const = 0;
+
+    // 音频线程进入 / 退出（WASAPI：MMCSS 注册；虚拟后端：登记为虚拟时钟的参与线程）
+    virtual void enterAudioThread() {}
+    virtual void leaveAudioThread() {}
+};
+
+// 当前平台的默认后端：Windows 上为 WASAPI，其他平台为虚拟时钟后端
+std::unique_ptr<AudioBackend> createPlatformBackend();
@@ -1,381 +1,2092 @@
 #include "AudioEngine.h"
 
-#include <Mmdeviceapi.h>
-#include <Audioclient.h>
-#include <Functiondiscoverykeys_devpkey.h>
-#include <atlbase.h>
-#include <avrt.h>            // AvSetMmThreadCharacteristics
-#include <iostream>
 #include <thread>
 #include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
 
-#pragma comment(lib, "Avrt.lib")
+#include "Utf8.h"
 
-using Microsoft::WRL::ComPtr;
+namespace {
+    // render 线程每个事件把设备缓冲补到两个周期（不超过缓冲长度），其余排队留在 ring 中吸收 capture 侧的抖动
+    uint32_t renderWatermark(const RenderStream& stream) {
+        return std::min(stream.bufferFrames(), std::max<uint32_t>(1, stream.periodFrames()) * 2);
+    }
+
+    // 交错帧逐帧乘以线性渐变的增益 start + step * i
+    void applyRamp(float* data, const size_t frames, const size_t channels, const float start, const float step) {
+        for (size_t i = 0; i < frames; ++i) {
+            const float g = std::clamp(start + step * static_cast<float>(i), 0.0f, 1.0f);
+            for (size_t c = 0; c < channels; ++c) data[i * channels + c] *= g;
+        }
+    }
+}
+
+AudioEngine::AudioEngine()
+    : AudioEngine(createPlatformBackend()) {
+}
 
-AudioEngine::AudioEngine() {
-    CoInitializeEx(nullptr, COINIT_MULTITHREADED);
-    mixFormat = nullptr;
-    running = false;
+AudioEngine::AudioEngine(std::unique_ptr<AudioBackend> backend)
+    : audioBackend(std::move(backend)), registry(*audioBackend) {
 }
 
 AudioEngine::~AudioEngine() {
     stopCopy();
-    if (mixFormat) {
-        CoTaskMemFree(mixFormat);
-        mixFormat = nullptr;
-    }
-    CoUninitialize();
-}
-
-DeviceNames AudioEngine::listDeviceNames() {
-    DeviceNames names;
-    ComPtr<IMMDeviceEnumerator> enumerator;
-    HRESULT hr = CoCreateInstance(__uuidof(MMDeviceEnumerator), nullptr, CLSCTX_ALL, IID_PPV_ARGS(&enumerator));
-    if (FAILED(hr)) return names;
-
-    // 输出设备（render） —— 既是播放目标，也可以作为 loopback 源
-    ComPtr<IMMDeviceCollection> collection;
-    if (SUCCEEDED(enumerator->EnumAudioEndpoints(eRender, DEVICE_STATE_ACTIVE, &collection))) {
-        UINT count = 0;
-        collection->GetCount(&count);
-        for (UINT i = 0; i < count; ++i) {
-            ComPtr<IMMDevice> dev;
-            collection->Item(i, &dev);
-            ComPtr<IPropertyStore> props;
-            if (SUCCEEDED(dev->OpenPropertyStore(STGM_READ, &props))) {
-                PROPVARIANT varName;
-                PropVariantInit(&varName);
-                if (SUCCEEDED(props->GetValue(PKEY_Device_FriendlyName, &varName))) {
-                    names.outputs.push_back(std::wstring(varName.pwszVal));
-                    // 同时把 render 设备也作为 loopback 源暴露（UI 层用来选择要捕获的播放设备）
-                    names.loopbackSources.push_back(std::wstring(varName.pwszVal));
+}
+
+DeviceList AudioEngine::listDevices() {
+    DeviceList list;
+    for (const auto& d : registry.devices()) {
+        if (d.isRender) {
+            // render 设备既是播放目标，也作为 loopback 源暴露（UI 层用来选择要捕获的播放设备）
+            list.outputs.push_back(d);
+            list.loopbackSources.push_back(d);
+        } else if (d.processId != 0) {
+            // 正在播放声音的进程：只能作为来源
+            list.loopbackSources.push_back(d);
+        } else {
+            // 物理输入设备（capture）
+            list.inputs.push_back(d);
+        }
+    }
+    return list;
+}
+
+bool AudioEngine::startCopy(const std::vector<std::wstring>& inputIds, const std::wstring& outputId, const std::uint32_t bufferMs) {
+    StreamConfig config;
+    config.bufferMs = bufferMs;
+    return startCopy(inputIds, outputId, config);
+}
+
+bool AudioEngine::startCopy(const std::vector<std::wstring>& inputIds, const std::wstring& outputId, const StreamConfig& config) {
+    if (inputIds.empty() || inputIds.size() > kMaxSources) return false;
+
+    {
+        std::lock_guard<CheckedMutex> lock(controlMutex);
+        if (!checkNotRunning()) return false;
+        reclaim();
+        startRequested = std::chrono::steady_clock::now();
+        if (!startLocked(inputIds, outputId, config, false)) return false;
+    }
+    startSupervisor();
+    return true;
+}
+
+bool AudioEngine::checkNotRunning() const {
+    // 运行中再次启动会覆盖仍被音频线程使用的流与处理图
+    if (!running.load(std::memory_order_acquire)) return true;
+    reportError("引擎已在运行，需先停止");
+    return false;
+}
+
+void AudioEngine::startSupervisor() {
+    // 监督线程负责失效设备的自动恢复，平时阻塞等待，不占用 CPU
+    if (!supervisorThread.joinable()) {
+        supervising.store(true, std::memory_order_release);
+        supervisorThread = std::thread(&AudioEngine::superviseLoop, this);
+    }
+}
+
+std::wstring AudioEngine::resolveSessionSource(const SessionEndpoint& endpoint) {
+    std::uint32_t processId = 0;
+    bool excludeTree = false;
+    if (!parseProcessLoopbackId(endpoint.id, processId, excludeTree)) {
+        const auto device = registry.find(endpoint.id);
+        return device && isLoopbackSource(*device) ? endpoint.id : std::wstring();
+    }
+    // 没有保存进程名时无法确认 PID 仍是同一个程序，宁可不恢复也不去捕获无关的进程
+    if (endpoint.processName.empty()) return {};
+    // 先按 PID 直接向后端查询这一个进程，仍是同一个程序即可
+    if (const auto device = registry.find(endpoint.id); device && device->name == endpoint.processName) return endpoint.id;
+    // PID 已失效或被复用：才按进程名在缓存中找（同名的多个进程取枚举顺序中的第一个）
+    if (const auto device = registry.findProcess(endpoint.processName)) return processLoopbackId(device->processId, excludeTree);
+    return {};
+}
+
+bool AudioEngine::startSession(const EngineSession& session) {
+    if (session.sources.empty() || session.sources.size() > kMaxSources) return false;
+    // 会话中各来源恢复后在引擎中的下标，找不到的来源为 -1（跳过，其余照常恢复）
+    std::vector<int> sourceIndex;
+    std::vector<std::wstring> inputIds;
+    std::map<std::wstring, SessionEndpoint> sourceHints;
+    for (const auto& source : session.sources) {
+        const std::wstring id = resolveSessionSource(source.endpoint);
+        if (id.empty()) {
+            reportError("无法恢复来源 " + narrowUtf8(source.endpoint.id));
+            sourceIndex.push_back(-1);
+            continue;
+        }
+        sourceIndex.push_back(static_cast<int>(inputIds.size()));
+        inputIds.push_back(id);
+        sourceHints[id] = source.endpoint;
+    }
+    if (inputIds.empty()) return false;
+
+    // 会话中各输出（0 为主输出）恢复后在引擎中的下标，打不开的附加输出为 -1
+    std::vector<int> outputIndex{ 0 };
+    std::uint32_t savedRate = 0;
+    std::uint32_t outputRate = 0;
+    {
+        std::lock_guard<CheckedMutex> lock(controlMutex);
+        if (!checkNotRunning()) return false;
+        reclaim();
+        startRequested = std::chrono::steady_clock::now();
+        formatHints = std::move(sourceHints);
+        formatHints[session.output.id] = session.output;
+        for (const auto& extra : session.extraOutputs) formatHints[extra.id] = extra;
+
+        StreamConfig config = session.config;
+        config.cachedFormat = StreamFormat{};
+        const bool started = startLocked(inputIds, session.output.id, config, false);
+        if (started) {
+            for (const auto& extra : session.extraOutputs) {
+                if (addOutputLocked(extra.id)) {
+                    outputIndex.push_back(static_cast<int>(sinks.size()));
+                } else {
+                    reportError("无法恢复附加输出 " + narrowUtf8(extra.id));
+                    outputIndex.push_back(-1);
                 }
-                PropVariantClear(&varName);
             }
         }
+        formatHints.clear();
+        if (!started) return false;
+        savedRate = session.output.format.sampleRate;
+        outputRate = outputFormat.sampleRate;
     }
+    startSupervisor();
 
-    // 物理输入设备（capture）
-    collection.Reset();
-    if (SUCCEEDED(enumerator->EnumAudioEndpoints(eCapture, DEVICE_STATE_ACTIVE, &collection))) {
-        UINT count = 0;
-        collection->GetCount(&count);
-        for (UINT i = 0; i < count; ++i) {
-            ComPtr<IMMDevice> dev;
-            collection->Item(i, &dev);
-            ComPtr<IPropertyStore> props;
-            if (SUCCEEDED(dev->OpenPropertyStore(STGM_READ, &props))) {
-                PROPVARIANT varName;
-                PropVariantInit(&varName);
-                if (SUCCEEDED(props->GetValue(PKEY_Device_FriendlyName, &varName))) {
-                    names.inputs.push_back(std::wstring(varName.pwszVal));
+    // 其余设置经各自的控制入口恢复（与运行中修改相同，不必停流）
+    for (size_t i = 0; i < session.sources.size(); ++i) {
+        if (sourceIndex[i] >= 0 && session.sources[i].gain != 1.0f) setSourceGain(static_cast<size_t>(sourceIndex[i]), session.sources[i].gain);
+    }
+    for (size_t i = 0; i < session.sources.size(); ++i) {
+        if (sourceIndex[i] < 0) continue;
+        const size_t source = static_cast<size_t>(sourceIndex[i]);
+        for (size_t o = 0; o < outputIndex.size(); ++o) {
+            if (outputIndex[o] < 0) continue;
+            const size_t output = static_cast<size_t>(outputIndex[o]);
+            if (i < session.routes.size() && o < session.routes[i].size()) {
+                Route route = session.routes[i][o];
+                if (savedRate != 0 && savedRate != outputRate) {
+                    route.delayFrames = static_cast<std::uint32_t>(static_cast<std::uint64_t>(route.delayFrames) * outputRate / savedRate);
                 }
-                PropVariantClear(&varName);
+                if (!setRoute(source, output, route)) reportError("无法恢复路由");
+            }
+            if (i < session.inserts.size() && o < session.inserts[i].size() && session.inserts[i][o].active()) {
+                if (!setInsert(source, output, session.inserts[i][o])) reportError("无法恢复插入效果");
             }
         }
     }
+    return true;
+}
+
+EngineSession AudioEngine::session() const {
+    std::lock_guard<CheckedMutex> lock(controlMutex);
+    EngineSession session;
+    if (!running.load(std::memory_order_acquire) || !renderStream) return session;
+    session.config = streamConfig;
+    session.config.cachedFormat = StreamFormat{};
+    session.output = SessionEndpoint{ renderId, renderStream->format(), renderStream->mode(), {} };
+    for (const auto& sink : sinks) {
+        session.extraOutputs.push_back(SessionEndpoint{ sink->id, sink->stream->format(), sink->stream->mode(), {} });
+    }
+    for (const auto& source : sources) {
+        SessionSource saved;
+        std::uint32_t processId = 0;
+        bool excludeTree = false;
+        const bool isProcess = parseProcessLoopbackId(source->id, processId, excludeTree);
+        saved.endpoint = SessionEndpoint{ source->id, source->stream->format(), source->stream->mode(), isProcess ? source->name : std::wstring() };
+        saved.gain = source->controlGain;
+        session.sources.push_back(saved);
 
-    return names;
+        std::vector<Route> routeRow;
+        std::vector<InsertSettings> insertRow;
+        for (size_t output = 0; output <= sinks.size(); ++output) {
+            const size_t column = routeColumnOf(output);
+            routeRow.push_back(routes.route(source->routeRow, column));
+            insertRow.push_back(insertSettings[source->routeRow * routes.columns() + column]);
+        }
+        session.routes.push_back(std::move(routeRow));
+        session.inserts.push_back(std::move(insertRow));
+    }
+    return session;
 }
 
-bool AudioEngine::startCopy(const std::vector<std::wstring>& inputNames, const std::wstring& outputName,const DWORD bufferMs) {
-    if (inputNames.empty()) return false;
+AudioEngine::StartupTiming AudioEngine::startupTiming() const {
+    StartupTiming timing;
+    {
+        std::lock_guard<CheckedMutex> lock(controlMutex);
+        timing.requested = startRequested;
+    }
+    const std::int64_t ns = firstFrameNs.load(std::memory_order_acquire);
+    if (ns != 0) {
+        timing.firstFrame = std::chrono::steady_clock::time_point(std::chrono::steady_clock::duration(ns));
+        timing.rendered = true;
+    }
+    return timing;
+}
 
-    std::lock_guard<std::mutex> lock(audioMutex);
+bool AudioEngine::startLocked(const std::vector<std::wstring>& inputIds, const std::wstring& outputId,
+                              const StreamConfig& config, const bool restart) {
+    streamConfig = config;
+    streamConfig.bufferMs = std::min(config.bufferMs, kMaxBufferMs);
+    // 低延迟模式不按 bufferMs 排队，只保留 render 水位加一个 capture 包
+    bufferMs = config.lowLatency ? 0 : streamConfig.bufferMs;
 
-    // 初始化枚举器
-    ComPtr<IMMDeviceEnumerator> enumerator;
-    HRESULT hr = CoCreateInstance(__uuidof(MMDeviceEnumerator), nullptr, CLSCTX_ALL, IID_PPV_ARGS(&enumerator));
-    if (FAILED(hr)) return false;
+    // 找到目标输出设备并打开 render 流（其格式即 ring 与混音的格式）
+    const auto outDev = registry.find(outputId);
+    if (!outDev || !outDev->isRender) return false;
+    renderStream = audioBackend->openRender(outDev->id, configFor(outDev->id));
+    if (!renderStream) return false;
+    renderId = outputId;
+    outputFormat = renderStream->format();
+    outputTargetFrames = renderWatermark(*renderStream);
 
-    // 找到目标输出设备
-    ComPtr<IMMDeviceCollection> collection;
-    hr = enumerator->EnumAudioEndpoints(eRender, DEVICE_STATE_ACTIVE, &collection);
+    // 每个选中的来源都在对应的 render 端点上打开一个独立的 loopback 流
+    sources.clear();
+    sinks.clear();
+    maxCapturePeriod = 0;
+    maxCapturePeriodOut = 0;
+    alignFrames = 0;
+    for (const auto& id : inputIds) {
+        const auto loopbackDev = registry.find(id);
+        if (!loopbackDev || !isLoopbackSource(*loopbackDev)) return false;
+        auto source = createSource(*loopbackDev);
+        if (!source) return false;
+        source->routeRow = sources.size();
+        sources.push_back(std::move(source));
+    }
+    // 全部接通、不带插入效果；失效后的重建由 restartLocked 恢复原来的路由与插入效果
+    routes.resetAll();
+    routes.publish();
+    insertSettings.fill(InsertSettings{});
 
-    if (FAILED(hr)) return false;
-    UINT count = 0; collection->GetCount(&count);
+    // 所有来源的周期都已知后再统一设定目标排队量
+    const uint32_t target = queueTargetFrames();
+    for (auto& source : sources) source->drift->setTarget(target);
 
-    ComPtr<IMMDevice> outDev;
-    for (UINT i = 0; i < count; ++i) {
-        ComPtr<IMMDevice> dev;
-        collection->Item(i, &dev);
-        ComPtr<IPropertyStore> props;
-        if (SUCCEEDED(dev->OpenPropertyStore(STGM_READ, &props))) {
-            PROPVARIANT varName; PropVariantInit(&varName);
-            if (SUCCEEDED(props->GetValue(PKEY_Device_FriendlyName, &varName))) {
-                if (outputName == std::wstring(varName.pwszVal)) outDev = dev;
-            }
-            PropVariantClear(&varName);
-        }
+    // 落后超过容忍范围的来源视为当前无声（loopback 端点静音时不会产生数据包）
+    mixer = std::make_unique<Mixer>(outputFormat.channels, std::max<size_t>(renderStream->bufferFrames() / 2, maxCapturePeriodOut * 2));
+    // 混音结果先写进 fanout 再分给各输出；容量按缓冲上限预留，附加输出的对齐延迟与各自的排队都放得下
+    const size_t maxBufferFrames = static_cast<size_t>(kMaxBufferMs) * outputFormat.sampleRate / 1000;
+    fanout = std::make_unique<FanoutRing>(std::max<size_t>(maxBufferFrames, renderStream->bufferFrames()) * 2, outputFormat.channels, kMaxSinks + 1);
+    outputMeter = std::make_unique<LevelMeter>(outputFormat.channels, outputFormat.sampleRate);
+    outputConcealer = std::make_unique<PacketLossConcealer>(outputFormat.channels, outputFormat.sampleRate);
+    updateLatencyReport();
+
+    size_t maxRingFrames = 0;
+    for (auto& source : sources) maxRingFrames = std::max(maxRingFrames, source->ring->capacity());
+    if (restart) stats.reconfigure(outputFormat.sampleRate, maxRingFrames);
+    else stats.reset(outputFormat.sampleRate, maxRingFrames);
+
+    // 两个音频线程都未运行：直接填好各自的处理图，清空上次遗留的命令
+    captureCount = 0;
+    renderCount = 0;
+    for (auto& source : sources) {
+        captureActive[captureCount] = source.get();
+        captureWait[captureCount++] = source->stream.get();
+        mixInputs[renderCount] = MixInput{ source->ring.get(), source->gain, source->history.get(), source->routeRow };
+        renderActive[renderCount++] = source.get();
     }
-    if (!outDev) return false;
-
-    // 激活输出客户端
-    hr = outDev->Activate(__uuidof(IAudioClient), CLSCTX_ALL, nullptr, &outputClient);
-    if (FAILED(hr)) return false;
-
-    // 获取 output 的 mix format（后续作为 render 的格式）
-    hr = outputClient->GetMixFormat(&mixFormat);
-    if (FAILED(hr) || !mixFormat) return false;
-
-    // 为演示简化：选择第一个 inputNames 中的源作为 loopback 捕获（当前代码仅支持单个 loopback 源的实际捕获）
-    // UI 已经允许多选来源并屏蔽输出候选；如果需要多源捕获与混音，这里需扩展为对每个 inputNames 激活独立 loopback client 并做混音逻辑
-    std::wstring firstInputName = inputNames[0];
-
-    // 在 render 列表中查找与 firstInputName 对应的设备，然后在该设备上 Activate IAudioClient 并 Initialize 为 loopback
-    collection.Reset();
-    hr = enumerator->EnumAudioEndpoints(eRender, DEVICE_STATE_ACTIVE, &collection);
-    if (FAILED(hr)) return false;
-    UINT renderCount = 0; collection->GetCount(&renderCount);
-    ComPtr<IMMDevice> loopbackDev;
-    for (UINT i = 0; i < renderCount; ++i) {
-        ComPtr<IMMDevice> dev;
-        collection->Item(i, &dev);
-        ComPtr<IPropertyStore> props;
-        if (SUCCEEDED(dev->OpenPropertyStore(STGM_READ, &props))) {
-            PROPVARIANT varName; PropVariantInit(&varName);
-            if (SUCCEEDED(props->GetValue(PKEY_Device_FriendlyName, &varName))) {
-                if (firstInputName == std::wstring(varName.pwszVal)) {
-                    loopbackDev = dev;
-                }
-            }
-            PropVariantClear(&varName);
+    renderSinkCount = 0;
+    masterCursor = 0;
+    renderAlign = 0;
+    queueTarget = target;
+    queueFloor = target;
+    queueCeiling = streamConfig.adaptiveBuffer ? queueCeilingFrames() : target;
+    jitterHold = 0.0;
+    crossfadeFrames = std::max<uint32_t>(1, kCrossfadeMs * outputFormat.sampleRate / 1000);
+    drainingOutput = nullptr;
+    fadeOutPending = false;
+    attachOutput(renderStream.get());
+    fadeInRemaining = restart ? crossfadeFrames : 0;
+    renderPrimed = false;
+    // 失效后的重建不算启动
+    if (!restart) {
+        renderStarted = false;
+        firstFrameNs.store(0, std::memory_order_relaxed);
+    }
+    outputLost = false;
+    outputLostNs = 0;
+    outputFailed.store(false, std::memory_order_relaxed);
+    commands.reset();
+    captureCommands.reset();
+    forwarded.reset();
+    // 两个线程都未运行，直通状态直接设好
+    passthroughPosted = passthroughEligible();
+    for (auto& source : sources) {
+        source->passthrough = passthroughPosted;
+        source->slip = 0.0;
+    }
+    renderPassthrough = passthroughPosted;
+    renderDirect = false;
+    renderRecorders.fill(nullptr);
+    insertChains.fill(nullptr);
+    renderInserts.fill(nullptr);
+    postedRecorderSwaps = 0;
+    recorderSwaps.store(0, std::memory_order_relaxed);
+
+    for (auto& source : sources) {
+        if (!source->stream->start()) {
+            reportError("无法启动来源 " + narrowUtf8(source->id));
+            stats.addError();
         }
     }
-    if (!loopbackDev) return false;
-
-    ComPtr<IAudioClient> inputClient;
-    hr = loopbackDev->Activate(__uuidof(IAudioClient), CLSCTX_ALL, nullptr, &inputClient);
-    if (FAILED(hr)) return false;
-
-    // 同步采样率/格式（若无法同步则继续，但 mixFormat 已取自 output）
-    syncSampleRate(inputClient, outputClient);
-
-    // 获取 buffer size（使用一个合理的 buffer duration，比如 bufferMs）
-    REFERENCE_TIME hnsBufferDuration = 10000 * bufferMs; // ms -> 100-ns units; 可调整
-    UINT32 bufferFrameCount = 0;
-
-    // 初始化输出 client （共享模式 + event callback）
-    hr = outputClient->Initialize(AUDCLNT_SHAREMODE_SHARED, AUDCLNT_STREAMFLAGS_EVENTCALLBACK, hnsBufferDuration, 0, mixFormat, nullptr);
-    if (FAILED(hr)) return false;
-    hr = outputClient->GetService(IID_PPV_ARGS(&renderClient));
-    if (FAILED(hr)) return false;
-    hr = outputClient->GetBufferSize(&bufferFrameCount);
-    if (FAILED(hr)) return false;
-
-    // 初始化输入 client （loopback + event callback）
-    hr = inputClient->Initialize(AUDCLNT_SHAREMODE_SHARED, AUDCLNT_STREAMFLAGS_LOOPBACK | AUDCLNT_STREAMFLAGS_EVENTCALLBACK, hnsBufferDuration, 0, mixFormat, nullptr);
-    if (FAILED(hr)) return false;
-    hr = inputClient->GetService(IID_PPV_ARGS(&captureClient));
-    if (FAILED(hr)) return false;
-
-    // 为输入注册事件（当捕获可读时被触发）
-    if (captureEvent) { CloseHandle(captureEvent); captureEvent = nullptr; }
-    captureEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
-    if (!captureEvent) return false;
-    hr = inputClient->SetEventHandle(captureEvent);
-    if (FAILED(hr)) return false;
-
-    // 为输出也注册事件（可选）
-    if (renderEvent) { CloseHandle(renderEvent); renderEvent = nullptr; }
-    renderEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
-    if (!renderEvent) return false;
-    hr = outputClient->SetEventHandle(renderEvent);
-    if (FAILED(hr)) {
-        // 若不支持则继续（不是致命）
-    }
-
-    // 保存 client 引用并开始线程
-    inputClients.clear();
-    inputClients.push_back(inputClient);
-    this->outputClient = outputClient;
-    running = true;
-
-    // 启动工作线程
+    if (!renderStream->start()) {
+        reportError("无法启动输出 " + narrowUtf8(renderId));
+        stats.addError();
+    }
+
+    // 启动 capture / render 两个工作线程
+    running.store(true, std::memory_order_release);
+    threadsReady = std::make_unique<std::latch>(2);
     captureThread = std::thread(&AudioEngine::captureLoop, this);
+    renderThread = std::thread(&AudioEngine::renderLoop, this);
 
     return true;
 }
 
-void AudioEngine::stopCopy() {
-    {
-        std::lock_guard<std::mutex> lock(audioMutex);
-        running = false;
+std::unique_ptr<CaptureStream> AudioEngine::openSourceStream(const std::wstring& id) {
+    std::uint32_t processId = 0;
+    bool excludeTree = false;
+    if (!parseProcessLoopbackId(id, processId, excludeTree)) return audioBackend->openLoopback(id, configFor(id));
+    // 进程 loopback 没有自己的格式：直接要输出的采样率与声道数，通常可以走直通路径
+    return audioBackend->openProcessLoopback(processId, excludeTree, StreamFormat{ outputFormat.sampleRate, outputFormat.channels },
+                                             streamConfig);
+}
+
+StreamConfig AudioEngine::configFor(const std::wstring& id) const {
+    StreamConfig config = streamConfig;
+    const auto hint = formatHints.find(id);
+    if (hint != formatHints.end()) {
+        config.cachedFormat = hint->second.format;
+        config.cachedMode = hint->second.mode;
+    }
+    return config;
+}
+
+std::unique_ptr<CaptureSource> AudioEngine::createSource(const DeviceInfo& device) {
+    auto source = std::make_unique<CaptureSource>();
+    source->id = device.id;
+    source->name = device.name;
+    std::unique_ptr<CaptureStream> stream = openSourceStream(device.id);
+    if (!stream) return nullptr;
+    attachCapture(*source, std::move(stream));
+
+    // ring 至少能容纳两个 render 缓冲或两个 capture 缓冲（换算到输出采样率），避免暂时写不进 render 时丢帧；
+    // 同时不小于 kMaxBufferMs，运行中调大缓冲目标也放得下
+    const size_t captureBufferOut = static_cast<size_t>(source->stream->bufferFrames()) * outputFormat.sampleRate / source->format.sampleRate + 1;
+    const size_t maxBufferFrames = static_cast<size_t>(kMaxBufferMs) * outputFormat.sampleRate / 1000;
+    const size_t ringFrames = std::max(std::max<size_t>(renderStream->bufferFrames(), captureBufferOut) * 2, maxBufferFrames);
+    source->ring = std::make_unique<SpscRing<float>>(ringFrames, outputFormat.channels);
+    // 路由延迟从历史中往回读：容量放得下最长延迟加一次混音，先垫满静音，任何延迟都有数据可读
+    source->history = std::make_unique<FanoutRing>(maxRouteDelayFrames() + kRouteBlockFrames, outputFormat.channels);
+    source->history->commitWrite(source->history->capacity());
+
+    source->drift = std::make_unique<DriftController>(outputFormat.sampleRate, static_cast<double>(queueTargetFrames()));
+    return source;
+}
+
+void AudioEngine::attachCapture(CaptureSource& source, std::unique_ptr<CaptureStream> stream) {
+    source.stream = std::move(stream);
+    source.format = source.stream->format();
+
+    // 声道数与输出不同时先上 / 下混到输出声道数，之后的重采样与 ring 都按输出声道数处理
+    const size_t captureBuffer = source.stream->bufferFrames();
+    source.remap = ChannelMatrix(source.format.channels, outputFormat.channels);
+    if (source.remap.identity()) source.remapped.clear();
+    else source.remapped.assign(captureBuffer * outputFormat.channels, 0.0f);
+
+    // 每个来源都经过重采样器：采样率不同时做转换，相同时用于漂移补偿；全部缓冲在这里一次分配好
+    source.resampler = std::make_unique<Resampler>(source.format.sampleRate, outputFormat.sampleRate, outputFormat.channels);
+    source.silence.assign(captureBuffer * outputFormat.channels, 0.0f);
+    source.meter = std::make_unique<LevelMeter>(source.format.channels, source.format.sampleRate);
+    // 丢包补偿在重采样之前进行（来源采样率、输出声道数）；新的流从头估计抖动与设备位置
+    source.concealer = std::make_unique<PacketLossConcealer>(outputFormat.channels, source.format.sampleRate);
+    source.concealed.assign(captureBuffer * outputFormat.channels, 0.0f);
+    source.positionKnown = false;
+    source.lastArrivalNs = 0;
+    source.jitterNs = 0.0;
+    source.jitterFrames.store(0.0f, std::memory_order_relaxed);
+
+    // 最长 capture 周期只增不减（移除来源后目标排队量保持不变）
+    maxCapturePeriod = std::max(maxCapturePeriod, source.stream->periodFrames());
+    maxCapturePeriodOut = std::max<size_t>(maxCapturePeriodOut,
+                                           static_cast<size_t>(source.stream->periodFrames()) * outputFormat.sampleRate / source.format.sampleRate + 1);
+}
+
+uint32_t AudioEngine::queueTargetFrames() const {
+    // 端到端排队量（ring + render padding）目标：普通模式为半个缓冲，两侧都留有余量；
+    // 自适应缓冲从下限开始，由 render 线程按实测的到达抖动往上加
+    const size_t fromBuffer = streamConfig.adaptiveBuffer ? 0 : static_cast<size_t>(bufferMs) * outputFormat.sampleRate / 2000;
+    return std::max<uint32_t>(static_cast<uint32_t>(fromBuffer), queueFloorFrames());
+}
+
+uint32_t AudioEngine::queueFloorFrames() const {
+    // 至少是 render 水位加一个 capture 包（两个线程的事件互不对齐）；
+    // 有附加输出时主输出多一段对齐延迟，来源 ring 里仍要留出一个 capture 包的余量
+    return static_cast<uint32_t>(outputTargetFrames + alignFrames + maxCapturePeriodOut);
+}
+
+uint32_t AudioEngine::queueCeilingFrames() const {
+    // 低延迟模式不按 bufferMs 排队，但自适应缓冲仍以它为上限
+    const size_t fromBuffer = static_cast<size_t>(streamConfig.bufferMs) * outputFormat.sampleRate / 2000;
+    return std::max<uint32_t>(static_cast<uint32_t>(fromBuffer), queueFloorFrames());
+}
+
+uint32_t AudioEngine::alignmentFrames() const {
+    // 附加输出要比主输出多排一个自身周期才不会欠载：主输出延迟到与最慢的附加输出对齐
+    size_t align = 0;
+    for (const auto& sink : sinks) {
+        const size_t frames = static_cast<size_t>(sink->watermark + sink->stream->periodFrames()) * outputFormat.sampleRate / sink->format.sampleRate + 1;
+        align = std::max(align, frames);
     }
+    return static_cast<uint32_t>(align);
+}
+
+std::size_t AudioEngine::freeRouteRow() const {
+    for (size_t row = 0; row < kMaxSources; ++row) {
+        if (std::none_of(sources.begin(), sources.end(), [row](const auto& source) { return source->routeRow == row; })) return row;
+    }
+    return 0;
+}
+
+std::size_t AudioEngine::freeRouteColumn() const {
+    // 第 0 列属于主输出
+    for (size_t column = 1; column <= kMaxSinks; ++column) {
+        if (std::none_of(sinks.begin(), sinks.end(), [column](const auto& sink) { return sink->routeColumn == column; })) return column;
+    }
+    return kMaxSinks;
+}
 
+std::size_t AudioEngine::routeColumnOf(const size_t output) const {
+    return output == 0 ? 0 : sinks[output - 1]->routeColumn;
+}
+
+std::uint32_t AudioEngine::maxRouteDelayFrames() const {
+    return static_cast<uint32_t>(static_cast<uint64_t>(kMaxRouteDelayMs) * outputFormat.sampleRate / 1000);
+}
+
+bool AudioEngine::passthroughEligible() const {
+    if (sources.size() != 1 || !sinks.empty() || !renderStream) return false;
+    const CaptureSource& source = *sources.front();
+    if (source.controlGain != 1.0f) return false;
+    // 与设备格式完全相同（含样本编码），同采样率因而无需重采样
+    const StreamFormat in = source.format;
+    const StreamFormat out = renderStream->format();
+    if (in.sampleRate != out.sampleRate || in.channels != out.channels || in.sample != out.sample) return false;
+    const Route& route = routes.route(source.routeRow, 0);
+    if (insertSettings[source.routeRow * routes.columns()].active()) return false;
+    return route.gain == 1.0f && route.delayFrames == 0 && !route.muted;
+}
+
+void AudioEngine::updatePassthrough() {
+    const bool eligible = passthroughEligible();
+    if (eligible == passthroughPosted || !running.load(std::memory_order_acquire)) return;
+    // 先交给 capture 线程（停用 / 恢复重采样器），再由它转发给 render 线程
+    EngineCommand command;
+    command.type = EngineCommand::Type::SetPassthrough;
+    command.source = eligible ? sources.front().get() : nullptr;
+    command.frames = eligible ? 1 : 0;
+    if (captureCommands.push(&command, 1) != 1) return;
+    passthroughPosted = eligible;
+    wakeCaptureThread();
+}
+
+void AudioEngine::updateLatencyReport() {
+    const uint32_t target = queueTargetFrames();
+    latency = LatencyReport{};
+    latency.renderMode = renderStream->mode();
+    latency.sampleRate = outputFormat.sampleRate;
+    latency.renderPeriodFrames = renderStream->periodFrames();
+    latency.renderBufferFrames = renderStream->bufferFrames();
+    latency.capturePeriodFrames = maxCapturePeriod;
+    latency.renderTargetFrames = outputTargetFrames;
+    latency.targetQueueFrames = target;
+    latency.alignFrames = alignFrames;
+    latency.estimatedLatencyMs = 1000.0 * (static_cast<double>(target) + maxCapturePeriodOut + Resampler::latencyFrames()) /
+                                 outputFormat.sampleRate;
+}
+
+void AudioEngine::stopCopy() {
+    // 先结束监督线程（它会获取 controlMutex），再停音频线程
+    supervising.store(false, std::memory_order_release);
+    wakeSupervisor();
+    if (supervisorThread.joinable()) supervisorThread.join();
+
+    std::lock_guard<CheckedMutex> lock(controlMutex);
+    stopThreads();
+    releaseStreams();
+}
+
+void AudioEngine::stopThreads() {
+    running.store(false, std::memory_order_release);
+
+    // 唤醒两个线程让其检查 running
     if (captureThread.joinable()) {
-        if (captureEvent) SetEvent(captureEvent);
+        wakeCaptureThread();
         captureThread.join();
     }
+    if (renderThread.joinable()) {
+        renderStream->signal();
+        for (auto& sink : sinks) sink->stream->signal();
+        renderThread.join();
+    }
+    threadsReady.reset();
+    releasePendingCommands();
+    reclaim();
+}
 
-    std::lock_guard<std::mutex> lock(audioMutex);
+void AudioEngine::releaseStreams() {
+    finishRecordings();
     // 停止并释放
-    if (inputClients.size() > 0) {
-        for (auto &c : inputClients) {
-            if (c) {
-                c->Stop();
-            }
+    for (auto& source : sources) {
+        source->stream->stop();
+    }
+    sources.clear();
+    for (auto& sink : sinks) {
+        sink->stream->stop();
+    }
+    sinks.clear();
+    alignFrames = 0;
+    captureCount = 0;
+    renderCount = 0;
+    renderSinkCount = 0;
+    output = nullptr;
+    mixer.reset();
+    fanout.reset();
+    // 音频线程都已退出，render 线程持有的插入效果在这里释放（队列中未执行的已由 releasePendingCommands 释放）
+    for (auto& insert : renderInserts) {
+        delete insert;
+        insert = nullptr;
+    }
+    insertChains.fill(nullptr);
+
+    if (renderStream) {
+        renderStream->stop();
+        renderStream.reset();
+    }
+}
+
+LatencyReport AudioEngine::latencyReport() const {
+    std::lock_guard<CheckedMutex> lock(controlMutex);
+    return latency;
+}
+
+AudioEngine::ErrorReport AudioEngine::lastError() const {
+    std::lock_guard<CheckedMutex> lock(errorMutex);
+    return errorState;
+}
+
+void AudioEngine::reportError(std::string message) const {
+    std::lock_guard<CheckedMutex> lock(errorMutex);
+    ++errorState.count;
+    errorState.message = std::move(message);
+}
+
+bool AudioEngine::startRecording(const size_t output, const std::filesystem::path& path, const RecorderOptions& options) {
+    std::lock_guard<CheckedMutex> lock(controlMutex);
+    reclaim();
+    if (!running.load(std::memory_order_acquire) || output > sinks.size()) return false;
+    const size_t column = routeColumnOf(output);
+    stopRecordingLocked(column);
+
+    auto recorder = std::make_unique<Recorder>();
+    std::string error;
+    if (!recorder->start(path, outputFormat, options, error)) {
+        reportError("无法开始录音：" + error);
+        return false;
+    }
+    EngineCommand command;
+    command.type = EngineCommand::Type::SetRecorder;
+    command.recorder = recorder.get();
+    command.frames = static_cast<uint32_t>(column);
+    if (!postCommandLocked(command)) return false;
+    ++postedRecorderSwaps;
+    recorders[column] = std::move(recorder);
+    return true;
+}
+
+bool AudioEngine::stopRecording(const size_t output) {
+    std::lock_guard<CheckedMutex> lock(controlMutex);
+    reclaim();
+    if (output > sinks.size() || !running.load(std::memory_order_acquire)) return false;
+    const size_t column = routeColumnOf(output);
+    if (!recorders[column]) return false;
+    stopRecordingLocked(column);
+    return true;
+}
+
+void AudioEngine::stopRecordingLocked(const size_t column) {
+    std::unique_ptr<Recorder> recorder = std::move(recorders[column]);
+    if (!recorder) return;
+    EngineCommand command;
+    command.type = EngineCommand::Type::SetRecorder;
+    command.frames = static_cast<uint32_t>(column);
+    bool detached = false;
+    if (postCommandLocked(command)) {
+        ++postedRecorderSwaps;
+        // render 线程执行到这条命令后不会再推送，此后才能写完文件
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(kRecorderDetachMs);
+        while (!(detached = recorderSwaps.load(std::memory_order_acquire) >= postedRecorderSwaps) &&
+               std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
         }
-        inputClients.clear();
     }
-    if (outputClient) {
-        outputClient->Stop();
-        renderClient.Reset();
-        outputClient.Reset();
+    if (detached) recorder->finish();
+    else orphanedRecorders.push_back(std::move(recorder));
+}
+
+void AudioEngine::finishRecordings() {
+    for (auto& recorder : recorders) recorder.reset();
+    orphanedRecorders.clear();
+    renderRecorders.fill(nullptr);
+}
+
+std::vector<RecorderStatus> AudioEngine::recordingStatus() const {
+    std::lock_guard<CheckedMutex> lock(controlMutex);
+    std::vector<RecorderStatus> result;
+    if (!running.load(std::memory_order_acquire)) return result;
+    for (size_t output = 0; output <= sinks.size(); ++output) {
+        const auto& recorder = recorders[routeColumnOf(output)];
+        result.push_back(recorder ? recorder->status() : RecorderStatus{});
     }
-    captureClient.Reset();
+    return result;
+}
 
-    if (captureEvent) { CloseHandle(captureEvent); captureEvent = nullptr; }
-    if (renderEvent) { CloseHandle(renderEvent); renderEvent = nullptr; }
+EngineMeters AudioEngine::meters() {
+    std::lock_guard<CheckedMutex> lock(controlMutex);
+    EngineMeters result;
+    if (!running.load(std::memory_order_acquire)) return result;
+    // 读者一侧由 controlMutex 串行化；过期的读数按静音返回（声道数保留）
+    const uint64_t now = audioBackend->nowNs();
+    const uint64_t staleNs = static_cast<uint64_t>(kMeterStaleMs) * 1000000ull;
+    const auto take = [&](LevelMeter& meter) {
+        MeterReading reading = meter.read();
+        reading.channels = static_cast<uint32_t>(meter.channels());
+        if (reading.timeNs == 0 || now > reading.timeNs + staleNs) {
+            reading.peak.fill(0.0f);
+            reading.rms.fill(0.0f);
+            reading.truePeak.fill(0.0f);
+        }
+        return reading;
+    };
+    for (auto& source : sources) result.sources.push_back(take(*source->meter));
+    result.outputs.push_back(take(*outputMeter));
+    for (auto& sink : sinks) result.outputs.push_back(take(*sink->meter));
+    return result;
 }
 
-void AudioEngine::captureLoop() {
-    // 快速检查
-    if (inputClients.empty() || !renderClient || !captureClient || !outputClient) return;
+std::vector<std::wstring> AudioEngine::sourceIds() const {
+    std::lock_guard<CheckedMutex> lock(controlMutex);
+    std::vector<std::wstring> ids;
+    for (const auto& source : sources) ids.push_back(source->id);
+    return ids;
+}
 
-    // 提升线程优先级（MMCSS）
-    DWORD mmcssTaskIndex = 0;
-    HANDLE mmHandle = nullptr;
-    mmHandle = AvSetMmThreadCharacteristicsA("Pro Audio", &mmcssTaskIndex);
-    if (!mmHandle) {
-        // 备用策略：设置线程为实时优先
-        SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL);
+std::wstring AudioEngine::outputId() const {
+    std::lock_guard<CheckedMutex> lock(controlMutex);
+    return renderId;
+}
+
+std::vector<std::wstring> AudioEngine::additionalOutputIds() const {
+    std::lock_guard<CheckedMutex> lock(controlMutex);
+    std::vector<std::wstring> ids;
+    for (const auto& sink : sinks) ids.push_back(sink->id);
+    return ids;
+}
+
+bool AudioEngine::setSourceGain(const size_t index, const float gain) {
+    std::lock_guard<CheckedMutex> lock(controlMutex);
+    reclaim();
+    if (index >= sources.size()) return false;
+    EngineCommand command;
+    command.type = EngineCommand::Type::SetGain;
+    command.source = sources[index].get();
+    command.gain = gain;
+    if (!postCommandLocked(command)) return false;
+    sources[index]->controlGain = gain;
+    updatePassthrough();
+    return true;
+}
+
+bool AudioEngine::addSource(const std::wstring& deviceId) {
+    std::lock_guard<CheckedMutex> lock(controlMutex);
+    reclaim();
+    if (!running.load(std::memory_order_acquire) || sources.size() >= kMaxSources) return false;
+    for (const auto& source : sources) {
+        if (source->id == deviceId) return false;
     }
 
-    auto inClient = inputClients[0].Get();
-    HRESULT hr = inClient->Start();
-    if (FAILED(hr)) {
-        std::cerr << "Failed to start input client: " << std::hex << hr << std::endl;
+    const auto loopbackDev = registry.find(deviceId);
+    if (!loopbackDev || !isLoopbackSource(*loopbackDev)) return false;
+    auto source = createSource(*loopbackDev);
+    if (!source) return false;
+    // 新来源在每个输出上都接通
+    source->routeRow = freeRouteRow();
+    routes.resetRow(source->routeRow);
+    routes.publish();
+    for (size_t column = 0; column < routes.columns(); ++column) clearInsertLocked(source->routeRow, column);
+
+    // 先垫上与其他来源大致相同的排队量（静音），加入混音时不会拖住其他来源
+    const uint32_t target = queueTargetFrames();
+    source->ring->pushSilence(target > outputTargetFrames ? target - outputTargetFrames : 0);
+
+    if (!source->stream->start()) {
+        reportError("无法启动来源 " + narrowUtf8(source->id));
+        return false;
     }
-    hr = outputClient->Start();
-    if (FAILED(hr)) {
-        std::cerr << "Failed to start output client: " << std::hex << hr << std::endl;
+    EngineCommand command;
+    command.type = EngineCommand::Type::AddSource;
+    command.source = source.get();
+    if (captureCommands.push(&command, 1) != 1) return false;
+    // 唤醒 capture 线程尽快接入新来源
+    wakeCaptureThread();
+    sources.push_back(std::move(source));
+    updatePassthrough();
+
+    // 新来源的周期可能更长，目标排队量随之调整
+    postQueueTarget();
+    updateLatencyReport();
+    return true;
+}
+
+bool AudioEngine::removeSource(const std::wstring& deviceId) {
+    std::lock_guard<CheckedMutex> lock(controlMutex);
+    reclaim();
+    if (!running.load(std::memory_order_acquire) || sources.size() <= 1) return false;
+    const auto it = std::find_if(sources.begin(), sources.end(), [&](const auto& source) { return source->id == deviceId; });
+    if (it == sources.end()) return false;
+
+    EngineCommand command;
+    command.type = EngineCommand::Type::RemoveSource;
+    command.source = it->get();
+    if (captureCommands.push(&command, 1) != 1) return false;
+    // 此后由音频线程摘下，render 线程交回收队列后在 reclaim 中释放
+    it->release();
+    sources.erase(it);
+    updatePassthrough();
+    wakeCaptureThread();
+    return true;
+}
+
+bool AudioEngine::retargetOutput(const std::wstring& deviceId) {
+    std::lock_guard<CheckedMutex> lock(controlMutex);
+    reclaim();
+    if (!running.load(std::memory_order_acquire)) return false;
+    if (deviceId == renderId) return true;
+    // 已是附加输出的设备不能再作主输出（先移除附加输出）
+    for (const auto& sink : sinks) {
+        if (sink->id == deviceId) return false;
     }
 
-    // 获取 buffer size
-    UINT32 renderBufferFrames = 0;
-    outputClient->GetBufferSize(&renderBufferFrames);
+    // 新的 render 流在这里打开并启动（耗时的设备初始化不在音频线程中进行）
+    const auto outDev = registry.find(deviceId);
+    if (!outDev || !outDev->isRender) return false;
+    std::unique_ptr<RenderStream> next = audioBackend->openRender(outDev->id, streamConfig);
+    if (!next) return false;
+    const StreamFormat format = next->format();
+    if (format.sampleRate != outputFormat.sampleRate || format.channels != outputFormat.channels) return false;
+    if (!next->start()) {
+        reportError("无法启动输出 " + narrowUtf8(deviceId));
+        return false;
+    }
 
-    // 主循环：等待 captureEvent（事件驱动）
-    while (true) {
-        {
-            std::lock_guard<std::mutex> lock(audioMutex);
-            if (!running) break;
-        }
+    EngineCommand command;
+    command.type = EngineCommand::Type::SwitchOutput;
+    command.output = next.get();
+    command.previousOutput = renderStream.get();
+    // 当前输出已失效时，切走即等于恢复：先清除标记，新输出若再失效由 render 线程重新置位
+    const bool wasFailed = outputFailed.exchange(false, std::memory_order_acq_rel);
+    if (!postCommandLocked(command)) {
+        if (wasFailed) outputFailed.store(true, std::memory_order_release);
+        return false;
+    }
+    // 旧输出此后归 render 线程：淡出并播完后交回收队列（失效的旧输出直接回收）
+    // render 线程可能正在等待失效的旧输出，在回收之前唤醒它
+    RenderStream* previous = renderStream.release();
+    if (wasFailed) previous->signal();
+    renderStream = std::move(next);
+    renderId = deviceId;
+    outputTargetFrames = renderWatermark(*renderStream);
+    // 新设备的样本编码可能不同
+    updatePassthrough();
 
-        DWORD waitResult = WaitForSingleObject(captureEvent, 2000); // 超时 2s 保守值
-        if (waitResult == WAIT_TIMEOUT) {
-            // 长时间未被唤醒，检查 running 并继续
-            continue;
-        } else if (waitResult != WAIT_OBJECT_0) {
-            // 错误，退出
-            break;
+    postQueueTarget();
+    updateLatencyReport();
+    return true;
+}
+
+bool AudioEngine::setBufferMs(const std::uint32_t ms) {
+    std::lock_guard<CheckedMutex> lock(controlMutex);
+    reclaim();
+    if (!running.load(std::memory_order_acquire)) return false;
+    bufferMs = std::min(ms, kMaxBufferMs);
+    streamConfig.bufferMs = bufferMs;
+    if (!postQueueTarget()) return false;
+    updateLatencyReport();
+    return true;
+}
+
+bool AudioEngine::setRoute(const size_t source, const size_t output, const Route& route) {
+    std::lock_guard<CheckedMutex> lock(controlMutex);
+    reclaim();
+    if (!running.load(std::memory_order_acquire) || source >= sources.size() || output > sinks.size()) return false;
+    Route clamped = route;
+    clamped.delayFrames = std::min(route.delayFrames, maxRouteDelayFrames());
+    routes.setRoute(sources[source]->routeRow, routeColumnOf(output), clamped);
+    routes.publish();
+    updatePassthrough();
+    return true;
+}
+
+Route AudioEngine::route(const size_t source, const size_t output) const {
+    std::lock_guard<CheckedMutex> lock(controlMutex);
+    if (source >= sources.size() || output > sinks.size()) return Route{};
+    return routes.route(sources[source]->routeRow, routeColumnOf(output));
+}
+
+bool AudioEngine::setInsert(const size_t source, const size_t output, const InsertSettings& settings) {
+    std::lock_guard<CheckedMutex> lock(controlMutex);
+    reclaim();
+    if (!running.load(std::memory_order_acquire) || source >= sources.size() || output > sinks.size()) return false;
+    return setInsertLocked(sources[source]->routeRow, routeColumnOf(output), settings);
+}
+
+InsertSettings AudioEngine::insert(const size_t source, const size_t output) const {
+    std::lock_guard<CheckedMutex> lock(controlMutex);
+    if (source >= sources.size() || output > sinks.size()) return InsertSettings{};
+    return insertSettings[sources[source]->routeRow * routes.columns() + routeColumnOf(output)];
+}
+
+bool AudioEngine::setInsertLocked(const size_t row, const size_t column, const InsertSettings& settings) {
+    const size_t cell = row * routes.columns() + column;
+    InsertChain* chain = insertChains[cell];
+    if (chain) {
+        // 已在 render 线程上：只投递参数，由它平滑过渡（render 线程来不及取走时返回 false）
+        if ((insertSettings[cell].active() || settings.active()) && !chain->post(settings)) return false;
+    } else if (settings.active()) {
+        // 第一次打开：效果链在这里按输出格式分配好，带着参数交给 render 线程
+        auto created = std::make_unique<InsertChain>(outputFormat.channels, outputFormat.sampleRate, kRouteBlockFrames);
+        created->post(settings);
+        EngineCommand command;
+        command.type = EngineCommand::Type::SetInsert;
+        command.insert = created.get();
+        command.frames = static_cast<uint32_t>(cell);
+        if (!postCommandLocked(command)) return false;
+        insertChains[cell] = created.release();
+    }
+    insertSettings[cell] = settings;
+    updatePassthrough();
+    return true;
+}
+
+void AudioEngine::clearInsertLocked(const size_t row, const size_t column) {
+    const size_t cell = row * routes.columns() + column;
+    insertSettings[cell] = InsertSettings{};
+    InsertChain* chain = insertChains[cell];
+    if (!chain) return;
+    // 矩阵的行 / 列换给新的来源或输出：摘下旧的效果链，不把它的状态带过去
+    EngineCommand command;
+    command.type = EngineCommand::Type::SetInsert;
+    command.frames = static_cast<uint32_t>(cell);
+    if (postCommandLocked(command)) insertChains[cell] = nullptr;
+    else chain->post(InsertSettings{});   // 命令队列满：留在原处，参数回到直通
+}
+
+bool AudioEngine::addOutput(const std::wstring& deviceId) {
+    std::lock_guard<CheckedMutex> lock(controlMutex);
+    reclaim();
+    if (!running.load(std::memory_order_acquire)) return false;
+    return addOutputLocked(deviceId);
+}
+
+bool AudioEngine::addOutputLocked(const std::wstring& deviceId) {
+    if (deviceId == renderId || sinks.size() >= kMaxSinks) return false;
+    for (const auto& sink : sinks) {
+        if (sink->id == deviceId) return false;
+    }
+    const auto device = registry.find(deviceId);
+    if (!device || !device->isRender) return false;
+    auto sink = createSink(*device);
+    if (!sink) return false;
+    // 新输出接收全部来源
+    sink->routeColumn = freeRouteColumn();
+    routes.resetColumn(sink->routeColumn);
+    routes.publish();
+    for (size_t row = 0; row < routes.rows(); ++row) clearInsertLocked(row, sink->routeColumn);
+
+    sinks.push_back(std::move(sink));
+    const uint32_t align = alignmentFrames();
+    EngineCommand command;
+    command.type = EngineCommand::Type::AddOutput;
+    command.sink = sinks.back().get();
+    command.frames = align;
+    if (!postCommandLocked(command)) {
+        sinks.back()->stream->stop();
+        sinks.pop_back();
+        return false;
+    }
+    alignFrames = align;
+    updatePassthrough();
+    // 主输出的对齐延迟计入目标排队量，来源 ring 的余量不变
+    postQueueTarget();
+    updateLatencyReport();
+    return true;
+}
+
+bool AudioEngine::removeOutput(const std::wstring& deviceId) {
+    std::lock_guard<CheckedMutex> lock(controlMutex);
+    reclaim();
+    if (!running.load(std::memory_order_acquire)) return false;
+    const auto it = std::find_if(sinks.begin(), sinks.end(), [&](const auto& sink) { return sink->id == deviceId; });
+    if (it == sinks.end()) return false;
+
+    stopRecordingLocked((*it)->routeColumn);
+    std::unique_ptr<OutputSink> removed = std::move(*it);
+    sinks.erase(it);
+    EngineCommand command;
+    command.type = EngineCommand::Type::RemoveOutput;
+    command.sink = removed.get();
+    command.frames = alignmentFrames();
+    if (!postCommandLocked(command)) {
+        sinks.push_back(std::move(removed));
+        return false;
+    }
+    // 此后归 render 线程，摘下后交回收队列
+    removed.release();
+    alignFrames = command.frames;
+    updatePassthrough();
+    postQueueTarget();
+    updateLatencyReport();
+    return true;
+}
+
+std::unique_ptr<OutputSink> AudioEngine::createSink(const DeviceInfo& device) {
+    auto sink = std::make_unique<OutputSink>();
+    sink->id = device.id;
+    sink->stream = audioBackend->openRender(device.id, configFor(device.id));
+    if (!sink->stream) return nullptr;
+    sink->format = sink->stream->format();
+    sink->watermark = renderWatermark(*sink->stream);
+
+    // 先按主输出声道重采样到本设备采样率，声道数不同时再混到本设备声道；缓冲按设备缓冲一次分配好
+    const size_t bufferFrames = sink->stream->bufferFrames();
+    sink->resampler = std::make_unique<Resampler>(outputFormat.sampleRate, sink->format.sampleRate, outputFormat.channels);
+    sink->remap = ChannelMatrix(outputFormat.channels, sink->format.channels);
+    if (!sink->remap.identity()) sink->scratch.assign(bufferFrames * outputFormat.channels, 0.0f);
+    // 与主输出的排队量之差控制到 0：要逐样本对齐，增益比来源的控制器高得多（约 1 s 收敛，临界阻尼）
+    DriftController::Params params;
+    params.kp = 1.0;
+    params.ki = 0.25;
+    params.smoothingSec = 0.1;
+    sink->drift = std::make_unique<DriftController>(outputFormat.sampleRate, 0.0, params);
+    sink->fadeInRemaining = crossfadeFrames;
+    sink->meter = std::make_unique<LevelMeter>(sink->format.channels, sink->format.sampleRate);
+    sink->concealer = std::make_unique<PacketLossConcealer>(sink->format.channels, sink->format.sampleRate);
+
+    if (!sink->stream->start()) {
+        reportError("无法启动附加输出 " + narrowUtf8(device.id));
+        return nullptr;
+    }
+    return sink;
+}
+
+std::size_t AudioEngine::failedStreams() const {
+    std::lock_guard<CheckedMutex> lock(controlMutex);
+    if (!running.load(std::memory_order_acquire)) return 0;
+    std::size_t count = outputFailed.load(std::memory_order_acquire) ? 1 : 0;
+    for (const auto& source : sources) {
+        if (source->failed.load(std::memory_order_acquire)) ++count;
+    }
+    for (const auto& sink : sinks) {
+        if (sink->failed.load(std::memory_order_acquire)) ++count;
+    }
+    return count;
+}
+
+void AudioEngine::wakeCaptureThread() {
+    // 任一来源的事件都能唤醒 capture 线程；失效的来源在恢复命令生效前仍在等待旧流
+    for (auto& source : sources) {
+        source->stream->signal();
+        if (source->failedStream) source->failedStream->signal();
+    }
+}
+
+void AudioEngine::wakeSupervisor() {
+    supervisorWake.fetch_add(1, std::memory_order_release);
+    supervisorWake.notify_one();
+}
+
+void AudioEngine::superviseLoop() {
+    uint32_t seen = supervisorWake.load(std::memory_order_acquire);
+    bool pending = false;
+    while (supervising.load(std::memory_order_acquire)) {
+        if (!pending) {
+            supervisorWake.wait(seen, std::memory_order_acquire);
+        } else {
+            // 还有没恢复的流（设备暂时不存在）：隔一段时间再试，期间仍响应唤醒与停止
+            for (uint32_t waited = 0; waited < kRecoveryRetryMs && supervisorWake.load(std::memory_order_acquire) == seen; waited += 10) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            }
         }
+        seen = supervisorWake.load(std::memory_order_acquire);
+        if (!supervising.load(std::memory_order_acquire)) break;
+        pending = !recoverStreams();
+    }
+}
 
-        // 处理所有可用包
-        UINT32 packetLength = 0;
-        hr = captureClient->GetNextPacketSize(&packetLength);
-        while (SUCCEEDED(hr) && packetLength > 0) {
-            BYTE* data = nullptr;
-            UINT32 framesAvailable = 0;
-            DWORD flags = 0;
-            hr = captureClient->GetBuffer(&data, &framesAvailable, &flags, nullptr, nullptr);
-            if (FAILED(hr)) {
-                std::cerr << "GetBuffer failed: " << std::hex << hr << std::endl;
-                break;
+bool AudioEngine::recoverStreams() {
+    std::lock_guard<CheckedMutex> lock(controlMutex);
+    reclaim();
+    if (!running.load(std::memory_order_acquire)) return true;
+
+    bool recovered = true;
+    if (outputFailed.load(std::memory_order_acquire)) recovered = recoverOutput();
+    // 输出格式改变时 recoverOutput 会整体重建，此时 sources 已是新的一组
+    for (auto& source : sources) {
+        if (source->failed.load(std::memory_order_acquire) && !recoverSource(*source)) recovered = false;
+    }
+    for (size_t i = 0; i < sinks.size(); ++i) {
+        if (sinks[i]->failed.load(std::memory_order_acquire) && !recoverSink(i)) recovered = false;
+    }
+    return recovered;
+}
+
+bool AudioEngine::recoverOutput() {
+    std::unique_ptr<RenderStream> next = audioBackend->openRender(renderId, streamConfig);
+    if (!next) return false;
+    const StreamFormat format = next->format();
+    if (format.sampleRate != outputFormat.sampleRate || format.channels != outputFormat.channels) {
+        next.reset();
+        return restartLocked();
+    }
+    if (!next->start()) return false;
+
+    // 与切换输出相同：render 线程直接回收失效的旧输出，新输出从静音淡入
+    EngineCommand command;
+    command.type = EngineCommand::Type::SwitchOutput;
+    command.output = next.get();
+    command.previousOutput = renderStream.get();
+    outputFailed.store(false, std::memory_order_release);
+    if (!postCommandLocked(command)) {
+        outputFailed.store(true, std::memory_order_release);
+        return false;
+    }
+    // render 线程正在等待旧输出（事件不会再触发），唤醒它接上新输出
+    RenderStream* previous = renderStream.release();
+    previous->signal();
+    renderStream = std::move(next);
+    outputTargetFrames = renderWatermark(*renderStream);
+    updatePassthrough();
+
+    postQueueTarget();
+    updateLatencyReport();
+    return true;
+}
+
+bool AudioEngine::recoverSource(CaptureSource& source) {
+    // 设备仍不存在或暂时打不开时稍后重试
+    std::unique_ptr<CaptureStream> stream = openSourceStream(source.id);
+    if (!stream) return false;
+    if (!stream->start()) return false;
+
+    // capture 线程不再读取失效的来源，新的流、重采样器可以直接换上；
+    // 旧流留到下次恢复时释放（capture 线程在恢复命令生效前仍在等待它）
+    source.failedStream = std::move(source.stream);
+    attachCapture(source, std::move(stream));
+
+    // ring 中原有的数据照常播完，再垫上静音补足目标排队量，接回后不会拖住其他来源
+    const size_t target = queueTargetFrames();
+    const size_t queued = source.ring->readAvailable() + outputTargetFrames;
+    if (target > queued) source.ring->pushSilence(target - queued);
+
+    EngineCommand command;
+    command.type = EngineCommand::Type::ResumeSource;
+    command.source = &source;
+    source.failed.store(false, std::memory_order_release);
+    if (captureCommands.push(&command, 1) != 1) {
+        source.stream = std::move(source.failedStream);
+        source.failed.store(true, std::memory_order_release);
+        return false;
+    }
+    source.failedStream->signal();
+    // 新设备的格式可能不同
+    updatePassthrough();
+
+    // 新流的周期可能更长
+    postQueueTarget();
+    updateLatencyReport();
+    return true;
+}
+
+bool AudioEngine::recoverSink(const size_t index) {
+    // 附加输出有自己的重采样器，格式变了也可以直接换上：打开一个新的 OutputSink 替换失效的那个
+    const auto device = registry.find(sinks[index]->id);
+    if (!device || !device->isRender) return false;
+    std::unique_ptr<OutputSink> next = createSink(*device);
+    if (!next) return false;
+    // failed 置位之前 render 线程已写好 lostNs，此后不再访问失效的对象
+    next->lostNs = sinks[index]->lostNs;
+    // 沿用原来的列，路由不变
+    next->routeColumn = sinks[index]->routeColumn;
+
+    EngineCommand remove;
+    remove.type = EngineCommand::Type::RemoveOutput;
+    remove.sink = sinks[index].get();
+    EngineCommand add;
+    add.type = EngineCommand::Type::AddOutput;
+    add.sink = next.get();
+    std::unique_ptr<OutputSink> previous = std::move(sinks[index]);
+    sinks[index] = std::move(next);
+    add.frames = remove.frames = alignmentFrames();
+    if (commands.writeAvailable() < 2 || !postCommandLocked(remove)) {
+        sinks[index]->stream->stop();
+        sinks[index] = std::move(previous);
+        return false;
+    }
+    postCommandLocked(add);
+    previous.release();
+    alignFrames = add.frames;
+    postQueueTarget();
+    updateLatencyReport();
+    return true;
+}
+
+bool AudioEngine::restartLocked() {
+    // 输出的采样率或声道数变了：ring、重采样器与混音都按输出格式建立，只能按原来的来源、输出与设置整体重建
+    std::vector<std::wstring> ids;
+    for (const auto& source : sources) ids.push_back(source->id);
+    std::vector<std::wstring> sinkIds;
+    for (const auto& sink : sinks) sinkIds.push_back(sink->id);
+    // 各来源到主输出与各附加输出的路由（按来源顺序，每行 1 + sinkIds.size() 个）
+    std::vector<Route> savedRoutes;
+    for (const auto& source : sources) {
+        savedRoutes.push_back(routes.route(source->routeRow, 0));
+        for (const auto& sink : sinks) savedRoutes.push_back(routes.route(source->routeRow, sink->routeColumn));
+    }
+    // 插入效果参数按同样的顺序
+    std::vector<InsertSettings> savedInserts;
+    for (const auto& source : sources) {
+        savedInserts.push_back(insertSettings[source->routeRow * routes.columns()]);
+        for (const auto& sink : sinks) savedInserts.push_back(insertSettings[source->routeRow * routes.columns() + sink->routeColumn]);
+    }
+    const std::wstring outputDevice = renderId;
+    const StreamConfig config = streamConfig;
+
+    stopThreads();
+    // 音频线程都已退出，可以直接读取它们持有的状态
+    std::vector<float> gains;
+    for (const auto& source : sources) gains.push_back(source->gain);
+    const uint64_t lostNs = outputLostNs;
+    releaseStreams();
+
+    if (!startLocked(ids, outputDevice, config, true)) {
+        reportError("输出格式改变后无法重新打开流，已停止");
+        stats.addError();
+        return false;
+    }
+    for (size_t i = 0; i < gains.size() && i < sources.size(); ++i) {
+        if (gains[i] == 1.0f) continue;
+        EngineCommand command;
+        command.type = EngineCommand::Type::SetGain;
+        command.source = sources[i].get();
+        command.gain = gains[i];
+        if (postCommandLocked(command)) sources[i]->controlGain = gains[i];
+    }
+    // 附加输出按新的主输出格式重新建立（暂时打不开的就此放弃）
+    for (const auto& id : sinkIds) {
+        if (!addOutputLocked(id)) reportError("无法重新打开附加输出 " + narrowUtf8(id));
+    }
+    // 路由照旧（延迟按帧数保留）；没能重新打开的附加输出跳过
+    const size_t stride = 1 + sinkIds.size();
+    for (size_t i = 0; i < sources.size() && (i + 1) * stride <= savedRoutes.size(); ++i) {
+        routes.setRoute(sources[i]->routeRow, 0, savedRoutes[i * stride]);
+        for (size_t j = 0; j < sinkIds.size(); ++j) {
+            for (const auto& sink : sinks) {
+                if (sink->id == sinkIds[j]) routes.setRoute(sources[i]->routeRow, sink->routeColumn, savedRoutes[i * stride + 1 + j]);
             }
+        }
+    }
+    routes.publish();
+    // 插入效果按新的输出格式重新建立
+    for (size_t i = 0; i < sources.size() && (i + 1) * stride <= savedInserts.size(); ++i) {
+        setInsertLocked(sources[i]->routeRow, 0, savedInserts[i * stride]);
+        for (size_t j = 0; j < sinkIds.size(); ++j) {
+            for (const auto& sink : sinks) {
+                if (sink->id == sinkIds[j]) setInsertLocked(sources[i]->routeRow, sink->routeColumn, savedInserts[i * stride + 1 + j]);
+            }
+        }
+    }
+    updatePassthrough();
+    if (lostNs != 0) {
+        const uint64_t now = audioBackend->nowNs();
+        stats.recordRecovery(now > lostNs ? now - lostNs : 0);
+    }
+    return true;
+}
 
-            // 计算字节
-            size_t bytesPerFrame = mixFormat->nBlockAlign;
-            size_t bytesToCopy = static_cast<size_t>(framesAvailable) * bytesPerFrame;
+bool AudioEngine::postQueueTarget() {
+    EngineCommand command;
+    command.type = EngineCommand::Type::SetQueueTarget;
+    command.frames = queueTargetFrames();
+    command.maxFrames = streamConfig.adaptiveBuffer ? queueCeilingFrames() : command.frames;
+    return postCommandLocked(command);
+}
 
-            // 获取 render 的当前填充来决定能写多少帧
-            UINT32 padding = 0;
-            outputClient->GetCurrentPadding(&padding);
-            UINT32 framesAvailableForWrite = 0;
-            if (renderBufferFrames > padding) framesAvailableForWrite = renderBufferFrames - padding;
-            else framesAvailableForWrite = 0;
+bool AudioEngine::postCommand(const EngineCommand& command) {
+    std::lock_guard<CheckedMutex> lock(controlMutex);
+    reclaim();
+    return postCommandLocked(command);
+}
 
-            UINT32 framesToWrite = std::min<UINT32>(framesAvailable, framesAvailableForWrite);
+bool AudioEngine::postCommandLocked(const EngineCommand& command) {
+    if (!running.load(std::memory_order_acquire)) return false;
+    return commands.push(&command, 1) == 1;
+}
 
-            // 如果无法写入任何帧（render 缓冲已满），则选择丢弃或稍等
-            if (framesToWrite == 0) {
-                // 释放 capture buffer（避免死锁），但仍要读取并丢弃数据（防止下次事件无限增长）
-                captureClient->ReleaseBuffer(framesAvailable);
-                // 继续处理下一个包或等待
+void AudioEngine::applyCaptureCommands() {
+    EngineCommand command;
+    while (captureCommands.pop(&command, 1) == 1) {
+        switch (command.type) {
+        case EngineCommand::Type::AddSource:
+            if (captureCount < kMaxSources) {
+                captureActive[captureCount] = command.source;
+                captureWait[captureCount++] = command.source->stream.get();
+            }
+            break;
+        case EngineCommand::Type::RemoveSource:
+            for (size_t i = 0; i < captureCount; ++i) {
+                if (captureActive[i] != command.source) continue;
+                for (size_t j = i + 1; j < captureCount; ++j) {
+                    captureActive[j - 1] = captureActive[j];
+                    captureWait[j - 1] = captureWait[j];
+                }
+                --captureCount;
                 break;
             }
-
-            // 获取输出缓冲
-            BYTE* outBuf = nullptr;
-            hr = renderClient->GetBuffer(framesToWrite, &outBuf);
-            if (FAILED(hr)) {
-                // 无法获得渲染缓冲，释放输入并中断
-                captureClient->ReleaseBuffer(framesAvailable);
+            break;
+        case EngineCommand::Type::SetPassthrough:
+            // 退出直通时重采样器从空历史重新开始（停用期间的历史已过时）
+            for (size_t i = 0; i < captureCount; ++i) {
+                CaptureSource* source = captureActive[i];
+                const bool on = command.frames != 0 && source == command.source;
+                if (source->passthrough && !on) source->resampler->reset();
+                if (on && !source->passthrough) source->slip = 0.0;
+                source->passthrough = on;
+            }
+            break;
+        case EngineCommand::Type::ResumeSource:
+            // 改为等待新流；重采样器是新建的，写入 ring 的前几帧淡入
+            for (size_t i = 0; i < captureCount; ++i) {
+                if (captureActive[i] != command.source) continue;
+                captureWait[i] = command.source->stream.get();
+                command.source->streamLost = false;
+                command.source->fadeInRemaining = crossfadeFrames;
                 break;
             }
+            break;
+        default:
+            break;
+        }
+        // render 线程随后接入 / 摘下同一个来源；队列满时只能放弃（被移除的来源随之泄漏，不在音频线程里释放）
+        if (forwarded.push(&command, 1) == 0) stats.addError();
+    }
+}
 
-            // 确保不会越界：仅复制 framesToWrite * bytesPerFrame
-            size_t bytesToActuallyCopy = static_cast<size_t>(framesToWrite) * bytesPerFrame;
+void AudioEngine::applyCommands() {
+    // 先处理 capture 线程转发的增删：控制线程在 RemoveSource 之前投递的命令此时一定可见，
+    // 下面按来源是否仍在处理图中判断，不会访问已摘下的来源
+    EngineCommand command;
+    while (forwarded.pop(&command, 1) == 1) {
+        if (command.type == EngineCommand::Type::AddSource && renderCount < kMaxSources) {
+            command.source->drift->setTarget(queueTarget);
+            mixInputs[renderCount] = MixInput{ command.source->ring.get(), command.source->gain, command.source->history.get(), command.source->routeRow };
+            renderActive[renderCount++] = command.source;
+        } else if (command.type == EngineCommand::Type::SetPassthrough) {
+            renderPassthrough = command.frames != 0;
+        } else if (command.type == EngineCommand::Type::ResumeSource) {
+            // 新设备的时钟不同，排队量也重新垫过：漂移控制从头开始
+            for (size_t i = 0; i < renderCount; ++i) {
+                if (renderActive[i] == command.source) renderActive[i]->drift->reset();
+            }
+        } else if (command.type == EngineCommand::Type::RemoveSource) {
+            for (size_t i = 0; i < renderCount; ++i) {
+                if (renderActive[i] != command.source) continue;
+                for (size_t j = i + 1; j < renderCount; ++j) {
+                    renderActive[j - 1] = renderActive[j];
+                    mixInputs[j - 1] = mixInputs[j];
+                }
+                --renderCount;
+                break;
+            }
+            retire(command.source);
+        }
+    }
 
-            if (flags & AUDCLNT_BUFFERFLAGS_SILENT) {
-                // 如果输入是 silent，写零
-                memset(outBuf, 0, bytesToActuallyCopy);
-            } else {
-                // 直接 memcpy（假设格式兼容）
-                memcpy(outBuf, data, bytesToActuallyCopy);
+    while (commands.pop(&command, 1) == 1) {
+        switch (command.type) {
+        case EngineCommand::Type::SetGain:
+            for (size_t i = 0; i < renderCount; ++i) {
+                if (renderActive[i] != command.source) continue;
+                renderActive[i]->gain = command.gain;
+                mixInputs[i].gain = command.gain;
+            }
+            break;
+        case EngineCommand::Type::SwitchOutput:
+            switchOutput(command.output);
+            break;
+        case EngineCommand::Type::SetQueueTarget:
+            // 漂移控制器按自身的调整上限平滑地移到新目标，不跳变；自适应缓冲保留已调整的目标，只限制在新的范围内
+            queueFloor = command.frames;
+            queueCeiling = std::max(command.maxFrames, command.frames);
+            queueTarget = std::clamp(queueTarget, queueFloor, queueCeiling);
+            for (size_t i = 0; i < renderCount; ++i) renderActive[i]->drift->setTarget(queueTarget);
+            break;
+        case EngineCommand::Type::AddOutput:
+            // 读位置在第一次补充时按主输出的排队量确定；对齐延迟变长时主输出下次多混一些，不插入静音
+            if (renderSinkCount < kMaxSinks) renderSinks[renderSinkCount++] = command.sink;
+            renderAlign = command.frames;
+            break;
+        case EngineCommand::Type::SetRecorder:
+            renderRecorders[command.frames] = command.recorder;
+            recorderSwaps.fetch_add(1, std::memory_order_release);
+            break;
+        case EngineCommand::Type::SetInsert:
+            if (renderInserts[command.frames]) retire(renderInserts[command.frames]);
+            renderInserts[command.frames] = command.insert;
+            break;
+        case EngineCommand::Type::RemoveOutput:
+            for (size_t i = 0; i < renderSinkCount; ++i) {
+                if (renderSinks[i] != command.sink) continue;
+                for (size_t j = i + 1; j < renderSinkCount; ++j) renderSinks[j - 1] = renderSinks[j];
+                --renderSinkCount;
+                break;
             }
+            renderAlign = command.frames;
+            retire(command.sink);
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+void AudioEngine::switchOutput(RenderStream* next) {
+    // 连续切换时，上一个还在播的旧输出直接回收
+    if (drainingOutput) retire(drainingOutput);
+    drainingOutput = nullptr;
+    fadeOutPending = false;
+    if (outputLost) {
+        // 失效的旧输出没有东西可播，直接回收；期间 ring 里积压的数据已经过时（写满后还有丢弃，前后不连续），
+        // 全部丢掉，新输出从静音开始按目标排队量重新积累
+        retire(output);
+        outputLost = false;
+        for (size_t i = 0; i < renderCount; ++i) renderActive[i]->ring->discard(SIZE_MAX);
+        masterCursor = fanout->writePosition();
+    } else {
+        // 旧输出不再按水位补充，只在下一次混音时写一段淡出，之后等它播完
+        drainingOutput = output;
+        fadeOutPending = true;
+    }
+    attachOutput(next);
+    // 排队量随旧输出的 padding 一起跳变，新设备的时钟也不同：漂移控制从头开始
+    for (size_t i = 0; i < renderCount; ++i) renderActive[i]->drift->reset();
+}
+
+void AudioEngine::writeFadeOut(const float* frames, const size_t frameCount) {
+    fadeOutPending = false;
+    uint32_t padding = 0;
+    if (!drainingOutput->padding(padding)) return;
+    const uint32_t bufferFrames = drainingOutput->bufferFrames();
+    const uint32_t space = bufferFrames > padding ? bufferFrames - padding : 0;
+    const uint32_t count = std::min<uint32_t>({ crossfadeFrames, static_cast<uint32_t>(frameCount), space });
+    if (count == 0) return;
+    float* outBuf = drainingOutput->acquire(count);
+    if (!outBuf) return;
+    std::memcpy(outBuf, frames, count * outputFormat.channels * sizeof(float));
+    applyRamp(outBuf, count, outputFormat.channels, 1.0f, -1.0f / static_cast<float>(count));
+    drainingOutput->commit(count);
+}
+
+void AudioEngine::attachOutput(RenderStream* stream) {
+    output = stream;
+    renderBufferFrames = stream->bufferFrames();
+    renderTargetFrames = renderWatermark(*stream);
+    lastRenderLevel = 0;
+    fadeInRemaining = crossfadeFrames;
+}
+
+void AudioEngine::releasePendingCommands() {
+    // 两个音频线程都已退出：队列中 RemoveSource 的来源已不在 sources 中，SwitchOutput 的旧输出
+    // 也已不归控制线程所有，与尚未换上的插入效果一起在这里释放；其余命令引用的对象仍由 sources / renderStream 持有
+    EngineCommand command;
+    for (auto* queue : { &captureCommands, &forwarded, &commands }) {
+        while (queue->pop(&command, 1) == 1) {
+            if (command.type == EngineCommand::Type::RemoveSource) delete command.source;
+            else if (command.type == EngineCommand::Type::SwitchOutput) delete command.previousOutput;
+            else if (command.type == EngineCommand::Type::RemoveOutput) delete command.sink;
+            else if (command.type == EngineCommand::Type::SetInsert) delete command.insert;
+        }
+    }
+}
+
+void AudioEngine::reclaim() {
+    RetiredObject item;
+    while (retired.pop(&item, 1) == 1) {
+        item.destroy(item.object);
+    }
+}
+
+void AudioEngine::captureLoop() {
+    // 提升线程优先级（由后端决定，例如 MMCSS）
+    audioBackend->enterAudioThread();
+    threadsReady->arrive_and_wait();
+
+    // 主循环：等待任一来源的 capture 事件（事件驱动），只负责把数据推入 ring
+    while (true) {
+        if (!running.load(std::memory_order_acquire)) break;
+
+        // 超时（来源静音时不产生数据包，或设备已失效不再触发事件）也照常检查一遍所有来源，以便发现失效
+        int waitResult = audioBackend->waitAny(captureWait.data(), captureCount, kStallTimeoutMs);
+        if (waitResult < 0 && waitResult != AudioBackend::kWaitTimeout) {
+            // 错误，退出
+            stats.addError();
+            break;
+        }
+
+        rtsan::Scope realtime;
+        const auto wakeStart = std::chrono::steady_clock::now();
+        applyCaptureCommands();
+
+        // 自动复位事件只会报告其中一个，所以每次唤醒都检查所有来源（已失效的来源等待监督线程换上新流）
+        for (size_t i = 0; i < captureCount; ++i) {
+            if (!captureActive[i]->streamLost) readSource(*captureActive[i]);
+        }
+
+        stats.recordWakeup(static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - wakeStart).count()));
+    }
+
+    audioBackend->leaveAudioThread();
+}
+
+void AudioEngine::renderLoop() {
+    audioBackend->enterAudioThread();
+    threadsReady->arrive_and_wait();
+
+    // 主循环：等待 render 事件（设备刚消耗了一个周期），补充数据的时机只取决于输出设备
+    while (true) {
+        if (!running.load(std::memory_order_acquire)) break;
+
+        // 主输出与各附加输出的事件都会唤醒（已失效的附加输出不再等待）
+        size_t waitCount = 0;
+        renderWait[waitCount++] = output;
+        for (size_t i = 0; i < renderSinkCount; ++i) {
+            if (!renderSinks[i]->lost) renderWait[waitCount++] = renderSinks[i]->stream.get();
+        }
+        // 超时说明设备没有在消耗数据，多半已失效：照常处理一遍，在 padding 失败时发现
+        int waitResult = audioBackend->waitAny(renderWait.data(), waitCount, kStallTimeoutMs);
+        if (waitResult < 0 && waitResult != AudioBackend::kWaitTimeout) {
+            stats.addError();
+            break;
+        }
+
+        rtsan::Scope realtime;
+        const auto wakeStart = std::chrono::steady_clock::now();
+        applyCommands();
+        fillRender();
+        serviceSinks();
+        stats.recordWakeup(static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - wakeStart).count()));
+    }
+
+    // 还在播淡出的旧输出交给回收队列
+    if (drainingOutput) {
+        retire(drainingOutput);
+        drainingOutput = nullptr;
+    }
+    audioBackend->leaveAudioThread();
+}
+
+void AudioEngine::readSource(CaptureSource& source) {
+    // 应用 render 侧计算出的漂移补偿
+    if (source.resampler) {
+        const double adjust = source.ratioAdjust.load(std::memory_order_relaxed);
+        if (adjust != source.resampler->ratioAdjust()) source.resampler->setRatioAdjust(adjust);
+    }
+
+    // 处理所有可用包：capture 侧只负责把数据推入 ring
+    CapturePacket packet;
+    while (true) {
+        if (!source.stream->readPacket(packet)) {
+            if (source.stream->invalidated()) markSourceLost(source);
+            else stats.addError();
+            break;
+        }
+        if (packet.frames == 0) break;
+        const uint64_t now = audioBackend->nowNs();
+        if (source.lostNs != 0) {
+            // 恢复后的第一个包：记录从失效到重新出声的时间
+            stats.recordRecovery(now > source.lostNs ? now - source.lostNs : 0);
+            source.lostNs = 0;
+        }
+
+        const uint32_t framesAvailable = packet.frames;
+        stats.addCaptured(framesAvailable);
+        if (packet.silent) stats.addSilent(framesAvailable);
+        if (packet.discontinuity) stats.addOverrun();
+        if (packet.silent) source.meter->processSilence(framesAvailable, now);
+        else source.meter->process(packet.data, framesAvailable, now);
+        trackArrival(source, packet, now);
+
+        // 开始写 ring：stampSeq 变为奇数，直到时间戳与 ring 一起更新完
+        const uint32_t seq = source.stampSeq.load(std::memory_order_relaxed);
+        source.stampSeq.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
 
-            // 提交渲染缓冲
-            hr = renderClient->ReleaseBuffer(framesToWrite, 0);
-            if (FAILED(hr)) {
-                std::cerr << "ReleaseBuffer (render) failed: " << std::hex << hr << std::endl;
+        // 之前有数据丢失（设备缓冲溢出等）：先把丢掉的那段补上，本包再从补偿信号淡入
+        size_t dropped = packet.discontinuity ? concealGap(source, packet) : 0;
+        if (packet.silent && (!source.resampler || source.passthrough) && !source.concealer->concealing()) {
+            // 如果输入是 silent，写零
+            dropped += framesAvailable - source.ring->pushSilence(framesAvailable);
+            source.concealer->observeSilence(framesAvailable);
+        } else if (packet.silent) {
+            // 重采样路径也要送入静音，保持滤波器历史与时间轴连续（刚补过丢失的帧时也经这里从补偿信号淡出）
+            for (size_t done = 0; done < framesAvailable;) {
+                const size_t chunk = std::min<size_t>(framesAvailable - done, source.silence.size() / source.ring->channels());
+                dropped += pushToRing(source, source.silence.data(), chunk);
+                done += chunk;
+            }
+        } else if (!source.remap.identity()) {
+            // 先混到输出声道数再写入 ring
+            const size_t inChannels = source.remap.inputChannels();
+            const size_t capacity = source.remapped.size() / source.ring->channels();
+            for (size_t done = 0; done < framesAvailable;) {
+                const size_t chunk = std::min<size_t>(framesAvailable - done, capacity);
+                source.remap.apply(packet.data + done * inChannels, source.remapped.data(), chunk);
+                dropped += pushToRing(source, source.remapped.data(), chunk);
+                done += chunk;
+            }
+        } else if (source.passthrough) {
+            // 直通：包直接拷进 ring。漂移补偿累计到一帧时丢掉包尾的一帧或把它重复一次（每隔数千帧才发生一次）
+            source.slip += (source.ratioAdjust.load(std::memory_order_relaxed) - 1.0) * framesAvailable;
+            size_t frames = framesAvailable;
+            if (source.slip >= 1.0 && frames > 1) {
+                --frames;
+                source.slip -= 1.0;
+            }
+            dropped += pushToRing(source, packet.data, frames);
+            if (source.slip <= -1.0) {
+                dropped += pushToRing(source, packet.data + (framesAvailable - 1) * source.ring->channels(), 1);
+                source.slip += 1.0;
             }
+        } else {
+            dropped += pushToRing(source, packet.data, framesAvailable);
+        }
+        source.stream->releasePacket(framesAvailable);
+        source.nextPosition = packet.devicePosition + framesAvailable;
+        source.positionKnown = true;
 
-            // 释放输入缓冲：注意参数必须是 framesConsumed 对应 input 的帧数
-            // 如果 framesToWrite < framesAvailable，我们仍然从 capture 释放全部 framesAvailable（因为我们已经消费了这些帧概念上）
-            // 为简单起见，先释放 framesAvailable（防止缓冲被卡住）。若需更精确的流对齐，可使用环形缓存存储未消费部分。
-            captureClient->ReleaseBuffer(framesAvailable);
+        if (packet.timestampNs != 0) {
+            // ring 末帧对应包内最后一帧，再扣掉重采样器的群延迟（直通时没有）
+            const double groupDelay = source.passthrough ? 0.0 : static_cast<double>(Resampler::latencyFrames());
+            const double endNs = static_cast<double>(packet.timestampNs) +
+                                 (static_cast<double>(framesAvailable) - groupDelay) * 1e9 / source.format.sampleRate;
+            source.stampEndNs.store(static_cast<uint64_t>(std::max(1.0, endNs)), std::memory_order_relaxed);
+        }
+        source.stampSeq.store(seq + 2, std::memory_order_release);
 
-            // 继续检查是否还有包
-            hr = captureClient->GetNextPacketSize(&packetLength);
+        // ring 已满说明 render 长时间没有消费，只能丢弃放不下的部分（音频线程里不打印，只计数）
+        if (dropped > 0) {
+            stats.addDropped(dropped);
+            stats.addOverrun();
         }
-        // loop 回到等待
     }
+}
 
-    // 清理
-    inClient->Stop();
-    outputClient->Stop();
+void AudioEngine::trackArrival(CaptureSource& source, const CapturePacket& packet, const uint64_t now) {
+    // RFC 3550 的到达间隔抖动：实际间隔与按上个包的帧数推算的间隔之差，取绝对值做 1/16 的指数平均
+    // 不连续的包（前面有数据丢失）与隔了很久才来的包（来源暂时无声）不计入
+    if (source.lastArrivalNs != 0 && !packet.discontinuity && now - source.lastArrivalNs < uint64_t(kJitterGapMs) * 1000000) {
+        const double expected = static_cast<double>(source.lastPacketFrames) * 1e9 / source.format.sampleRate;
+        const double deviation = std::abs(static_cast<double>(now - source.lastArrivalNs) - expected);
+        source.jitterNs += (deviation - source.jitterNs) / 16.0;
+        source.jitterFrames.store(static_cast<float>(source.jitterNs * outputFormat.sampleRate / 1e9), std::memory_order_relaxed);
+    }
+    source.lastArrivalNs = now;
+    source.lastPacketFrames = packet.frames;
+}
 
-    if (mmHandle) AvRevertMmThreadCharacteristics(mmHandle);
-    else SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_NORMAL);
+size_t AudioEngine::concealGap(CaptureSource& source, const CapturePacket& packet) {
+    // 丢失的帧数按设备位置推算（不知道时为 0：只让本包从延拓的信号淡入，消除接缝处的跳变）；
+    // 超过一次补偿的长度就不再补（之后只会是静音，补进去只会白白增加延迟）
+    PacketLossConcealer& concealer = *source.concealer;
+    uint64_t missing = source.positionKnown && packet.devicePosition > source.nextPosition ? packet.devicePosition - source.nextPosition : 0;
+    missing = std::min<uint64_t>(missing, concealer.maxConcealFrames());
+    const size_t block = source.concealed.size() / concealer.channels();
+    size_t dropped = 0;
+    do {
+        const size_t frames = static_cast<size_t>(std::min<uint64_t>(missing, block));
+        concealFrames(concealer, source.concealed.data(), frames);
+        if (frames > 0) dropped += writeRing(source, source.concealed.data(), frames);
+        missing -= frames;
+    } while (missing > 0);
+    return dropped;
 }
 
-auto AudioEngine::syncSampleRate(ComPtr<IAudioClient> inputClient, ComPtr<IAudioClient> outputClient) -> bool {
-    if (!inputClient || !outputClient) return false;
+std::size_t AudioEngine::concealFrames(PacketLossConcealer& concealer, float* out, const size_t frames) {
+    const bool starting = !concealer.concealing();
+    const size_t audible = concealer.conceal(out, frames);
+    if (audible > 0) stats.addConcealed(audible, starting);
+    return audible;
+}
 
-    WAVEFORMATEX* inFormat = nullptr;
-    WAVEFORMATEX* outFormat = nullptr;
-    HRESULT hr = inputClient->GetMixFormat(&inFormat);
-    if (FAILED(hr) || !inFormat) return false;
-    hr = outputClient->GetMixFormat(&outFormat);
-    if (FAILED(hr) || !outFormat) { CoTaskMemFree(inFormat); return false; }
+void AudioEngine::markSourceLost(CaptureSource& source) {
+    source.streamLost = true;
+    source.lostNs = audioBackend->nowNs();
+    stats.addFault();
+    source.failed.store(true, std::memory_order_release);
+    wakeSupervisor();
+}
 
-    // 如果不等则以 input 为准（只同步采样率和 bytes/sec）
-    if (inFormat->nSamplesPerSec != outFormat->nSamplesPerSec ||
-        inFormat->wBitsPerSample != outFormat->wBitsPerSample ||
-        inFormat->nChannels != outFormat->nChannels) {
-        // 简单策略：用 input 的关键字段覆盖 output 的对应字段（注意：若格式完全不兼容，后面应该做重采样）
-        outFormat->nSamplesPerSec = inFormat->nSamplesPerSec;
-        outFormat->nAvgBytesPerSec = inFormat->nAvgBytesPerSec;
-        outFormat->nBlockAlign = inFormat->nBlockAlign;
-        outFormat->wBitsPerSample = inFormat->wBitsPerSample;
-        outFormat->nChannels = inFormat->nChannels;
+void AudioEngine::markSinkLost(OutputSink& sink) {
+    sink.lost = true;
+    sink.lostNs = audioBackend->nowNs();
+    stats.addFault();
+    sink.failed.store(true, std::memory_order_release);
+    wakeSupervisor();
+}
+
+void AudioEngine::markOutputLost() {
+    outputLost = true;
+    outputLostNs = audioBackend->nowNs();
+    stats.addFault();
+    outputFailed.store(true, std::memory_order_release);
+    wakeSupervisor();
+}
+
+void AudioEngine::fillRender() {
+    // 切换前的旧输出播完后回收
+    if (drainingOutput) {
+        uint32_t remaining = 0;
+        if (!drainingOutput->padding(remaining) || remaining == 0) {
+            retire(drainingOutput);
+            drainingOutput = nullptr;
+        }
     }
 
-    if (mixFormat) CoTaskMemFree(mixFormat);
-    mixFormat = outFormat; // 使用同步后的格式（注意：outFormat 从 GetMixFormat 分配，后面由 this 释放）
-    CoTaskMemFree(inFormat);
-    return true;
+    // 输出已失效：等监督线程换上新的输出
+    if (outputLost) return;
+
+    // 获取 render 的当前填充，计算设备需要补充的帧数
+    uint32_t padding = 0;
+    if (!output->padding(padding)) {
+        if (output->invalidated()) markOutputLost();
+        else stats.addError();
+        return;
+    }
+    const uint32_t framesRequested = renderTargetFrames > padding ? renderTargetFrames - padding : 0;
+    // 刚切换到的新输出还没写过数据，此时为空不算欠载
+    const bool wasFilled = lastRenderLevel > 0;
+    // 主输出延迟线中已混好、还没写给设备的帧（没有附加输出时为 0）
+    const size_t delayed = fanout->available(masterCursor);
+
+    updateDrift(padding, delayed);
+    measureLatency(padding + delayed);
+
+    // 已失效的来源不会再有新数据，不等待它们（ring 里剩下的照常混完）；全部失效时按原样混完剩余数据
+    size_t liveCount = 0;
+    for (size_t i = 0; i < renderCount; ++i) {
+        if (!renderActive[i]->failed.load(std::memory_order_relaxed)) liveInputs[liveCount++] = mixInputs[i];
+    }
+    const MixInput* readyInputs = liveCount > 0 ? liveInputs.data() : mixInputs.data();
+    const size_t readyCount = liveCount > 0 ? liveCount : renderCount;
+
+    // 设备缓冲已被播空（线程被延迟调度）或下面需要补静音，都计为一次欠载
+    // （启动后还没有数据到达、或所有来源都已失效正在恢复时除外）
+    const bool counting = renderPrimed && liveCount > 0;
+    bool underrun = counting && wasFilled && padding == 0;
+    if (framesRequested == 0) {
+        if (underrun) stats.addUnderrun();
+        return;
+    }
+
+    float* outBuf = output->acquire(framesRequested);
+    if (!outBuf) {
+        if (output->invalidated()) markOutputLost();
+        else stats.addError();
+        return;
+    }
+
+    // 直通与混音之间切换：离开直通时各来源的历史已过时（直通不写历史），清成静音，路由延迟从静音开始
+    const bool direct = delayed == 0 && directPath();
+    if (direct != renderDirect) {
+        if (!direct) {
+            for (size_t i = 0; i < renderCount; ++i) renderActive[i]->history->fillSilence();
+        }
+        renderDirect = direct;
+        stats.setPassthrough(direct);
+    }
+
+    // 混音写进 fanout：有多少混多少，把延迟线补到 设备请求 + 对齐延迟；对齐延迟变短时少混，由延迟线先播
+    const size_t wanted = framesRequested + renderAlign > delayed ? framesRequested + renderAlign - delayed : 0;
+    size_t framesReady = mixer->framesReady(readyInputs, readyCount, wanted);
+    if (!wasFilled) {
+        // 刚切换到的新输出：静音补在前面，数据连续地接在后面，并让 ring 留下目标排队量中延迟线与设备缓冲以外的部分
+        const size_t downstream = static_cast<size_t>(framesRequested) + renderAlign;
+        const size_t keep = queueTarget > downstream ? queueTarget - downstream : 0;
+        const size_t avail = mixer->framesReady(readyInputs, readyCount, SIZE_MAX);
+        framesReady = std::min(framesReady, avail > keep ? avail - keep : 0);
+    }
+    if (framesReady > 0) {
+        if (!direct) mixToFanout(framesReady);
+        renderPrimed = true;
+    }
+
+    // 主输出从延迟线的读位置取数据（直通时直接取来源 ring），不足的部分补静音，保证设备按时拿到请求的帧数
+    const size_t take = std::min<size_t>(framesRequested, direct ? framesReady : fanout->available(masterCursor));
+    const size_t lead = wasFilled ? 0 : framesRequested - take;
+    float* mixed = outBuf + lead * outputFormat.channels;
+    std::memset(outBuf, 0, lead * outputFormat.channels * sizeof(float));
+    if (direct) {
+        copyDirect(mixed, take);
+        stats.addPassthrough(take);
+        if (renderRecorders[0]) renderRecorders[0]->push(mixed, take);
+    } else {
+        const auto regions = fanout->readRegions(masterCursor, take);
+        std::memcpy(mixed, regions.first.data, regions.first.frames * outputFormat.channels * sizeof(float));
+        std::memcpy(mixed + regions.first.frames * outputFormat.channels, regions.second.data,
+                    regions.second.frames * outputFormat.channels * sizeof(float));
+        masterCursor += take;
+    }
+    // 新输出前面垫的静音不计入补偿历史；真实数据在刚补偿过时开头与补偿信号交叉淡化
+    if (lead > 0) outputConcealer->observeSilence(lead);
+    if (take > 0) outputConcealer->play(mixed, take);
+    if (lead + take < framesRequested) {
+        // 数据没有按时到达：接着上一段数据周期延拓（持续一小段后淡出成静音），而不是直接补静音
+        concealFrames(*outputConcealer, mixed + take * outputFormat.channels, framesRequested - lead - take);
+        underrun = underrun || counting;
+    }
+    if (underrun) stats.addUnderrun();
+
+    // 切换输出：同一段数据在旧输出上淡出（1 -> 0）、在新输出上淡入（0 -> 1）
+    if (fadeOutPending && take > 0) writeFadeOut(mixed, take);
+    if (fadeInRemaining > 0 && take > 0) {
+        const uint32_t frames = std::min(fadeInRemaining, static_cast<uint32_t>(take));
+        const float step = 1.0f / static_cast<float>(crossfadeFrames);
+        applyRamp(mixed, frames, outputFormat.channels, static_cast<float>(crossfadeFrames - fadeInRemaining) * step, step);
+        fadeInRemaining -= frames;
+    }
+    outputMeter->process(outBuf, framesRequested, audioBackend->nowNs());
+
+    if (output->commit(framesRequested)) {
+        lastRenderLevel = padding + framesRequested;
+        stats.addRendered(framesRequested);
+        if (outputLostNs != 0) {
+            // 失效后换上的输出第一次写入：记录从失效到重新出声的时间
+            const uint64_t now = audioBackend->nowNs();
+            stats.recordRecovery(now > outputLostNs ? now - outputLostNs : 0);
+            outputLostNs = 0;
+        }
+        if (!renderStarted && take > 0) {
+            // 启动后第一次交出真实数据（之前都是垫的静音）
+            renderStarted = true;
+            firstFrameNs.store(std::chrono::steady_clock::now().time_since_epoch().count(), std::memory_order_release);
+        }
+    } else if (output->invalidated()) {
+        markOutputLost();
+    } else {
+        stats.addError();
+    }
+}
+
+void AudioEngine::mixToFanout(const size_t frames) {
+    // 主输出与各附加输出各混一条 bus；路由表只在混音期间持有，控制线程发布新快照最多等这一小段
+    size_t busCount = 0;
+    renderBuses[busCount++] = 0;
+    for (size_t i = 0; i < renderSinkCount; ++i) renderBuses[busCount++] = renderSinks[i]->routeColumn;
+    const RouteTable table = routes.acquire();
+    // 每次最多混 kRouteBlockFrames 帧，最长延迟加上这一段仍在来源的历史之内
+    for (size_t done = 0; done < frames;) {
+        const size_t block = std::min(frames - done, kRouteBlockFrames);
+        const uint64_t insertNs = mixer->mixRouted(mixInputs.data(), renderCount, table, renderBuses.data(), busCount,
+                                                   *fanout, block, renderInserts.data());
+        if (insertNs > 0) stats.recordInsert(insertNs);
+        done += block;
+    }
+    routes.release();
+
+    // 录音取的是刚混进各 bus 的这一段
+    for (size_t b = 0; b < busCount; ++b) {
+        Recorder* recorder = renderRecorders[renderBuses[b]];
+        if (!recorder) continue;
+        const size_t count = std::min(frames, fanout->capacity());
+        const auto regions = fanout->readRegions(fanout->writePosition() - count, count, renderBuses[b]);
+        recorder->push(regions.first.data, regions.first.frames);
+        recorder->push(regions.second.data, regions.second.frames);
+    }
+}
+
+bool AudioEngine::directPath() {
+    // 控制线程的通知与 render 线程的处理图可能暂时不一致（例如附加输出已接入、退出直通的通知还在路上），以后者为准
+    if (!renderPassthrough || renderSinkCount != 0 || renderCount != 1 || mixInputs[0].gain != 1.0f) return false;
+    // 刚关掉的插入效果先在混音路径上过渡到直通，再切过来
+    InsertChain* insert = renderInserts[mixInputs[0].row * routes.columns()];
+    if (insert && insert->update()) return false;
+    const Route& route = routes.acquire().at(mixInputs[0].row, 0);
+    const bool unity = route.gain == 1.0f && route.delayFrames == 0 && !route.muted;
+    routes.release();
+    return unity;
+}
+
+void AudioEngine::copyDirect(float* out, const size_t frames) {
+    SpscRing<float>& ring = *mixInputs[0].ring;
+    const auto regions = ring.prepareRead(frames);
+    const size_t channels = outputFormat.channels;
+    std::memcpy(out, regions.first.data, regions.first.frames * channels * sizeof(float));
+    std::memcpy(out + regions.first.frames * channels, regions.second.data, regions.second.frames * channels * sizeof(float));
+    ring.commitRead(regions.frames());
+}
+
+void AudioEngine::serviceSinks() {
+    if (renderSinkCount == 0 || outputLost) return;
+    // 主输出"已混好还没播放"的帧数：延迟线 + 设备缓冲，各附加输出都向它看齐
+    uint32_t masterPadding = 0;
+    if (!output->padding(masterPadding)) return;
+    const double masterQueued = static_cast<double>(fanout->available(masterCursor)) + masterPadding;
+    for (size_t i = 0; i < renderSinkCount; ++i) {
+        if (!renderSinks[i]->lost) serviceSink(*renderSinks[i], masterQueued);
+    }
+}
+
+void AudioEngine::serviceSink(OutputSink& sink, const double masterQueued) {
+    uint32_t padding = 0;
+    if (!sink.stream->padding(padding)) {
+        if (sink.stream->invalidated()) markSinkLost(sink);
+        else stats.addError();
+        return;
+    }
+    const double ratio = static_cast<double>(outputFormat.sampleRate) / sink.format.sampleRate;
+    const size_t channels = outputFormat.channels;
+
+    if (!sink.placed) {
+        // 第一次补充：读位置退到与主输出排队量相同处（重采样器的群延迟也算在内）
+        const double back = std::max(0.0, masterQueued - padding * ratio - Resampler::latencyFrames());
+        const double limit = static_cast<double>(std::min<uint64_t>(fanout->writePosition(), fanout->capacity()));
+        // 刚启动时主输出排队的还多是垫在前面的静音，fanout 里没有这么多帧：等它混出来再定位，否则这一路排得比主输出少
+        if (back > limit && fanout->writePosition() < fanout->capacity()) return;
+        const auto frames = static_cast<uint64_t>(std::min(back, limit));
+        sink.cursor = fanout->writePosition() - frames;
+        sink.placed = true;
+        sink.lastLevel = padding;
+        // 本列此前没有混音（或属于已移除的输出），退回去的这一段按静音播放
+        const auto stale = fanout->readRegions(sink.cursor, fanout->available(sink.cursor), sink.routeColumn);
+        for (const auto& span : { stale.first, stale.second }) std::memset(span.data, 0, span.frames * outputFormat.channels * sizeof(float));
+    }
+    const size_t skipped = fanout->clampReader(sink.cursor);
+    if (skipped > 0) {
+        // 落后太多，数据已被覆盖：只能跳过
+        stats.addDropped(skipped);
+        stats.addOverrun();
+    }
+
+    // 漂移补偿：两路输出中已混好还没播放的帧数之差（主输出帧），控制到 0
+    const double elapsed = sink.lastLevel > padding ? (sink.lastLevel - padding) * ratio : 0.0;
+    sink.lastLevel = padding;
+    const double queued = static_cast<double>(fanout->available(sink.cursor)) + Resampler::latencyFrames() + padding * ratio;
+    if (sink.primed) sink.resampler->setRatioAdjust(sink.drift->update(queued - masterQueued, elapsed));
+
+    // 只写 fanout 中已有数据能产生的帧数：补静音会让这一路的排队量超过主输出、播放提前；
+    // 设备缓冲已经播空时才补满（计为欠载）。重采样的产出按上限估计，留几帧余量
+    const uint32_t wanted = sink.watermark > padding ? sink.watermark - padding : 0;
+    const size_t bound = sink.resampler->maxOutputFor(fanout->available(sink.cursor));
+    const size_t producible = bound > 3 ? bound - 3 : 0;
+    const uint32_t framesRequested = sink.primed && padding == 0 ? wanted : static_cast<uint32_t>(std::min<size_t>(wanted, producible));
+    if (framesRequested == 0) return;
+    float* outBuf = sink.stream->acquire(framesRequested);
+    if (!outBuf) {
+        if (sink.stream->invalidated()) markSinkLost(sink);
+        else stats.addError();
+        return;
+    }
+
+    // 重采样直接读 fanout 中的区域；声道数相同时直接写进设备缓冲
+    float* target = sink.remap.identity() ? outBuf : sink.scratch.data();
+    size_t produced = 0;
+    const auto regions = fanout->readRegions(sink.cursor, fanout->available(sink.cursor), sink.routeColumn);
+    for (const auto& span : { regions.first, regions.second }) {
+        if (span.frames == 0 || produced == framesRequested) continue;
+        size_t consumed = 0;
+        produced += sink.resampler->process(span.data, span.frames, consumed, target + produced * channels, framesRequested - produced);
+        sink.cursor += consumed;
+    }
+    if (!sink.remap.identity()) sink.remap.apply(sink.scratch.data(), outBuf, produced);
+    if (produced > 0) sink.concealer->play(outBuf, produced);
+    if (produced < framesRequested) {
+        // 设备缓冲已经播空：与主输出一样补上补偿信号
+        concealFrames(*sink.concealer, outBuf + produced * sink.format.channels, framesRequested - produced);
+        if (sink.primed) stats.addUnderrun();
+    }
+    if (sink.fadeInRemaining > 0 && produced > 0) {
+        const uint32_t frames = std::min(sink.fadeInRemaining, static_cast<uint32_t>(produced));
+        const float step = 1.0f / static_cast<float>(crossfadeFrames);
+        applyRamp(outBuf, frames, sink.format.channels, static_cast<float>(crossfadeFrames - sink.fadeInRemaining) * step, step);
+        sink.fadeInRemaining -= frames;
+    }
+    sink.meter->process(outBuf, framesRequested, audioBackend->nowNs());
+
+    if (!sink.stream->commit(framesRequested)) {
+        if (sink.stream->invalidated()) markSinkLost(sink);
+        else stats.addError();
+        return;
+    }
+    sink.lastLevel = padding + framesRequested;
+    if (produced > 0) sink.primed = true;
+    if (sink.lostNs != 0 && produced > 0) {
+        // 失效后换上的附加输出第一次写入
+        const uint64_t now = audioBackend->nowNs();
+        stats.recordRecovery(now > sink.lostNs ? now - sink.lostNs : 0);
+        sink.lostNs = 0;
+    }
+}
+
+void AudioEngine::updateDrift(const uint32_t padding, const size_t delayed) {
+    // 设备自上次写入以来消耗的帧数（以设备自身的时钟为准，与后端无关）
+    const double elapsedFrames = lastRenderLevel > padding ? static_cast<double>(lastRenderLevel - padding) : 0.0;
+    lastRenderLevel = padding;
+    adaptQueueTarget(elapsedFrames);
+
+    size_t maxAvail = 0;
+    for (size_t i = 0; i < renderCount; ++i) maxAvail = std::max(maxAvail, renderActive[i]->ring->readAvailable());
+    stats.recordRingFill(maxAvail);
+
+    for (size_t i = 0; i < renderCount; ++i) {
+        CaptureSource& source = *renderActive[i];
+        if (!source.drift) continue;
+        const size_t avail = source.ring->readAvailable();
+        // 当前不产生数据的来源（被混音器当作静音）与已失效的来源不参与调节，避免积分项饱和
+        if (maxAvail - avail > mixer->lagToleranceFrames() || source.failed.load(std::memory_order_relaxed)) continue;
+        const double adjust = source.drift->update(static_cast<double>(avail + delayed) + padding, elapsedFrames);
+        source.ratioAdjust.store(adjust, std::memory_order_relaxed);
+    }
+}
+
+void AudioEngine::adaptQueueTarget(const double elapsedFrames) {
+    // 仍在产生数据、未失效的来源中最大的到达抖动；上升时立即跟上，下降时慢慢回落，目标不会来回摆动
+    size_t maxAvail = 0;
+    for (size_t i = 0; i < renderCount; ++i) maxAvail = std::max(maxAvail, renderActive[i]->ring->readAvailable());
+    double jitter = 0.0;
+    for (size_t i = 0; i < renderCount; ++i) {
+        const CaptureSource& source = *renderActive[i];
+        if (maxAvail - source.ring->readAvailable() > mixer->lagToleranceFrames() || source.failed.load(std::memory_order_relaxed)) continue;
+        jitter = std::max<double>(jitter, source.jitterFrames.load(std::memory_order_relaxed));
+    }
+    const double release = std::exp(-elapsedFrames * 1000.0 / (static_cast<double>(kJitterReleaseMs) * outputFormat.sampleRate));
+    jitterHold = std::max(jitter, jitterHold * release);
+    stats.recordJitter(jitterHold);
+
+    if (queueCeiling > queueFloor) {
+        // 排队量要盖住晚到的包：下限加上几倍的抖动
+        const double desired = std::clamp(queueFloor + kJitterMargin * jitterHold, static_cast<double>(queueFloor), static_cast<double>(queueCeiling));
+        const double step = static_cast<double>(kAdaptiveStepMs) * outputFormat.sampleRate / 1000.0;
+        if (std::abs(desired - static_cast<double>(queueTarget)) >= step) {
+            queueTarget = static_cast<uint32_t>(desired);
+            for (size_t i = 0; i < renderCount; ++i) renderActive[i]->drift->setTarget(queueTarget);
+        }
+    }
+    stats.recordQueueTarget(queueTarget);
+}
+
+void AudioEngine::measureLatency(const size_t downstream) {
+    // ring 读位置上的帧在 downstream 帧之后播放；它的采集时刻 = ring 末帧采集时刻 - ring 中的帧数
+    // 取各来源中最大的一个（只统计仍在产生数据、未失效的来源）
+    const uint64_t now = audioBackend->nowNs();
+    const double nsPerFrame = 1e9 / outputFormat.sampleRate;
+    size_t maxAvail = 0;
+    for (size_t i = 0; i < renderCount; ++i) maxAvail = std::max(maxAvail, renderActive[i]->ring->readAvailable());
+
+    int64_t worst = 0;
+    bool measured = false;
+    for (size_t i = 0; i < renderCount; ++i) {
+        CaptureSource& source = *renderActive[i];
+        if (source.failed.load(std::memory_order_relaxed)) continue;
+        const uint32_t seq = source.stampSeq.load(std::memory_order_acquire);
+        if (seq & 1u) continue;
+        const size_t avail = source.ring->readAvailable();
+        if (maxAvail > avail + mixer->lagToleranceFrames()) continue;
+        const uint64_t endNs = source.stampEndNs.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (source.stampSeq.load(std::memory_order_relaxed) != seq || endNs == 0) continue;
+
+        const double latency = static_cast<double>(now) - static_cast<double>(endNs) + static_cast<double>(avail + downstream) * nsPerFrame;
+        if (!measured || latency > static_cast<double>(worst)) worst = static_cast<int64_t>(latency);
+        measured = true;
+    }
+    if (measured) stats.recordLatency(worst);
+}
+
+size_t AudioEngine::pushToRing(CaptureSource& source, const float* frames, const size_t frameCount) {
+    PacketLossConcealer& concealer = *source.concealer;
+    if (!concealer.concealing()) {
+        concealer.observe(frames, frameCount);
+        return writeRing(source, frames, frameCount);
+    }
+    // 补过丢失的帧之后的第一段数据：开头拷出来与补偿信号的延续交叉淡化，其余照常写入
+    const size_t channels = source.ring->channels();
+    const size_t head = std::min(frameCount, source.concealed.size() / channels);
+    std::memcpy(source.concealed.data(), frames, head * channels * sizeof(float));
+    concealer.play(source.concealed.data(), head);
+    size_t dropped = writeRing(source, source.concealed.data(), head);
+    if (head < frameCount) {
+        concealer.observe(frames + head * channels, frameCount - head);
+        dropped += writeRing(source, frames + head * channels, frameCount - head);
+    }
+    return dropped;
+}
+
+size_t AudioEngine::writeRing(CaptureSource& source, const float* frames, const size_t frameCount) {
+    const bool direct = !source.resampler || source.passthrough;
+    if (direct && source.fadeInRemaining == 0) {
+        return frameCount - source.ring->push(frames, frameCount);
+    }
+    if (direct) {
+        const auto regions = source.ring->prepareWrite(frameCount);
+        const size_t channels = source.ring->channels();
+        std::memcpy(regions.first.data, frames, regions.first.frames * channels * sizeof(float));
+        std::memcpy(regions.second.data, frames + regions.first.frames * channels, regions.second.frames * channels * sizeof(float));
+        fadeInRegions(source, regions, regions.frames());
+        source.ring->commitWrite(regions.frames());
+        return frameCount - regions.frames();
+    }
+
+    // 重采样结果直接写进 ring 的可写区域（最多两段）
+    size_t consumedTotal = 0;
+    auto regions = source.ring->prepareWrite(source.resampler->maxOutputFor(frameCount));
+    size_t produced = 0;
+    for (const auto& span : { regions.first, regions.second }) {
+        if (span.frames == 0 || consumedTotal == frameCount) continue;
+        size_t consumed = 0;
+        produced += source.resampler->process(frames + consumedTotal * source.ring->channels(), frameCount - consumedTotal,
+                                              consumed, span.data, span.frames);
+        consumedTotal += consumed;
+    }
+    fadeInRegions(source, regions, produced);
+    source.ring->commitWrite(produced);
+    return frameCount - consumedTotal;
+}
+
+void AudioEngine::fadeInRegions(CaptureSource& source, const SpscRing<float>::Regions& regions, const size_t frames) {
+    if (source.fadeInRemaining == 0) return;
+    // 写入的帧先占满第一段再接第二段；淡入长度与切换输出相同
+    const float step = 1.0f / static_cast<float>(crossfadeFrames);
+    size_t done = 0;
+    for (const auto& span : { regions.first, regions.second }) {
+        const size_t count = std::min({ span.frames, frames - done, static_cast<size_t>(source.fadeInRemaining) });
+        if (count == 0) continue;
+        applyRamp(span.data, count, source.ring->channels(), static_cast<float>(crossfadeFrames - source.fadeInRemaining) * step, step);
+        source.fadeInRemaining -= static_cast<uint32_t>(count);
+        done += count;
+    }
 }
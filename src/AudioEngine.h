@@ -1,52 +1,597 @@
 #pragma once
 
+#include <array>
+#include <filesystem>
 #include <string>
 #include <vector>
-#include <wrl/client.h>
-#include <audioclient.h>
 #include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
 #include <thread>
 #include <mutex>
-#include <windows.h>
+#include <latch>
 
-struct DeviceNames {
-    std::vector<std::wstring> inputs;   // 物理 capture 设备（麦克风等）
-    std::vector<std::wstring> outputs;  // render 设备（播放目标）
-    std::vector<std::wstring> loopbackSources; // 可作为 loopback 捕获的 render 设备（用于 UI 多选来源）
+#include "AudioBackend.h"
+#include "Concealer.h"
+#include "DeviceRegistry.h"
+#include "DriftController.h"
+#include "EngineStats.h"
+#include "FanoutRing.h"
+#include "InsertChain.h"
+#include "LevelMeter.h"
+#include "Mixer.h"
+#include "Recorder.h"
+#include "Resampler.h"
+#include "RoutingMatrix.h"
+#include "RtSanitizer.h"
+#include "SampleConvert.h"
+#include "Session.h"
+#include "SpscRing.h"
+
+struct DeviceList {
+    std::vector<DeviceInfo> inputs;   // 物理 capture 设备（麦克风等）
+    std::vector<DeviceInfo> outputs;  // render 设备（播放目标）
+    std::vector<DeviceInfo> loopbackSources; // 可作为 loopback 捕获的 render 设备与进程（用于 UI 多选来源）
+};
+
+// 一个 loopback 来源：独立的 capture 流与 ring
+struct CaptureSource {
+    std::wstring id;     // 端点 ID 或进程来源的 ID（见 processLoopbackId）
+    std::wstring name;   // 友好名称（仅用于显示）
+    std::unique_ptr<CaptureStream> stream;
+    std::unique_ptr<SpscRing<float>> ring;
+    float gain = 1.0f;   // 运行中只在 render 线程读写，UI 经命令队列修改
+    // 控制线程持有：最近一次设置的增益（判断能否走直通路径）
+    float controlGain = 1.0f;
+    // 路由矩阵中的行；history 为混音时读出的最近帧（先垫满静音），各路由的延迟即从中往回读的帧数
+    std::size_t routeRow = 0;
+    std::unique_ptr<FanoutRing> history;
+
+    // 来源端点的格式（loopback 只能按端点自身格式捕获）
+    StreamFormat format;
+    // 声道数与输出不同时先混到输出声道数，remapped 为预分配的中间缓冲（按 capture 缓冲大小）
+    ChannelMatrix remap;
+    std::vector<float> remapped;
+    // 推入 ring 前转换到输出采样率；同采样率时也保留，用于补偿两个设备间的时钟漂移
+    std::unique_ptr<Resampler> resampler;
+    // 漂移控制器在 render 侧更新，capture 侧读取调整系数后应用到 resampler
+    std::unique_ptr<DriftController> drift;
+    std::atomic<double> ratioAdjust{ 1.0 };
+    // 预分配的静音帧（输出声道数），供静音包送入重采样器
+    std::vector<float> silence;
+    // ring 写入端最后一帧对应的采集时刻（后端时基，0 表示未知），用于实测端到端延迟
+    // stampSeq 为奇数表示 capture 侧正在写入，render 侧读到前后不一致时放弃本次测量
+    std::atomic<std::uint32_t> stampSeq{ 0 };
+    std::atomic<std::uint64_t> stampEndNs{ 0 };
+
+    // 流失效后由 capture 线程置位，监督线程重新打开流后清除
+    std::atomic<bool> failed{ false };
+    // 上一个失效的流：恢复命令生效前 capture 线程仍在等待它的事件，下次恢复或来源释放时一并释放
+    std::unique_ptr<CaptureStream> failedStream;
+    // capture 线程持有：流已失效（不再读取）、发现失效的时刻（后端时基）、恢复后剩余的淡入帧数（输出采样率）
+    bool streamLost = false;
+    std::uint64_t lostNs = 0;
+    std::uint32_t fadeInRemaining = 0;
+    // capture 线程持有：直通时不经过重采样器，漂移补偿按累计的误差帧数偶尔丢弃 / 重复一帧
+    bool passthrough = false;
+    double slip = 0.0;
+    // 按来源自身格式测量 capture 包的电平（capture 线程写入，控制线程读取）
+    std::unique_ptr<LevelMeter> meter;
+
+    // capture 线程持有：包带不连续标志时，按设备位置推算丢失的帧数，用补偿信号补上（来源采样率、输出声道数），
+    // 之后的数据从补偿信号交叉淡化过去；concealed 为预分配的补偿 / 接缝缓冲（按 capture 缓冲大小）
+    std::unique_ptr<PacketLossConcealer> concealer;
+    std::vector<float> concealed;
+    std::uint64_t nextPosition = 0;
+    bool positionKnown = false;
+    // capture 线程持有：上一个包的到达时刻与帧数、到达间隔抖动（RFC 3550 的估计，纳秒）
+    std::uint64_t lastArrivalNs = 0;
+    std::uint32_t lastPacketFrames = 0;
+    double jitterNs = 0.0;
+    // 同上，换算成输出帧，供 render 线程调整自适应缓冲的目标
+    std::atomic<float> jitterFrames{ 0.0f };
+};
+
+// 附加输出：从 fanout 中自己那一列的混音按自己的读位置取数据，经过自己的重采样器
+// 补偿与主输出之间的时钟漂移（采样率不同时一并转换），并让"已混好还没播放"的帧数与主输出保持一致，
+// 各输出因此逐帧对齐
+struct OutputSink {
+    std::wstring id;     // 端点 ID
+    std::unique_ptr<RenderStream> stream;
+    StreamFormat format;
+    // 路由矩阵中的列，也是它在 fanout 中读取的 bus（主输出为第 0 列）
+    std::size_t routeColumn = 0;
+    // 主输出声道 -> 本设备声道；声道数不同时重采样结果先写进 scratch 再混到设备缓冲
+    ChannelMatrix remap;
+    std::vector<float> scratch;
+    // 主输出采样率 -> 本设备采样率
+    std::unique_ptr<Resampler> resampler;
+    // 输入为两路输出排队量之差（换算到主输出采样率），目标为 0
+    std::unique_ptr<DriftController> drift;
+    std::uint32_t watermark = 0;   // 每个事件补到的水位（本设备帧）
+
+    // 写给本设备的帧的电平（render 线程写入，控制线程读取）
+    std::unique_ptr<LevelMeter> meter;
+    // 设备缓冲播空、只能补数据时生成补偿信号（render 线程持有）
+    std::unique_ptr<PacketLossConcealer> concealer;
+
+    // 失效后由 render 线程置位（lostNs 先写好），监督线程换上新的 OutputSink 后随旧对象回收
+    std::atomic<bool> failed{ false };
+
+    // ---- render 线程持有 ----
+    std::uint64_t cursor = 0;      // fanout 读位置
+    bool placed = false;           // 读位置已按主输出的排队量定好
+    bool primed = false;           // 已经写出过真实数据（此后补静音才计为欠载）
+    bool lost = false;
+    std::uint64_t lostNs = 0;      // 失效时刻；恢复出的新对象继承它，第一次写入后记录恢复时间
+    std::uint32_t lastLevel = 0;
+    std::uint32_t fadeInRemaining = 0;
+};
+
+// 实际协商到的延迟参数（启动后可查询）
+struct LatencyReport {
+    StreamMode renderMode = StreamMode::Shared;
+    std::uint32_t sampleRate = 0;
+    std::uint32_t renderPeriodFrames = 0;
+    std::uint32_t renderBufferFrames = 0;
+    std::uint32_t capturePeriodFrames = 0;   // 各来源中最长的周期（按来源采样率）
+    std::uint32_t renderTargetFrames = 0;    // render 线程每次把设备缓冲补到的水位
+    std::uint32_t targetQueueFrames = 0;     // 漂移控制的目标排队量
+    std::uint32_t alignFrames = 0;           // 有附加输出时主输出额外的对齐延迟
+    double estimatedLatencyMs = 0.0;         // capture -> render 的估算端到端延迟
 };
 
+// 各来源与各输出的电平（见 AudioEngine::meters）
+struct EngineMeters {
+    std::vector<MeterReading> sources;   // 与 sourceIds() 顺序一致
+    std::vector<MeterReading> outputs;   // 0 为主输出，其后依次为 additionalOutputIds()
+};
+
+// UI -> 音频线程的控制命令（经无锁队列传递，音频线程内不加锁）
+// 增删来源先交给 capture 线程，由它转发给 render 线程，两个线程各自更新自己的处理图
+struct EngineCommand {
+    enum class Type {
+        SetGain,          // source 的增益
+        AddSource,        // source 加入处理图
+        RemoveSource,     // source 移出处理图，最后由 render 线程交给回收队列
+        SwitchOutput,     // 改为写入 output；previousOutput 淡出并播完后回收
+        SetQueueTarget,   // 漂移控制的目标排队量改为 frames；maxFrames 大于 frames 时为自适应缓冲，目标在两者之间按抖动调整
+        ResumeSource,     // source 失效后已换上新的流：capture 线程改为读取新流并淡入，render 线程重置漂移控制
+        AddOutput,        // sink 加入附加输出，主输出的对齐延迟改为 frames
+        RemoveOutput,     // sink 移出附加输出并交给回收队列，主输出的对齐延迟改为 frames
+        SetPassthrough,   // frames 为 1：唯一的来源 source 改走直通路径（capture 线程执行后转发给 render 线程）；为 0：退出直通
+        SetRecorder,      // 第 frames 列的录音改为 recorder（nullptr 为摘下）；执行后 recorderSwaps 加一
+        SetInsert,        // 路由矩阵第 frames 格（行 × 列）的插入效果换成 insert（nullptr 为摘下），旧的交给回收队列
+    };
+    Type type = Type::SetGain;
+    CaptureSource* source = nullptr;
+    OutputSink* sink = nullptr;
+    RenderStream* output = nullptr;
+    RenderStream* previousOutput = nullptr;
+    Recorder* recorder = nullptr;
+    InsertChain* insert = nullptr;
+    float gain = 1.0f;
+    std::uint32_t frames = 0;
+    std::uint32_t maxFrames = 0;
+};
+
+// 音频线程从处理图中摘下的对象，交给非实时线程释放
+struct RetiredObject {
+    void* object = nullptr;
+    void (*destroy)(void*) = nullptr;
+};
+
+// 路由核心：与具体音频 API 无关，设备访问全部经由 AudioBackend
 class AudioEngine {
 public:
+    // 使用当前平台的默认后端
     AudioEngine();
+    explicit AudioEngine(std::unique_ptr<AudioBackend> backend);
     ~AudioEngine();
 
-    // 列出可用的输入与输出设备
-    static DeviceNames listDeviceNames();
+    // 列出可用的输入与输出设备（来自缓存，不会重新枚举）
+    DeviceList listDevices();
+    // 设备缓存：变化通知、手动刷新
+    DeviceRegistry& deviceRegistry() { return registry; }
 
-    // 启动转发：输入设备名列表（loopback 源名列表），输出设备名
+    // 启动转发：loopback 来源的端点 ID 列表，输出端点 ID
+    // 已在运行时返回 false（先 stopCopy；startSession 同样）
     bool startCopy(const std::vector<std::wstring>& inputDevices,
                const std::wstring& outputDevice,
-               DWORD bufferMs = 150);
+               std::uint32_t bufferMs = 150);
+    // 同上，可指定低延迟模式等流参数
+    bool startCopy(const std::vector<std::wstring>& inputDevices,
+               const std::wstring& outputDevice,
+               const StreamConfig& config);
     void stopCopy();
 
+    // ---- 会话：保存当前的完整设置，下次启动时直接恢复 ----
+    // 当前的来源、输出、增益、路由、插入效果、流参数与各端点实际协商到的格式（未运行时返回空会话）
+    EngineSession session() const;
+    // 按会话启动：端点按 ID 直接打开，上次协商到的格式作为提示交给后端（见 StreamConfig::cachedFormat），
+    // 之后依次恢复附加输出、增益、路由与插入效果（找不到的来源与打不开的附加输出跳过，其余照常恢复；
+    // 一个来源都没有时返回 false）。进程来源按保存的进程名重新解析 PID（见 SessionEndpoint::processName）
+    // 主输出采样率与保存时不同时，路由延迟按比例换算
+    bool startSession(const EngineSession& session);
+
+    // 启动计时：最近一次 startCopy / startSession 被调用的时刻，与 render 线程第一次把真实数据交给主输出的时刻
+    struct StartupTiming {
+        std::chrono::steady_clock::time_point requested;
+        std::chrono::steady_clock::time_point firstFrame;
+        bool rendered = false;   // 为 false 时 firstFrame 无意义
+    };
+    StartupTiming startupTiming() const;
+
+    // 最近一次 startCopy 协商到的周期与估算延迟
+    LatencyReport latencyReport() const;
+
+    // 运行统计快照（无锁，可在 UI 线程定时调用）
+    EngineStatsSnapshot statsSnapshot() const { return stats.snapshot(); }
+
+    // 控制操作与自动恢复中最近一次出错的说明（UTF-8）与累计次数，供界面与控制接口轮询；count 变化即有新的错误
+    // 启动失败、会话中某项恢复失败、设备重新打开失败等都记在这里（音频线程里的后端调用失败只计入 statsSnapshot().errors）
+    // stopCopy 与重新启动都不清除
+    struct ErrorReport {
+        std::uint64_t count = 0;
+        std::string message;
+    };
+    ErrorReport lastError() const;
+
+    // 各来源（按 capture 包）与各输出（按写给设备的帧）的峰值、RMS 与真峰值，可按显示刷新率调用
+    // 只读各电平表经三缓冲发布的读数，音频线程不会因此等待；超过 kMeterStaleMs 没有新读数
+    // （loopback 端点没有声音时不产生数据包、流已失效）的按静音返回
+    EngineMeters meters();
+
+    // 已失效、正在等待自动恢复的流（来源与输出）个数
+    // 设备被移除、禁用或格式改变后由监督线程在后台重新打开，接回原来的 ring 并淡入；输出格式改变时整体重建
+    std::size_t failedStreams() const;
+
+    // 设置第 index 个来源（与 sourceIds() 顺序一致）的线性增益，可在运行中调用
+    // 经命令队列送到 render 线程，队列满时返回 false
+    bool setSourceGain(size_t index, float gain);
+
+    // ---- 运行中重新配置：只影响相关的流，其他流不停 ----
+    // 加入 / 移除一个 loopback 来源（至少保留一个来源）
+    bool addSource(const std::wstring& deviceId);
+    bool removeSource(const std::wstring& deviceId);
+    // 切换输出设备：新 render 流在调用线程中打开并启动，render 线程切过去时旧输出淡出、新输出淡入
+    // 新设备的采样率或声道数与当前输出不同时返回 false（需要重新 startCopy）
+    bool retargetOutput(const std::wstring& deviceId);
+    // 修改缓冲目标（与 startCopy 的 bufferMs 含义相同），漂移控制器平滑地移到新的排队量
+    bool setBufferMs(std::uint32_t bufferMs);
+    // 附加输出：来源同时送到多个设备（各自的混音由路由矩阵决定），与主输出逐帧对齐（采样率、声道数可以与主输出不同）
+    // 主输出随之增加一段对齐延迟（最慢的附加输出的水位加一个周期）
+    bool addOutput(const std::wstring& deviceId);
+    bool removeOutput(const std::wstring& deviceId);
+
+    // ---- 路由矩阵：来源 × 输出 ----
+    // source 与 sourceIds() 顺序一致；output 0 为主输出，1.. 依次为 additionalOutputIds()
+    // 新加入的来源与输出默认全部接通（单位增益、无延迟）；延迟按输出采样率计，上限 kMaxRouteDelayMs
+    // 修改以快照发布，音频线程不会因此等待
+    bool setRoute(size_t source, size_t output, const Route& route);
+    Route route(size_t source, size_t output) const;
+    // 路由延迟的上限（输出帧）
+    std::uint32_t maxRouteDelayFrames() const;
+    // 路由上的插入效果（高通、均衡、噪声门、压缩 / 限幅，见 InsertChain），在混音点之前处理该路由的信号
+    // 参数经无锁队列送到 render 线程并在那里平滑过渡；压缩的 look-ahead 使这条路由延后同样的时长
+    // 新加入的来源与输出不带插入效果；主输出路由上有插入效果时不走直通路径
+    bool setInsert(size_t source, size_t output, const InsertSettings& settings);
+    InsertSettings insert(size_t source, size_t output) const;
+
+    // 直通路径：只有一个来源、没有附加输出、来源与输出格式完全相同、增益与路由都是单位且无延迟时，
+    // 不再经过重采样、混音与 fanout，capture 包与 render 缓冲之间各只拷贝一次；处理图变化时自动切回
+    // 当前所走的路径见 statsSnapshot().passthrough
+
+    bool isRunning() const { return running.load(std::memory_order_acquire); }
+    // 当前来源（按加入顺序）与输出的端点 ID
+    std::vector<std::wstring> sourceIds() const;
+    std::wstring outputId() const;
+    std::vector<std::wstring> additionalOutputIds() const;
+
+    // ---- 录音：把送往某个输出的混音（路由矩阵中该列在混音点的数据）写进 WAV / W64 文件 ----
+    // output 与 setRoute 相同（0 为主输出），格式为输出格式的 float32；音频线程只把帧推进无锁 ring，
+    // 由录音自己的线程写盘，磁盘跟不上时在文件中补静音而不是让音频等待（见 Recorder）
+    // 同一输出再次开始会先结束上一段；移除该输出、stopCopy、输出格式改变导致整体重建时结束
+    bool startRecording(size_t output, const std::filesystem::path& path, const RecorderOptions& options = {});
+    bool stopRecording(size_t output);
+    // 各输出的录音状态（与 meters().outputs 顺序一致，没有在录的 active 为 false）
+    std::vector<RecorderStatus> recordingStatus() const;
+
+    AudioBackend& backend() const { return *audioBackend; }
+
 private:
+    static constexpr std::size_t kMaxSources = 16;
+    // 附加输出个数上限（加上主输出不超过 WaitForMultipleObjects 的限制）
+    static constexpr std::size_t kMaxSinks = 8;
+    // ring 按该缓冲上限预留，运行中调大缓冲目标时不必重新分配
+    static constexpr std::uint32_t kMaxBufferMs = 500;
+    // 路由延迟上限；按路由混音时每次最多混这么多帧（历史容量 = 延迟上限 + 该帧数）
+    static constexpr std::uint32_t kMaxRouteDelayMs = 1000;
+    static constexpr std::size_t kRouteBlockFrames = 1024;
+    // 路由矩阵的格数（插入效果按格存放）
+    static constexpr std::size_t kRouteCells = kMaxSources * (kMaxSinks + 1);
+    // 切换输出时的淡出 / 淡入长度
+    static constexpr std::uint32_t kCrossfadeMs = 20;
+    // 音频线程等待事件的超时：失效的设备不再触发事件，超时后检查一遍流的状态
+    static constexpr std::uint32_t kStallTimeoutMs = 200;
+    // 失效的设备暂时打不开时的重试间隔
+    static constexpr std::uint32_t kRecoveryRetryMs = 500;
+    // 电平读数超过该时长没有更新即视为静音
+    static constexpr std::uint32_t kMeterStaleMs = 100;
+    // 停止录音时等待 render 线程摘下它的上限（render 线程至少每 kStallTimeoutMs 执行一次命令）
+    static constexpr std::uint32_t kRecorderDetachMs = 5 * kStallTimeoutMs;
+    // 自适应缓冲：目标 = 下限 + kJitterMargin 倍到达抖动；抖动下降时按 kJitterReleaseMs 的时间常数回落，
+    // 目标变化超过 kAdaptiveStepMs 才更新（漂移控制器再平滑地移过去）
+    static constexpr double kJitterMargin = 4.0;
+    static constexpr std::uint32_t kJitterReleaseMs = 10000;
+    static constexpr std::uint32_t kAdaptiveStepMs = 2;
+    // 两个包的到达间隔超过该值（来源暂时无声、不产生数据包）时不计入抖动
+    static constexpr std::uint32_t kJitterGapMs = 200;
+
+    // 持有 controlMutex 时调用：startCopy / stopCopy 的主体（不含监督线程）
+    // restart 为 true 表示失效后的自动重建：保留累计统计，输出从静音淡入
+    bool startLocked(const std::vector<std::wstring>& inputIds, const std::wstring& outputId,
+                     const StreamConfig& config, bool restart);
+    // 持有 controlMutex 时调用：startCopy / startSession 的入口检查，已在运行时记下错误并返回 false
+    // （restartLocked 在 stopThreads 之后直接调用 startLocked，不经过这里）
+    bool checkNotRunning() const;
+    // 记下一次出错（见 lastError）；控制线程与监督线程调用，可以持有 controlMutex
+    void reportError(std::string message) const;
+    // 启动监督线程（已在运行时不做任何事）
+    void startSupervisor();
+    // 置 running 为 false，等待两个音频线程退出并回收队列中的对象
+    void stopThreads();
+    // 停止并释放所有流
+    void releaseStreams();
+
+    // startSession：会话中的来源在当前系统中的 ID，找不到时为空
+    std::wstring resolveSessionSource(const SessionEndpoint& endpoint);
+    // 打开端点 id 时的流参数：startSession 期间带上会话中该端点的格式提示
+    StreamConfig configFor(const std::wstring& id) const;
+
+    // 控制线程：打开一个 loopback 来源并分配好它的全部缓冲（不启动）
+    std::unique_ptr<CaptureSource> createSource(const DeviceInfo& device);
+    // 按来源 ID 打开 loopback 流：端点在该 render 端点上 loopback，进程来源按当前输出格式打开进程 loopback
+    std::unique_ptr<CaptureStream> openSourceStream(const std::wstring& id);
+    // 控制线程：给来源换上 stream，并按其格式建好重采样器与静音缓冲（capture 线程此时不能在读这个来源）
+    void attachCapture(CaptureSource& source, std::unique_ptr<CaptureStream> stream);
+    // 唤醒 capture 线程（它可能正在等待某个已失效来源的旧流）
+    void wakeCaptureThread();
+    // 控制线程：打开并启动一个附加输出，按主输出格式建好重采样器与声道映射
+    std::unique_ptr<OutputSink> createSink(const DeviceInfo& device);
+    // 持有 controlMutex 时调用：加入附加输出并投递给 render 线程
+    bool addOutputLocked(const std::wstring& deviceId);
+    // 按当前附加输出计算主输出的对齐延迟（主输出帧）
+    std::uint32_t alignmentFrames() const;
+    // 未被当前来源 / 附加输出占用的矩阵行、列
+    std::size_t freeRouteRow() const;
+    std::size_t freeRouteColumn() const;
+    // 第 output 个输出（0 为主输出）在矩阵中的列
+    std::size_t routeColumnOf(size_t output) const;
+    // 持有 controlMutex 时调用：设置 / 清除矩阵中一格的插入效果
+    bool setInsertLocked(size_t row, size_t column, const InsertSettings& settings);
+    void clearInsertLocked(size_t row, size_t column);
+    // 持有 controlMutex 时调用：当前处理图能否走直通路径；变化时通知两个音频线程
+    bool passthroughEligible() const;
+    void updatePassthrough();
+    // 持有 controlMutex 时调用：从 render 线程摘下 column 的录音并写完文件
+    // render 线程没能及时摘下时先留在 orphanedRecorders，音频线程退出后再写完
+    void stopRecordingLocked(size_t column);
+    // 音频线程都已退出：结束所有录音
+    void finishRecordings();
+
+    // 监督线程：平时阻塞等待，音频线程报告流失效后重新打开，打不开时按 kRecoveryRetryMs 重试
+    void superviseLoop();
+    // 音频线程调用：唤醒监督线程（不加锁）
+    void wakeSupervisor();
+    // 依次恢复失效的输出与来源；全部恢复（或已停止）时返回 true
+    bool recoverStreams();
+    bool recoverOutput();
+    bool recoverSource(CaptureSource& source);
+    bool recoverSink(size_t index);
+    // 输出格式改变后按原来的来源、输出与设置重建
+    bool restartLocked();
+    // 按 bufferMs 与当前输出、来源的周期计算目标排队量（自适应缓冲时为下限）
+    std::uint32_t queueTargetFrames() const;
+    // 不考虑 bufferMs 时的最低排队量；自适应缓冲的上限
+    std::uint32_t queueFloorFrames() const;
+    std::uint32_t queueCeilingFrames() const;
+    // 重新填写 latency（持有 controlMutex 时调用）
+    void updateLatencyReport();
+
+    // capture 线程：等待各来源的 capture 事件，把数据推入 ring
     void captureLoop();
-    bool syncSampleRate(Microsoft::WRL::ComPtr<IAudioClient> inputClient,
-                        Microsoft::WRL::ComPtr<IAudioClient> outputClient);
+    // render 线程：等待 render 事件，从 ring 拉取设备需要的帧数
+    void renderLoop();
+    // 把某个来源当前所有可读的包推入其 ring
+    void readSource(CaptureSource& source);
+    // capture 线程：更新来源的到达抖动
+    void trackArrival(CaptureSource& source, const CapturePacket& packet, std::uint64_t now);
+    // capture 线程：包带不连续标志，丢失的帧用补偿信号补进 ring；返回丢弃的帧数
+    size_t concealGap(CaptureSource& source, const CapturePacket& packet);
+    // 生成 frames 帧补偿信号并计入统计（音频线程）
+    std::size_t concealFrames(PacketLossConcealer& concealer, float* out, size_t frames);
+    // capture 线程：来源的流失效，停止读取并交给监督线程
+    void markSourceLost(CaptureSource& source);
+    // render 线程：输出失效，停止写入并交给监督线程
+    void markOutputLost();
+    // 将各来源 ring 中的数据混音写进 fanout，再把主输出的 render 缓冲补到目标水位，数据不足时补静音
+    void fillRender();
+    // 按路由矩阵从各来源 ring 混出 frames 帧，写进 fanout 中主输出与各附加输出的 bus
+    void mixToFanout(size_t frames);
+    // render 线程：本周期能否走直通（除控制线程的通知外，再按 render 线程自己的处理图确认）
+    bool directPath();
+    // 直通：把唯一来源 ring 中的 frames 帧直接拷进设备缓冲
+    void copyDirect(float* out, size_t frames);
+    // render 线程：把各附加输出补到各自的水位
+    void serviceSinks();
+    void serviceSink(OutputSink& sink, double masterQueued);
+    void markSinkLost(OutputSink& sink);
+    // 把一段交错 float32 帧（已是输出声道数）写入来源 ring，必要时经过重采样；返回丢弃的输入帧数
+    // 同时记入来源的补偿器历史，刚补过丢失的帧时开头一段先与补偿信号交叉淡化
+    size_t pushToRing(CaptureSource& source, const float* frames, size_t frameCount);
+    size_t writeRing(CaptureSource& source, const float* frames, size_t frameCount);
+    // 恢复后的来源：对刚写入 ring、尚未提交的帧做淡入
+    void fadeInRegions(CaptureSource& source, const SpscRing<float>::Regions& regions, size_t frames);
+    // 根据各来源的排队量更新漂移控制器；delayed 为主输出延迟线中的帧数
+    void updateDrift(std::uint32_t padding, size_t delayed);
+    // 自适应缓冲：按各来源的到达抖动调整目标排队量；elapsedFrames 为距上次调用经过的输出帧数
+    void adaptQueueTarget(double elapsedFrames);
+    // 按各来源的采集时间戳测量 capture -> render 延迟；downstream 为 ring 之后排队的帧数（延迟线 + 设备缓冲）
+    void measureLatency(size_t downstream);
 
-    HANDLE captureEvent = nullptr;
-    HANDLE renderEvent = nullptr;
-    WAVEFORMATEX* mixFormat = nullptr;
+    // 控制线程投递命令（多个控制线程之间用 controlMutex 串行化）；render 线程每个周期开头执行
+    bool postCommand(const EngineCommand& command);
+    // 同上，调用方已持有 controlMutex
+    bool postCommandLocked(const EngineCommand& command);
+    // 把当前的目标排队量投递给 render 线程
+    bool postQueueTarget();
+    void applyCommands();
+    // capture 线程每次唤醒时执行增删来源的命令并转发给 render 线程
+    void applyCaptureCommands();
+    // render 线程：切换输出（旧输出写一段淡出后留待播完）
+    void switchOutput(RenderStream* next);
+    // render 线程：把刚混好的一段数据带淡出写进旧输出
+    void writeFadeOut(const float* frames, size_t frameCount);
+    // render 线程：按当前输出设置水位与淡入
+    void attachOutput(RenderStream* stream);
+    // 线程退出后释放仍在队列中、已经不属于任何一方的对象
+    void releasePendingCommands();
 
+    // render 线程调用：把对象交给非实时线程释放；控制线程在各入口处调用 reclaim 回收
+    template <typename T>
+    void retire(T* object) {
+        const RetiredObject item{ object, [](void* p) { delete static_cast<T*>(p); } };
+        if (retired.push(&item, 1) == 0) leakedObjects.fetch_add(1, std::memory_order_relaxed);
+    }
+    void reclaim();
+
+    std::unique_ptr<AudioBackend> audioBackend;
+    // 必须在 audioBackend 之后构造、之前析构
+    DeviceRegistry registry;
+
+    // 音频线程只读 running，不接触 controlMutex；controlMutex 只串行化各控制入口
     std::atomic<bool> running{ false };
-    std::mutex audioMutex;
+    mutable CheckedMutex controlMutex;
+    // 只保护 errorState，持有期间不再获取其他锁
+    mutable CheckedMutex errorMutex;
+    mutable ErrorReport errorState;
+
+    static constexpr std::size_t kQueueSize = 256;
+    // 控制 -> render、控制 -> capture、capture -> render 三条命令队列
+    SpscRing<EngineCommand> commands{ kQueueSize, 1 };
+    SpscRing<EngineCommand> captureCommands{ kQueueSize, 1 };
+    SpscRing<EngineCommand> forwarded{ kQueueSize, 1 };
+    SpscRing<RetiredObject> retired{ kQueueSize, 1 };
+    // 回收队列满时只能放弃释放（宁可泄漏也不在音频线程里 delete）
+    std::atomic<std::uint64_t> leakedObjects{ 0 };
 
     std::thread captureThread;
+    std::thread renderThread;
+    // 两个音频线程都登记完（enterAudioThread）后才开始等待事件
+    std::unique_ptr<std::latch> threadsReady;
 
-    std::vector<Microsoft::WRL::ComPtr<IAudioClient>> inputClients;
-    Microsoft::WRL::ComPtr<IAudioClient> outputClient;
+    // 监督线程：startCopy 启动、stopCopy 结束；supervisorWake 每次加一并 notify 唤醒它
+    std::thread supervisorThread;
+    std::atomic<bool> supervising{ false };
+    std::atomic<std::uint32_t> supervisorWake{ 0 };
+    // 输出失效后由 render 线程置位，换上新的输出后清除
+    std::atomic<bool> outputFailed{ false };
 
-    // 以下成员与现有实现匹配（如需扩展多输入，请在此处增加 captureClients、device ids 等）
-    Microsoft::WRL::ComPtr<IAudioCaptureClient> captureClient;
-    Microsoft::WRL::ComPtr<IAudioRenderClient> renderClient;
-};
\ No newline at end of file
+    // ---- 控制线程持有（controlMutex 保护）----
+    // 每个选中的来源各自一套 capture 流与 ring（render 暂时写不下的帧先暂存在 ring 中）
+    std::vector<std::unique_ptr<CaptureSource>> sources;
+    std::vector<std::unique_ptr<OutputSink>> sinks;
+    std::unique_ptr<RenderStream> renderStream;
+    std::wstring renderId;
+    StreamConfig streamConfig;
+    // startSession 期间各端点上次协商到的格式（端点 ID -> 格式与模式），其余时候为空
+    std::map<std::wstring, SessionEndpoint> formatHints;
+    // 最近一次 startCopy / startSession 被调用的时刻
+    std::chrono::steady_clock::time_point startRequested;
+    LatencyReport latency;
+    StreamFormat outputFormat;
+    std::uint32_t bufferMs = 0;
+    // 当前输出的水位、各来源中最长的 capture 周期（按来源 / 输出采样率）
+    std::uint32_t outputTargetFrames = 0;
+    std::uint32_t maxCapturePeriod = 0;
+    std::size_t maxCapturePeriodOut = 0;
+    std::uint32_t alignFrames = 0;
+    // 最近一次通知音频线程的直通状态
+    bool passthroughPosted = false;
+    // 路由矩阵：控制线程修改并发布，render 线程混音时读取快照
+    RoutingMatrix routes{ kMaxSources, kMaxSinks + 1 };
+    // 各列（与路由矩阵相同）的录音；已投递的 SetRecorder 个数，render 线程执行到这里才算摘下
+    std::array<std::unique_ptr<Recorder>, kMaxSinks + 1> recorders;
+    std::vector<std::unique_ptr<Recorder>> orphanedRecorders;
+    std::uint32_t postedRecorderSwaps = 0;
+    std::atomic<std::uint32_t> recorderSwaps{ 0 };
+    // 各格的插入效果参数；已交给 render 线程的效果链（归 render 线程所有，控制线程只向它投递参数）
+    std::array<InsertSettings, kRouteCells> insertSettings{};
+    std::array<InsertChain*, kRouteCells> insertChains{};
+
+    // ---- capture 线程持有：当前处理图中的来源与等待的流 ----
+    std::array<CaptureSource*, kMaxSources> captureActive{};
+    std::array<AudioStream*, kMaxSources> captureWait{};
+    std::size_t captureCount = 0;
+
+    // ---- render 线程持有 ----
+    std::array<CaptureSource*, kMaxSources> renderActive{};
+    std::size_t renderCount = 0;
+    RenderStream* output = nullptr;
+    // 切换后仍在播放淡出尾巴的旧输出
+    RenderStream* drainingOutput = nullptr;
+    // 启动后是否已经交出过真实数据；第一次交出的时刻（steady_clock 纳秒）发布给控制线程，0 表示还没有
+    bool renderStarted = false;
+    std::atomic<std::int64_t> firstFrameNs{ 0 };
+    std::array<OutputSink*, kMaxSinks> renderSinks{};
+    std::size_t renderSinkCount = 0;
+    // 等待主输出与各附加输出的事件
+    std::array<AudioStream*, kMaxSinks + 1> renderWait{};
+    // 混音结果：每个输出一条 bus（按矩阵列）。主输出读位置落后写入位置 renderAlign 帧（对齐延迟线）
+    std::unique_ptr<FanoutRing> fanout;
+    // 写给主输出的帧的电平（startCopy 中按输出格式建好，render 线程写入，控制线程读取）
+    std::unique_ptr<LevelMeter> outputMeter;
+    // 主输出欠载时的补偿（startCopy 中按输出格式建好）
+    std::unique_ptr<PacketLossConcealer> outputConcealer;
+    // 各列的录音：混好（或直通拷好）的帧推进它的 ring
+    std::array<Recorder*, kMaxSinks + 1> renderRecorders{};
+    // 各格的插入效果（与路由矩阵同样按 行 × 列 排列）
+    std::array<InsertChain*, kRouteCells> renderInserts{};
+    // 本周期要混的 bus：主输出与各附加输出的列
+    std::array<std::size_t, kMaxSinks + 1> renderBuses{};
+    std::uint64_t masterCursor = 0;
+    std::uint32_t renderAlign = 0;
+    // 控制线程通知的直通状态、上个周期实际是否走了直通
+    bool renderPassthrough = false;
+    bool renderDirect = false;
+    std::uint32_t renderBufferFrames = 0;
+    std::uint32_t renderTargetFrames = 0;
+    std::uint32_t queueTarget = 0;
+    // 目标排队量的上下限（相等即为固定目标）与保持中的到达抖动（输出帧）
+    std::uint32_t queueFloor = 0;
+    std::uint32_t queueCeiling = 0;
+    double jitterHold = 0.0;
+    // 淡入 / 淡出长度：startCopy 中设定，运行中不变（capture 线程恢复来源时也按它淡入）
+    std::uint32_t crossfadeFrames = 0;
+    std::uint32_t fadeInRemaining = 0;
+    bool fadeOutPending = false;
+    // 已经写出过真实数据（此后补静音才计为欠载）
+    bool renderPrimed = false;
+    // 当前输出已失效（不再写入）、发现失效的时刻（后端时基，换上的新输出第一次写入后清零）
+    bool outputLost = false;
+    std::uint64_t outputLostNs = 0;
+
+    // 混音：startCopy 中按输出格式创建，音频线程内不再分配
+    std::unique_ptr<Mixer> mixer;
+    std::array<MixInput, kMaxSources> mixInputs{};
+    // 每个周期从 mixInputs 中挑出未失效的来源，决定本次能输出多少帧
+    std::array<MixInput, kMaxSources> liveInputs{};
+
+    // 上次写入后 render 缓冲中的帧数，用来推算设备在两次更新之间消耗的帧数
+    std::uint32_t lastRenderLevel = 0;
+
+    EngineStats stats;
+};
@@ -0,0 +1,174 @@
+#include "Concealer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+    std::size_t framesFor(std::uint32_t ms, std::uint32_t sampleRate) {
+        return std::max<std::size_t>(1, static_cast<std::size_t>(ms) * sampleRate / 1000);
+    }
+
+    // 两段单声道信号的互相关与后一段的能量，stride 为抽样步长（粗搜索时跳着算）
+    void correlate(const float *x, const float *y, std::size_t count, std::size_t stride, double &xy, double &yy) {
+        xy = 0.0;
+        yy = 0.0;
+        for (std::size_t i = 0; i < count; i += stride) {
+            xy += double(x[i]) * y[i];
+            yy += double(y[i]) * y[i];
+        }
+    }
+}
+
+PacketLossConcealer::PacketLossConcealer(std::size_t channels, std::uint32_t sampleRate)
+    : chans(std::max<std::size_t>(1, channels)),
+      minLag(framesFor(kMinLagMs, sampleRate)),
+      maxLag(std::max(framesFor(kMaxLagMs, sampleRate), minLag)),
+      matchFrames(framesFor(kMatchMs, sampleRate)),
+      holdFrames(framesFor(kHoldMs, sampleRate)),
+      fadeFrames(framesFor(kFadeMs, sampleRate)),
+      overlapFrames(framesFor(kOverlapMs, sampleRate)) {
+    // 周期尾部要与再往前一个周期交叉淡化，搜索时比较窗口也要整段落在历史内
+    historyFrames = std::max(2 * maxLag, matchFrames + maxLag);
+    history.assign(2 * historyFrames * chans, 0.0f);
+    cycle.assign(maxLag * chans, 0.0f);
+    mono.assign(historyFrames, 0.0f);
+    continuation.assign(overlapFrames * chans, 0.0f);
+}
+
+void PacketLossConcealer::reset() {
+    std::fill(history.begin(), history.end(), 0.0f);
+    writePos = 0;
+    filled = 0;
+    active = false;
+    silent = false;
+    position = 0;
+}
+
+void PacketLossConcealer::observe(const float *frames, std::size_t count) {
+    active = false;
+    record(frames, count);
+}
+
+void PacketLossConcealer::record(const float *frames, std::size_t count) {
+    // 只有最后 historyFrames 帧会留下
+    if (count > historyFrames) {
+        frames += (count - historyFrames) * chans;
+        count = historyFrames;
+    }
+    for (std::size_t i = 0; i < count; ++i) {
+        const float *frame = frames + i * chans;
+        std::memcpy(history.data() + writePos * chans, frame, chans * sizeof(float));
+        std::memcpy(history.data() + (writePos + historyFrames) * chans, frame, chans * sizeof(float));
+        if (++writePos == historyFrames) writePos = 0;
+    }
+    filled = std::min(historyFrames, filled + count);
+}
+
+void PacketLossConcealer::observeSilence(std::size_t) {
+    active = false;
+    filled = 0;
+}
+
+void PacketLossConcealer::prepare() {
+    active = true;
+    silent = true;
+    lag = 0;
+    phase = 0;
+    position = 0;
+    if (filled < historyFrames) return;
+
+    // 时间顺序的历史（最早 -> 最新）
+    const float *h = history.data() + writePos * chans;
+    const std::size_t n = historyFrames;
+    double energy = 0.0;
+    for (std::size_t i = 0; i < n; ++i) {
+        float sum = 0.0f;
+        for (std::size_t c = 0; c < chans; ++c) sum += h[i * chans + c];
+        mono[i] = sum;
+    }
+    const float *x = mono.data() + n - matchFrames;
+    for (std::size_t i = 0; i < matchFrames; ++i) energy += double(x[i]) * x[i];
+    if (energy < 1e-12 * double(matchFrames)) return;
+
+    // 末尾 matchFrames 帧与往前 L 帧的一段做归一化互相关：先隔一个取样粗搜，再在最优值附近逐个细搜
+    auto score = [&](std::size_t l, std::size_t stride) {
+        double xy = 0.0, yy = 0.0;
+        correlate(x, x - l, matchFrames, stride, xy, yy);
+        return yy > 0.0 ? xy / std::sqrt(yy) : -1.0;
+    };
+    std::size_t best = maxLag;
+    double bestScore = -2.0;
+    for (std::size_t l = minLag; l <= maxLag; l += 2) {
+        const double s = score(l, 2);
+        if (s > bestScore) {
+            bestScore = s;
+            best = l;
+        }
+    }
+    bestScore = -2.0;
+    const std::size_t from = std::max(minLag, best - 1);
+    const std::size_t to = std::min(maxLag, best + 1);
+    for (std::size_t l = from; l <= to; ++l) {
+        const double s = score(l, 1);
+        if (s > bestScore) {
+            bestScore = s;
+            lag = l;
+        }
+    }
+
+    // 循环的周期 = 历史最后 lag 帧；尾部逐渐换成再往前一个周期的对应位置，
+    // 使周期末尾自然地接回周期开头（与历史中 h[n - lag - 1] -> h[n - lag] 一样连续）
+    std::memcpy(cycle.data(), h + (n - lag) * chans, lag * chans * sizeof(float));
+    const std::size_t overlap = std::max<std::size_t>(1, lag / 4);
+    for (std::size_t k = lag - overlap; k < lag; ++k) {
+        const float t = static_cast<float>(k - (lag - overlap) + 1) / static_cast<float>(overlap + 1);
+        for (std::size_t c = 0; c < chans; ++c) {
+            float &v = cycle[k * chans + c];
+            v = (1.0f - t) * v + t * h[(n - 2 * lag + k) * chans + c];
+        }
+    }
+    silent = false;
+}
+
+std::size_t PacketLossConcealer::synthesize(float *out, std::size_t count) {
+    std::size_t audible = 0;
+    for (std::size_t i = 0; i < count; ++i, ++position) {
+        float gain = 0.0f;
+        if (!silent && position < holdFrames) gain = 1.0f;
+        else if (!silent && position < holdFrames + fadeFrames)
+            gain = 1.0f - static_cast<float>(position - holdFrames + 1) / static_cast<float>(fadeFrames + 1);
+        if (gain == 0.0f) {
+            std::memset(out + i * chans, 0, (count - i) * chans * sizeof(float));
+            position += count - i;
+            break;
+        }
+        const float *src = cycle.data() + phase * chans;
+        for (std::size_t c = 0; c < chans; ++c) out[i * chans + c] = src[c] * gain;
+        if (++phase == lag) phase = 0;
+        ++audible;
+    }
+    return audible;
+}
+
+std::size_t PacketLossConcealer::conceal(float *out, std::size_t count) {
+    if (!active) prepare();
+    const std::size_t audible = synthesize(out, count);
+    // 历史记的是实际送出的信号：补偿之后紧接着再丢数据时，下一次补偿从这里接着找周期，不会跨过断点
+    record(out, count);
+    return audible;
+}
+
+void PacketLossConcealer::play(float *frames, std::size_t count) {
+    if (active) {
+        // 补偿信号的延续逐帧淡出、真实数据淡入
+        const std::size_t overlap = std::min(count, overlapFrames);
+        synthesize(continuation.data(), overlap);
+        for (std::size_t i = 0; i < overlap; ++i) {
+            const float t = static_cast<float>(i + 1) / static_cast<float>(overlap + 1);
+            float *frame = frames + i * chans;
+            for (std::size_t c = 0; c < chans; ++c) frame[c] = t * frame[c] + (1.0f - t) * continuation[i * chans + c];
+        }
+    }
+    observe(frames, count);
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// 丢包 / 欠载补偿（与平台无关）：记住最近送出的一段信号（含补偿信号本身），数据接不上时按波形相似度找出基音周期，
+// 用最后一个周期循环延拓（周期首尾交叉淡化，不产生断点），持续 kHoldMs 后在 kFadeMs 内淡出成静音；
+// 真实数据回来时从延拓的信号交叉淡化过去。构造时完成全部分配，音频线程内不分配内存
+class PacketLossConcealer {
+public:
+    // 基音周期的搜索范围（50..400 Hz）与比较窗口
+    static constexpr std::uint32_t kMinLagMs = 2;
+    static constexpr std::uint32_t kMaxLagMs = 20;
+    static constexpr std::uint32_t kMatchMs = 10;
+    // 原样延拓的时长、之后淡出到静音的时长、真实数据回来时的交叉淡化长度
+    static constexpr std::uint32_t kHoldMs = 20;
+    static constexpr std::uint32_t kFadeMs = 30;
+    static constexpr std::uint32_t kOverlapMs = 5;
+
+    PacketLossConcealer(std::size_t channels, std::uint32_t sampleRate);
+
+    std::size_t channels() const { return chans; }
+    // 一次补偿中有声音的最长帧数（之后为静音）
+    std::size_t maxConcealFrames() const { return holdFrames + fadeFrames; }
+
+    // ---- 音频线程 ----
+
+    // 真实数据（交错，原地修改）：正在补偿时开头一段与补偿信号交叉淡化，然后记入历史
+    void play(float *frames, std::size_t count);
+    // 只记入历史（调用方确定没有在补偿，例如数据不需要修改时）
+    void observe(const float *frames, std::size_t count);
+    // 送入了 count 帧静音：历史作废，之后的补偿输出静音
+    void observeSilence(std::size_t count);
+    // 接着上次送出的数据生成 count 帧补偿信号（count 可以为 0，只开始补偿、让下一段真实数据淡入）
+    // 返回其中有声音的帧数（历史不足或已淡出时为静音）
+    std::size_t conceal(float *out, std::size_t count);
+    bool concealing() const { return active; }
+    void reset();
+
+private:
+    // 追加到历史末尾
+    void record(const float *frames, std::size_t count);
+    // 在历史中找与末尾最相似的周期（按声道和做归一化互相关），并生成可循环的一个周期
+    void prepare();
+    // 接着 position 生成 count 帧（含增益包络）写入 out，返回有声音的帧数
+    std::size_t synthesize(float *out, std::size_t count);
+
+    std::size_t chans;
+    std::size_t minLag;
+    std::size_t maxLag;
+    std::size_t matchFrames;
+    std::size_t holdFrames;
+    std::size_t fadeFrames;
+    std::size_t overlapFrames;
+
+    // 交错历史：长度 2 * historyFrames 的镜像缓冲，[writePos, writePos + historyFrames) 始终是最近的连续帧
+    std::size_t historyFrames;
+    std::vector<float> history;
+    std::size_t writePos = 0;
+    std::size_t filled = 0;      // 历史中有效（连续、非作废）的帧数
+
+    // 补偿状态：循环的周期（交错）、周期长度、周期内相位、已生成的帧数
+    std::vector<float> cycle;
+    std::vector<float> mono;
+    std::vector<float> continuation;   // 交叉淡化时补偿信号的延续
+    bool active = false;
+    bool silent = false;
+    std::size_t lag = 0;
+    std::size_t phase = 0;
+    std::size_t position = 0;
+};
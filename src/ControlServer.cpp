@@ -0,0 +1,553 @@
+#include "ControlServer.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <sstream>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <afunix.h>
+#else
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#include "AudioEngine.h"
+#include "Session.h"
+#include "Utf8.h"
+
+namespace {
+#ifdef _WIN32
+    using SocketHandle = SOCKET;
+    using PollEntry = WSAPOLLFD;
+    const SocketHandle kInvalidSocket = INVALID_SOCKET;
+    void closeSocket(SocketHandle s) { closesocket(s); }
+    int pollSockets(PollEntry *entries, std::size_t count, int timeoutMs) {
+        return WSAPoll(entries, static_cast<ULONG>(count), timeoutMs);
+    }
+    bool setNonBlocking(SocketHandle s) {
+        u_long enable = 1;
+        return ioctlsocket(s, FIONBIO, &enable) == 0;
+    }
+    bool wouldBlock() { return WSAGetLastError() == WSAEWOULDBLOCK; }
+#else
+    using SocketHandle = int;
+    using PollEntry = pollfd;
+    constexpr SocketHandle kInvalidSocket = -1;
+    void closeSocket(SocketHandle s) { ::close(s); }
+    int pollSockets(PollEntry *entries, std::size_t count, int timeoutMs) {
+        return ::poll(entries, static_cast<nfds_t>(count), timeoutMs);
+    }
+    bool setNonBlocking(SocketHandle s) {
+        const int flags = fcntl(s, F_GETFL, 0);
+        return flags >= 0 && fcntl(s, F_SETFL, flags | O_NONBLOCK) == 0;
+    }
+    bool wouldBlock() { return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR; }
+#endif
+
+#ifdef MSG_NOSIGNAL
+    constexpr int kSendFlags = MSG_NOSIGNAL;   // 对端已关闭时不触发 SIGPIPE
+#else
+    constexpr int kSendFlags = 0;
+#endif
+
+    SocketHandle handleOf(const std::intptr_t s) { return static_cast<SocketHandle>(s); }
+
+    // 连接数与缓冲上限：一行请求不会很长，推送跟不上的客户端直接断开
+    constexpr std::size_t kMaxClients = 8;
+    constexpr std::size_t kMaxLineBytes = 64 * 1024;
+    constexpr std::size_t kMaxPendingBytes = 1024 * 1024;
+    // 没有订阅时的轮询间隔（同时决定 stop 的响应时间）
+    constexpr int kIdlePollMs = 100;
+
+    std::uint64_t steadyNs() {
+        return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    float dbToGain(const double db) { return static_cast<float>(std::pow(10.0, db / 20.0)); }
+
+    bool readIndex(const JsonValue &request, const char *key, std::size_t &out) {
+        const JsonValue *value = request.find(key);
+        if (!value || !value->isNumber() || value->number() < 0 || value->number() != std::floor(value->number())) return false;
+        out = static_cast<std::size_t>(value->number());
+        return true;
+    }
+
+    // gain_db 优先，其次线性 gain；两者都没有时返回 false
+    bool readGain(const JsonValue &request, float &gain) {
+        if (const JsonValue *db = request.find("gain_db"); db && db->isNumber()) {
+            gain = dbToGain(db->number());
+            return true;
+        }
+        if (const JsonValue *linear = request.find("gain"); linear && linear->isNumber() && linear->number() >= 0) {
+            gain = static_cast<float>(linear->number());
+            return true;
+        }
+        return false;
+    }
+
+    void writeIdList(std::ostream &out, const std::vector<std::wstring> &ids) {
+        out << '[';
+        for (std::size_t i = 0; i < ids.size(); ++i) {
+            if (i) out << ',';
+            writeJsonString(out, narrowUtf8(ids[i]));
+        }
+        out << ']';
+    }
+
+    void writeLevels(std::ostream &out, const std::array<float, kMaxMeterChannels> &levels, const std::uint32_t channels) {
+        out << '[';
+        for (std::uint32_t ch = 0; ch < channels; ++ch) {
+            if (ch) out << ',';
+            out << levels[ch];
+        }
+        out << ']';
+    }
+
+    // 每路一个对象：各声道的线性峰值、RMS 与真峰值
+    void writeMeterList(std::ostream &out, const std::vector<MeterReading> &readings) {
+        out << '[';
+        for (std::size_t i = 0; i < readings.size(); ++i) {
+            const MeterReading &reading = readings[i];
+            if (i) out << ',';
+            out << "{\"peak\":";
+            writeLevels(out, reading.peak, reading.channels);
+            out << ",\"rms\":";
+            writeLevels(out, reading.rms, reading.channels);
+            out << ",\"true_peak\":";
+            writeLevels(out, reading.truePeak, reading.channels);
+            out << '}';
+        }
+        out << ']';
+    }
+
+    // 每个输出一个对象（没有在录的只有 active）
+    void writeRecordings(std::ostream &out, const std::vector<RecorderStatus> &recordings) {
+        out << '[';
+        for (std::size_t i = 0; i < recordings.size(); ++i) {
+            const RecorderStatus &status = recordings[i];
+            if (i) out << ',';
+            out << "{\"active\":" << (status.active ? "true" : "false");
+            if (status.active) {
+                out << ",\"path\":";
+                writeJsonString(out, narrowUtf8(status.path.wstring()));
+                out << ",\"frames_written\":" << status.framesWritten
+                    << ",\"frames_dropped\":" << status.framesDropped
+                    << ",\"backlog_ms\":" << status.backlogMs
+                    << ",\"peak_backlog_ms\":" << status.peakBacklogMs
+                    << ",\"unbuffered\":" << (status.unbuffered ? "true" : "false")
+                    << ",\"failed\":" << (status.failed ? "true" : "false");
+            }
+            out << '}';
+        }
+        out << ']';
+    }
+}
+
+ControlServer::ControlServer(AudioEngine &engine)
+    : engine(engine) {
+}
+
+ControlServer::~ControlServer() {
+    stop();
+}
+
+bool ControlServer::start(const std::filesystem::path &socketPath, std::string &error) {
+    stop();
+
+#ifdef _WIN32
+    WSADATA wsa;
+    if (WSAStartup(MAKEWORD(2, 2), &wsa) != 0) {
+        error = "WSAStartup 失败";
+        return false;
+    }
+#endif
+
+    const auto fail = [&](const std::string &reason) {
+#ifdef _WIN32
+        WSACleanup();
+#endif
+        error = reason;
+        return false;
+    };
+
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    const std::string native = narrowUtf8(socketPath.wstring());
+    if (native.empty() || native.size() >= sizeof(address.sun_path)) return fail("套接字路径为空或过长");
+    std::memcpy(address.sun_path, native.data(), native.size());
+
+    const SocketHandle s = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (s == kInvalidSocket) return fail("无法创建套接字");
+    // 上次异常退出留下的套接字文件
+    std::error_code ignored;
+    std::filesystem::remove(socketPath, ignored);
+    if (::bind(s, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) != 0 ||
+        ::listen(s, static_cast<int>(kMaxClients)) != 0 || !setNonBlocking(s)) {
+        closeSocket(s);
+        return fail("无法监听 " + native);
+    }
+
+    path = socketPath;
+    listener = static_cast<std::intptr_t>(s);
+    serving.store(true, std::memory_order_release);
+    thread = std::thread(&ControlServer::serveLoop, this);
+    return true;
+}
+
+void ControlServer::stop() {
+    if (!thread.joinable()) return;
+    serving.store(false, std::memory_order_release);
+    thread.join();
+
+    for (auto &client : clients) closeSocket(handleOf(client.socket));
+    clients.clear();
+    closeSocket(handleOf(listener));
+    listener = -1;
+    std::error_code ignored;
+    std::filesystem::remove(path, ignored);
+#ifdef _WIN32
+    WSACleanup();
+#endif
+}
+
+void ControlServer::serveLoop() {
+    std::vector<PollEntry> entries;
+    while (serving.load(std::memory_order_acquire)) {
+        // 等到最近一个订阅到期（最多 kIdlePollMs）
+        const std::uint64_t now = steadyNs();
+        int timeoutMs = kIdlePollMs;
+        for (const auto &client : clients) {
+            if (client.intervalMs == 0) continue;
+            const std::uint64_t due = client.nextEventNs > now ? (client.nextEventNs - now) / 1000000 : 0;
+            timeoutMs = std::min(timeoutMs, static_cast<int>(due));
+        }
+
+        entries.assign(clients.size() + 1, PollEntry{});
+        entries[0].fd = handleOf(listener);
+        entries[0].events = POLLIN;
+        for (std::size_t i = 0; i < clients.size(); ++i) {
+            entries[i + 1].fd = handleOf(clients[i].socket);
+            entries[i + 1].events = static_cast<short>(POLLIN | (clients[i].output.empty() ? 0 : POLLOUT));
+        }
+        if (pollSockets(entries.data(), entries.size(), timeoutMs) < 0 && !wouldBlock()) break;
+
+        // 先处理已有连接（entries 与 clients 下标对应），再接受新连接
+        for (std::size_t i = 0; i < clients.size(); ++i) {
+            const short revents = entries[i + 1].revents;
+            if (revents & (POLLIN | POLLHUP | POLLERR)) readClient(clients[i]);
+            if ((revents & POLLOUT) && !clients[i].closing) flushClient(clients[i]);
+        }
+        if (entries[0].revents & POLLIN) acceptClients();
+
+        pushEvents(steadyNs());
+
+        const auto closed = std::remove_if(clients.begin(), clients.end(), [](const Client &client) {
+            if (client.closing) closeSocket(handleOf(client.socket));
+            return client.closing;
+        });
+        clients.erase(closed, clients.end());
+    }
+}
+
+void ControlServer::acceptClients() {
+    while (true) {
+        const SocketHandle s = ::accept(handleOf(listener), nullptr, nullptr);
+        if (s == kInvalidSocket) return;
+        if (clients.size() >= kMaxClients || !setNonBlocking(s)) {
+            closeSocket(s);
+            continue;
+        }
+        Client client;
+        client.socket = static_cast<std::intptr_t>(s);
+        clients.push_back(std::move(client));
+    }
+}
+
+void ControlServer::readClient(Client &client) {
+    char buffer[4096];
+    while (!client.closing) {
+        const auto received = ::recv(handleOf(client.socket), buffer, sizeof(buffer), 0);
+        if (received == 0) {
+            client.closing = true;
+            return;
+        }
+        if (received < 0) {
+            if (!wouldBlock()) client.closing = true;
+            break;
+        }
+        client.input.append(buffer, static_cast<std::size_t>(received));
+    }
+
+    std::size_t begin = 0;
+    for (std::size_t newline; (newline = client.input.find('\n', begin)) != std::string::npos; begin = newline + 1) {
+        std::string line = client.input.substr(begin, newline - begin);
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (!line.empty()) handleLine(client, line);
+    }
+    client.input.erase(0, begin);
+    if (client.input.size() > kMaxLineBytes) client.closing = true;
+    flushClient(client);
+}
+
+void ControlServer::flushClient(Client &client) {
+    while (!client.output.empty() && !client.closing) {
+        const auto sent = ::send(handleOf(client.socket), client.output.data(), static_cast<int>(client.output.size()), kSendFlags);
+        if (sent < 0) {
+            if (!wouldBlock()) client.closing = true;
+            break;
+        }
+        client.output.erase(0, static_cast<std::size_t>(sent));
+    }
+    if (client.output.size() > kMaxPendingBytes) client.closing = true;
+}
+
+void ControlServer::handleLine(Client &client, const std::string &line) {
+    std::ostringstream reply;
+    JsonValue request;
+    if (!parseJson(line, request) || !request.isObject()) {
+        reply << R"({"id":null,"ok":false,"error":"invalid json"})" << '\n';
+        client.output += reply.str();
+        return;
+    }
+
+    std::string result;
+    std::string error;
+    const bool ok = execute(client, request, result, error);
+    reply << "{\"id\":";
+    if (const JsonValue *id = request.find("id")) id->write(reply);
+    else reply << "null";
+    if (ok) {
+        reply << ",\"ok\":true,\"result\":" << (result.empty() ? "{}" : result);
+    } else {
+        reply << ",\"ok\":false,\"error\":";
+        writeJsonString(reply, error);
+    }
+    reply << "}\n";
+    client.output += reply.str();
+}
+
+bool ControlServer::execute(Client &client, const JsonValue &request, std::string &result, std::string &error) {
+    const JsonValue *cmd = request.find("cmd");
+    if (!cmd || !cmd->isString()) {
+        error = "missing cmd";
+        return false;
+    }
+    const std::string &name = cmd->string();
+
+    if (name == "get_stats") {
+        result = statsJson();
+        return true;
+    }
+
+    if (name == "start") {
+        if (engine.isRunning()) {
+            error = "already running";
+            return false;
+        }
+        const JsonValue *sources = request.find("sources");
+        if (!sources) {
+            if (!startHandler || !startHandler()) {
+                error = "start failed";
+                return false;
+            }
+            return true;
+        }
+        const JsonValue *output = request.find("output");
+        if (!sources->isArray() || !output || !output->isString()) {
+            error = "sources / output required";
+            return false;
+        }
+        std::vector<std::wstring> ids;
+        for (const auto &id : sources->array()) {
+            if (!id.isString()) {
+                error = "sources must be strings";
+                return false;
+            }
+            ids.push_back(widenUtf8(id.string()));
+        }
+        StreamConfig config;
+        if (const JsonValue *v = request.find("buffer_ms"); v && v->isNumber() && v->number() >= 0) {
+            config.bufferMs = static_cast<std::uint32_t>(v->number());
+        }
+        if (const JsonValue *v = request.find("low_latency"); v && v->isBool()) config.lowLatency = v->boolean();
+        if (const JsonValue *v = request.find("allow_exclusive"); v && v->isBool()) config.allowExclusive = v->boolean();
+        if (const JsonValue *v = request.find("adaptive_buffer"); v && v->isBool()) config.adaptiveBuffer = v->boolean();
+        const std::uint64_t errorsBefore = engine.lastError().count;
+        if (!engine.startCopy(ids, widenUtf8(output->string()), config)) {
+            const AudioEngine::ErrorReport report = engine.lastError();
+            error = report.count > errorsBefore ? "start failed: " + report.message : "start failed";
+            return false;
+        }
+        return true;
+    }
+
+    if (name == "stop") {
+        engine.stopCopy();
+        return true;
+    }
+
+    if (name == "set_gain") {
+        std::size_t source = 0;
+        float gain = 1.0f;
+        if (!readIndex(request, "source", source) || !readGain(request, gain)) {
+            error = "source and gain_db / gain required";
+            return false;
+        }
+        if (!engine.setSourceGain(source, gain)) {
+            error = "set_gain failed";
+            return false;
+        }
+        return true;
+    }
+
+    if (name == "set_route") {
+        std::size_t source = 0;
+        std::size_t output = 0;
+        if (!readIndex(request, "source", source) || !readIndex(request, "output", output)) {
+            error = "source and output required";
+            return false;
+        }
+        Route route = engine.route(source, output);
+        readGain(request, route.gain);
+        if (const JsonValue *delay = request.find("delay_ms"); delay && delay->isNumber() && delay->number() >= 0) {
+            const double frames = delay->number() * engine.latencyReport().sampleRate / 1000.0;
+            route.delayFrames = static_cast<std::uint32_t>(std::min(frames, 4294967295.0) + 0.5);
+        }
+        if (const JsonValue *muted = request.find("muted"); muted && muted->isBool()) route.muted = muted->boolean();
+        if (!engine.setRoute(source, output, route)) {
+            error = "set_route failed";
+            return false;
+        }
+        return true;
+    }
+
+    if (name == "set_insert") {
+        std::size_t source = 0;
+        std::size_t output = 0;
+        if (!readIndex(request, "source", source) || !readIndex(request, "output", output)) {
+            error = "source and output required";
+            return false;
+        }
+        InsertSettings settings = engine.insert(source, output);
+        if (!readInsertJson(request, settings, error)) return false;
+        if (!engine.setInsert(source, output, settings)) {
+            error = "set_insert failed";
+            return false;
+        }
+        return true;
+    }
+
+    if (name == "record_start") {
+        std::size_t output = 0;
+        const JsonValue *path = request.find("path");
+        if (!readIndex(request, "output", output) || !path || !path->isString() || path->string().empty()) {
+            error = "output and path required";
+            return false;
+        }
+        RecorderOptions options;
+        if (const JsonValue *container = request.find("container"); container && container->isString()) {
+            if (container->string() == "w64") options.container = RecordContainer::W64;
+            else if (container->string() != "wav") {
+                error = "container must be wav or w64";
+                return false;
+            }
+        }
+        if (const JsonValue *v = request.find("buffer_ms"); v && v->isNumber() && v->number() >= 1) {
+            options.bufferMs = static_cast<std::uint32_t>(std::min(v->number(), 600000.0));
+        }
+        if (!engine.startRecording(output, std::filesystem::path(widenUtf8(path->string())), options)) {
+            error = "record_start failed";
+            return false;
+        }
+        return true;
+    }
+
+    if (name == "record_stop") {
+        std::size_t output = 0;
+        if (!readIndex(request, "output", output)) {
+            error = "output required";
+            return false;
+        }
+        if (!engine.stopRecording(output)) {
+            error = "record_stop failed";
+            return false;
+        }
+        return true;
+    }
+
+    if (name == "subscribe") {
+        std::size_t interval = 0;
+        if (!readIndex(request, "interval_ms", interval)) {
+            error = "interval_ms required";
+            return false;
+        }
+        client.intervalMs = static_cast<std::uint32_t>(std::clamp<std::size_t>(interval, kMinIntervalMs, 3600000));
+        client.nextEventNs = steadyNs();
+        std::ostringstream out;
+        out << "{\"interval_ms\":" << client.intervalMs << '}';
+        result = out.str();
+        return true;
+    }
+
+    if (name == "unsubscribe") {
+        client.intervalMs = 0;
+        return true;
+    }
+
+    error = "unknown cmd";
+    return false;
+}
+
+std::string ControlServer::statsJson() const {
+    const LatencyReport latency = engine.latencyReport();
+    std::ostringstream out;
+    out << "{\"running\":" << (engine.isRunning() ? "true" : "false")
+        << ",\"failed_streams\":" << engine.failedStreams()
+        << ",\"sources\":";
+    writeIdList(out, engine.sourceIds());
+    out << ",\"outputs\":";
+    std::vector<std::wstring> outputs;
+    if (engine.isRunning()) outputs.push_back(engine.outputId());
+    for (auto &id : engine.additionalOutputIds()) outputs.push_back(std::move(id));
+    writeIdList(out, outputs);
+    out << ",\"sample_rate\":" << latency.sampleRate
+        << ",\"estimated_latency_ms\":" << latency.estimatedLatencyMs;
+    // 引擎记下的最近一次错误：error_count 变化即有新的错误
+    const AudioEngine::ErrorReport error = engine.lastError();
+    out << ",\"error_count\":" << error.count << ",\"last_error\":";
+    writeJsonString(out, error.message);
+    out << ",\"stats\":";
+    writeStatsJson(out, engine.statsSnapshot());
+    const EngineMeters meters = engine.meters();
+    out << ",\"meters\":{\"sources\":";
+    writeMeterList(out, meters.sources);
+    out << ",\"outputs\":";
+    writeMeterList(out, meters.outputs);
+    out << "},\"recordings\":";
+    writeRecordings(out, engine.recordingStatus());
+    out << '}';
+    return out.str();
+}
+
+void ControlServer::pushEvents(const std::uint64_t nowNs) {
+    std::string event;
+    for (auto &client : clients) {
+        if (client.intervalMs == 0 || client.closing || nowNs < client.nextEventNs) continue;
+        // 同一轮到期的客户端共用一份快照
+        if (event.empty()) event = "{\"event\":\"stats\",\"data\":" + statsJson() + "}\n";
+        client.output += event;
+        // 跟不上时不补发，按当前时间重新计时
+        const std::uint64_t intervalNs = std::uint64_t(client.intervalMs) * 1000000ull;
+        client.nextEventNs += intervalNs;
+        if (client.nextEventNs <= nowNs) client.nextEventNs = nowNs + intervalNs;
+        flushClient(client);
+    }
+}
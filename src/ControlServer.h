@@ -0,0 +1,80 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Json.h"
+
+class AudioEngine;
+
+// 本地控制与指标接口：在 Unix 域套接字上收发一行一个的 JSON（Windows 10 起同样支持 AF_UNIX）
+// - 服务线程只调用 AudioEngine 的公开接口：统计为无锁快照，增益、路由经引擎的无锁命令队列 / 快照送到音频线程，
+//   轮询与订阅不会让音频线程等待
+// - 请求 {"id": 任意, "cmd": "...", ...}，应答 {"id": 同上, "ok": true, "result": {...}} 或 {"id", "ok": false, "error": "..."}
+//   start      [sources: [端点 ID], output, buffer_ms, low_latency, allow_exclusive, adaptive_buffer]；省略 sources 时交给 startHandler
+//   stop
+//   set_gain   source, gain_db | gain
+//   set_route  source, output, [gain_db | gain, delay_ms, muted]；未给出的字段保持不变
+//   set_insert source, output, [hpf_hz, eq: [{type, hz, gain_db, q}],
+//              gate: {enabled, threshold_db, range_db, attack_ms, hold_ms, release_ms},
+//              compressor: {enabled, threshold_db, ratio, attack_ms, release_ms, lookahead_ms, makeup_db}]
+//              该路由的插入效果（见 InsertChain）；未给出的字段保持不变，eq 按下标覆盖前几段
+//              lookahead_ms 只延后这条路由，其他路由需要对齐时用 set_route 的 delay_ms
+//   record_start  output, path, [container: "wav" | "w64", buffer_ms]：录制送往该输出的混音（见 AudioEngine::startRecording）
+//   record_stop   output
+//   get_stats  运行状态、统计、引擎最近一次错误（error_count 与 last_error，见 AudioEngine::lastError）、各来源 / 输出的电平（meters：线性 peak / rms / true_peak）与各输出的录音状态（recordings）
+//   subscribe  interval_ms：此后按间隔推送 {"event": "stats", ...}；unsubscribe 停止
+class ControlServer {
+public:
+    explicit ControlServer(AudioEngine &engine);
+    ~ControlServer();
+
+    ControlServer(const ControlServer &) = delete;
+    ControlServer &operator=(const ControlServer &) = delete;
+
+    // 不带参数的 start 请求（例如按配置文件重新启动）；在服务线程上调用，返回是否成功
+    void setStartHandler(std::function<bool()> handler) { startHandler = std::move(handler); }
+
+    // 监听 socketPath（已存在的同名文件先删除）并启动服务线程；失败返回 false，error 为原因
+    bool start(const std::filesystem::path &socketPath, std::string &error);
+    void stop();
+    bool isRunning() const { return serving.load(std::memory_order_acquire); }
+
+    // 订阅推送的最短间隔
+    static constexpr std::uint32_t kMinIntervalMs = 10;
+
+private:
+    struct Client {
+        std::intptr_t socket = -1;
+        std::string input;
+        std::string output;
+        std::uint32_t intervalMs = 0;   // 0 表示未订阅
+        std::uint64_t nextEventNs = 0;
+        bool closing = false;
+    };
+
+    void serveLoop();
+    void acceptClients();
+    // 读出一个客户端的数据并处理其中完整的行；连接断开或出错时置 closing
+    void readClient(Client &client);
+    void flushClient(Client &client);
+    void handleLine(Client &client, const std::string &line);
+    // 执行一条请求，结果写进 result（JSON 对象），失败返回 false 并填写 error
+    bool execute(Client &client, const JsonValue &request, std::string &result, std::string &error);
+    std::string statsJson() const;
+    void pushEvents(std::uint64_t nowNs);
+
+    AudioEngine &engine;
+    std::function<bool()> startHandler;
+
+    std::filesystem::path path;
+    std::intptr_t listener = -1;
+    std::vector<Client> clients;
+    std::thread thread;
+    std::atomic<bool> serving{ false };
+};
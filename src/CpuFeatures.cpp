@@ -0,0 +1,39 @@
+#include "CpuFeatures.h"
+
+#if AR_X86 && defined(_MSC_VER)
+#include <intrin.h>
+#include <immintrin.h>
+#endif
+
+namespace {
+    CpuFeatures detect() {
+        CpuFeatures f;
+#if AR_X86 && defined(_MSC_VER)
+        int info[4] = {};
+        __cpuid(info, 0);
+        const int maxLeaf = info[0];
+        __cpuid(info, 1);
+        f.sse2 = (info[3] & (1 << 26)) != 0;
+        const bool osxsave = (info[2] & (1 << 27)) != 0;
+        const bool fma = (info[2] & (1 << 12)) != 0;
+        // AVX 寄存器状态需要操作系统支持（XCR0 的 bit1/bit2）
+        const bool avxOs = osxsave && (_xgetbv(0) & 0x6) == 0x6;
+        if (maxLeaf >= 7 && avxOs) {
+            __cpuidex(info, 7, 0);
+            f.avx2 = (info[1] & (1 << 5)) != 0;
+            f.fma = f.avx2 && fma;
+        }
+#elif AR_X86
+        __builtin_cpu_init();
+        f.sse2 = __builtin_cpu_supports("sse2");
+        f.avx2 = __builtin_cpu_supports("avx2");
+        f.fma = f.avx2 && __builtin_cpu_supports("fma");
+#endif
+        return f;
+    }
+}
+
+const CpuFeatures &cpuFeatures() {
+    static const CpuFeatures features = detect();
+    return features;
+}
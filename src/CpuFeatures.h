@@ -0,0 +1,24 @@
+#pragma once
+
+// 运行时 CPU 特性检测（用于在启动时选择 SIMD 内核）
+struct CpuFeatures {
+    bool sse2 = false;
+    bool avx2 = false;
+    bool fma = false;
+};
+
+// 首次调用时检测一次，之后返回缓存结果
+const CpuFeatures &cpuFeatures();
+
+// GCC/Clang 需要为单个函数打开 AVX2 指令集；MSVC 可直接使用对应 intrinsics
+#if defined(__GNUC__) || defined(__clang__)
+#define AR_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#else
+#define AR_TARGET_AVX2
+#endif
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define AR_X86 1
+#else
+#define AR_X86 0
+#endif
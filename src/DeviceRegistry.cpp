@@ -0,0 +1,120 @@
+#include "DeviceRegistry.h"
+
+#include <algorithm>
+
+DeviceRegistry::DeviceRegistry(AudioBackend &backend)
+    : backend(backend) {
+    backend.setDeviceChangeCallback([this](const DeviceChange &change) { onDeviceChange(change); });
+}
+
+DeviceRegistry::~DeviceRegistry() {
+    backend.setDeviceChangeCallback(nullptr);
+}
+
+std::vector<DeviceInfo> DeviceRegistry::devices() {
+    std::lock_guard<CheckedMutex> lock(mutex);
+    update();
+    return list;
+}
+
+std::optional<DeviceInfo> DeviceRegistry::find(const std::wstring &id) {
+    std::lock_guard<CheckedMutex> lock(mutex);
+    // 还没有完整枚举过（例如按保存的端点 ID 直接启动）时只查询这一个端点，不为此枚举全部设备；
+    // 进程来源不一定在缓存中（排除进程树的来源、枚举之后才开始播放的进程），同样直接查询
+    std::uint32_t processId = 0;
+    bool excludeTree = false;
+    if (!loaded || parseProcessLoopbackId(id, processId, excludeTree)) {
+        DeviceInfo info;
+        if (!backend.describe(id, info)) return std::nullopt;
+        return info;
+    }
+    update();
+    for (const auto &d : list) {
+        if (d.id == id) return d;
+    }
+    return std::nullopt;
+}
+
+std::optional<DeviceInfo> DeviceRegistry::findProcess(const std::wstring &name) {
+    std::lock_guard<CheckedMutex> lock(mutex);
+    update();
+    for (const auto &d : list) {
+        if (d.processId == 0 || d.name != name) continue;
+        // 缓存中的进程可能已经退出（通知还没到）：向后端确认这一个
+        DeviceInfo info;
+        if (backend.describe(d.id, info) && info.name == name) return info;
+    }
+    return std::nullopt;
+}
+
+std::wstring DeviceRegistry::defaultDevice(bool isRender) {
+    std::lock_guard<CheckedMutex> lock(mutex);
+    update();
+    for (const auto &d : list) {
+        if (d.isRender == isRender && d.isDefault) return d.id;
+    }
+    return {};
+}
+
+void DeviceRegistry::refresh() {
+    std::lock_guard<CheckedMutex> lock(mutex);
+    loaded = false;
+    changeCount.fetch_add(1, std::memory_order_acq_rel);
+}
+
+void DeviceRegistry::setChangedCallback(std::function<void()> callback) {
+    std::lock_guard<std::mutex> lock(callbackMutex);
+    changed = std::move(callback);
+}
+
+void DeviceRegistry::onDeviceChange(const DeviceChange &change) {
+    {
+        std::lock_guard<std::mutex> lock(pendingMutex);
+        pending.push_back(change);
+    }
+    changeCount.fetch_add(1, std::memory_order_acq_rel);
+
+    std::lock_guard<std::mutex> lock(callbackMutex);
+    if (changed) changed();
+}
+
+void DeviceRegistry::update() {
+    if (!loaded) {
+        list = backend.enumerate();
+        loaded = true;
+        enumerationCount.fetch_add(1, std::memory_order_relaxed);
+        // 枚举前后收到的变化照样按顺序应用一遍，结果与最后一次通知一致
+    }
+
+    std::vector<DeviceChange> changes;
+    {
+        std::lock_guard<std::mutex> lock(pendingMutex);
+        changes.swap(pending);
+    }
+
+    for (const auto &change : changes) {
+        auto it = std::find_if(list.begin(), list.end(), [&](const DeviceInfo &d) { return d.id == change.id; });
+        switch (change.type) {
+        case DeviceChange::Type::Added: {
+            // 只查询这一个端点；已经不可用时按移除处理
+            DeviceInfo info;
+            if (!backend.describe(change.id, info)) {
+                if (it != list.end()) list.erase(it);
+            } else if (it != list.end()) {
+                *it = std::move(info);
+            } else {
+                list.push_back(std::move(info));
+            }
+            break;
+        }
+        case DeviceChange::Type::Removed:
+            if (it != list.end()) list.erase(it);
+            break;
+        case DeviceChange::Type::DefaultChanged:
+            for (auto &d : list) {
+                if (d.isRender == change.isRender) d.isDefault = d.id == change.id;
+            }
+            break;
+        }
+    }
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "AudioBackend.h"
+#include "RtSanitizer.h"
+
+// 端点缓存：第一次查询时完整枚举一次，此后只按后端的变化通知增量更新，
+// 界面操作与 startCopy 都不再经过枚举器。设备一律按端点 ID 区分（友好名称可能重名）
+class DeviceRegistry {
+public:
+    // 构造时即向后端注册变化回调，析构时注销；backend 必须比 registry 活得久
+    explicit DeviceRegistry(AudioBackend &backend);
+    ~DeviceRegistry();
+
+    DeviceRegistry(const DeviceRegistry &) = delete;
+    DeviceRegistry &operator=(const DeviceRegistry &) = delete;
+
+    // 当前可用的端点（枚举顺序，之后新增的排在后面）
+    std::vector<DeviceInfo> devices();
+    // 缓存尚未建立时直接向后端查询该端点，不触发完整枚举
+    // 进程来源一律直接向后端查询（PID 随时可能退出或被复用，缓存中的可能已过时，也不一定在缓存中）
+    std::optional<DeviceInfo> find(const std::wstring &id);
+    // 按进程名在缓存中找正在播放的进程（枚举顺序中第一个仍在运行的，逐个向后端确认），不复制整个列表；没有时为空
+    std::optional<DeviceInfo> findProcess(const std::wstring &name);
+    // 某个方向的默认端点 ID，没有时为空
+    std::wstring defaultDevice(bool isRender);
+
+    // 丢弃缓存，下次查询时重新完整枚举（用户手动刷新时使用）
+    void refresh();
+
+    // 每收到一次变化通知加一（新内容在下次查询时取回），界面可据此判断是否需要重建列表
+    std::uint64_t generation() const { return changeCount.load(std::memory_order_acquire); }
+    // 完整枚举的次数
+    std::uint64_t enumerations() const { return enumerationCount.load(std::memory_order_relaxed); }
+
+    // 收到变化通知后调用：在后端的通知线程上执行，应尽快返回（例如投递到界面线程）
+    // 传入空函数取消；返回后不会再有回调在执行
+    void setChangedCallback(std::function<void()> callback);
+
+private:
+    void onDeviceChange(const DeviceChange &change);
+    // 持有 mutex 时调用：需要时完整枚举，然后按顺序应用积压的变化
+    void update();
+
+    AudioBackend &backend;
+
+    // 查询与更新缓存
+    CheckedMutex mutex;
+    bool loaded = false;
+    std::vector<DeviceInfo> list;
+
+    // 通知线程只往 pending 里追加，不等待枚举或查询
+    std::mutex pendingMutex;
+    std::vector<DeviceChange> pending;
+
+    std::mutex callbackMutex;
+    std::function<void()> changed;
+
+    std::atomic<std::uint64_t> changeCount{ 0 };
+    std::atomic<std::uint64_t> enumerationCount{ 0 };
+};
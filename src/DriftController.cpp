@@ -0,0 +1,62 @@
+#include "DriftController.h"
+
+#include <algorithm>
+#include <cmath>
+
+DriftController::DriftController(double sampleRate, double targetFrames)
+    : DriftController(sampleRate, targetFrames, Params{}) {
+}
+
+DriftController::DriftController(double sampleRate, double targetFrames, const Params &params)
+    : rate(sampleRate > 0 ? sampleRate : 48000.0), target(targetFrames), goal(targetFrames), params(params) {
+}
+
+void DriftController::setTarget(double frames) {
+    goal = frames;
+    if (!primed) target = frames;
+}
+
+void DriftController::reset() {
+    target = goal;
+    primed = false;
+    smoothed = 0.0;
+    integral = 0.0;
+    currentAdjust = 1.0;
+}
+
+double DriftController::update(double queuedFrames, double elapsedFrames) {
+    if (elapsedFrames <= 0.0) return currentAdjust;
+    const double dt = elapsedFrames / rate;
+
+    // 排队量随数据包到达呈锯齿状，先做指数平滑
+    if (!primed) {
+        smoothed = queuedFrames;
+        primed = true;
+    } else {
+        const double alpha = 1.0 - std::exp(-dt / params.smoothingSec);
+        smoothed += alpha * (queuedFrames - smoothed);
+    }
+
+    // 目标变化时逐步移动，并把移动速度作为前馈：误差保持很小，积分项不会被带偏，到达后也不会过冲
+    const double maxStep = params.targetSlew * elapsedFrames;
+    const double step = std::clamp(goal - target, -maxStep, maxStep);
+    target += step;
+    const double feedForward = -step / elapsedFrames;
+
+    // 误差换算成秒，使增益与采样率无关
+    const double error = (smoothed - target) / rate;
+
+    // 积分项限幅，防止启动或设备卡顿时积分饱和
+    const double integralLimit = params.ki > 0.0 ? params.maxAdjust / params.ki : 0.0;
+    const double nextIntegral = std::clamp(integral + error * dt, -integralLimit, integralLimit);
+
+    // 输出已到上限且误差仍朝同一方向时不再积分（抗积分饱和），按上限追赶到位后不会过冲
+    double correction = feedForward + params.kp * error + params.ki * nextIntegral;
+    if (std::abs(correction) <= params.maxAdjust || correction * error < 0.0) {
+        integral = nextIntegral;
+    } else {
+        correction = feedForward + params.kp * error + params.ki * integral;
+    }
+    currentAdjust = 1.0 + std::clamp(correction, -params.maxAdjust, params.maxAdjust);
+    return currentAdjust;
+}
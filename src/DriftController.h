@@ -0,0 +1,42 @@
+#pragma once
+
+// 时钟漂移补偿控制器（与平台无关）
+// 观察端到端排队帧数（来源 ring 填充 + render 端 padding），与目标比较，
+// 以 PI 控制输出重采样比例的微调系数，使延迟长期稳定在目标附近
+class DriftController {
+public:
+    struct Params {
+        double kp = 0.1;           // 每秒误差对应的比例调整量（10 ms 误差 -> 1000 ppm）
+        double ki = 0.005;         // 积分增益（每秒）
+        double smoothingSec = 0.5; // 排队量的指数平滑时间常数
+        double maxAdjust = 0.005;  // 调整上限（±5000 ppm）
+        double targetSlew = 0.004; // 运行中改目标时，目标每秒最多移动的量（秒），须小于 maxAdjust
+    };
+
+    DriftController(double sampleRate, double targetFrames);
+    DriftController(double sampleRate, double targetFrames, const Params &params);
+
+    // 首次 update 之前立即生效；之后按 targetSlew 逐步移过去
+    void setTarget(double frames);
+    double targetFrames() const { return target; }
+
+    // queuedFrames：当前排队帧数；elapsedFrames：距上次更新经过的帧数（按输出采样率）
+    // 返回新的比例调整系数（>1 表示消耗输入更快）
+    double update(double queuedFrames, double elapsedFrames);
+
+    double adjust() const { return currentAdjust; }
+    double smoothedFrames() const { return smoothed; }
+
+    void reset();
+
+private:
+    double rate;
+    double target;
+    double goal;
+    Params params;
+
+    bool primed = false;
+    double smoothed = 0.0;
+    double integral = 0.0;
+    double currentAdjust = 1.0;
+};
@@ -0,0 +1,290 @@
+#include "EngineStats.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <limits>
+
+namespace {
+    // 原子地取最大 / 最小值
+    template <typename T>
+    void storeMax(std::atomic<T> &target, T value) {
+        T prev = target.load(std::memory_order_relaxed);
+        while (prev < value && !target.compare_exchange_weak(prev, value, std::memory_order_relaxed)) {
+        }
+    }
+
+    template <typename T>
+    void storeMin(std::atomic<T> &target, T value) {
+        T prev = target.load(std::memory_order_relaxed);
+        while (prev > value && !target.compare_exchange_weak(prev, value, std::memory_order_relaxed)) {
+        }
+    }
+
+    std::int64_t steadyTicks() {
+        return std::chrono::steady_clock::now().time_since_epoch().count();
+    }
+
+    // CSV 与 JSON 共用的列定义
+    struct Column {
+        const char *name;
+        double (*get)(const EngineStatsSnapshot &);
+    };
+
+    const Column kColumns[] = {
+        { "time_s", [](const EngineStatsSnapshot &s) { return s.timeSec; } },
+        { "frames_captured", [](const EngineStatsSnapshot &s) { return double(s.framesCaptured); } },
+        { "frames_rendered", [](const EngineStatsSnapshot &s) { return double(s.framesRendered); } },
+        { "frames_dropped", [](const EngineStatsSnapshot &s) { return double(s.framesDropped); } },
+        { "silent_frames", [](const EngineStatsSnapshot &s) { return double(s.silentFrames); } },
+        { "passthrough_frames", [](const EngineStatsSnapshot &s) { return double(s.passthroughFrames); } },
+        { "passthrough", [](const EngineStatsSnapshot &s) { return s.passthrough ? 1.0 : 0.0; } },
+        { "underruns", [](const EngineStatsSnapshot &s) { return double(s.underruns); } },
+        { "overruns", [](const EngineStatsSnapshot &s) { return double(s.overruns); } },
+        { "errors", [](const EngineStatsSnapshot &s) { return double(s.errors); } },
+        { "ring_fill_ms", [](const EngineStatsSnapshot &s) { return s.ringFillMs; } },
+        { "ring_fill_peak_ms", [](const EngineStatsSnapshot &s) { return s.ringFillPeakMs; } },
+        { "ring_fill_p99_ms", [](const EngineStatsSnapshot &s) { return s.ringFillP99Ms; } },
+        { "wakeups", [](const EngineStatsSnapshot &s) { return double(s.wakeups); } },
+        { "wakeup_us", [](const EngineStatsSnapshot &s) { return s.wakeupUs; } },
+        { "wakeup_mean_us", [](const EngineStatsSnapshot &s) { return s.wakeupMeanUs; } },
+        { "wakeup_peak_us", [](const EngineStatsSnapshot &s) { return s.wakeupPeakUs; } },
+        { "wakeup_p99_us", [](const EngineStatsSnapshot &s) { return s.wakeupP99Us; } },
+        { "latency_ms", [](const EngineStatsSnapshot &s) { return s.latencyMs; } },
+        { "latency_min_ms", [](const EngineStatsSnapshot &s) { return s.latencyMinMs; } },
+        { "latency_max_ms", [](const EngineStatsSnapshot &s) { return s.latencyMaxMs; } },
+        { "faults", [](const EngineStatsSnapshot &s) { return double(s.faults); } },
+        { "recoveries", [](const EngineStatsSnapshot &s) { return double(s.recoveries); } },
+        { "recovery_ms", [](const EngineStatsSnapshot &s) { return s.recoveryMs; } },
+        { "recovery_max_ms", [](const EngineStatsSnapshot &s) { return s.recoveryMaxMs; } },
+        { "concealments", [](const EngineStatsSnapshot &s) { return double(s.concealments); } },
+        { "concealed_frames", [](const EngineStatsSnapshot &s) { return double(s.concealedFrames); } },
+        { "jitter_ms", [](const EngineStatsSnapshot &s) { return s.jitterMs; } },
+        { "queue_target_ms", [](const EngineStatsSnapshot &s) { return s.queueTargetMs; } },
+        { "latency_p50_ms", [](const EngineStatsSnapshot &s) { return s.latencyP50Ms; } },
+        { "latency_p99_ms", [](const EngineStatsSnapshot &s) { return s.latencyP99Ms; } },
+        { "latency_p999_ms", [](const EngineStatsSnapshot &s) { return s.latencyP999Ms; } },
+        { "insert_mean_us", [](const EngineStatsSnapshot &s) { return s.insertMeanUs; } },
+        { "insert_peak_us", [](const EngineStatsSnapshot &s) { return s.insertPeakUs; } },
+    };
+}
+
+// ---- AtomicHistogram ----
+
+AtomicHistogram::AtomicHistogram(std::size_t binCount) : bins(std::max<std::size_t>(binCount, 1)) {
+}
+
+void AtomicHistogram::configure(double binWidth) {
+    width.store(binWidth > 0.0 ? binWidth : 1.0, std::memory_order_relaxed);
+    clear();
+}
+
+void AtomicHistogram::clear() {
+    for (auto &bin : bins) bin.store(0, std::memory_order_relaxed);
+    total.store(0, std::memory_order_relaxed);
+}
+
+void AtomicHistogram::add(double value) {
+    const double w = width.load(std::memory_order_relaxed);
+    const double index = std::max(0.0, value / w);
+    const std::size_t last = bins.size() - 1;
+    const std::size_t bin = index >= double(last) ? last : static_cast<std::size_t>(index);
+    bins[bin].fetch_add(1, std::memory_order_relaxed);
+    total.fetch_add(1, std::memory_order_relaxed);
+}
+
+double AtomicHistogram::percentile(double p) const {
+    const std::uint64_t count = total.load(std::memory_order_relaxed);
+    if (count == 0) return 0.0;
+    const auto rank = static_cast<std::uint64_t>(std::ceil(std::clamp(p, 0.0, 1.0) * double(count)));
+    std::uint64_t seen = 0;
+    for (std::size_t i = 0; i < bins.size(); ++i) {
+        seen += bins[i].load(std::memory_order_relaxed);
+        if (seen >= rank) return double(i + 1) * width.load(std::memory_order_relaxed);
+    }
+    return double(bins.size()) * width.load(std::memory_order_relaxed);
+}
+
+// ---- EngineStats ----
+
+void EngineStats::reset(std::uint32_t sampleRate, std::size_t ringCapacityFrames) {
+    startTicks.store(steadyTicks(), std::memory_order_relaxed);
+
+    for (auto *counter : { &framesCaptured, &framesRendered, &framesDropped, &silentFrames, &passthroughFrames,
+                           &underruns, &overruns, &errors, &ringFill, &ringFillPeak,
+                           &wakeups, &wakeupNs, &wakeupTotalNs, &wakeupPeakNs,
+                           &faults, &recoveries, &recoveryNs, &recoveryMaxNs,
+                           &concealments, &concealedFrames, &queueTarget,
+                           &insertBlocks, &insertTotalNs, &insertPeakNs }) {
+        counter->store(0, std::memory_order_relaxed);
+    }
+    jitterFrames.store(0.0, std::memory_order_relaxed);
+    latencyNs.store(0, std::memory_order_relaxed);
+    latencyMinNs.store(std::numeric_limits<std::int64_t>::max(), std::memory_order_relaxed);
+    latencyMaxNs.store(std::numeric_limits<std::int64_t>::min(), std::memory_order_relaxed);
+    latencyValid.store(false, std::memory_order_relaxed);
+    passthroughActive.store(false, std::memory_order_relaxed);
+
+    // 处理耗时每桶 20 µs（约 2.5 ms 以上计入溢出桶）；延迟每桶 0.25 ms（512 ms 以上计入溢出桶）
+    wakeupHistogram.configure(20000.0);
+    latencyHistogram.configure(250000.0);
+    reconfigure(sampleRate, ringCapacityFrames);
+}
+
+void EngineStats::reconfigure(std::uint32_t sampleRate, std::size_t ringCapacityFrames) {
+    rate.store(sampleRate > 0 ? sampleRate : 48000, std::memory_order_relaxed);
+    // ring 填充按容量均分
+    ringFillHistogram.configure(std::max<double>(1.0, double(ringCapacityFrames) / AtomicHistogram::kBins));
+}
+
+void EngineStats::recordRingFill(std::size_t frames) {
+    ringFill.store(frames, std::memory_order_relaxed);
+    storeMax<std::uint64_t>(ringFillPeak, frames);
+    ringFillHistogram.add(double(frames));
+}
+
+void EngineStats::recordWakeup(std::uint64_t ns) {
+    wakeups.fetch_add(1, std::memory_order_relaxed);
+    wakeupNs.store(ns, std::memory_order_relaxed);
+    wakeupTotalNs.fetch_add(ns, std::memory_order_relaxed);
+    storeMax(wakeupPeakNs, ns);
+    wakeupHistogram.add(double(ns));
+}
+
+void EngineStats::recordLatency(std::int64_t ns) {
+    latencyNs.store(ns, std::memory_order_relaxed);
+    storeMin(latencyMinNs, ns);
+    storeMax(latencyMaxNs, ns);
+    latencyHistogram.add(double(ns));
+    latencyValid.store(true, std::memory_order_relaxed);
+}
+
+void EngineStats::recordRecovery(std::uint64_t ns) {
+    recoveries.fetch_add(1, std::memory_order_relaxed);
+    recoveryNs.store(ns, std::memory_order_relaxed);
+    storeMax(recoveryMaxNs, ns);
+}
+
+void EngineStats::recordInsert(std::uint64_t ns) {
+    insertBlocks.fetch_add(1, std::memory_order_relaxed);
+    insertTotalNs.fetch_add(ns, std::memory_order_relaxed);
+    storeMax(insertPeakNs, ns);
+}
+
+EngineStatsSnapshot EngineStats::snapshot() const {
+    EngineStatsSnapshot s;
+    const double framesToMs = 1000.0 / rate.load(std::memory_order_relaxed);
+
+    s.timeSec = double(steadyTicks() - startTicks.load(std::memory_order_relaxed)) *
+                std::chrono::steady_clock::period::num / std::chrono::steady_clock::period::den;
+
+    s.framesCaptured = framesCaptured.load(std::memory_order_relaxed);
+    s.framesRendered = framesRendered.load(std::memory_order_relaxed);
+    s.framesDropped = framesDropped.load(std::memory_order_relaxed);
+    s.silentFrames = silentFrames.load(std::memory_order_relaxed);
+    s.passthroughFrames = passthroughFrames.load(std::memory_order_relaxed);
+    s.passthrough = passthroughActive.load(std::memory_order_relaxed);
+    s.underruns = underruns.load(std::memory_order_relaxed);
+    s.overruns = overruns.load(std::memory_order_relaxed);
+    s.errors = errors.load(std::memory_order_relaxed);
+
+    s.ringFillMs = double(ringFill.load(std::memory_order_relaxed)) * framesToMs;
+    s.ringFillPeakMs = double(ringFillPeak.load(std::memory_order_relaxed)) * framesToMs;
+    s.ringFillP99Ms = ringFillHistogram.percentile(0.99) * framesToMs;
+
+    s.wakeups = wakeups.load(std::memory_order_relaxed);
+    s.wakeupUs = double(wakeupNs.load(std::memory_order_relaxed)) / 1000.0;
+    s.wakeupMeanUs = s.wakeups > 0 ? double(wakeupTotalNs.load(std::memory_order_relaxed)) / 1000.0 / double(s.wakeups) : 0.0;
+    s.wakeupPeakUs = double(wakeupPeakNs.load(std::memory_order_relaxed)) / 1000.0;
+    s.wakeupP99Us = wakeupHistogram.percentile(0.99) / 1000.0;
+
+    if (latencyValid.load(std::memory_order_relaxed)) {
+        s.latencyMs = double(latencyNs.load(std::memory_order_relaxed)) / 1e6;
+        s.latencyMinMs = double(latencyMinNs.load(std::memory_order_relaxed)) / 1e6;
+        s.latencyMaxMs = double(latencyMaxNs.load(std::memory_order_relaxed)) / 1e6;
+        // 分位取所在桶的上沿，不超过实测最大值
+        s.latencyP50Ms = std::min(latencyHistogram.percentile(0.5) / 1e6, s.latencyMaxMs);
+        s.latencyP99Ms = std::min(latencyHistogram.percentile(0.99) / 1e6, s.latencyMaxMs);
+        s.latencyP999Ms = std::min(latencyHistogram.percentile(0.999) / 1e6, s.latencyMaxMs);
+    }
+
+    s.faults = faults.load(std::memory_order_relaxed);
+    s.recoveries = recoveries.load(std::memory_order_relaxed);
+    s.recoveryMs = double(recoveryNs.load(std::memory_order_relaxed)) / 1e6;
+    s.recoveryMaxMs = double(recoveryMaxNs.load(std::memory_order_relaxed)) / 1e6;
+
+    s.concealments = concealments.load(std::memory_order_relaxed);
+    s.concealedFrames = concealedFrames.load(std::memory_order_relaxed);
+    s.jitterMs = jitterFrames.load(std::memory_order_relaxed) * framesToMs;
+    s.queueTargetMs = double(queueTarget.load(std::memory_order_relaxed)) * framesToMs;
+
+    s.insertBlocks = insertBlocks.load(std::memory_order_relaxed);
+    s.insertMeanUs = s.insertBlocks > 0 ? double(insertTotalNs.load(std::memory_order_relaxed)) / 1000.0 / double(s.insertBlocks) : 0.0;
+    s.insertPeakUs = double(insertPeakNs.load(std::memory_order_relaxed)) / 1000.0;
+    return s;
+}
+
+// ---- StatsSeries ----
+
+StatsSeries::StatsSeries(std::size_t maxSamples)
+    : maxSamples(std::max<std::size_t>(1, maxSamples)) {
+}
+
+void StatsSeries::append(const EngineStatsSnapshot &sample) {
+    // 超出上限时丢掉最早的一半，避免长时间运行无限增长
+    if (data.size() >= maxSamples) data.erase(data.begin(), data.begin() + static_cast<std::ptrdiff_t>(maxSamples / 2));
+    data.push_back(sample);
+}
+
+bool StatsSeries::writeCsv(const std::filesystem::path &path) const {
+    std::ofstream out(path);
+    if (!out) return false;
+    writeStatsCsvHeader(out);
+    for (const auto &sample : data) writeStatsCsvRow(out, sample);
+    return static_cast<bool>(out);
+}
+
+bool StatsSeries::writeJson(const std::filesystem::path &path) const {
+    std::ofstream out(path);
+    if (!out) return false;
+    out << "[\n";
+    for (std::size_t i = 0; i < data.size(); ++i) {
+        out << "  ";
+        writeStatsJson(out, data[i]);
+        out << (i + 1 < data.size() ? ",\n" : "\n");
+    }
+    out << "]\n";
+    return static_cast<bool>(out);
+}
+
+void writeStatsCsvHeader(std::ostream &out) {
+    bool first = true;
+    for (const auto &column : kColumns) {
+        out << (first ? "" : ",") << column.name;
+        first = false;
+    }
+    out << '\n';
+}
+
+void writeStatsCsvRow(std::ostream &out, const EngineStatsSnapshot &sample) {
+    const auto precision = out.precision(12);
+    bool first = true;
+    for (const auto &column : kColumns) {
+        out << (first ? "" : ",") << column.get(sample);
+        first = false;
+    }
+    out << '\n';
+    out.precision(precision);
+}
+
+void writeStatsJson(std::ostream &out, const EngineStatsSnapshot &sample) {
+    const auto precision = out.precision(12);
+    out << '{';
+    bool first = true;
+    for (const auto &column : kColumns) {
+        out << (first ? "" : ", ") << '"' << column.name << "\": " << column.get(sample);
+        first = false;
+    }
+    out << '}';
+    out.precision(precision);
+}
@@ -0,0 +1,184 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <iosfwd>
+#include <vector>
+
+// 引擎运行统计：音频线程只做原子累加 / 取最大值，UI 线程随时取快照，两边都不加锁
+
+// 固定分桶的无锁直方图（最后一个桶兼作溢出桶）；桶在构造时分配
+class AtomicHistogram {
+public:
+    static constexpr std::size_t kBins = 128;
+
+    explicit AtomicHistogram(std::size_t binCount = kBins);
+
+    // 重新设定桶宽并清空
+    void configure(double binWidth);
+    void clear();
+
+    void add(double value);
+
+    // 第 p（0..1）分位所在桶的上沿；没有样本时返回 0
+    double percentile(double p) const;
+
+private:
+    std::atomic<double> width{ 1.0 };
+    std::vector<std::atomic<std::uint32_t>> bins;
+    std::atomic<std::uint64_t> total{ 0 };
+};
+
+// 某一时刻的统计快照（可复制，供 UI 显示与导出）
+struct EngineStatsSnapshot {
+    double timeSec = 0.0;               // 自 startCopy 起的时间
+
+    std::uint64_t framesCaptured = 0;   // 各来源读到的帧数之和（按来源采样率）
+    std::uint64_t framesRendered = 0;   // 写入 render 缓冲的帧数
+    std::uint64_t framesDropped = 0;    // ring 写满丢弃的帧数
+    std::uint64_t silentFrames = 0;     // 带静音标志的 capture 帧数
+    std::uint64_t passthroughFrames = 0; // 经直通路径（不混音、不重采样）写入 render 缓冲的帧数
+    bool passthrough = false;           // 当前是否走直通路径
+
+    std::uint64_t underruns = 0;        // render 缓冲被播空的次数
+    std::uint64_t overruns = 0;         // capture 不连续或 ring 写满的次数
+    std::uint64_t errors = 0;           // 后端调用失败次数
+
+    double ringFillMs = 0.0;            // ring 填充（取各来源中最多的一个）
+    double ringFillPeakMs = 0.0;
+    double ringFillP99Ms = 0.0;
+
+    std::uint64_t wakeups = 0;          // 音频线程被唤醒的次数
+    double wakeupUs = 0.0;              // 单次唤醒的处理耗时
+    double wakeupMeanUs = 0.0;
+    double wakeupPeakUs = 0.0;
+    double wakeupP99Us = 0.0;
+
+    double latencyMs = 0.0;             // 实测 capture -> render 延迟（后端不提供时间戳时为 0）
+    double latencyMinMs = 0.0;
+    double latencyMaxMs = 0.0;
+    double latencyP50Ms = 0.0;
+    double latencyP99Ms = 0.0;
+    double latencyP999Ms = 0.0;
+
+    std::uint64_t faults = 0;           // 流失效（设备移除、禁用、格式改变）的次数
+    std::uint64_t recoveries = 0;       // 自动恢复成功的次数
+    double recoveryMs = 0.0;            // 最近一次从失效到重新出声的时间
+    double recoveryMaxMs = 0.0;
+
+    std::uint64_t concealments = 0;     // 欠载或丢包时生成补偿信号的次数
+    std::uint64_t concealedFrames = 0;  // 补偿生成的有声帧数（各按所在流的采样率）
+    double jitterMs = 0.0;              // capture 包到达间隔抖动（各来源中最大的一个，下降时缓慢回落）
+    double queueTargetMs = 0.0;         // 当前的目标排队量（自适应缓冲时随抖动变化）
+
+    std::uint64_t insertBlocks = 0;     // 经过插入效果的混音块数（每块含全部路由）
+    double insertMeanUs = 0.0;          // 每块插入效果的处理耗时
+    double insertPeakUs = 0.0;
+};
+
+class EngineStats {
+public:
+    // startCopy 时调用：清零并按输出采样率与 ring 容量设定直方图
+    void reset(std::uint32_t sampleRate, std::size_t ringCapacityFrames);
+    // 输出格式改变后重建时调用：只更新采样率与 ring 直方图，累计值保留
+    void reconfigure(std::uint32_t sampleRate, std::size_t ringCapacityFrames);
+
+    void addCaptured(std::uint64_t frames) { framesCaptured.fetch_add(frames, std::memory_order_relaxed); }
+    void addRendered(std::uint64_t frames) { framesRendered.fetch_add(frames, std::memory_order_relaxed); }
+    void addDropped(std::uint64_t frames) { framesDropped.fetch_add(frames, std::memory_order_relaxed); }
+    void addSilent(std::uint64_t frames) { silentFrames.fetch_add(frames, std::memory_order_relaxed); }
+    void addPassthrough(std::uint64_t frames) { passthroughFrames.fetch_add(frames, std::memory_order_relaxed); }
+    void setPassthrough(bool active) { passthroughActive.store(active, std::memory_order_relaxed); }
+    void addUnderrun() { underruns.fetch_add(1, std::memory_order_relaxed); }
+    void addOverrun() { overruns.fetch_add(1, std::memory_order_relaxed); }
+    void addError() { errors.fetch_add(1, std::memory_order_relaxed); }
+    void addFault() { faults.fetch_add(1, std::memory_order_relaxed); }
+    // started 为 true 表示一次新的补偿
+    void addConcealed(std::uint64_t frames, bool started) {
+        if (started) concealments.fetch_add(1, std::memory_order_relaxed);
+        concealedFrames.fetch_add(frames, std::memory_order_relaxed);
+    }
+    // 以下两项按输出帧
+    void recordJitter(double frames) { jitterFrames.store(frames, std::memory_order_relaxed); }
+    void recordQueueTarget(std::uint64_t frames) { queueTarget.store(frames, std::memory_order_relaxed); }
+
+    void recordRingFill(std::size_t frames);
+    void recordWakeup(std::uint64_t ns);
+    void recordLatency(std::int64_t ns);
+    // 失效的流重新出声，ns 为从发现失效起的时间
+    void recordRecovery(std::uint64_t ns);
+    // 一个混音块中全部插入效果花费的时间
+    void recordInsert(std::uint64_t ns);
+
+    EngineStatsSnapshot snapshot() const;
+
+private:
+    std::atomic<std::uint32_t> rate{ 48000 };
+    std::atomic<std::chrono::steady_clock::rep> startTicks{ 0 };
+
+    std::atomic<std::uint64_t> framesCaptured{ 0 };
+    std::atomic<std::uint64_t> framesRendered{ 0 };
+    std::atomic<std::uint64_t> framesDropped{ 0 };
+    std::atomic<std::uint64_t> silentFrames{ 0 };
+    std::atomic<std::uint64_t> passthroughFrames{ 0 };
+    std::atomic<bool> passthroughActive{ false };
+    std::atomic<std::uint64_t> underruns{ 0 };
+    std::atomic<std::uint64_t> overruns{ 0 };
+    std::atomic<std::uint64_t> errors{ 0 };
+
+    std::atomic<std::uint64_t> ringFill{ 0 };
+    std::atomic<std::uint64_t> ringFillPeak{ 0 };
+    AtomicHistogram ringFillHistogram;
+
+    std::atomic<std::uint64_t> wakeups{ 0 };
+    std::atomic<std::uint64_t> wakeupNs{ 0 };
+    std::atomic<std::uint64_t> wakeupTotalNs{ 0 };
+    std::atomic<std::uint64_t> wakeupPeakNs{ 0 };
+    AtomicHistogram wakeupHistogram;
+
+    std::atomic<std::int64_t> latencyNs{ 0 };
+    std::atomic<std::int64_t> latencyMinNs{ 0 };
+    std::atomic<std::int64_t> latencyMaxNs{ 0 };
+    std::atomic<bool> latencyValid{ false };
+    AtomicHistogram latencyHistogram{ 2048 };
+
+    std::atomic<std::uint64_t> faults{ 0 };
+    std::atomic<std::uint64_t> recoveries{ 0 };
+    std::atomic<std::uint64_t> recoveryNs{ 0 };
+    std::atomic<std::uint64_t> recoveryMaxNs{ 0 };
+
+    std::atomic<std::uint64_t> concealments{ 0 };
+    std::atomic<std::uint64_t> concealedFrames{ 0 };
+    std::atomic<double> jitterFrames{ 0.0 };
+    std::atomic<std::uint64_t> queueTarget{ 0 };
+
+    std::atomic<std::uint64_t> insertBlocks{ 0 };
+    std::atomic<std::uint64_t> insertTotalNs{ 0 };
+    std::atomic<std::uint64_t> insertPeakNs{ 0 };
+};
+
+// 统计时间序列（UI 线程使用）：定时追加快照，事后导出 CSV / JSON
+class StatsSeries {
+public:
+    explicit StatsSeries(std::size_t maxSamples = 36000);
+
+    void append(const EngineStatsSnapshot &sample);
+    void clear() { data.clear(); }
+    const std::vector<EngineStatsSnapshot> &samples() const { return data; }
+
+    bool writeCsv(const std::filesystem::path &path) const;
+    bool writeJson(const std::filesystem::path &path) const;
+
+private:
+    std::size_t maxSamples;
+    std::vector<EngineStatsSnapshot> data;
+};
+
+// 逐行写 CSV（与 StatsSeries::writeCsv 的列相同），无界面模式按间隔追加到同一个文件
+void writeStatsCsvHeader(std::ostream &out);
+void writeStatsCsvRow(std::ostream &out, const EngineStatsSnapshot &sample);
+// 单个快照写成一个 JSON 对象（键与 CSV 列名相同），供控制接口应答与推送
+void writeStatsJson(std::ostream &out, const EngineStatsSnapshot &sample);
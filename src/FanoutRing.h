@@ -0,0 +1,86 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "SpscRing.h"
+
+// 单写多读的帧环形缓冲：混音结果写入一次，各输出按自己的读位置直接读取其中的区域（不拷贝）
+// - 写入端与所有读者在同一线程（render 线程），不做同步
+// - 读位置按写入总帧数计（64 位，不回绕）；写入端从不等待读者，落后超过容量的读者由 clampReader 推到最旧的数据处
+// - 可以有多条 bus（例如每个输出各自的混音），共用同一个写入位置，各自连续存放
+class FanoutRing {
+public:
+    using Span = SpscRing<float>::Span;
+    using Regions = SpscRing<float>::Regions;
+
+    FanoutRing(std::size_t minCapacityFrames, std::size_t channels, std::size_t buses = 1)
+        : chans(channels ? channels : 1), busCount(buses ? buses : 1) {
+        std::size_t cap = 1;
+        while (cap < minCapacityFrames) cap <<= 1;
+        mask = cap - 1;
+        buffer.assign(cap * chans * busCount, 0.0f);
+    }
+
+    FanoutRing(const FanoutRing &) = delete;
+    FanoutRing &operator=(const FanoutRing &) = delete;
+
+    std::size_t capacity() const { return mask + 1; }
+    std::size_t channels() const { return chans; }
+    std::size_t buses() const { return busCount; }
+    // 已写入的总帧数，新读者从这里开始即为"没有积压"
+    std::uint64_t writePosition() const { return written; }
+
+    // ---- 写入端 ----
+
+    // 取得 bus 上 frames 帧（不超过容量）的写入区域，覆盖最旧的数据；各 bus 写好后一起提交
+    Regions prepareWrite(std::size_t frames, std::size_t bus = 0) { return regionsAt(bus, written, std::min(frames, capacity())); }
+    void commitWrite(std::size_t frames) { written += frames; }
+
+    // ---- 读者 ----
+
+    // 读位置 cursor 之后可读的帧数（cursor 须已经过 clampReader）
+    std::size_t available(std::uint64_t cursor) const { return static_cast<std::size_t>(written - cursor); }
+
+    // 读者落后超过容量（数据已被覆盖）时推到最旧的数据处，返回跳过的帧数
+    std::size_t clampReader(std::uint64_t &cursor) const {
+        const std::uint64_t oldest = written > capacity() ? written - capacity() : 0;
+        if (cursor >= oldest) return 0;
+        const auto skipped = static_cast<std::size_t>(oldest - cursor);
+        cursor = oldest;
+        return skipped;
+    }
+
+    // bus 上从 cursor 开始最多 frames 帧的可读区域（不移动读位置）
+    Regions readRegions(std::uint64_t cursor, std::size_t frames, std::size_t bus = 0) {
+        return regionsAt(bus, cursor, std::min(frames, available(cursor)));
+    }
+
+    // 清空：读者须各自重新定位
+    void reset() { written = 0; }
+
+    // 整个缓冲写满静音（所有 bus），写入位置随之前进一个容量
+    void fillSilence() {
+        std::fill(buffer.begin(), buffer.end(), 0.0f);
+        written += capacity();
+    }
+
+private:
+    Regions regionsAt(std::size_t bus, std::uint64_t index, std::size_t frames) {
+        float *base = buffer.data() + std::min(bus, busCount - 1) * capacity() * chans;
+        const auto pos = static_cast<std::size_t>(index) & mask;
+        const std::size_t firstFrames = std::min(frames, capacity() - pos);
+        Regions r;
+        r.first = { base + pos * chans, firstFrames };
+        r.second = { base, frames - firstFrames };
+        return r;
+    }
+
+    std::uint64_t written = 0;
+    std::size_t mask = 0;
+    std::size_t chans = 1;
+    std::size_t busCount = 1;
+    std::vector<float> buffer;
+};
@@ -0,0 +1,411 @@
+#include "InsertChain.h"
+#include "CpuFeatures.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if AR_X86
+#include <immintrin.h>
+#endif
+
+namespace {
+    constexpr double kPi = 3.14159265358979323846;
+    constexpr std::size_t kLanes = kMaxInsertChannels;
+
+    // ---- 标量实现 ----
+
+    void biquadScalar(const BiquadCoefficients *coefs, std::size_t sections, float *state,
+                      float *frames, std::size_t count, std::size_t channels, std::size_t stride) {
+        for (std::size_t i = 0; i < count; ++i) {
+            float *f = frames + i * stride;
+            for (std::size_t s = 0; s < sections; ++s) {
+                const BiquadCoefficients &k = coefs[s];
+                float *z1 = state + 2 * s * kLanes;
+                float *z2 = z1 + kLanes;
+                for (std::size_t c = 0; c < channels; ++c) {
+                    const float x = f[c];
+                    const float y = k.b0 * x + z1[c];
+                    z1[c] = k.b1 * x - k.a1 * y + z2[c];
+                    z2[c] = k.b2 * x - k.a2 * y;
+                    f[c] = y;
+                }
+            }
+        }
+    }
+
+#if AR_X86
+    // ---- SSE2：每 4 个声道一组，立体声只用 64 位读写 ----
+
+    inline __m128 loadLanes(const float *p, std::size_t n) {
+        if (n == 4) return _mm_loadu_ps(p);
+        if (n == 2) return _mm_castpd_ps(_mm_load_sd(reinterpret_cast<const double *>(p)));
+        alignas(16) float t[4] = {};
+        std::memcpy(t, p, n * sizeof(float));
+        return _mm_load_ps(t);
+    }
+
+    inline void storeLanes(float *p, __m128 v, std::size_t n) {
+        if (n == 4) _mm_storeu_ps(p, v);
+        else if (n == 2) _mm_store_sd(reinterpret_cast<double *>(p), _mm_castps_pd(v));
+        else {
+            alignas(16) float t[4];
+            _mm_store_ps(t, v);
+            std::memcpy(p, t, n * sizeof(float));
+        }
+    }
+
+    void biquadSse2(const BiquadCoefficients *coefs, std::size_t sections, float *state,
+                    float *frames, std::size_t count, std::size_t channels, std::size_t stride) {
+        sections = std::min(sections, kMaxBiquadSections);
+        for (std::size_t g = 0; g < channels; g += 4) {
+            const std::size_t n = std::min<std::size_t>(4, channels - g);
+            __m128 b0[kMaxBiquadSections], b1[kMaxBiquadSections], b2[kMaxBiquadSections];
+            __m128 a1[kMaxBiquadSections], a2[kMaxBiquadSections];
+            __m128 z1[kMaxBiquadSections], z2[kMaxBiquadSections];
+            for (std::size_t s = 0; s < sections; ++s) {
+                b0[s] = _mm_set1_ps(coefs[s].b0);
+                b1[s] = _mm_set1_ps(coefs[s].b1);
+                b2[s] = _mm_set1_ps(coefs[s].b2);
+                a1[s] = _mm_set1_ps(coefs[s].a1);
+                a2[s] = _mm_set1_ps(coefs[s].a2);
+                z1[s] = _mm_loadu_ps(state + 2 * s * kLanes + g);
+                z2[s] = _mm_loadu_ps(state + (2 * s + 1) * kLanes + g);
+            }
+            for (std::size_t i = 0; i < count; ++i) {
+                float *f = frames + i * stride + g;
+                __m128 x = loadLanes(f, n);
+                for (std::size_t s = 0; s < sections; ++s) {
+                    const __m128 y = _mm_add_ps(_mm_mul_ps(b0[s], x), z1[s]);
+                    z1[s] = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(b1[s], x), _mm_mul_ps(a1[s], y)), z2[s]);
+                    z2[s] = _mm_sub_ps(_mm_mul_ps(b2[s], x), _mm_mul_ps(a2[s], y));
+                    x = y;
+                }
+                storeLanes(f, x, n);
+            }
+            for (std::size_t s = 0; s < sections; ++s) {
+                _mm_storeu_ps(state + 2 * s * kLanes + g, z1[s]);
+                _mm_storeu_ps(state + (2 * s + 1) * kLanes + g, z2[s]);
+            }
+        }
+    }
+
+    // ---- AVX2：5..8 个声道一个向量（掩码读写）；4 个以下与 SSE2 相同 ----
+
+    AR_TARGET_AVX2 void biquadAvx2(const BiquadCoefficients *coefs, std::size_t sections, float *state,
+                                   float *frames, std::size_t count, std::size_t channels, std::size_t stride) {
+        if (channels <= 4) {
+            biquadSse2(coefs, sections, state, frames, count, channels, stride);
+            return;
+        }
+        sections = std::min(sections, kMaxBiquadSections);
+        const __m256i mask = _mm256_cmpgt_epi32(_mm256_set1_epi32(static_cast<int>(std::min(channels, kLanes))),
+                                                _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+        __m256 b0[kMaxBiquadSections], b1[kMaxBiquadSections], b2[kMaxBiquadSections];
+        __m256 a1[kMaxBiquadSections], a2[kMaxBiquadSections];
+        __m256 z1[kMaxBiquadSections], z2[kMaxBiquadSections];
+        for (std::size_t s = 0; s < sections; ++s) {
+            b0[s] = _mm256_set1_ps(coefs[s].b0);
+            b1[s] = _mm256_set1_ps(coefs[s].b1);
+            b2[s] = _mm256_set1_ps(coefs[s].b2);
+            a1[s] = _mm256_set1_ps(coefs[s].a1);
+            a2[s] = _mm256_set1_ps(coefs[s].a2);
+            z1[s] = _mm256_loadu_ps(state + 2 * s * kLanes);
+            z2[s] = _mm256_loadu_ps(state + (2 * s + 1) * kLanes);
+        }
+        for (std::size_t i = 0; i < count; ++i) {
+            float *f = frames + i * stride;
+            __m256 x = _mm256_maskload_ps(f, mask);
+            for (std::size_t s = 0; s < sections; ++s) {
+                const __m256 y = _mm256_fmadd_ps(b0[s], x, z1[s]);
+                z1[s] = _mm256_fmadd_ps(b1[s], x, _mm256_fnmadd_ps(a1[s], y, z2[s]));
+                z2[s] = _mm256_fnmadd_ps(a2[s], y, _mm256_mul_ps(b2[s], x));
+                x = y;
+            }
+            _mm256_maskstore_ps(f, mask, x);
+        }
+        for (std::size_t s = 0; s < sections; ++s) {
+            _mm256_storeu_ps(state + 2 * s * kLanes, z1[s]);
+            _mm256_storeu_ps(state + (2 * s + 1) * kLanes, z2[s]);
+        }
+    }
+#endif
+
+    const BiquadKernels kScalar{ biquadScalar, "scalar" };
+#if AR_X86
+    const BiquadKernels kSse2{ biquadSse2, "sse2" };
+    const BiquadKernels kAvx2{ biquadAvx2, "avx2" };
+#endif
+
+    float dbToGain(double db) { return static_cast<float>(std::pow(10.0, db / 20.0)); }
+
+    // 时间常数 ms 对应的每帧靠拢系数（0 为立即到位）
+    float timeCoefficient(double ms, double rate) {
+        return ms > 0.0 ? static_cast<float>(std::exp(-1000.0 / (ms * rate))) : 0.0f;
+    }
+
+    bool isIdentity(const BiquadCoefficients &k) {
+        return k.b0 == 1.0f && k.b1 == 0.0f && k.b2 == 0.0f && k.a1 == 0.0f && k.a2 == 0.0f;
+    }
+
+    BiquadCoefficients normalize(double b0, double b1, double b2, double a0, double a1, double a2) {
+        return BiquadCoefficients{ static_cast<float>(b0 / a0), static_cast<float>(b1 / a0), static_cast<float>(b2 / a0),
+                                   static_cast<float>(a1 / a0), static_cast<float>(a2 / a0) };
+    }
+
+    // RBJ Audio EQ Cookbook
+    BiquadCoefficients highPass(double hz, double rate) {
+        const double w0 = 2.0 * kPi * std::clamp(hz, 10.0, 0.45 * rate) / rate;
+        const double cw = std::cos(w0);
+        const double alpha = std::sin(w0) / (2.0 * 0.70710678118654752);
+        return normalize((1.0 + cw) / 2.0, -(1.0 + cw), (1.0 + cw) / 2.0, 1.0 + alpha, -2.0 * cw, 1.0 - alpha);
+    }
+
+    BiquadCoefficients equalizer(const EqBand &band, double rate) {
+        if (band.type == EqBand::Type::Off) return BiquadCoefficients{};
+        const double w0 = 2.0 * kPi * std::clamp<double>(band.hz, 10.0, 0.45 * rate) / rate;
+        const double cw = std::cos(w0);
+        const double alpha = std::sin(w0) / (2.0 * std::clamp<double>(band.q, 0.1, 20.0));
+        const double a = std::pow(10.0, std::clamp<double>(band.gainDb, -24.0, 24.0) / 40.0);
+        const double sa = 2.0 * std::sqrt(a) * alpha;
+        switch (band.type) {
+        case EqBand::Type::LowShelf:
+            return normalize(a * ((a + 1) - (a - 1) * cw + sa), 2 * a * ((a - 1) - (a + 1) * cw), a * ((a + 1) - (a - 1) * cw - sa),
+                             (a + 1) + (a - 1) * cw + sa, -2 * ((a - 1) + (a + 1) * cw), (a + 1) + (a - 1) * cw - sa);
+        case EqBand::Type::HighShelf:
+            return normalize(a * ((a + 1) + (a - 1) * cw + sa), -2 * a * ((a - 1) + (a + 1) * cw), a * ((a + 1) + (a - 1) * cw - sa),
+                             (a + 1) - (a - 1) * cw + sa, 2 * ((a - 1) - (a + 1) * cw), (a + 1) - (a - 1) * cw - sa);
+        default:
+            return normalize(1 + alpha * a, -2 * cw, 1 - alpha * a, 1 + alpha / a, -2 * cw, 1 - alpha / a);
+        }
+    }
+
+    // 当前值向目标靠拢一步，足够接近时直接到位；返回是否仍在变化
+    bool approach(float &value, float target, float step) {
+        const float diff = target - value;
+        if (std::abs(diff) <= 1e-6f) {
+            value = target;
+            return false;
+        }
+        value += diff * step;
+        return true;
+    }
+
+    void flushDenormal(float &value) {
+        if (std::abs(value) < 1e-20f) value = 0.0f;
+    }
+}
+
+const BiquadKernels &scalarBiquadKernels() { return kScalar; }
+
+const BiquadKernels &sse2BiquadKernels() {
+#if AR_X86
+    return kSse2;
+#else
+    return kScalar;
+#endif
+}
+
+const BiquadKernels &avx2BiquadKernels() {
+#if AR_X86
+    return cpuFeatures().fma ? kAvx2 : sse2BiquadKernels();
+#else
+    return kScalar;
+#endif
+}
+
+const BiquadKernels &biquadKernels() {
+    static const BiquadKernels &selected = cpuFeatures().fma ? avx2BiquadKernels()
+                                           : cpuFeatures().sse2 ? sse2BiquadKernels()
+                                           : scalarBiquadKernels();
+    return selected;
+}
+
+const char *eqBandTypeName(const EqBand::Type type) {
+    switch (type) {
+    case EqBand::Type::Peak: return "peak";
+    case EqBand::Type::LowShelf: return "low_shelf";
+    case EqBand::Type::HighShelf: return "high_shelf";
+    default: return "off";
+    }
+}
+
+bool InsertSettings::active() const {
+    if (highPassHz > 0.0f || gate.enabled || compressor.enabled) return true;
+    return std::any_of(eq.begin(), eq.end(), [](const EqBand &band) { return band.type != EqBand::Type::Off; });
+}
+
+// ---- InsertChain ----
+
+InsertChain::InsertChain(std::size_t channels, std::uint32_t sampleRate, std::size_t maxBlockFrames)
+    : stride(std::max<std::size_t>(1, channels)),
+      chans(std::min(stride, kMaxInsertChannels)),
+      rate(sampleRate > 0 ? sampleRate : 48000) {
+    smoothing = 1.0f - static_cast<float>(std::exp(-static_cast<double>(kSubBlockFrames) * 1000.0 / (kSmoothMs * rate)));
+    buffer.assign(std::max<std::size_t>(1, maxBlockFrames) * stride, 0.0f);
+    delayCapacity = static_cast<std::size_t>(kMaxLookaheadMs * rate / 1000.0) + 1;
+    delayLine.assign(delayCapacity * chans, 0.0f);
+}
+
+bool InsertChain::post(const InsertSettings &settings) {
+    return queue.push(&settings, 1) == 1;
+}
+
+bool InsertChain::update() {
+    InsertSettings settings;
+    bool received = false;
+    while (queue.pop(&settings, 1) == 1) received = true;
+    if (received) applySettings(settings);
+    if (idle()) {
+        if (!wasIdle) clearState();
+        wasIdle = true;
+        return false;
+    }
+    wasIdle = false;
+    return true;
+}
+
+void InsertChain::applySettings(const InsertSettings &settings) {
+    targetCoefs[0] = settings.highPassHz > 0.0f ? highPass(settings.highPassHz, rate) : BiquadCoefficients{};
+    for (std::size_t b = 0; b < kMaxEqBands; ++b) targetCoefs[1 + b] = equalizer(settings.eq[b], rate);
+
+    const GateSettings &gate = settings.gate;
+    gateEnabled = gate.enabled;
+    gateThreshold = dbToGain(gate.thresholdDb);
+    gateFloor = dbToGain(std::min(gate.rangeDb, 0.0f));
+    gateAttack = timeCoefficient(gate.attackMs, rate);
+    gateRelease = timeCoefficient(gate.releaseMs, rate);
+    gateHoldFrames = static_cast<std::uint32_t>(std::max(gate.holdMs, 0.0f) * rate / 1000.0);
+
+    const CompressorSettings &comp = settings.compressor;
+    const double lookaheadMs = std::clamp<double>(comp.lookaheadMs, 0.0, kMaxLookaheadMs);
+    const bool limiter = comp.ratio >= kLimiterRatio;
+    compressorEnabled = comp.enabled;
+    targetThresholdDb = comp.thresholdDb;
+    targetSlope = comp.enabled ? (limiter ? -1.0f : 1.0f / std::max(comp.ratio, 1.0f) - 1.0f) : 0.0f;
+    targetMakeup = comp.enabled ? dbToGain(comp.makeupDb) : 1.0f;
+    // 限幅：起音在 look-ahead 期间至少完成 95%，峰值到达输出时增益已经压下来
+    const double attackMs = limiter && lookaheadMs > 0.0 ? std::min<double>(comp.attackMs, lookaheadMs / 3.0) : comp.attackMs;
+    compAttack = timeCoefficient(attackMs, rate);
+    compRelease = timeCoefficient(comp.releaseMs, rate);
+    // 与路由延迟（delay_ms）相同按四舍五入取整，两者设为同样的毫秒数时恰好对齐
+    targetDelayFrames = comp.enabled ? std::min(static_cast<std::size_t>(lookaheadMs * rate / 1000.0 + 0.5), delayCapacity - 1) : 0;
+}
+
+void InsertChain::smooth() {
+    sections = 0;
+    for (std::size_t s = 0; s < kMaxBiquadSections; ++s) {
+        BiquadCoefficients &k = coefs[s];
+        const BiquadCoefficients &t = targetCoefs[s];
+        approach(k.b0, t.b0, smoothing);
+        approach(k.b1, t.b1, smoothing);
+        approach(k.b2, t.b2, smoothing);
+        approach(k.a1, t.a1, smoothing);
+        approach(k.a2, t.a2, smoothing);
+        if (!isIdentity(k)) sections = s + 1;
+    }
+    // 之后的节都是直通，不再计算；状态清零，重新打开时从静止开始
+    std::fill(biquadState.begin() + static_cast<std::ptrdiff_t>(sections * 2 * kLanes), biquadState.end(), 0.0f);
+
+    approach(thresholdDb, targetThresholdDb, smoothing);
+    approach(slope, targetSlope, smoothing);
+    approach(makeup, targetMakeup, smoothing);
+}
+
+bool InsertChain::idle() const {
+    for (std::size_t s = 0; s < kMaxBiquadSections; ++s) {
+        if (!isIdentity(coefs[s]) || !isIdentity(targetCoefs[s])) return false;
+    }
+    return !gateEnabled && gateGain == 1.0f && !compressorEnabled && slope == 0.0f && makeup == 1.0f &&
+           delayFrames == 0 && targetDelayFrames == 0;
+}
+
+void InsertChain::suspend() {
+    if (suspended) return;
+    clearState();
+    suspended = true;
+}
+
+void InsertChain::clearState() {
+    biquadState.fill(0.0f);
+    gateGain = 1.0f;
+    gateHoldLeft = 0;
+    envelope = 0.0f;
+    std::fill(delayLine.begin(), delayLine.end(), 0.0f);
+    delayPos = 0;
+    delayWritten = 0;
+}
+
+void InsertChain::process(float *frames, const std::size_t count) {
+    const BiquadKernels &kernels = biquadKernels();
+    suspended = false;
+    for (std::size_t done = 0; done < count;) {
+        const std::size_t n = std::min(kSubBlockFrames, count - done);
+        float *block = frames + done * stride;
+        smooth();
+        if (sections > 0) kernels.process(coefs.data(), sections, biquadState.data(), block, n, chans, stride);
+        if (gateEnabled || gateGain != 1.0f) processGate(block, n);
+        if (compressorEnabled || slope != 0.0f || makeup != 1.0f || delayFrames != 0 || targetDelayFrames != 0) processCompressor(block, n);
+        else delayWritten = 0;
+        done += n;
+    }
+    // 输入静音后滤波器状态与包络会衰减进非规格化数，运算会慢上百倍
+    for (float &z : biquadState) flushDenormal(z);
+    flushDenormal(envelope);
+}
+
+void InsertChain::processGate(float *frames, const std::size_t count) {
+    for (std::size_t i = 0; i < count; ++i) {
+        float *f = frames + i * stride;
+        float peak = 0.0f;
+        for (std::size_t c = 0; c < chans; ++c) peak = std::max(peak, std::abs(f[c]));
+        // 超过阈值即打开并重新计时，低于阈值满 hold 后才开始关闭
+        if (peak >= gateThreshold) gateHoldLeft = gateHoldFrames + 1;
+        const bool open = !gateEnabled || gateHoldLeft > 0;
+        if (gateHoldLeft > 0) --gateHoldLeft;
+        const float target = open ? 1.0f : gateFloor;
+        gateGain = target + (gateGain - target) * (target > gateGain ? gateAttack : gateRelease);
+        for (std::size_t c = 0; c < chans; ++c) f[c] *= gateGain;
+    }
+    if (!gateEnabled && gateGain > 0.99999f) gateGain = 1.0f;
+}
+
+void InsertChain::processCompressor(float *frames, const std::size_t count) {
+    const float threshold = dbToGain(thresholdDb);
+    // look-ahead 改变时在这一段内从旧的读位置交叉淡化到新的
+    const bool crossfade = targetDelayFrames != delayFrames;
+    // 延迟线中 delay 帧之前的位置（delay < delayCapacity）
+    const auto tap = [this](std::size_t delay) { return delayPos >= delay ? delayPos - delay : delayPos + delayCapacity - delay; };
+    // 该位置样本的权重：刚打开 look-ahead 时延迟线里还没有数据，先输出静音，最早写进来的一段淡入
+    const auto weight = [this](std::size_t delay) {
+        if (delay == 0) return 1.0f;
+        if (delayWritten <= delay) return 0.0f;
+        const std::uint64_t age = delayWritten - 1 - delay;
+        return age < kSubBlockFrames ? static_cast<float>(age + 1) / static_cast<float>(kSubBlockFrames + 1) : 1.0f;
+    };
+    for (std::size_t i = 0; i < count; ++i) {
+        float *f = frames + i * stride;
+        // 检测未延迟的输入（链接各声道），输出取 delayFrames 帧之前的样本
+        float peak = 0.0f;
+        for (std::size_t c = 0; c < chans; ++c) peak = std::max(peak, std::abs(f[c]));
+        envelope = peak + (envelope - peak) * (peak > envelope ? compAttack : compRelease);
+        float gain = makeup;
+        if (slope != 0.0f && envelope > threshold) gain *= std::exp2(slope * std::log2(envelope / threshold));
+
+        std::memcpy(delayLine.data() + delayPos * chans, f, chans * sizeof(float));
+        ++delayWritten;
+        const float *delayed = delayLine.data() + tap(delayFrames) * chans;
+        if (crossfade) {
+            const float *next = delayLine.data() + tap(targetDelayFrames) * chans;
+            const float t = static_cast<float>(i + 1) / static_cast<float>(count);
+            const float a = (1.0f - t) * weight(delayFrames) * gain;
+            const float b = t * weight(targetDelayFrames) * gain;
+            for (std::size_t c = 0; c < chans; ++c) f[c] = a * delayed[c] + b * next[c];
+        } else {
+            const float g = delayWritten > delayFrames + kSubBlockFrames ? gain : weight(delayFrames) * gain;
+            for (std::size_t c = 0; c < chans; ++c) f[c] = delayed[c] * g;
+        }
+        if (++delayPos == delayCapacity) delayPos = 0;
+    }
+    if (crossfade) delayFrames = targetDelayFrames;
+}
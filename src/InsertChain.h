@@ -0,0 +1,179 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "SpscRing.h"
+
+// 插入效果处理的声道数上限（更多的声道原样通过）
+constexpr std::size_t kMaxInsertChannels = 8;
+// 均衡的段数（加上高通共 1 + kMaxEqBands 个二阶节）
+constexpr std::size_t kMaxEqBands = 4;
+constexpr std::size_t kMaxBiquadSections = 1 + kMaxEqBands;
+
+// 一段均衡（RBJ Audio EQ Cookbook 的二阶节）
+struct EqBand {
+    enum class Type : std::uint8_t { Off, Peak, LowShelf, HighShelf };
+    Type type = Type::Off;
+    float hz = 1000.0f;
+    float gainDb = 0.0f;
+    float q = 0.707f;
+};
+
+// 配置与控制接口中的名称：off、peak、low_shelf、high_shelf
+const char *eqBandTypeName(EqBand::Type type);
+
+// 前馈压缩；ratio >= InsertChain::kLimiterRatio 时为限幅（超过阈值的部分全部压掉）
+struct CompressorSettings {
+    bool enabled = false;
+    float thresholdDb = -18.0f;
+    float ratio = 4.0f;
+    float attackMs = 5.0f;
+    float releaseMs = 100.0f;
+    // 0..InsertChain::kMaxLookaheadMs；只有这条路由随之延后同样的时长（按输出采样率取整到帧），
+    // 同一输出上的其他路由不会自动对齐：干声路由与带 look-ahead 的路由混在一起会梳状滤波，
+    // 需要时给其他路由设置相同的路由延迟（Route::delayFrames）
+    float lookaheadMs = 5.0f;
+    float makeupDb = 0.0f;
+};
+
+// 噪声门：电平低于阈值并超过 holdMs 后按 releaseMs 衰减到 rangeDb
+struct GateSettings {
+    bool enabled = false;
+    float thresholdDb = -50.0f;
+    float rangeDb = -60.0f;
+    float attackMs = 1.0f;
+    float holdMs = 50.0f;
+    float releaseMs = 150.0f;
+};
+
+// 一条路由的插入效果参数，处理顺序：高通 -> 均衡 -> 噪声门 -> 压缩 / 限幅
+struct InsertSettings {
+    float highPassHz = 0.0f;   // 二阶 Butterworth 高通，0 为关闭
+    std::array<EqBand, kMaxEqBands> eq{};
+    GateSettings gate;
+    CompressorSettings compressor;
+
+    // 是否有任何节点打开
+    bool active() const;
+};
+
+// 所有声道共用一组系数的二阶节（转置直接 II 型，已按 a0 归一化；默认为直通）
+struct BiquadCoefficients {
+    float b0 = 1.0f;
+    float b1 = 0.0f;
+    float b2 = 0.0f;
+    float a1 = 0.0f;
+    float a2 = 0.0f;
+};
+
+// 级联二阶节内核（启动时按 CPU 特性选择 AVX2 / SSE2 / 标量实现）：
+// 每帧的各声道放在同一个向量里一起算，一帧依次经过全部二阶节，状态在整块处理期间留在寄存器中
+struct BiquadKernels {
+    // stride 声道交错的 count 帧原地依次经过 sections 个二阶节，只处理前 channels（<= kMaxInsertChannels）个声道
+    // state 为 [节][z1, z2][kMaxInsertChannels]
+    void (*process)(const BiquadCoefficients *coefs, std::size_t sections, float *state,
+                    float *frames, std::size_t count, std::size_t channels, std::size_t stride);
+    const char *name;
+};
+
+const BiquadKernels &biquadKernels();
+
+// 各实现单独暴露，便于对比测试与基准
+const BiquadKernels &scalarBiquadKernels();
+const BiquadKernels &sse2BiquadKernels();   // 非 x86 平台上退化为标量实现
+const BiquadKernels &avx2BiquadKernels();   // 同上
+
+// 一条路由的插入效果链（与平台无关）：构造时按声道数、采样率与最大块长分配全部缓冲，之后不再分配。
+// 参数经无锁队列从控制线程送到音频线程，在音频线程中按 kSubBlockFrames 分段逐步过渡（二阶节系数、
+// 压缩参数按 kSmoothMs 的时间常数靠拢），打开 / 关闭节点也只是把参数移向 / 移离直通，不会产生断点
+class InsertChain {
+public:
+    static constexpr std::size_t kSubBlockFrames = 32;
+    static constexpr std::uint32_t kSmoothMs = 20;
+    static constexpr std::uint32_t kMaxLookaheadMs = 10;
+    static constexpr float kLimiterRatio = 20.0f;
+    // 控制线程到音频线程的参数队列长度（音频线程每块只取最新的一份）
+    static constexpr std::size_t kQueueSize = 16;
+
+    InsertChain(std::size_t channels, std::uint32_t sampleRate, std::size_t maxBlockFrames);
+
+    InsertChain(const InsertChain &) = delete;
+    InsertChain &operator=(const InsertChain &) = delete;
+
+    std::size_t channels() const { return stride; }
+
+    // ---- 控制线程（调用方自行串行化）----
+
+    // 投递新参数；队列满时返回 false
+    bool post(const InsertSettings &settings);
+
+    // ---- 音频线程 ----
+
+    // 取出排队的参数；返回本块是否需要处理（全部节点已关闭且过渡结束时为 false，调用方可以跳过，状态随之清空）
+    bool update();
+    // 路由静音或增益为 0、本块跳过 process 时调用：清空滤波器、包络与 look-ahead 延迟线，
+    // 恢复出声时从干净的状态开始，不会把静音之前残留的样本与增益衰减带出来（一段静音内只清一次）
+    void suspend();
+    // 预分配的块缓冲（maxBlockFrames 帧交错），调用方拷入后原地处理
+    float *block() { return buffer.data(); }
+    // 原地处理 count 帧交错样本（长度不限）
+    void process(float *frames, std::size_t count);
+
+private:
+    // 由参数算出各节点的目标（音频线程）
+    void applySettings(const InsertSettings &settings);
+    // 每段开头：当前值向目标靠拢一步，并重新数出需要计算的二阶节
+    void smooth();
+    bool idle() const;
+    void clearState();
+    void processGate(float *frames, std::size_t count);
+    void processCompressor(float *frames, std::size_t count);
+
+    std::size_t stride;   // 每帧的样本数
+    std::size_t chans;    // 参与处理的声道数
+    double rate;
+    float smoothing;      // 每段的靠拢系数
+
+    SpscRing<InsertSettings> queue{ kQueueSize, 1 };
+    std::vector<float> buffer;
+
+    // 二阶节：0 为高通，1.. 为均衡
+    std::array<BiquadCoefficients, kMaxBiquadSections> targetCoefs{};
+    std::array<BiquadCoefficients, kMaxBiquadSections> coefs{};
+    alignas(32) std::array<float, kMaxBiquadSections * 2 * kMaxInsertChannels> biquadState{};
+    std::size_t sections = 0;   // 本段需要计算的节数（最后一个非直通节之后的不算）
+
+    // 噪声门
+    bool gateEnabled = false;
+    float gateThreshold = 0.0f;   // 线性
+    float gateFloor = 1.0f;       // 关闭时的增益
+    float gateAttack = 0.0f;      // 每帧的靠拢系数
+    float gateRelease = 0.0f;
+    std::uint32_t gateHoldFrames = 0;
+    std::uint32_t gateHoldLeft = 0;
+    float gateGain = 1.0f;
+
+    // 压缩 / 限幅：阈值（dB）、斜率（1 / ratio - 1）与补偿增益按段过渡；look-ahead 为检测信号领先输出的帧数
+    bool compressorEnabled = false;
+    float targetThresholdDb = 0.0f;
+    float targetSlope = 0.0f;
+    float targetMakeup = 1.0f;
+    float thresholdDb = 0.0f;
+    float slope = 0.0f;
+    float makeup = 1.0f;
+    float compAttack = 0.0f;
+    float compRelease = 0.0f;
+    float envelope = 0.0f;
+    std::vector<float> delayLine;   // (maxLookahead + 1) 帧，环形
+    std::size_t delayCapacity = 0;
+    std::size_t delayPos = 0;
+    std::size_t delayFrames = 0;
+    std::size_t targetDelayFrames = 0;
+    std::uint64_t delayWritten = 0;   // 自上次中断起连续写入的帧数，更早的内容无效
+
+    bool wasIdle = true;
+    bool suspended = false;   // suspend 之后还没有 process 过
+};
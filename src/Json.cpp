@@ -0,0 +1,248 @@
+#include "Json.h"
+
+#include <charconv>
+#include <cmath>
+#include <ostream>
+
+class JsonParser {
+public:
+    explicit JsonParser(const std::string &text) : pos(text.data()), end(text.data() + text.size()) {}
+
+    bool parseDocument(JsonValue &out) {
+        if (!parseValue(out, 0)) return false;
+        skipSpace();
+        return pos == end;
+    }
+
+private:
+    // 嵌套深度上限：请求都很浅，防止恶意输入耗尽栈
+    static constexpr int kMaxDepth = 32;
+
+    void skipSpace() {
+        while (pos != end && (*pos == ' ' || *pos == '\t' || *pos == '\r' || *pos == '\n')) ++pos;
+    }
+
+    bool literal(const char *word) {
+        const char *p = pos;
+        for (; *word; ++word, ++p) {
+            if (p == end || *p != *word) return false;
+        }
+        pos = p;
+        return true;
+    }
+
+    bool parseValue(JsonValue &out, const int depth) {
+        if (depth > kMaxDepth) return false;
+        skipSpace();
+        if (pos == end) return false;
+        switch (*pos) {
+        case '{': return parseObject(out, depth);
+        case '[': return parseArray(out, depth);
+        case '"':
+            out.kind = JsonValue::Type::String;
+            return parseString(out.text);
+        case 't':
+            out.kind = JsonValue::Type::Bool;
+            out.flag = true;
+            return literal("true");
+        case 'f':
+            out.kind = JsonValue::Type::Bool;
+            out.flag = false;
+            return literal("false");
+        case 'n':
+            out.kind = JsonValue::Type::Null;
+            return literal("null");
+        default:
+            return parseNumber(out);
+        }
+    }
+
+    bool parseNumber(JsonValue &out) {
+        const auto result = std::from_chars(pos, end, out.value);
+        if (result.ec != std::errc() || !std::isfinite(out.value)) return false;
+        pos = result.ptr;
+        out.kind = JsonValue::Type::Number;
+        return true;
+    }
+
+    static void appendUtf8(std::string &s, const char32_t code) {
+        if (code < 0x80) {
+            s.push_back(static_cast<char>(code));
+        } else if (code < 0x800) {
+            s.push_back(static_cast<char>(0xC0 | (code >> 6)));
+            s.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+        } else if (code < 0x10000) {
+            s.push_back(static_cast<char>(0xE0 | (code >> 12)));
+            s.push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+            s.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+        } else {
+            s.push_back(static_cast<char>(0xF0 | (code >> 18)));
+            s.push_back(static_cast<char>(0x80 | ((code >> 12) & 0x3F)));
+            s.push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+            s.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+        }
+    }
+
+    bool parseHex4(char32_t &code) {
+        if (end - pos < 4) return false;
+        code = 0;
+        for (int i = 0; i < 4; ++i, ++pos) {
+            const char c = *pos;
+            code <<= 4;
+            if (c >= '0' && c <= '9') code |= static_cast<char32_t>(c - '0');
+            else if (c >= 'a' && c <= 'f') code |= static_cast<char32_t>(c - 'a' + 10);
+            else if (c >= 'A' && c <= 'F') code |= static_cast<char32_t>(c - 'A' + 10);
+            else return false;
+        }
+        return true;
+    }
+
+    bool parseString(std::string &out) {
+        ++pos;  // 开头的引号
+        out.clear();
+        while (pos != end) {
+            const char c = *pos++;
+            if (c == '"') return true;
+            if (static_cast<unsigned char>(c) < 0x20) return false;
+            if (c != '\\') {
+                out.push_back(c);
+                continue;
+            }
+            if (pos == end) return false;
+            switch (*pos++) {
+            case '"': out.push_back('"'); break;
+            case '\\': out.push_back('\\'); break;
+            case '/': out.push_back('/'); break;
+            case 'b': out.push_back('\b'); break;
+            case 'f': out.push_back('\f'); break;
+            case 'n': out.push_back('\n'); break;
+            case 'r': out.push_back('\r'); break;
+            case 't': out.push_back('\t'); break;
+            case 'u': {
+                char32_t code = 0;
+                if (!parseHex4(code)) return false;
+                // 代理对
+                if (code >= 0xD800 && code < 0xDC00) {
+                    char32_t low = 0;
+                    if (!literal("\\u") || !parseHex4(low) || low < 0xDC00 || low >= 0xE000) return false;
+                    code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                } else if (code >= 0xDC00 && code < 0xE000) {
+                    return false;   // 孤立的低位代理无法编码为合法的 UTF-8
+                }
+                appendUtf8(out, code);
+                break;
+            }
+            default: return false;
+            }
+        }
+        return false;
+    }
+
+    bool parseArray(JsonValue &out, const int depth) {
+        ++pos;
+        out.kind = JsonValue::Type::Array;
+        skipSpace();
+        if (pos != end && *pos == ']') {
+            ++pos;
+            return true;
+        }
+        while (true) {
+            out.items.emplace_back();
+            if (!parseValue(out.items.back(), depth + 1)) return false;
+            skipSpace();
+            if (pos == end) return false;
+            if (*pos == ']') {
+                ++pos;
+                return true;
+            }
+            if (*pos++ != ',') return false;
+        }
+    }
+
+    bool parseObject(JsonValue &out, const int depth) {
+        ++pos;
+        out.kind = JsonValue::Type::Object;
+        skipSpace();
+        if (pos != end && *pos == '}') {
+            ++pos;
+            return true;
+        }
+        while (true) {
+            skipSpace();
+            std::string key;
+            if (pos == end || *pos != '"' || !parseString(key)) return false;
+            skipSpace();
+            if (pos == end || *pos++ != ':') return false;
+            if (!parseValue(out.members[key], depth + 1)) return false;
+            skipSpace();
+            if (pos == end) return false;
+            if (*pos == '}') {
+                ++pos;
+                return true;
+            }
+            if (*pos++ != ',') return false;
+        }
+    }
+
+    const char *pos;
+    const char *end;
+};
+
+const JsonValue *JsonValue::find(const std::string &key) const {
+    const auto it = members.find(key);
+    return it == members.end() ? nullptr : &it->second;
+}
+
+void JsonValue::write(std::ostream &out) const {
+    switch (kind) {
+    case Type::Null: out << "null"; break;
+    case Type::Bool: out << (flag ? "true" : "false"); break;
+    case Type::Number: out << value; break;
+    case Type::String: writeJsonString(out, text); break;
+    case Type::Array: {
+        out << '[';
+        for (std::size_t i = 0; i < items.size(); ++i) {
+            if (i) out << ',';
+            items[i].write(out);
+        }
+        out << ']';
+        break;
+    }
+    case Type::Object: {
+        out << '{';
+        bool first = true;
+        for (const auto &[key, member] : members) {
+            if (!first) out << ',';
+            first = false;
+            writeJsonString(out, key);
+            out << ':';
+            member.write(out);
+        }
+        out << '}';
+        break;
+    }
+    }
+}
+
+bool parseJson(const std::string &text, JsonValue &out) {
+    out = JsonValue{};
+    return JsonParser(text).parseDocument(out);
+}
+
+void writeJsonString(std::ostream &out, const std::string &text) {
+    static const char kHex[] = "0123456789abcdef";
+    out << '"';
+    for (const char c : text) {
+        switch (c) {
+        case '"': out << "\\\""; break;
+        case '\\': out << "\\\\"; break;
+        case '\n': out << "\\n"; break;
+        case '\r': out << "\\r"; break;
+        case '\t': out << "\\t"; break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20) out << "\\u00" << kHex[(c >> 4) & 0xF] << kHex[c & 0xF];
+            else out << c;
+        }
+    }
+    out << '"';
+}
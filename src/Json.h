@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <iosfwd>
+#include <map>
+#include <string>
+#include <vector>
+
+// 最小的 JSON 值与解析器（控制接口的一行请求用），不依赖 Qt
+class JsonValue {
+public:
+    enum class Type { Null, Bool, Number, String, Array, Object };
+
+    JsonValue() = default;
+
+    Type type() const { return kind; }
+    bool isNull() const { return kind == Type::Null; }
+    bool isNumber() const { return kind == Type::Number; }
+    bool isString() const { return kind == Type::String; }
+    bool isBool() const { return kind == Type::Bool; }
+    bool isArray() const { return kind == Type::Array; }
+    bool isObject() const { return kind == Type::Object; }
+
+    bool boolean() const { return flag; }
+    double number() const { return value; }
+    const std::string &string() const { return text; }
+    const std::vector<JsonValue> &array() const { return items; }
+
+    // 对象成员；不存在时返回 nullptr
+    const JsonValue *find(const std::string &key) const;
+
+    // 原样写回（用于把请求中的 id 回显到应答）
+    void write(std::ostream &out) const;
+
+private:
+    friend class JsonParser;
+
+    Type kind = Type::Null;
+    bool flag = false;
+    double value = 0.0;
+    std::string text;
+    std::vector<JsonValue> items;
+    std::map<std::string, JsonValue> members;
+};
+
+// 解析一段完整的 JSON 文本（前后可有空白）；失败返回 false
+bool parseJson(const std::string &text, JsonValue &out);
+
+// 写出带引号与转义的 JSON 字符串（text 为 UTF-8）
+void writeJsonString(std::ostream &out, const std::string &text);
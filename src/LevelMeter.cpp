@@ -0,0 +1,296 @@
+#include "LevelMeter.h"
+#include "CpuFeatures.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+
+#if AR_X86
+#include <immintrin.h>
+#endif
+
+namespace {
+    constexpr std::size_t kTaps = LevelMeter::kTruePeakTaps;
+
+    // ITU-R BS.1770-4 附录 2 的 4 倍过采样插值滤波器（48 抽头，按相位拆成 4 × 12）
+    alignas(32) constexpr float kPhases[4][kTaps] = {
+        { 0.0017089843750f, 0.0109863281250f, -0.0196533203125f, 0.0332031250000f, -0.0594482421875f, 0.1373291015625f,
+          0.9721679687500f, -0.1022949218750f, 0.0476074218750f, -0.0266113281250f, 0.0148925781250f, -0.0083007812500f },
+        { -0.0291748046875f, 0.0292968750000f, -0.0517578125000f, 0.0891113281250f, -0.1665039062500f, 0.4650878906250f,
+          0.7797851562500f, -0.2003173828125f, 0.1015625000000f, -0.0582275390625f, 0.0330810546875f, -0.0189208984375f },
+        { -0.0189208984375f, 0.0330810546875f, -0.0582275390625f, 0.1015625000000f, -0.2003173828125f, 0.7797851562500f,
+          0.4650878906250f, -0.1665039062500f, 0.0891113281250f, -0.0517578125000f, 0.0292968750000f, -0.0291748046875f },
+        { -0.0083007812500f, 0.0148925781250f, -0.0266113281250f, 0.0476074218750f, -0.1022949218750f, 0.9721679687500f,
+          0.1373291015625f, -0.0594482421875f, 0.0332031250000f, -0.0196533203125f, 0.0109863281250f, 0.0017089843750f },
+    };
+
+    // ---- 标量实现 ----
+
+    void reduceScalar(const float *samples, std::size_t frames, std::size_t channels, float *peak, float *sumSquares) {
+        for (std::size_t f = 0; f < frames; ++f) {
+            for (std::size_t c = 0; c < channels; ++c) {
+                const float x = samples[f * channels + c];
+                peak[c] = std::max(peak[c], std::fabs(x));
+                sumSquares[c] += x * x;
+            }
+        }
+    }
+
+    float truePeakScalar(const float *samples, std::size_t count) {
+        float peak = 0.0f;
+        for (std::size_t n = 0; n < count; ++n) {
+            for (const auto &phase : kPhases) {
+                float y = 0.0f;
+                for (std::size_t k = 0; k < kTaps; ++k) y += phase[k] * samples[n - k];
+                peak = std::max(peak, std::fabs(y));
+            }
+        }
+        return peak;
+    }
+
+#if AR_X86
+    // 交错样本的向量归约：G 个向量（共 G × W 个样本）恰好是整数帧，每个 lane 固定对应一个声道，
+    // 最后按 lane 合并到各声道。G = 声道数 / gcd(声道数, W)，超过 4 的声道数（5、7 等）走标量
+    std::size_t vectorGroup(const std::size_t channels, const std::size_t width) {
+        const std::size_t group = channels / std::gcd(channels, width);
+        return group <= 4 ? group : 0;
+    }
+
+    void foldLanes(const float *peakLanes, const float *squareLanes, std::size_t lanes, std::size_t channels,
+                   float *peak, float *sumSquares) {
+        for (std::size_t i = 0; i < lanes; ++i) {
+            peak[i % channels] = std::max(peak[i % channels], peakLanes[i]);
+            sumSquares[i % channels] += squareLanes[i];
+        }
+    }
+
+    // ---- SSE2 ----
+
+    template <std::size_t G>
+    std::size_t reduceSse2Group(const float *samples, std::size_t samplesCount, std::size_t channels, float *peak, float *sumSquares) {
+        const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+        __m128 peaks[G], squares[G];
+        for (std::size_t g = 0; g < G; ++g) peaks[g] = squares[g] = _mm_setzero_ps();
+        std::size_t i = 0;
+        for (; i + G * 4 <= samplesCount; i += G * 4) {
+            for (std::size_t g = 0; g < G; ++g) {
+                const __m128 x = _mm_loadu_ps(samples + i + g * 4);
+                peaks[g] = _mm_max_ps(peaks[g], _mm_and_ps(x, absMask));
+                squares[g] = _mm_add_ps(squares[g], _mm_mul_ps(x, x));
+            }
+        }
+        alignas(16) float peakLanes[G * 4], squareLanes[G * 4];
+        for (std::size_t g = 0; g < G; ++g) {
+            _mm_store_ps(peakLanes + g * 4, peaks[g]);
+            _mm_store_ps(squareLanes + g * 4, squares[g]);
+        }
+        foldLanes(peakLanes, squareLanes, G * 4, channels, peak, sumSquares);
+        return i;
+    }
+
+    void reduceSse2(const float *samples, std::size_t frames, std::size_t channels, float *peak, float *sumSquares) {
+        const std::size_t total = frames * channels;
+        std::size_t done = 0;
+        switch (vectorGroup(channels, 4)) {
+        case 1: done = reduceSse2Group<1>(samples, total, channels, peak, sumSquares); break;
+        case 2: done = reduceSse2Group<2>(samples, total, channels, peak, sumSquares); break;
+        case 3: done = reduceSse2Group<3>(samples, total, channels, peak, sumSquares); break;
+        case 4: done = reduceSse2Group<4>(samples, total, channels, peak, sumSquares); break;
+        default: break;
+        }
+        reduceScalar(samples + done, (total - done) / channels, channels, peak, sumSquares);
+    }
+
+    // 每次算 4 个相邻输出：y_p[n..n+3] = Σ_k h_p[k] · x[n-k..n+3-k]；4 个相位各用一个累加器，互不依赖
+    float truePeakSse2(const float *samples, std::size_t count) {
+        const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+        __m128 peak = _mm_setzero_ps();
+        std::size_t n = 0;
+        for (; n + 4 <= count; n += 4) {
+            __m128 y0 = _mm_setzero_ps(), y1 = _mm_setzero_ps(), y2 = _mm_setzero_ps(), y3 = _mm_setzero_ps();
+            for (std::size_t k = 0; k < kTaps; ++k) {
+                const __m128 x = _mm_loadu_ps(samples + n - k);
+                y0 = _mm_add_ps(y0, _mm_mul_ps(_mm_set1_ps(kPhases[0][k]), x));
+                y1 = _mm_add_ps(y1, _mm_mul_ps(_mm_set1_ps(kPhases[1][k]), x));
+                y2 = _mm_add_ps(y2, _mm_mul_ps(_mm_set1_ps(kPhases[2][k]), x));
+                y3 = _mm_add_ps(y3, _mm_mul_ps(_mm_set1_ps(kPhases[3][k]), x));
+            }
+            peak = _mm_max_ps(peak, _mm_max_ps(_mm_max_ps(_mm_and_ps(y0, absMask), _mm_and_ps(y1, absMask)),
+                                               _mm_max_ps(_mm_and_ps(y2, absMask), _mm_and_ps(y3, absMask))));
+        }
+        alignas(16) float lanes[4];
+        _mm_store_ps(lanes, peak);
+        const float tail = truePeakScalar(samples + n, count - n);
+        return std::max({ lanes[0], lanes[1], lanes[2], lanes[3], tail });
+    }
+
+    // ---- AVX2 ----
+
+    template <std::size_t G>
+    AR_TARGET_AVX2 std::size_t reduceAvx2Group(const float *samples, std::size_t samplesCount, std::size_t channels, float *peak, float *sumSquares) {
+        const __m256 absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF));
+        __m256 peaks[G], squares[G];
+        for (std::size_t g = 0; g < G; ++g) peaks[g] = squares[g] = _mm256_setzero_ps();
+        std::size_t i = 0;
+        for (; i + G * 8 <= samplesCount; i += G * 8) {
+            for (std::size_t g = 0; g < G; ++g) {
+                const __m256 x = _mm256_loadu_ps(samples + i + g * 8);
+                peaks[g] = _mm256_max_ps(peaks[g], _mm256_and_ps(x, absMask));
+                squares[g] = _mm256_fmadd_ps(x, x, squares[g]);
+            }
+        }
+        alignas(32) float peakLanes[G * 8], squareLanes[G * 8];
+        for (std::size_t g = 0; g < G; ++g) {
+            _mm256_store_ps(peakLanes + g * 8, peaks[g]);
+            _mm256_store_ps(squareLanes + g * 8, squares[g]);
+        }
+        foldLanes(peakLanes, squareLanes, G * 8, channels, peak, sumSquares);
+        return i;
+    }
+
+    AR_TARGET_AVX2 void reduceAvx2(const float *samples, std::size_t frames, std::size_t channels, float *peak, float *sumSquares) {
+        const std::size_t total = frames * channels;
+        std::size_t done = 0;
+        switch (vectorGroup(channels, 8)) {
+        case 1: done = reduceAvx2Group<1>(samples, total, channels, peak, sumSquares); break;
+        case 2: done = reduceAvx2Group<2>(samples, total, channels, peak, sumSquares); break;
+        case 3: done = reduceAvx2Group<3>(samples, total, channels, peak, sumSquares); break;
+        case 4: done = reduceAvx2Group<4>(samples, total, channels, peak, sumSquares); break;
+        default: break;
+        }
+        reduceScalar(samples + done, (total - done) / channels, channels, peak, sumSquares);
+    }
+
+    AR_TARGET_AVX2 float truePeakAvx2(const float *samples, std::size_t count) {
+        const __m256 absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF));
+        __m256 peak = _mm256_setzero_ps();
+        std::size_t n = 0;
+        for (; n + 8 <= count; n += 8) {
+            __m256 y0 = _mm256_setzero_ps(), y1 = _mm256_setzero_ps(), y2 = _mm256_setzero_ps(), y3 = _mm256_setzero_ps();
+            for (std::size_t k = 0; k < kTaps; ++k) {
+                const __m256 x = _mm256_loadu_ps(samples + n - k);
+                y0 = _mm256_fmadd_ps(_mm256_broadcast_ss(&kPhases[0][k]), x, y0);
+                y1 = _mm256_fmadd_ps(_mm256_broadcast_ss(&kPhases[1][k]), x, y1);
+                y2 = _mm256_fmadd_ps(_mm256_broadcast_ss(&kPhases[2][k]), x, y2);
+                y3 = _mm256_fmadd_ps(_mm256_broadcast_ss(&kPhases[3][k]), x, y3);
+            }
+            peak = _mm256_max_ps(peak, _mm256_max_ps(_mm256_max_ps(_mm256_and_ps(y0, absMask), _mm256_and_ps(y1, absMask)),
+                                                     _mm256_max_ps(_mm256_and_ps(y2, absMask), _mm256_and_ps(y3, absMask))));
+        }
+        alignas(32) float lanes[8];
+        _mm256_store_ps(lanes, peak);
+        const float tail = truePeakScalar(samples + n, count - n);
+        return std::max(*std::max_element(lanes, lanes + 8), tail);
+    }
+#endif
+
+    const MeterKernels kScalar{ reduceScalar, truePeakScalar, "scalar" };
+#if AR_X86
+    const MeterKernels kSse2{ reduceSse2, truePeakSse2, "sse2" };
+    const MeterKernels kAvx2{ reduceAvx2, truePeakAvx2, "avx2" };
+#endif
+}
+
+const MeterKernels &scalarMeterKernels() { return kScalar; }
+
+const MeterKernels &sse2MeterKernels() {
+#if AR_X86
+    return kSse2;
+#else
+    return kScalar;
+#endif
+}
+
+const MeterKernels &avx2MeterKernels() {
+#if AR_X86
+    return cpuFeatures().fma ? kAvx2 : sse2MeterKernels();
+#else
+    return kScalar;
+#endif
+}
+
+const MeterKernels &meterKernels() {
+    static const MeterKernels &selected = cpuFeatures().fma ? avx2MeterKernels()
+                                         : cpuFeatures().sse2 ? sse2MeterKernels()
+                                         : scalarMeterKernels();
+    return selected;
+}
+
+// ---- LevelMeter ----
+
+LevelMeter::LevelMeter(const std::size_t channels, const std::uint32_t sampleRate)
+    : chans(std::min(channels, kMaxMeterChannels)),
+      stride(std::max<std::size_t>(channels, 1)),
+      windowFrames(std::max<std::size_t>(static_cast<std::size_t>(sampleRate) * kWindowMs / 1000, 1)),
+      rmsDecay(static_cast<float>(std::exp(-static_cast<double>(kWindowMs) / kRmsIntegrationMs))),
+      deinterleaved(chans * (kTaps - 1 + kChunkFrames), 0.0f),
+      silence(stride * kChunkFrames, 0.0f) {
+}
+
+void LevelMeter::process(const float *frames, const std::size_t count, const std::uint64_t nowNs) {
+    // 按窗口边界与解交错缓冲的大小分块，窗口满了就发布
+    for (std::size_t done = 0; done < count;) {
+        const std::size_t chunk = std::min({ count - done, kChunkFrames, windowFrames - accumulated });
+        processChunk(frames + done * stride, chunk);
+        done += chunk;
+        accumulated += chunk;
+        if (accumulated >= windowFrames) publish(nowNs);
+    }
+}
+
+void LevelMeter::processSilence(const std::size_t count, const std::uint64_t nowNs) {
+    for (std::size_t done = 0; done < count;) {
+        const std::size_t chunk = std::min(count - done, kChunkFrames);
+        process(silence.data(), chunk, nowNs);
+        done += chunk;
+    }
+}
+
+void LevelMeter::processChunk(const float *frames, const std::size_t count) {
+    if (chans == 0) return;
+    const MeterKernels &k = meterKernels();
+
+    // 声道数未超过上限时直接在交错数据上归约；否则逐帧只看前 chans 个声道
+    std::array<float, kMaxMeterChannels> squares{};
+    if (chans == stride) {
+        k.reduce(frames, count, chans, peak.data(), squares.data());
+    } else {
+        for (std::size_t f = 0; f < count; ++f) k.reduce(frames + f * stride, 1, chans, peak.data(), squares.data());
+    }
+    for (std::size_t c = 0; c < chans; ++c) sumSquares[c] += squares[c];
+
+    // 真峰值：每声道解交错到历史之后，滤波，再把末尾留作下一块的历史
+    const std::size_t history = kTaps - 1;
+    const std::size_t span = history + kChunkFrames;
+    for (std::size_t c = 0; c < chans; ++c) {
+        float *line = deinterleaved.data() + c * span;
+        for (std::size_t f = 0; f < count; ++f) line[history + f] = frames[f * stride + c];
+        truePeak[c] = std::max(truePeak[c], k.truePeak(line + history, count));
+        std::memmove(line, line + count, history * sizeof(float));
+    }
+}
+
+void LevelMeter::publish(const std::uint64_t nowNs) {
+    MeterReading &reading = readings.back();
+    reading.channels = static_cast<std::uint32_t>(chans);
+    for (std::size_t c = 0; c < chans; ++c) {
+        // 均方值按窗口做一阶积分，时间常数 kRmsIntegrationMs
+        const double windowMean = sumSquares[c] / static_cast<double>(accumulated);
+        meanSquare[c] = rmsDecay * meanSquare[c] + (1.0 - rmsDecay) * windowMean;
+        reading.peak[c] = peak[c];
+        reading.rms[c] = static_cast<float>(std::sqrt(meanSquare[c]));
+        reading.truePeak[c] = truePeak[c];
+        peak[c] = 0.0f;
+        sumSquares[c] = 0.0;
+        truePeak[c] = 0.0f;
+    }
+    reading.timeNs = nowNs != 0 ? nowNs : 1;
+    readings.publish();
+    accumulated = 0;
+}
+
+const MeterReading &LevelMeter::read() {
+    readings.update();
+    return readings.front();
+}
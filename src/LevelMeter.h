@@ -0,0 +1,88 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "TripleBuffer.h"
+
+// 电平表测量的声道数上限（更多的声道不参与测量）
+constexpr std::size_t kMaxMeterChannels = 8;
+
+// 一次电平读数（线性幅度，1.0 = 0 dBFS）
+struct MeterReading {
+    std::uint32_t channels = 0;
+    std::array<float, kMaxMeterChannels> peak{};      // 最近一个窗口内的样本峰值
+    std::array<float, kMaxMeterChannels> rms{};       // RMS（约 300 ms 积分）
+    std::array<float, kMaxMeterChannels> truePeak{};  // 最近一个窗口内 4 倍过采样的真峰值（ITU-R BS.1770 附录 2）
+    std::uint64_t timeNs = 0;                         // 发布时刻（后端时基），0 表示还没有数据
+};
+
+// 电平内核（启动时按 CPU 特性选择 AVX2 / SSE2 / 标量实现）
+struct MeterKernels {
+    // 交错样本逐声道求 |x| 的最大值与平方和，合并进 peak / sumSquares（各 channels 个）
+    void (*reduce)(const float *samples, std::size_t frames, std::size_t channels, float *peak, float *sumSquares);
+    // 单声道连续样本的 4 倍过采样峰值；samples[-11..-1] 必须是前面的历史样本
+    float (*truePeak)(const float *samples, std::size_t count);
+    const char *name;
+};
+
+const MeterKernels &meterKernels();
+
+// 各实现单独暴露，便于对比测试与基准
+const MeterKernels &scalarMeterKernels();
+const MeterKernels &sse2MeterKernels();   // 非 x86 平台上退化为标量实现
+const MeterKernels &avx2MeterKernels();   // 同上
+
+// 一路信号的电平表（与平台无关）：音频线程逐块送入样本，每 kWindowMs 经三缓冲发布一次读数，
+// 读者（界面、控制接口）随时取最近的一份，不会让音频线程等待
+// 每帧的开销固定：一次归约加每声道 12 抽头 × 4 相位的过采样滤波，分块处理，不分配内存
+class LevelMeter {
+public:
+    static constexpr std::uint32_t kWindowMs = 10;
+    static constexpr std::uint32_t kRmsIntegrationMs = 300;
+    // 过采样滤波器每相位的抽头数（即需要保留的历史样本数 + 1）
+    static constexpr std::size_t kTruePeakTaps = 12;
+
+    LevelMeter(std::size_t channels, std::uint32_t sampleRate);
+
+    std::size_t channels() const { return chans; }
+
+    // ---- 音频线程 ----
+
+    // 送入交错样本；nowNs 为当前时刻（后端时基），用于标记发布的读数
+    void process(const float *frames, std::size_t count, std::uint64_t nowNs);
+    // 送入 count 帧静音（例如带静音标志的 capture 包）
+    void processSilence(std::size_t count, std::uint64_t nowNs);
+
+    // ---- 读者（调用方自行串行化）----
+
+    // 最近发布的读数；还没有发布过时 timeNs 为 0
+    const MeterReading &read();
+
+private:
+    // 每次处理的帧数上限（决定解交错缓冲的大小）
+    static constexpr std::size_t kChunkFrames = 256;
+
+    void processChunk(const float *frames, std::size_t count);
+    void publish(std::uint64_t nowNs);
+
+    std::size_t chans;             // 参与测量的声道数
+    std::size_t stride;            // 输入每帧的样本数
+    std::size_t windowFrames;
+    float rmsDecay;                // 每个窗口的均方值衰减系数
+
+    // 当前窗口的累计值
+    std::size_t accumulated = 0;
+    std::array<float, kMaxMeterChannels> peak{};
+    std::array<double, kMaxMeterChannels> sumSquares{};
+    std::array<float, kMaxMeterChannels> truePeak{};
+    std::array<double, kMaxMeterChannels> meanSquare{};
+
+    // 每声道一段：前 kTruePeakTaps - 1 个为历史，后面是本块解交错的样本
+    std::vector<float> deinterleaved;
+    std::vector<float> silence;
+
+    TripleBuffer<MeterReading> readings;
+};
@@ -7,9 +7,47 @@
 #include <QPushButton>
 #include <QListWidget>
 #include <QMessageBox>
+#include <QFileDialog>
+#include <QSet>
+#include <QHeaderView>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <limits>
+
+namespace {
+    // 友好名称重名（同型号的多个设备）时加序号区分；默认设备加标记；进程来源带上 PID
+    QString displayName(const std::vector<DeviceInfo> &devices, std::size_t index) {
+        const DeviceInfo &device = devices[index];
+        QString text = QString::fromStdWString(device.name);
+        if (device.processId != 0) {
+            text = QString("%1（进程 %2）").arg(text).arg(device.processId);
+            return device.excludeProcessTree ? QString("除 %1 以外的全部声音").arg(text) : text;
+        }
+        std::size_t before = 0, total = 0;
+        for (std::size_t i = 0; i < devices.size(); ++i) {
+            if (devices[i].name != device.name) continue;
+            ++total;
+            if (i < index) ++before;
+        }
+        if (total > 1) text += QString(" #%1").arg(before + 1);
+        if (device.isDefault) text += "（默认）";
+        return text;
+    }
 
-MainWindow::MainWindow(QWidget *parent)
-    : QMainWindow(parent) {
+    // 路由单元格的文字：增益（dB）与延迟（ms）
+    QString routeText(const Route &route, double framesPerMs) {
+        if (route.muted) return "静音";
+        return QString("%1 dB · %2 ms")
+            .arg(20.0 * std::log10(std::max(route.gain, 1e-6f)), 0, 'f', 1)
+            .arg(framesPerMs > 0 ? route.delayFrames / framesPerMs : 0.0, 0, 'f', 0);
+    }
+}
+
+MainWindow::MainWindow(AudioEngine &engine, const EngineSession &session, std::filesystem::path sessionPath,
+                       std::chrono::steady_clock::time_point launched, QWidget *parent)
+    : QMainWindow(parent), engine(engine), sessionPath(std::move(sessionPath)), launched(launched) {
     // 基本 UI 元件创建
     QWidget *central = new QWidget(this);
     setCentralWidget(central);
@@ -19,6 +57,8 @@ MainWindow::MainWindow(QWidget *parent)
     outputCombo = new QComboBox(this);
     inputList = new QListWidget(this);
     inputList->setSelectionMode(QAbstractItemView::MultiSelection);
+    extraOutputList = new QListWidget(this);
+    extraOutputList->setSelectionMode(QAbstractItemView::MultiSelection);
 
     refreshBtn = new QPushButton("刷新", this);
     startBtn = new QPushButton("开始", this);
@@ -59,8 +99,53 @@ MainWindow::MainWindow(QWidget *parent)
 
     connect(bufferSlider, &QSlider::valueChanged, this, [this](int value) {
         bufferLabel->setText(QString("缓冲长度: %1 ms").arg(value));
+        // 运行中直接修改缓冲目标，不重启
+        if (engine.isRunning()) engine.setBufferMs(static_cast<std::uint32_t>(value));
+    });
+
+    // 勾选后忽略缓冲长度，按设备支持的最小周期运行
+    lowLatencyCheck = new QCheckBox("低延迟模式", this);
+    lowLatencyCheck->setToolTip("使用设备支持的最小周期；允许时优先独占输出设备");
+    connect(lowLatencyCheck, &QCheckBox::toggled, this, [this](bool checked) {
+        // 自适应缓冲在低延迟模式下仍以缓冲长度为上限
+        bufferSlider->setEnabled(!checked || adaptiveCheck->isChecked());
+        bufferLabel->setEnabled(!checked || adaptiveCheck->isChecked());
+    });
+    adaptiveCheck = new QCheckBox("自适应缓冲", this);
+    adaptiveCheck->setToolTip("按数据包到达的抖动自动调整缓冲，缓冲长度作为上限；数据没有按时到达时补上延拓的波形");
+    connect(adaptiveCheck, &QCheckBox::toggled, this, [this](bool checked) {
+        bufferSlider->setEnabled(checked || !lowLatencyCheck->isChecked());
+        bufferLabel->setEnabled(checked || !lowLatencyCheck->isChecked());
     });
 
+    // 路由矩阵：单元格显示增益 / 延迟，选中后在下方修改
+    routeTable = new QTableWidget(this);
+    routeTable->setSelectionMode(QAbstractItemView::SingleSelection);
+    routeTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    routeTable->horizontalHeader()->setSectionResizeMode(QHeaderView::Stretch);
+    routeGainBox = new QDoubleSpinBox(this);
+    routeGainBox->setRange(-60.0, 12.0);
+    routeGainBox->setSingleStep(0.5);
+    routeGainBox->setSuffix(" dB");
+    routeDelayBox = new QSpinBox(this);
+    routeDelayBox->setRange(0, 1000);
+    routeDelayBox->setSuffix(" ms");
+    routeDelayBox->setToolTip("与采集卡视频延迟对齐");
+    routeMuteCheck = new QCheckBox("静音", this);
+
+    // 运行统计
+    statsText = new QLabel(this);
+    statsText->setStyleSheet("color:#AAAAAA; font-size:12px;");
+    exportStatsBtn = new QPushButton("导出统计", this);
+    exportStatsBtn->setEnabled(false);
+    recordBtn = new QPushButton("录制", this);
+    recordBtn->setToolTip("把送往路由表中选中的输出（未选中时为主输出）的混音录制为 WAV / W64");
+    recordBtn->setEnabled(false);
+    statsTimer = new QTimer(this);
+    statsTimer->setInterval(500);
+    meterTimer = new QTimer(this);
+    meterTimer->setInterval(33);
+
     auto layout = new QVBoxLayout();
 
     auto topRow = new QHBoxLayout();
@@ -75,10 +160,38 @@ MainWindow::MainWindow(QWidget *parent)
     group->setLayout(gLayout);
     layout->addWidget(group);
 
+    auto extraGroup = new QGroupBox("附加输出 (多选，与输出设备同步播放)");
+    auto extraLayout = new QVBoxLayout();
+    extraLayout->addWidget(extraOutputList);
+    extraGroup->setLayout(extraLayout);
+    layout->addWidget(extraGroup);
+
+    auto routeGroup = new QGroupBox("路由 (来源 × 输出)");
+    auto routeLayout = new QVBoxLayout();
+    routeLayout->addWidget(routeTable);
+    auto routeRow = new QHBoxLayout();
+    routeRow->addWidget(new QLabel("增益:"));
+    routeRow->addWidget(routeGainBox);
+    routeRow->addWidget(new QLabel("延迟:"));
+    routeRow->addWidget(routeDelayBox);
+    routeRow->addWidget(routeMuteCheck);
+    routeRow->addStretch();
+    routeLayout->addLayout(routeRow);
+    routeGroup->setLayout(routeLayout);
+    layout->addWidget(routeGroup);
+
+    auto meterGroup = new QGroupBox("电平 (RMS · 峰值 · 真峰值)");
+    meterLayout = new QGridLayout();
+    meterLayout->setColumnStretch(1, 1);
+    meterGroup->setLayout(meterLayout);
+    layout->addWidget(meterGroup);
+
     // 缓冲行
     auto bufferRow = new QHBoxLayout();
     bufferRow->addWidget(bufferLabel);
     bufferRow->addWidget(bufferSlider);
+    bufferRow->addWidget(lowLatencyCheck);
+    bufferRow->addWidget(adaptiveCheck);
     layout->addLayout(bufferRow);
 
     auto ctrlRow = new QHBoxLayout();
@@ -89,68 +202,349 @@ MainWindow::MainWindow(QWidget *parent)
     ctrlRow->addWidget(statusRow);
     layout->addLayout(ctrlRow);
 
+    auto statsRow = new QHBoxLayout();
+    statsRow->addWidget(statsText, 1);
+    statsRow->addWidget(recordBtn);
+    statsRow->addWidget(exportStatsBtn);
+    layout->addLayout(statsRow);
+
     central->setLayout(layout);
 
     // 连接信号
-    connect(refreshBtn, &QPushButton::clicked, this, &MainWindow::refreshDevices);
+    // 手动刷新时重新完整枚举；平时列表只随设备变化通知更新
+    connect(refreshBtn, &QPushButton::clicked, this, [this] {
+        engine.deviceRegistry().refresh();
+        refreshDevices();
+    });
     connect(inputList, &QListWidget::itemSelectionChanged, this, &MainWindow::onInputSelectionChanged);
+    connect(outputCombo, &QComboBox::activated, this, &MainWindow::onOutputActivated);
+    connect(extraOutputList, &QListWidget::itemSelectionChanged, this, &MainWindow::onExtraOutputSelectionChanged);
+    connect(routeTable, &QTableWidget::itemSelectionChanged, this, &MainWindow::onRouteCellSelected);
+    connect(routeGainBox, &QDoubleSpinBox::valueChanged, this, &MainWindow::onRouteEdited);
+    connect(routeDelayBox, &QSpinBox::valueChanged, this, &MainWindow::onRouteEdited);
+    connect(routeMuteCheck, &QCheckBox::toggled, this, &MainWindow::onRouteEdited);
     connect(startBtn, &QPushButton::clicked, this, &MainWindow::onStartClicked);
     connect(stopBtn, &QPushButton::clicked, this, &MainWindow::onStopClicked);
+    connect(statsTimer, &QTimer::timeout, this, &MainWindow::onStatsTimer);
+    connect(meterTimer, &QTimer::timeout, this, &MainWindow::onMeterTimer);
+    connect(exportStatsBtn, &QPushButton::clicked, this, &MainWindow::onExportStatsClicked);
+    connect(recordBtn, &QPushButton::clicked, this, &MainWindow::onRecordClicked);
+
+    // 设备增删或默认设备变化时重建列表（通知来自后端线程，投递到界面线程执行）
+    engine.deviceRegistry().setChangedCallback([this] {
+        QMetaObject::invokeMethod(this, &MainWindow::refreshDevices, Qt::QueuedConnection);
+    });
+
+    // 上次会话的流参数（已自动恢复时与引擎一致）
+    if (!session.output.id.empty()) {
+        bufferSlider->setValue(static_cast<int>(session.config.bufferMs));
+        lowLatencyCheck->setChecked(session.config.lowLatency);
+        adaptiveCheck->setChecked(session.config.adaptiveBuffer);
+    }
 
     // 初始刷新
     refreshDevices();
-    onInputSelectionChanged();
+    if (engine.isRunning()) {
+        // main 已按会话启动：界面直接显示运行状态
+        warmStarted = true;
+        onEngineStarted();
+    } else {
+        if (!session.output.id.empty()) selectSession(session);
+        onInputSelectionChanged();
+        // main 按会话自动启动失败：显示引擎记下的原因
+        if (const AudioEngine::ErrorReport error = engine.lastError(); error.count > 0) {
+            setStatus("#FF0000", "恢复会话失败：" + QString::fromStdString(error.message));
+        }
+    }
 }
 
 MainWindow::~MainWindow() {
+    engine.deviceRegistry().setChangedCallback(nullptr);
+    // 写回会话：运行中的下次自动恢复，已停止的下次只预选；没有选全来源与输出时保留原来的文件
+    const EngineSession session = currentSession();
+    if (!session.sources.empty() && !session.output.id.empty()) {
+        std::error_code ec;
+        std::filesystem::create_directories(sessionPath.parent_path(), ec);
+        std::string error;
+        if (!saveSession(sessionPath, session, error)) std::cerr << "Failed to save session: " << error << std::endl;
+    }
     // 确保停止后端
     engine.stopCopy();
 }
 
-void MainWindow::refreshDevices() const {
-    outputCombo->clear();
-    inputList->clear();
+void MainWindow::selectSession(const EngineSession &session) {
+    const auto select = [](QListWidget *list, const QSet<QString> &ids) {
+        list->blockSignals(true);
+        for (int i = 0; i < list->count(); ++i) {
+            QListWidgetItem *item = list->item(i);
+            item->setSelected(ids.contains(item->data(Qt::UserRole).toString()));
+        }
+        list->blockSignals(false);
+    };
+    QSet<QString> sources;
+    for (const auto &source: session.sources) sources.insert(QString::fromStdWString(source.endpoint.id));
+    select(inputList, sources);
+    // 先按来源重建输出列表，选中主输出后再按主输出重建附加输出列表
+    onInputSelectionChanged();
+    if (const int index = outputCombo->findData(QString::fromStdWString(session.output.id)); index >= 0) {
+        outputCombo->setCurrentIndex(index);
+    }
+    onInputSelectionChanged();
+    QSet<QString> extras;
+    for (const auto &extra: session.extraOutputs) extras.insert(QString::fromStdWString(extra.id));
+    select(extraOutputList, extras);
+}
 
-    auto devices = engine.listDeviceNames();
+StreamConfig MainWindow::streamConfig() const {
+    StreamConfig config;
+    config.bufferMs = static_cast<std::uint32_t>(bufferSlider->value());
+    config.lowLatency = lowLatencyCheck->isChecked();
+    config.allowExclusive = config.lowLatency;
+    config.adaptiveBuffer = adaptiveCheck->isChecked();
+    return config;
+}
+
+EngineSession MainWindow::currentSession() const {
+    if (engine.isRunning()) {
+        EngineSession session = engine.session();
+        session.autoStart = true;
+        return session;
+    }
+    EngineSession session;
+    for (auto *it: inputList->selectedItems()) {
+        SessionSource source;
+        source.endpoint.id = it->data(Qt::UserRole).toString().toStdWString();
+        session.sources.push_back(source);
+    }
+    session.output.id = outputCombo->currentData().toString().toStdWString();
+    for (auto *it: extraOutputList->selectedItems()) {
+        SessionEndpoint extra;
+        extra.id = it->data(Qt::UserRole).toString().toStdWString();
+        session.extraOutputs.push_back(extra);
+    }
+    // 选择与上次停止时相同：沿用当时的格式、增益、路由与插入效果
+    const auto sameIds = [](const auto &a, const auto &b, const auto &idOf) {
+        return std::equal(a.begin(), a.end(), b.begin(), b.end(), [&](const auto &x, const auto &y) { return idOf(x) == idOf(y); });
+    };
+    if (session.output.id == stoppedSession.output.id &&
+        sameIds(session.sources, stoppedSession.sources, [](const SessionSource &s) { return s.endpoint.id; }) &&
+        sameIds(session.extraOutputs, stoppedSession.extraOutputs, [](const SessionEndpoint &e) { return e.id; })) {
+        session = stoppedSession;
+    }
+    session.config = streamConfig();
+    session.autoStart = false;
+    return session;
+}
 
-    // 把 loopback-capable 的 render 设备作为“输入来源”供多选（A/B）
-    for (const auto &d: devices.loopbackSources) {
-        inputList->addItem(QString::fromWCharArray(d.c_str()));
+void MainWindow::refreshDevices() {
+    // 运行中保持正在使用的来源为选中状态，否则保留原来的选择
+    QSet<QString> selectedIds;
+    if (engine.isRunning()) {
+        for (const auto &id: engine.sourceIds()) selectedIds.insert(QString::fromStdWString(id));
+    } else {
+        for (auto *it: inputList->selectedItems()) selectedIds.insert(it->data(Qt::UserRole).toString());
     }
 
-    // 输出候选（先全部加入，后续会根据选中情况过滤）
-    for (const auto &d: devices.outputs) {
-        outputCombo->addItem(QString::fromWCharArray(d.c_str()));
+    // 重建列表期间不触发选择变化（运行中会被当成移除全部来源）
+    inputList->blockSignals(true);
+    inputList->clear();
+
+    const DeviceList devices = engine.listDevices();
+
+    // 把 loopback-capable 的 render 设备与正在播放的进程作为“输入来源”供多选（A/B）；条目数据为端点 / 进程来源 ID
+    for (std::size_t i = 0; i < devices.loopbackSources.size(); ++i) {
+        const QString id = QString::fromStdWString(devices.loopbackSources[i].id);
+        auto *item = new QListWidgetItem(displayName(devices.loopbackSources, i), inputList);
+        item->setData(Qt::UserRole, id);
+        item->setSelected(selectedIds.contains(id));
     }
+    inputList->blockSignals(false);
 
-    // 保证初始时进行一次过滤
+    // 重建输出下拉并过滤
     onInputSelectionChanged();
 }
 
-void MainWindow::onInputSelectionChanged() const {
-    // 收集已选中的来源名称（QString）
-    QSet<QString> selectedNames;
+void MainWindow::onInputSelectionChanged() {
+    // 收集已选中来源的端点 ID
+    QSet<QString> selectedIds;
     for (auto *it: inputList->selectedItems()) {
-        selectedNames.insert(it->text());
+        selectedIds.insert(it->data(Qt::UserRole).toString());
+    }
+
+    // 运行中：按新的选择增删来源，其他来源与输出不受影响
+    if (engine.isRunning()) {
+        const QString currentOutput = QString::fromStdWString(engine.outputId());
+        for (const auto &id: engine.sourceIds()) {
+            if (!selectedIds.contains(QString::fromStdWString(id)) && !engine.removeSource(id)) {
+                setStatus("#FFDC35", "运行中 · 至少保留一个来源");
+            }
+        }
+        const auto running = engine.sourceIds();
+        for (auto *it: inputList->selectedItems()) {
+            const QString id = it->data(Qt::UserRole).toString();
+            const std::wstring source = id.toStdWString();
+            if (std::find(running.begin(), running.end(), source) != running.end()) continue;
+            // 当前输出设备不能同时作为来源（会形成回环）
+            if (id == currentOutput || !engine.addSource(source)) {
+                setStatus("#FFDC35", QString("运行中 · 无法加入 %1").arg(it->text()));
+            }
+        }
     }
 
-    // 重新构建输出下拉：从 engine 列表中加入 outputs，但跳过已选的来源
+    // 重新构建输出下拉：加入 outputs，但跳过已选的来源；尽量保持原来的选择
+    const QString previous = engine.isRunning() ? QString::fromStdWString(engine.outputId()) : outputCombo->currentData().toString();
+    outputCombo->blockSignals(true);
     outputCombo->clear();
-    auto devices = engine.listDeviceNames();
-    for (const auto &d: devices.outputs) {
-        QString name = QString::fromWCharArray(d.c_str());
-        if (!selectedNames.contains(name)) {
-            outputCombo->addItem(name);
+    const DeviceList devices = engine.listDevices();
+    for (std::size_t i = 0; i < devices.outputs.size(); ++i) {
+        const QString id = QString::fromStdWString(devices.outputs[i].id);
+        if (!selectedIds.contains(id)) {
+            outputCombo->addItem(displayName(devices.outputs, i), id);
         }
     }
+    if (const int index = outputCombo->findData(previous); index >= 0) outputCombo->setCurrentIndex(index);
+    outputCombo->blockSignals(false);
+
+    // 附加输出列表：跳过已选的来源与主输出，保持原来的选择
+    QSet<QString> extraIds;
+    if (engine.isRunning()) {
+        for (const auto &id: engine.additionalOutputIds()) extraIds.insert(QString::fromStdWString(id));
+    } else {
+        for (auto *it: extraOutputList->selectedItems()) extraIds.insert(it->data(Qt::UserRole).toString());
+    }
+    const QString mainOutput = outputCombo->currentData().toString();
+    extraOutputList->blockSignals(true);
+    extraOutputList->clear();
+    for (std::size_t i = 0; i < devices.outputs.size(); ++i) {
+        const QString id = QString::fromStdWString(devices.outputs[i].id);
+        if (selectedIds.contains(id) || id == mainOutput) continue;
+        auto *item = new QListWidgetItem(displayName(devices.outputs, i), extraOutputList);
+        item->setData(Qt::UserRole, id);
+        item->setSelected(extraIds.contains(id));
+    }
+    extraOutputList->blockSignals(false);
 
     // 如果没有可用输出，禁用开始按钮
     if (outputCombo->count() == 0) {
         startBtn->setEnabled(false);
         setStatus("#FFFFFF", "无可用输出（可能被选为来源）");
     } else {
-        startBtn->setEnabled(true);
+        startBtn->setEnabled(!engine.isRunning());
     }
+    refreshRoutes();
+}
+
+void MainWindow::onOutputActivated(int index) {
+    if (index < 0) return;
+    if (!engine.isRunning()) {
+        // 新的主输出不再出现在附加输出列表中
+        onInputSelectionChanged();
+        return;
+    }
+    const std::wstring id = outputCombo->itemData(index).toString().toStdWString();
+    if (id == engine.outputId()) return;
+
+    // 新输出在后台建好后淡入；格式不同无法无缝切换时退回到重新启动
+    if (!engine.retargetOutput(id)) {
+        onStopClicked();
+        onStartClicked();
+    }
+    onInputSelectionChanged();
+}
+
+void MainWindow::onExtraOutputSelectionChanged() {
+    if (!engine.isRunning()) return;
+    QSet<QString> selectedIds;
+    for (auto *it: extraOutputList->selectedItems()) selectedIds.insert(it->data(Qt::UserRole).toString());
+
+    const auto running = engine.additionalOutputIds();
+    for (const auto &id: running) {
+        if (!selectedIds.contains(QString::fromStdWString(id))) engine.removeOutput(id);
+    }
+    for (auto *it: extraOutputList->selectedItems()) {
+        const std::wstring id = it->data(Qt::UserRole).toString().toStdWString();
+        if (std::find(running.begin(), running.end(), id) != running.end()) continue;
+        if (!engine.addOutput(id)) {
+            setStatus("#FFDC35", QString("运行中 · 无法加入附加输出 %1").arg(it->text()));
+        }
+    }
+    refreshRoutes();
+}
+
+void MainWindow::refreshRoutes() {
+    // 表头按端点 ID 找显示名称
+    const DeviceList devices = engine.listDevices();
+    const auto nameOf = [&devices](const std::wstring &id) {
+        for (std::size_t i = 0; i < devices.outputs.size(); ++i) {
+            if (devices.outputs[i].id == id) return displayName(devices.outputs, i);
+        }
+        return QString::fromStdWString(id);
+    };
+
+    routeTable->blockSignals(true);
+    routeTable->clear();
+    if (!engine.isRunning()) {
+        routeTable->setRowCount(0);
+        routeTable->setColumnCount(0);
+        routeTable->blockSignals(false);
+        onRouteCellSelected();
+        rebuildMeters({}, {});
+        return;
+    }
+    const auto sourceIds = engine.sourceIds();
+    const auto extraIds = engine.additionalOutputIds();
+    routeTable->setRowCount(static_cast<int>(sourceIds.size()));
+    routeTable->setColumnCount(static_cast<int>(extraIds.size() + 1));
+    QStringList rows, columns;
+    for (const auto &id: sourceIds) rows << nameOf(id);
+    columns << nameOf(engine.outputId());
+    for (const auto &id: extraIds) columns << nameOf(id);
+    routeTable->setVerticalHeaderLabels(rows);
+    routeTable->setHorizontalHeaderLabels(columns);
+    rebuildMeters(rows, columns);
+
+    const double framesPerMs = engine.latencyReport().sampleRate / 1000.0;
+    for (int r = 0; r < routeTable->rowCount(); ++r) {
+        for (int c = 0; c < routeTable->columnCount(); ++c) {
+            const Route route = engine.route(static_cast<std::size_t>(r), static_cast<std::size_t>(c));
+            routeTable->setItem(r, c, new QTableWidgetItem(routeText(route, framesPerMs)));
+        }
+    }
+    routeTable->blockSignals(false);
+    onRouteCellSelected();
+}
+
+void MainWindow::onRouteCellSelected() {
+    const auto *item = routeTable->currentItem();
+    const bool selected = item && !routeTable->selectedItems().isEmpty();
+    routeGainBox->setEnabled(selected);
+    routeDelayBox->setEnabled(selected);
+    routeMuteCheck->setEnabled(selected);
+    if (!selected) return;
+
+    // 载入选中路由的参数（不触发修改）
+    const Route route = engine.route(static_cast<std::size_t>(item->row()), static_cast<std::size_t>(item->column()));
+    const double framesPerMs = engine.latencyReport().sampleRate / 1000.0;
+    for (QWidget *w: { static_cast<QWidget *>(routeGainBox), static_cast<QWidget *>(routeDelayBox), static_cast<QWidget *>(routeMuteCheck) }) w->blockSignals(true);
+    routeGainBox->setValue(20.0 * std::log10(std::max(route.gain, 1e-6f)));
+    routeDelayBox->setValue(framesPerMs > 0 ? static_cast<int>(std::lround(route.delayFrames / framesPerMs)) : 0);
+    routeMuteCheck->setChecked(route.muted);
+    for (QWidget *w: { static_cast<QWidget *>(routeGainBox), static_cast<QWidget *>(routeDelayBox), static_cast<QWidget *>(routeMuteCheck) }) w->blockSignals(false);
+}
+
+void MainWindow::onRouteEdited() {
+    auto *item = routeTable->currentItem();
+    if (!item || !engine.isRunning()) return;
+    const auto row = static_cast<std::size_t>(item->row());
+    const auto column = static_cast<std::size_t>(item->column());
+
+    // 修改以快照发布给音频线程，不会卡住播放
+    const std::uint32_t rate = engine.latencyReport().sampleRate;
+    Route route;
+    route.gain = static_cast<float>(std::pow(10.0, routeGainBox->value() / 20.0));
+    route.delayFrames = static_cast<std::uint32_t>(routeDelayBox->value()) * rate / 1000;
+    route.muted = routeMuteCheck->isChecked();
+    if (engine.setRoute(row, column, route)) item->setText(routeText(engine.route(row, column), rate / 1000.0));
 }
 
 void MainWindow::onStartClicked() {
@@ -166,33 +560,239 @@ void MainWindow::onStartClicked() {
 
     std::vector<std::wstring> sources;
     for (auto item: items) {
-        sources.push_back(item->text().toStdWString());
+        sources.push_back(item->data(Qt::UserRole).toString().toStdWString());
     }
-    std::wstring outName = outputCombo->currentText().toStdWString();
-
-    DWORD bufferMs = static_cast<DWORD>(bufferSlider->value());
+    std::wstring outId = outputCombo->currentData().toString().toStdWString();
 
     // 禁用 start 按钮以避免重复启动
     startBtn->setEnabled(false);
+    errorsAtStart = engine.lastError().count;
 
-    if (engine.startCopy(sources, outName, bufferMs)) {
-        setStatus("#28FF28", "运行中");
-        bufferSlider->setEnabled(false);   // ← 禁用滑块
-        bufferLabel->setEnabled(false);    // ← 标签也禁用（变灰）
+    if (engine.startCopy(sources, outId, streamConfig())) {
+        // 附加输出在主输出启动后逐个加入（打不开的跳过）
+        for (auto *it: extraOutputList->selectedItems()) {
+            engine.addOutput(it->data(Qt::UserRole).toString().toStdWString());
+        }
+        warmStarted = false;
+        onEngineStarted();
     } else {
-        setStatus("#FF0000", "启动失败");
+        const AudioEngine::ErrorReport error = engine.lastError();
+        setStatus("#FF0000", error.count > errorsAtStart ? "启动失败：" + QString::fromStdString(error.message) : QString("启动失败"));
 
         startBtn->setEnabled(true);
     }
 }
 
+void MainWindow::onEngineStarted() {
+    startBtn->setEnabled(false);
+    refreshRoutes();
+    if (lowLatencyCheck->isChecked()) {
+        // 显示实际协商到的周期与估算延迟
+        const LatencyReport report = engine.latencyReport();
+        const double periodMs = 1000.0 * report.renderPeriodFrames / report.sampleRate;
+        const QString mode = report.renderMode == StreamMode::Exclusive ? "独占"
+                             : report.renderMode == StreamMode::SharedLowLatency ? "共享最小周期" : "共享";
+        runningStatus = QString("运行中 · %1 · 周期 %2 ms · 约 %3 ms")
+                            .arg(mode).arg(periodMs, 0, 'f', 2).arg(report.estimatedLatencyMs, 0, 'f', 1);
+    } else {
+        runningStatus = "运行中";
+    }
+    setStatus("#28FF28", runningStatus);
+    recovering = false;
+    // 缓冲长度可以在运行中调整；低延迟模式需要重新打开流
+    lowLatencyCheck->setEnabled(false);
+    adaptiveCheck->setEnabled(false);
+
+    statsSeries.clear();
+    statsTimer->start();
+    meterTimer->start();
+    exportStatsBtn->setEnabled(true);
+    recordBtn->setEnabled(true);
+    firstFramePending = true;
+}
+
 void MainWindow::onStopClicked() {
+    if (statsTimer->isActive()) {
+        // 停止前记录最后一个样本
+        onStatsTimer();
+        statsTimer->stop();
+    }
+    meterTimer->stop();
+    stoppedSession = engine.session();
     engine.stopCopy();
+    recordingOutput = -1;
+    recordBtn->setText("录制");
+    recordBtn->setEnabled(false);
+    refreshRoutes();
     setStatus("#FFDC35", "已停止");
 
     startBtn->setEnabled(true);
-    bufferSlider->setEnabled(true);   // ← 禁用滑块
-    bufferLabel->setEnabled(true);    // ← 标签也禁用（变灰）
+    lowLatencyCheck->setEnabled(true);
+    adaptiveCheck->setEnabled(true);
+}
+
+void MainWindow::onStatsTimer() {
+    const EngineStatsSnapshot stats = engine.statsSnapshot();
+    statsSeries.append(stats);
+    QString text = QString("延迟 %1 ms · 缓冲 %2 ms（峰值 %3 / p99 %4）· 欠载 %5 · 溢出 %6 · 丢帧 %7 · 处理 p99 %8 µs")
+                       .arg(stats.latencyMs, 0, 'f', 1)
+                       .arg(stats.ringFillMs, 0, 'f', 1)
+                       .arg(stats.ringFillPeakMs, 0, 'f', 1)
+                       .arg(stats.ringFillP99Ms, 0, 'f', 1)
+                       .arg(stats.underruns)
+                       .arg(stats.overruns)
+                       .arg(stats.framesDropped)
+                       .arg(stats.wakeupP99Us, 0, 'f', 0);
+    if (stats.passthrough) text += " · 直通";
+    text += QString(" · 抖动 %1 ms · 目标 %2 ms").arg(stats.jitterMs, 0, 'f', 1).arg(stats.queueTargetMs, 0, 'f', 1);
+    if (stats.concealments > 0) text += QString(" · 补偿 %1 次").arg(stats.concealments);
+    if (stats.insertBlocks > 0) text += QString(" · 效果 %1 us").arg(stats.insertMeanUs, 0, 'f', 1);
+    if (stats.faults > 0) {
+        text += QString(" · 设备失效 %1 次，已恢复 %2 次（上次 %3 ms）")
+                    .arg(stats.faults).arg(stats.recoveries).arg(stats.recoveryMs, 0, 'f', 0);
+    }
+    // 本次启动以来引擎记下的错误（会话中某项没能恢复、设备重新打开失败等），显示最近一条
+    const AudioEngine::ErrorReport error = engine.lastError();
+    if (error.count > errorsAtStart) {
+        text += QString(" · 出错 %1 次：%2").arg(error.count - errorsAtStart).arg(QString::fromStdString(error.message));
+    }
+    // 录音：移除输出或整体重建后引擎会自行结束，这里跟着复位按钮
+    if (recordingOutput >= 0) {
+        const auto recordings = engine.recordingStatus();
+        const auto index = static_cast<std::size_t>(recordingOutput);
+        if (index < recordings.size() && recordings[index].active) {
+            const RecorderStatus &recording = recordings[index];
+            text += QString(" · 录制 %1 s").arg(static_cast<double>(recording.framesWritten) / engine.latencyReport().sampleRate, 0, 'f', 0);
+            if (recording.framesDropped > 0) text += QString("（磁盘跟不上，补静音 %1 帧）").arg(recording.framesDropped);
+            if (recording.failed) text += "（写入失败）";
+        } else {
+            recordingOutput = -1;
+            recordBtn->setText("录制");
+        }
+    }
+    statsText->setText(text);
+
+    // 设备失效时引擎在后台自动恢复；输出格式改变后重建失败则引擎已停止
+    // （先查询失效个数：重建期间它会等重建完成，之后 isRunning 才是确定的）
+    const std::size_t failed = engine.failedStreams();
+    if (!engine.isRunning()) {
+        statsTimer->stop();
+        meterTimer->stop();
+        rebuildMeters({}, {});
+        recordingOutput = -1;
+        recordBtn->setText("录制");
+        recordBtn->setEnabled(false);
+        setStatus("#FF0000", error.count > errorsAtStart ? "已停止：" + QString::fromStdString(error.message) : QString("设备失效，已停止"));
+        startBtn->setEnabled(true);
+        lowLatencyCheck->setEnabled(true);
+        adaptiveCheck->setEnabled(true);
+        return;
+    }
+    if ((failed > 0) != recovering) {
+        recovering = failed > 0;
+        if (recovering) setStatus("#FFDC35", QString("恢复中 · %1 个设备失效").arg(failed));
+        else setStatus("#28FF28", runningStatus);
+    }
+    // 第一帧交给输出设备后显示一次启动耗时
+    if (firstFramePending) {
+        if (const AudioEngine::StartupTiming timing = engine.startupTiming(); timing.rendered) {
+            firstFramePending = false;
+            const auto origin = warmStarted ? launched : timing.requested;
+            runningStatus += QString(" · %1 %2 ms")
+                                 .arg(QString(warmStarted ? "启动到首帧" : "首帧"))
+                                 .arg(std::chrono::duration<double, std::milli>(timing.firstFrame - origin).count(), 0, 'f', 0);
+            if (!recovering) setStatus("#28FF28", runningStatus);
+        }
+    }
+}
+
+void MainWindow::onRecordClicked() {
+    if (recordingOutput >= 0) {
+        engine.stopRecording(static_cast<std::size_t>(recordingOutput));
+        recordingOutput = -1;
+        recordBtn->setText("录制");
+        return;
+    }
+    const int column = routeTable->currentColumn();
+    const int output = column >= 0 ? column : 0;
+    const QString path = QFileDialog::getSaveFileName(this, "录制输出", "audiorepeater-recording.wav",
+                                                      "WAV (*.wav);;Wave64 (*.w64)");
+    if (path.isEmpty()) return;
+
+    RecorderOptions options;
+    if (path.endsWith(".w64", Qt::CaseInsensitive)) options.container = RecordContainer::W64;
+    if (!engine.startRecording(static_cast<std::size_t>(output), path.toStdWString(), options)) {
+        QMessageBox::warning(this, "提示", "无法开始录制");
+        return;
+    }
+    recordingOutput = output;
+    recordBtn->setText("停止录制");
+}
+
+void MainWindow::onMeterTimer() {
+    const EngineMeters meters = engine.meters();
+    // 来源或输出刚增删、行还没重建时跳过这一帧
+    if (meters.sources.size() != meterSources || meters.sources.size() + meters.outputs.size() != meterRows.size()) return;
+
+    const auto toDb = [](float level) { return level > 0.0f ? 20.0 * std::log10(level) : -std::numeric_limits<double>::infinity(); };
+    const auto dbText = [](double db) { return db > -100.0 ? QString::number(db, 'f', 1) : QString("-∞"); };
+    for (std::size_t i = 0; i < meterRows.size(); ++i) {
+        const MeterReading &reading = i < meterSources ? meters.sources[i] : meters.outputs[i - meterSources];
+        float rms = 0.0f, peak = 0.0f, truePeak = 0.0f;
+        for (std::uint32_t ch = 0; ch < reading.channels; ++ch) {
+            rms = std::max(rms, reading.rms[ch]);
+            peak = std::max(peak, reading.peak[ch]);
+            truePeak = std::max(truePeak, reading.truePeak[ch]);
+        }
+        const double rmsDb = toDb(rms);
+        const double truePeakDb = toDb(truePeak);
+        MeterRow &row = meterRows[i];
+        row.bar->setValue(static_cast<int>(std::lround(std::clamp(rmsDb, -60.0, 0.0) * 10.0)));
+        row.text->setText(QString("峰值 %1 dBFS · 真峰值 %2 dBTP").arg(dbText(toDb(peak)), dbText(truePeakDb)));
+        // 真峰值超过 0 dBTP 说明 D/A 之后会削波
+        row.text->setStyleSheet(truePeakDb > 0.0 ? "color:#FF5050;" : "");
+    }
+}
+
+void MainWindow::onExportStatsClicked() {
+    if (statsSeries.samples().empty()) {
+        QMessageBox::information(this, "提示", "暂无统计数据");
+        return;
+    }
+    const QString path = QFileDialog::getSaveFileName(this, "导出统计", "audiorepeater-stats.csv",
+                                                      "CSV (*.csv);;JSON (*.json)");
+    if (path.isEmpty()) return;
+
+    const std::filesystem::path file = path.toStdWString();
+    const bool ok = path.endsWith(".json", Qt::CaseInsensitive) ? statsSeries.writeJson(file) : statsSeries.writeCsv(file);
+    if (!ok) QMessageBox::warning(this, "提示", "导出失败");
+}
+
+void MainWindow::rebuildMeters(const QStringList &sources, const QStringList &outputs) {
+    for (const MeterRow &row : meterRows) {
+        delete row.name;
+        delete row.bar;
+        delete row.text;
+    }
+    meterRows.clear();
+    meterSources = static_cast<std::size_t>(sources.size());
+
+    const auto addRow = [this](const QString &name) {
+        MeterRow row{ new QLabel(name, this), new QProgressBar(this), new QLabel(this) };
+        // 以 0.1 dB 为单位显示 -60 ~ 0 dBFS
+        row.bar->setRange(-600, 0);
+        row.bar->setValue(-600);
+        row.bar->setTextVisible(false);
+        row.bar->setMaximumHeight(12);
+        row.text->setStyleSheet("font-size:12px;");
+        const int r = static_cast<int>(meterRows.size());
+        meterLayout->addWidget(row.name, r, 0);
+        meterLayout->addWidget(row.bar, r, 1);
+        meterLayout->addWidget(row.text, r, 2);
+        meterRows.push_back(row);
+    };
+    for (const QString &name : sources) addRow(name);
+    for (const QString &name : outputs) addRow("→ " + name);
 }
 
 void MainWindow::setStatus(const QString &color, const QString &text) const {
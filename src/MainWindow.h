@@ -6,32 +6,90 @@
 #include <QPushButton>
 #include <QLabel>
 #include <QSlider>
+#include <QCheckBox>
+#include <QDoubleSpinBox>
+#include <QSpinBox>
+#include <QTableWidget>
+#include <QTimer>
+#include <QProgressBar>
+#include <QGridLayout>
+
+#include <chrono>
+#include <filesystem>
+
 #include "AudioEngine.h"
+#include "Session.h"
 
 class MainWindow final : public QMainWindow {
     Q_OBJECT
 
 public:
-    explicit MainWindow(QWidget *parent = nullptr);
+    // engine 可能已经按 session 启动（界面随之显示运行状态），否则按 session 预选设备与参数
+    // 关闭时把当前设置写回 sessionPath；launched 为进程启动的时刻（用来计算首帧时间）
+    MainWindow(AudioEngine &engine, const EngineSession &session, std::filesystem::path sessionPath,
+               std::chrono::steady_clock::time_point launched, QWidget *parent = nullptr);
 
+    // 保存会话并停止后端
     ~MainWindow() override;
 
 private slots:
-    void refreshDevices() const;
+    void refreshDevices();
+
+    // 运行中会按新的选择增删来源
+    void onInputSelectionChanged();
+
+    // 运行中选择了另一个输出设备：切换输出
+    void onOutputActivated(int index);
 
-    void onInputSelectionChanged() const;
+    // 运行中会按新的选择增删附加输出
+    void onExtraOutputSelectionChanged();
+
+    // 路由矩阵：按当前来源与输出重建表格；选中一格后用下方控件修改
+    void refreshRoutes();
+    void onRouteCellSelected();
+    void onRouteEdited();
 
     void onStartClicked();
 
     void onStopClicked();
 
+    // 定时读取引擎统计并刷新显示
+    void onStatsTimer();
+
+    void onExportStatsClicked();
+
+    // 录制路由表中选中的那一列（未选中时为主输出）；再次点击停止
+    void onRecordClicked();
+
+    // 按显示刷新率读取各来源与各输出的电平
+    void onMeterTimer();
+
 private:
-    // 后端引擎
-    AudioEngine engine;
+    // 后端引擎（由 main 持有，先于界面启动）
+    AudioEngine &engine;
+
+    // 会话文件；最近一次停止前的会话（停止后退出时沿用其中的格式、增益、路由与插入效果）
+    std::filesystem::path sessionPath;
+    EngineSession stoppedSession;
+    // 首帧时间：自动恢复的会话从进程启动算起，手动开始从点击开始算起；显示一次后清除 firstFramePending
+    std::chrono::steady_clock::time_point launched;
+    bool warmStarted = false;
+    bool firstFramePending = false;
+
+    // 按会话预选来源、输出与附加输出（未运行时）
+    void selectSession(const EngineSession &session);
+    // 当前的流参数（缓冲长度、低延迟、自适应缓冲）
+    StreamConfig streamConfig() const;
+    // 退出时写回的会话：运行中为引擎的当前设置（下次自动恢复），否则为界面上的选择（下次只预选）
+    EngineSession currentSession() const;
+    // 引擎启动后（手动开始或自动恢复）更新界面
+    void onEngineStarted();
 
     // UI 元件
     QComboBox *outputCombo;
     QListWidget *inputList;
+    // 附加输出：与主输出同时播放同一路混音
+    QListWidget *extraOutputList;
     QPushButton *refreshBtn;
     QPushButton *startBtn;
     QPushButton *stopBtn;
@@ -40,8 +98,47 @@ private:
 
     void setStatus(const QString &color, const QString &text) const;
 
+    // 电平行：先是各来源，后是主输出与各附加输出；随路由表一起按当前名称重建
+    void rebuildMeters(const QStringList &sources, const QStringList &outputs);
+
 
     // 缓冲长度控件
     QSlider *bufferSlider;
     QLabel *bufferLabel;
+    // 低延迟模式（共享模式最小周期 / 独占模式）
+    QCheckBox *lowLatencyCheck;
+    // 自适应缓冲（缓冲长度作为上限）
+    QCheckBox *adaptiveCheck;
+
+    // 路由矩阵：行为来源，列为主输出与各附加输出
+    QTableWidget *routeTable;
+    QDoubleSpinBox *routeGainBox;
+    QSpinBox *routeDelayBox;
+    QCheckBox *routeMuteCheck;
+
+    // 运行统计：显示与导出
+    QLabel *statsText;
+    QPushButton *exportStatsBtn;
+    QPushButton *recordBtn;
+    // 正在录制的输出（与路由表的列一致），-1 表示没有在录
+    int recordingOutput = -1;
+    QTimer *statsTimer;
+    StatsSeries statsSeries;
+
+    // 电平：每行一个 RMS 条（最响的声道，dBFS），旁边显示峰值与真峰值
+    struct MeterRow {
+        QLabel *name;
+        QProgressBar *bar;
+        QLabel *text;
+    };
+    QGridLayout *meterLayout;
+    std::vector<MeterRow> meterRows;
+    std::size_t meterSources = 0;
+    QTimer *meterTimer;
+
+    // 启动时的状态文字；设备失效恢复期间改显示恢复状态，恢复后还原
+    QString runningStatus;
+    bool recovering = false;
+    // 本次启动前引擎已记下的错误次数（见 AudioEngine::lastError），之后新增的才显示
+    std::uint64_t errorsAtStart = 0;
 };
\ No newline at end of file
@@ -0,0 +1,222 @@
+#include "Mixer.h"
+#include "CpuFeatures.h"
+#include "InsertChain.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#if AR_X86
+#include <immintrin.h>
+#endif
+
+namespace {
+    // ---- 标量实现 ----
+
+    void accumulateScalar(float *dst, const float *src, std::size_t samples, float gain) {
+        for (std::size_t i = 0; i < samples; ++i) dst[i] += src[i] * gain;
+    }
+
+    void saturateScalar(float *dst, std::size_t samples) {
+        for (std::size_t i = 0; i < samples; ++i) dst[i] = std::clamp(dst[i], -1.0f, 1.0f);
+    }
+
+#if AR_X86
+    // ---- SSE2 ----
+
+    void accumulateSse2(float *dst, const float *src, std::size_t samples, float gain) {
+        const __m128 g = _mm_set1_ps(gain);
+        std::size_t i = 0;
+        for (; i + 8 <= samples; i += 8) {
+            __m128 a0 = _mm_loadu_ps(dst + i);
+            __m128 a1 = _mm_loadu_ps(dst + i + 4);
+            a0 = _mm_add_ps(a0, _mm_mul_ps(_mm_loadu_ps(src + i), g));
+            a1 = _mm_add_ps(a1, _mm_mul_ps(_mm_loadu_ps(src + i + 4), g));
+            _mm_storeu_ps(dst + i, a0);
+            _mm_storeu_ps(dst + i + 4, a1);
+        }
+        accumulateScalar(dst + i, src + i, samples - i, gain);
+    }
+
+    void saturateSse2(float *dst, std::size_t samples) {
+        const __m128 hi = _mm_set1_ps(1.0f);
+        const __m128 lo = _mm_set1_ps(-1.0f);
+        std::size_t i = 0;
+        for (; i + 4 <= samples; i += 4) {
+            _mm_storeu_ps(dst + i, _mm_max_ps(lo, _mm_min_ps(hi, _mm_loadu_ps(dst + i))));
+        }
+        saturateScalar(dst + i, samples - i);
+    }
+
+    // ---- AVX2 ----
+
+    AR_TARGET_AVX2 void accumulateAvx2(float *dst, const float *src, std::size_t samples, float gain) {
+        const __m256 g = _mm256_set1_ps(gain);
+        std::size_t i = 0;
+        for (; i + 16 <= samples; i += 16) {
+            __m256 a0 = _mm256_fmadd_ps(_mm256_loadu_ps(src + i), g, _mm256_loadu_ps(dst + i));
+            __m256 a1 = _mm256_fmadd_ps(_mm256_loadu_ps(src + i + 8), g, _mm256_loadu_ps(dst + i + 8));
+            _mm256_storeu_ps(dst + i, a0);
+            _mm256_storeu_ps(dst + i + 8, a1);
+        }
+        accumulateScalar(dst + i, src + i, samples - i, gain);
+    }
+
+    AR_TARGET_AVX2 void saturateAvx2(float *dst, std::size_t samples) {
+        const __m256 hi = _mm256_set1_ps(1.0f);
+        const __m256 lo = _mm256_set1_ps(-1.0f);
+        std::size_t i = 0;
+        for (; i + 8 <= samples; i += 8) {
+            _mm256_storeu_ps(dst + i, _mm256_max_ps(lo, _mm256_min_ps(hi, _mm256_loadu_ps(dst + i))));
+        }
+        saturateScalar(dst + i, samples - i);
+    }
+#endif
+
+    // 把 src 的（最多两段）区域按帧对应到 dst 的区域上，逐个连续片段调用 op(dst, src, frames)
+    template <typename Op>
+    void forEachSpan(const SpscRing<float>::Regions &dst, const SpscRing<float>::Regions &src,
+                     std::size_t frames, std::size_t chans, Op op) {
+        const auto locate = [chans](const SpscRing<float>::Regions &r, std::size_t at, std::size_t &left) {
+            if (at < r.first.frames) {
+                left = r.first.frames - at;
+                return r.first.data + at * chans;
+            }
+            left = r.second.frames - (at - r.first.frames);
+            return r.second.data + (at - r.first.frames) * chans;
+        };
+        std::size_t done = 0;
+        while (done < frames) {
+            std::size_t dstLeft = 0, srcLeft = 0;
+            float *d = locate(dst, done, dstLeft);
+            float *s = locate(src, done, srcLeft);
+            const std::size_t n = std::min({ dstLeft, srcLeft, frames - done });
+            if (n == 0) break;
+            op(d, s, n);
+            done += n;
+        }
+    }
+
+    const MixKernels kScalar{ accumulateScalar, saturateScalar, "scalar" };
+#if AR_X86
+    const MixKernels kSse2{ accumulateSse2, saturateSse2, "sse2" };
+    const MixKernels kAvx2{ accumulateAvx2, saturateAvx2, "avx2" };
+#endif
+}
+
+const MixKernels &scalarMixKernels() { return kScalar; }
+
+const MixKernels &sse2MixKernels() {
+#if AR_X86
+    return kSse2;
+#else
+    return kScalar;
+#endif
+}
+
+const MixKernels &avx2MixKernels() {
+#if AR_X86
+    return cpuFeatures().fma ? kAvx2 : sse2MixKernels();
+#else
+    return kScalar;
+#endif
+}
+
+const MixKernels &mixKernels() {
+    static const MixKernels &selected = cpuFeatures().fma ? avx2MixKernels()
+                                       : cpuFeatures().sse2 ? sse2MixKernels()
+                                       : scalarMixKernels();
+    return selected;
+}
+
+Mixer::Mixer(std::size_t channels, std::size_t lagToleranceFrames)
+    : chans(channels ? channels : 1), lagTolerance(lagToleranceFrames) {
+}
+
+std::size_t Mixer::framesReady(const MixInput *inputs, std::size_t count, std::size_t maxFrames) const {
+    std::size_t maxAvail = 0;
+    for (std::size_t i = 0; i < count; ++i) {
+        maxAvail = std::max(maxAvail, inputs[i].ring->readAvailable());
+    }
+
+    // 以数据最多的来源为节拍，只等待与其差距在容忍范围内的来源
+    std::size_t frames = std::min(maxAvail, maxFrames);
+    for (std::size_t i = 0; i < count; ++i) {
+        const std::size_t avail = inputs[i].ring->readAvailable();
+        if (maxAvail - avail <= lagTolerance) frames = std::min(frames, avail);
+    }
+    return frames;
+}
+
+std::uint64_t Mixer::mixRouted(const MixInput *inputs, std::size_t count, const RouteTable &routes,
+                               const std::size_t *buses, std::size_t busCount, FanoutRing &out, std::size_t frames,
+                               InsertChain *const *inserts) const {
+    const MixKernels &k = mixKernels();
+    std::uint64_t insertNs = 0;
+
+    // 每个来源只从 ring 读一次：拷进历史，之后各 bus 都从历史读，延迟只是读位置不同
+    for (std::size_t i = 0; i < count; ++i) {
+        SpscRing<float> &ring = *inputs[i].ring;
+        FanoutRing &history = *inputs[i].history;
+        const auto src = ring.prepareRead(frames);
+        const auto dst = history.prepareWrite(frames);
+        forEachSpan(dst, src, src.frames(), chans, [this](float *d, const float *s, std::size_t n) {
+            std::memcpy(d, s, n * chans * sizeof(float));
+        });
+        // ring 中不足的部分补静音
+        std::size_t copied = src.frames();
+        for (const auto &span : { dst.first, dst.second }) {
+            const std::size_t skip = std::min(copied, span.frames);
+            std::memset(span.data + skip * chans, 0, (span.frames - skip) * chans * sizeof(float));
+            copied -= skip;
+        }
+        ring.commitRead(src.frames());
+        history.commitWrite(frames);
+    }
+
+    // 逐条 bus 按路由累加：静音或零增益的路由不参与计算，累加内核在交错样本上对所有声道一起做
+    for (std::size_t b = 0; b < busCount; ++b) {
+        const std::size_t bus = buses[b];
+        const auto dst = out.prepareWrite(frames, bus);
+        std::memset(dst.first.data, 0, dst.first.frames * chans * sizeof(float));
+        std::memset(dst.second.data, 0, dst.second.frames * chans * sizeof(float));
+        for (std::size_t i = 0; i < count; ++i) {
+            const Route &route = routes.at(inputs[i].row, bus);
+            const float gain = route.gain * inputs[i].gain;
+            InsertChain *insert = inserts ? inserts[inputs[i].row * routes.columns + bus] : nullptr;
+            // 参数每块都要取走，即使这条路由此刻不出声
+            const bool processed = insert && insert->update();
+            if (route.muted || gain == 0.0f) {
+                // 不出声期间不处理：状态清空，恢复时不带出静音之前的残留
+                if (processed) insert->suspend();
+                continue;
+            }
+            FanoutRing &history = *inputs[i].history;
+            const std::uint64_t start = history.writePosition() - frames - route.delayFrames;
+            const auto src = history.readRegions(start, frames);
+            if (processed) {
+                // 历史要留给其他路由，效果在拷贝上原地处理
+                float *block = insert->block();
+                std::memcpy(block, src.first.data, src.first.frames * chans * sizeof(float));
+                std::memcpy(block + src.first.frames * chans, src.second.data, src.second.frames * chans * sizeof(float));
+                const auto begin = std::chrono::steady_clock::now();
+                insert->process(block, frames);
+                insertNs += static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now() - begin).count());
+                const float *s = block;
+                for (const auto &span : { dst.first, dst.second }) {
+                    k.accumulate(span.data, s, span.frames * chans, gain);
+                    s += span.frames * chans;
+                }
+                continue;
+            }
+            forEachSpan(dst, src, frames, chans, [&k, gain, this](float *d, const float *s, std::size_t n) {
+                k.accumulate(d, s, n * chans, gain);
+            });
+        }
+        k.saturate(dst.first.data, dst.first.frames * chans);
+        k.saturate(dst.second.data, dst.second.frames * chans);
+    }
+    out.commitWrite(frames);
+    return insertNs;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "FanoutRing.h"
+#include "RoutingMatrix.h"
+#include "SpscRing.h"
+
+// float32 混音内核（启动时按 CPU 特性选择 AVX2 / SSE2 / 标量实现）
+struct MixKernels {
+    // dst[i] += src[i] * gain
+    void (*accumulate)(float *dst, const float *src, std::size_t samples, float gain);
+    // dst[i] = clamp(dst[i], -1, 1)
+    void (*saturate)(float *dst, std::size_t samples);
+    const char *name;
+};
+
+const MixKernels &mixKernels();
+
+// 各实现单独暴露，便于对比测试与基准
+const MixKernels &scalarMixKernels();
+const MixKernels &sse2MixKernels();   // 非 x86 平台上退化为标量实现
+const MixKernels &avx2MixKernels();   // 同上
+
+class InsertChain;
+
+// 一个混音输入：该来源的 ring + 线性增益
+// 按路由矩阵混音时另需来源的历史（延迟线）与它在矩阵中的行
+struct MixInput {
+    SpscRing<float> *ring = nullptr;
+    float gain = 1.0f;
+    FanoutRing *history = nullptr;
+    std::size_t row = 0;
+};
+
+// 多源混音核心（与平台无关）：从各来源 ring 中取帧求和，输出交错 float32
+class Mixer {
+public:
+    // lagToleranceFrames：落后于最快来源不超过该帧数的来源会被等待；
+    // 落后更多的来源（例如 loopback 端点当前没有声音、不产生数据包）视为静音，不拖住整体输出
+    Mixer(std::size_t channels, std::size_t lagToleranceFrames);
+
+    std::size_t lagToleranceFrames() const { return lagTolerance; }
+
+    // 本次最多可以输出的帧数（不超过 maxFrames）
+    std::size_t framesReady(const MixInput *inputs, std::size_t count, std::size_t maxFrames) const;
+
+    // 按路由矩阵混到 out 的多条 bus（buses 为要混的列，bus 编号即列号）：
+    // 各来源先读出 frames 帧追加到自己的历史（不足的部分按静音），再按每条路由的增益与延迟
+    // 从历史中累加到对应的 bus；调用方保证 frames 加上最大延迟不超过历史容量。写好后提交 out
+    // inserts（可为空）与路由表同样按 行 × 列 排列，路由上有插入效果时先拷出处理再累加（frames 不超过其块长）；
+    // 返回插入效果花费的时间（ns）
+    std::uint64_t mixRouted(const MixInput *inputs, std::size_t count, const RouteTable &routes,
+                            const std::size_t *buses, std::size_t busCount, FanoutRing &out, std::size_t frames,
+                            InsertChain *const *inserts = nullptr) const;
+
+private:
+    std::size_t chans;
+    std::size_t lagTolerance;
+};
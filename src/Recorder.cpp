@@ -0,0 +1,447 @@
+#include "Recorder.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <new>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace {
+    void putLe16(unsigned char* p, const std::uint16_t v) {
+        p[0] = static_cast<unsigned char>(v);
+        p[1] = static_cast<unsigned char>(v >> 8);
+    }
+
+    void putLe32(unsigned char* p, const std::uint32_t v) {
+        for (int i = 0; i < 4; ++i) p[i] = static_cast<unsigned char>(v >> (8 * i));
+    }
+
+    void putLe64(unsigned char* p, const std::uint64_t v) {
+        for (int i = 0; i < 8; ++i) p[i] = static_cast<unsigned char>(v >> (8 * i));
+    }
+
+    // Wave64 的块标识：前 4 字节为 RIFF 中对应的 FourCC，其余为固定后缀（"riff" 的后缀不同）
+    constexpr unsigned char kW64Suffix[12] = { 0xF3, 0xAC, 0xD3, 0x11, 0x8C, 0xD1, 0x00, 0xC0, 0x4F, 0x8E, 0xDB, 0x8A };
+    constexpr unsigned char kW64RiffSuffix[12] = { 0x2E, 0x91, 0xCF, 0x11, 0xA5, 0xD6, 0x28, 0xDB, 0x04, 0xC1, 0x00, 0x00 };
+    // KSDATAFORMAT_SUBTYPE_IEEE_FLOAT
+    constexpr unsigned char kFloatSubtype[16] = { 0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10, 0x00, 0x80, 0x00, 0x00, 0xAA, 0x00, 0x38, 0x9B, 0x71 };
+
+    void putW64Guid(unsigned char* p, const char* fourcc, const unsigned char* suffix) {
+        std::memcpy(p, fourcc, 4);
+        std::memcpy(p + 4, suffix, 12);
+    }
+
+    // fmt 块的内容：双声道以内用 IEEE float，更多声道用 WAVE_FORMAT_EXTENSIBLE 并给出默认声道掩码
+    std::size_t writeFmt(unsigned char* p, const StreamFormat& format) {
+        const bool extensible = format.channels > 2;
+        putLe16(p, extensible ? 0xFFFE : 3);
+        putLe16(p + 2, static_cast<std::uint16_t>(format.channels));
+        putLe32(p + 4, format.sampleRate);
+        putLe32(p + 8, format.sampleRate * format.channels * 4);
+        putLe16(p + 12, static_cast<std::uint16_t>(format.channels * 4));
+        putLe16(p + 14, 32);
+        if (!extensible) return 16;
+        putLe16(p + 16, 22);
+        putLe16(p + 18, 32);
+        putLe32(p + 20, format.channels <= 18 ? (1u << format.channels) - 1 : 0);
+        std::memcpy(p + 24, kFloatSubtype, sizeof(kFloatSubtype));
+        return 40;
+    }
+
+    // 头部块（kAlignBytes 字节，数据紧接其后）；dataBytes 为数据的实际长度（不含对齐填充）
+    void buildHeader(unsigned char* block, const std::size_t size, const RecordContainer container,
+                     const StreamFormat& format, const std::uint64_t dataBytes) {
+        std::memset(block, 0, size);
+        if (container == RecordContainer::W64) {
+            // riff(40) fmt(24 + n) junk(填到 size - 24) data(24)，各块按 8 字节对齐
+            const std::uint64_t padded = (dataBytes + 7) & ~std::uint64_t(7);
+            putW64Guid(block, "riff", kW64RiffSuffix);
+            putLe64(block + 16, size + padded);
+            putW64Guid(block + 24, "wave", kW64Suffix);
+            putW64Guid(block + 40, "fmt ", kW64Suffix);
+            const std::size_t fmtBytes = writeFmt(block + 64, format);
+            putLe64(block + 56, 24 + fmtBytes);
+            const std::size_t junk = 64 + fmtBytes;
+            putW64Guid(block + junk, "junk", kW64Suffix);
+            putLe64(block + junk + 16, size - 24 - junk);
+            putW64Guid(block + size - 24, "data", kW64Suffix);
+            putLe64(block + size - 8, 24 + dataBytes);
+            return;
+        }
+
+        // RIFF(12) JUNK(8 + 28，超过 4 GiB 时改为 ds64) fmt(8 + n) JUNK(填到 size - 8) data(8)
+        const std::uint64_t riffBytes = size - 8 + dataBytes + (dataBytes & 1);
+        const bool rf64 = riffBytes > 0xFFFFFFFFull;
+        std::memcpy(block, rf64 ? "RF64" : "RIFF", 4);
+        putLe32(block + 4, rf64 ? 0xFFFFFFFFu : static_cast<std::uint32_t>(riffBytes));
+        std::memcpy(block + 8, "WAVE", 4);
+        std::memcpy(block + 12, rf64 ? "ds64" : "JUNK", 4);
+        putLe32(block + 16, 28);
+        if (rf64) {
+            putLe64(block + 20, riffBytes);
+            putLe64(block + 28, dataBytes);
+            putLe64(block + 36, dataBytes / (format.channels * 4ull));
+        }
+        std::memcpy(block + 48, "fmt ", 4);
+        const std::size_t fmtBytes = writeFmt(block + 56, format);
+        putLe32(block + 52, static_cast<std::uint32_t>(fmtBytes));
+        const std::size_t junk = 56 + fmtBytes;
+        std::memcpy(block + junk, "JUNK", 4);
+        putLe32(block + junk + 4, static_cast<std::uint32_t>(size - 8 - junk - 8));
+        std::memcpy(block + size - 8, "data", 4);
+        putLe32(block + size - 4, rf64 ? 0xFFFFFFFFu : static_cast<std::uint32_t>(dataBytes));
+    }
+
+    std::uint64_t steadyNs() {
+        return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+}
+
+const char* recordContainerName(const RecordContainer container) {
+    return container == RecordContainer::W64 ? "w64" : "wav";
+}
+
+// 文件写入：偏移与长度都按 kAlignBytes 对齐。两块数据缓冲与头部各占一个槽位，各自可以有一次写入在进行中
+class Recorder::File {
+public:
+    ~File() { close(); }
+
+#ifdef _WIN32
+    bool open(const std::filesystem::path& path, std::string& error) {
+        // 无缓冲 + 重叠 I/O：数据直接从我们的对齐缓冲写到磁盘，写入线程不等上一块写完就去准备下一块
+        handle = CreateFileW(path.c_str(), GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS,
+                             FILE_ATTRIBUTE_NORMAL | FILE_FLAG_NO_BUFFERING | FILE_FLAG_OVERLAPPED, nullptr);
+        if (handle == INVALID_HANDLE_VALUE) {
+            error = "无法创建录音文件";
+            return false;
+        }
+        for (auto& slot : slots) {
+            slot.overlapped.hEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+            if (!slot.overlapped.hEvent) {
+                error = "无法创建事件";
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool unbuffered() const { return true; }
+
+    void reserve(const std::uint64_t bytes) {
+        // 只预留空间（不改变文件长度），失败不影响写入
+        FILE_ALLOCATION_INFO info{};
+        info.AllocationSize.QuadPart = static_cast<LONGLONG>(bytes);
+        SetFileInformationByHandle(handle, FileAllocationInfo, &info, sizeof(info));
+    }
+
+    bool write(const std::size_t slotIndex, const std::uint64_t offset, const unsigned char* data, const std::size_t bytes) {
+        if (!wait(slotIndex)) return false;
+        Slot& slot = slots[slotIndex];
+        ResetEvent(slot.overlapped.hEvent);
+        slot.overlapped.Offset = static_cast<DWORD>(offset);
+        slot.overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+        slot.expected = static_cast<DWORD>(bytes);
+        if (!WriteFile(handle, data, slot.expected, nullptr, &slot.overlapped) && GetLastError() != ERROR_IO_PENDING) return false;
+        slot.pending = true;
+        return true;
+    }
+
+    bool wait(const std::size_t slotIndex) {
+        Slot& slot = slots[slotIndex];
+        if (!slot.pending) return true;
+        slot.pending = false;
+        DWORD done = 0;
+        return GetOverlappedResult(handle, &slot.overlapped, &done, TRUE) && done == slot.expected;
+    }
+
+    bool truncate(const std::uint64_t size) {
+        FILE_END_OF_FILE_INFO info{};
+        info.EndOfFile.QuadPart = static_cast<LONGLONG>(size);
+        return SetFileInformationByHandle(handle, FileEndOfFileInfo, &info, sizeof(info)) != 0;
+    }
+
+    void close() {
+        for (std::size_t i = 0; i < kSlots; ++i) wait(i);
+        for (auto& slot : slots) {
+            if (slot.overlapped.hEvent) CloseHandle(slot.overlapped.hEvent);
+            slot.overlapped.hEvent = nullptr;
+        }
+        if (handle != INVALID_HANDLE_VALUE) CloseHandle(handle);
+        handle = INVALID_HANDLE_VALUE;
+    }
+
+private:
+    struct Slot {
+        OVERLAPPED overlapped{};
+        DWORD expected = 0;
+        bool pending = false;
+    };
+    static constexpr std::size_t kSlots = 3;
+    HANDLE handle = INVALID_HANDLE_VALUE;
+    Slot slots[kSlots];
+#else
+    bool open(const std::filesystem::path& path, std::string& error) {
+        // 优先绕过页缓存（O_DIRECT）；文件系统不支持（如 tmpfs）时退回普通写入
+        fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC | O_DIRECT, 0644);
+        direct = fd >= 0;
+        if (fd < 0 && errno == EINVAL) fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd < 0) {
+            error = std::string("无法创建录音文件：") + std::strerror(errno);
+            return false;
+        }
+        return true;
+    }
+
+    bool unbuffered() const { return direct; }
+
+    void reserve(const std::uint64_t bytes) {
+        // 预先分配磁盘块，但不改变文件长度（关闭时按实际长度截断）；不支持时忽略
+#ifdef __linux__
+        ::fallocate(fd, FALLOC_FL_KEEP_SIZE, 0, static_cast<off_t>(bytes));
+#else
+        (void)bytes;
+#endif
+    }
+
+    // POSIX 上没有可移植的重叠写入：写入线程本身就是音频线程之外的后台，这里同步完成
+    bool write(std::size_t, const std::uint64_t offset, const unsigned char* data, const std::size_t bytes) {
+        for (std::size_t done = 0; done < bytes;) {
+            const ssize_t n = ::pwrite(fd, data + done, bytes - done, static_cast<off_t>(offset + done));
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0 && errno == EINVAL && direct) {
+                // 打开时接受了 O_DIRECT，写入时才拒绝：关掉后重试
+                direct = false;
+                ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) & ~O_DIRECT);
+                continue;
+            }
+            if (n <= 0) return false;
+            done += static_cast<std::size_t>(n);
+        }
+        return true;
+    }
+
+    bool wait(std::size_t) { return true; }
+
+    bool truncate(const std::uint64_t size) { return ::ftruncate(fd, static_cast<off_t>(size)) == 0; }
+
+    void close() {
+        if (fd >= 0) ::close(fd);
+        fd = -1;
+    }
+
+private:
+    int fd = -1;
+    bool direct = false;
+#endif
+};
+
+void Recorder::AlignedDelete::operator()(unsigned char* p) const {
+    ::operator delete[](p, std::align_val_t{ kAlignBytes });
+}
+
+Recorder::Recorder() = default;
+
+Recorder::~Recorder() {
+    finish();
+}
+
+bool Recorder::start(const std::filesystem::path& path, const StreamFormat& fmt, const RecorderOptions& options, std::string& error) {
+    finish();
+    if (fmt.channels == 0 || fmt.sampleRate == 0) {
+        error = "无效的格式";
+        return false;
+    }
+    format = fmt;
+    opts = options;
+    filePath = path;
+
+    const auto allocate = [](std::size_t bytes) {
+        return std::unique_ptr<unsigned char[], AlignedDelete>(
+            static_cast<unsigned char*>(::operator new[](bytes, std::align_val_t{ kAlignBytes })));
+    };
+    for (auto& block : blocks) block = allocate(kWriteBytes);
+    header = allocate(kAlignBytes);
+    const std::size_t ringFrames = std::max<std::size_t>(1, static_cast<std::size_t>(opts.bufferMs) * format.sampleRate / 1000);
+    ring = std::make_unique<SpscRing<float>>(ringFrames, format.channels);
+
+    file = std::make_unique<File>();
+    if (!file->open(path, error)) {
+        file.reset();
+        return false;
+    }
+    reserved = kReserveBytes;
+    file->reserve(reserved);
+    current = 0;
+    fill = 0;
+    writeOffset = kAlignBytes;
+    dataBytes = 0;
+    throttleStartNs = steadyNs();
+    throttledBytes = 0;
+    gap = 0;
+    stopping = false;
+    failed.store(false, std::memory_order_relaxed);
+    written.store(0, std::memory_order_relaxed);
+    dropped.store(0, std::memory_order_relaxed);
+    peakBacklog.store(0, std::memory_order_relaxed);
+    if (!writeHeader(0)) {
+        error = "写入录音文件失败";
+        file.reset();
+        return false;
+    }
+
+    running.store(true, std::memory_order_release);
+    writer = std::thread(&Recorder::writerLoop, this);
+    return true;
+}
+
+void Recorder::finish() {
+    if (!writer.joinable()) return;
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex);
+        stopping = true;
+    }
+    wake.notify_one();
+    writer.join();
+    running.store(false, std::memory_order_release);
+    file.reset();
+}
+
+void Recorder::push(const float* frames, const std::size_t count) {
+    // 先把上次没送进去的帧补成静音，保证之后的数据落在文件中正确的位置
+    if (gap > 0) {
+        gap -= ring->pushSilence(static_cast<std::size_t>(std::min<std::uint64_t>(gap, SIZE_MAX)));
+        if (gap > 0) {
+            gap += count;
+            dropped.fetch_add(count, std::memory_order_relaxed);
+            return;
+        }
+    }
+    const std::size_t pushed = ring->push(frames, count);
+    if (pushed < count) {
+        gap = count - pushed;
+        dropped.fetch_add(gap, std::memory_order_relaxed);
+    }
+}
+
+RecorderStatus Recorder::status() const {
+    RecorderStatus result;
+    result.active = running.load(std::memory_order_acquire);
+    result.path = filePath;
+    result.framesWritten = written.load(std::memory_order_relaxed);
+    result.framesDropped = dropped.load(std::memory_order_relaxed);
+    if (ring && format.sampleRate > 0) {
+        result.backlogMs = 1000.0 * static_cast<double>(ring->readAvailable()) / format.sampleRate;
+        result.peakBacklogMs = 1000.0 * static_cast<double>(peakBacklog.load(std::memory_order_relaxed)) / format.sampleRate;
+    }
+    result.unbuffered = file && file->unbuffered();
+    result.failed = failed.load(std::memory_order_relaxed);
+    return result;
+}
+
+void Recorder::writerLoop() {
+    std::uint64_t lastHeaderNs = steadyNs();
+    while (true) {
+        const std::size_t backlog = ring->readAvailable();
+        if (backlog > peakBacklog.load(std::memory_order_relaxed)) peakBacklog.store(backlog, std::memory_order_relaxed);
+
+        const bool submitted = drain();
+        {
+            std::unique_lock<std::mutex> lock(wakeMutex);
+            if (stopping && ring->readAvailable() == 0) break;
+            // 攒满过一块说明积压较多，不等待直接继续
+            if (!submitted && !stopping) wake.wait_for(lock, std::chrono::milliseconds(kPollMs));
+        }
+
+        // 定期回写头部：长度覆盖已写到磁盘的整块数据
+        const std::uint64_t now = steadyNs();
+        if (!failed.load(std::memory_order_relaxed) && now - lastHeaderNs >= kHeaderRefreshMs * 1000000ull) {
+            lastHeaderNs = now;
+            const std::uint64_t onDisk = writeOffset - kAlignBytes;
+            if (!writeHeader(onDisk - onDisk % (format.channels * 4ull))) failed.store(true, std::memory_order_relaxed);
+        }
+    }
+
+    // 尾块补零到对齐长度写出，再把文件截到实际长度、回填头部
+    if (!failed.load(std::memory_order_relaxed)) {
+        const std::size_t tail = fill;
+        bool ok = tail == 0 || submitBlock((tail + kAlignBytes - 1) / kAlignBytes * kAlignBytes);
+        for (std::size_t i = 0; i < 2; ++i) ok = file->wait(i) && ok;
+        const std::uint64_t padding = opts.container == RecordContainer::W64 ? (8 - dataBytes % 8) % 8 : dataBytes & 1;
+        ok = ok && file->truncate(kAlignBytes + dataBytes + padding) && writeHeader(dataBytes);
+        if (!ok) failed.store(true, std::memory_order_relaxed);
+    }
+    file->close();
+}
+
+bool Recorder::drain() {
+    // 只取进入时已有的数据：磁盘跟不上时 ring 一直不空，也要回到外层回写头部、响应停止
+    const auto regions = ring->prepareRead(SIZE_MAX);
+    if (regions.frames() == 0) return false;
+    if (failed.load(std::memory_order_relaxed)) {
+        // 已经写不进去了：照常取走数据，音频线程一侧不会因此积压
+        ring->commitRead(regions.frames());
+        return false;
+    }
+
+    // 按字节流填进当前块，一帧可以跨两块；拷走的整帧先归还给 ring，再去等磁盘
+    bool submitted = false;
+    const std::size_t frameBytes = format.channels * sizeof(float);
+    for (const auto& span : { regions.first, regions.second }) {
+        const auto* bytes = reinterpret_cast<const unsigned char*>(span.data);
+        std::size_t remaining = span.frames * frameBytes;
+        while (remaining > 0) {
+            const std::size_t n = std::min(remaining, kWriteBytes - fill);
+            std::memcpy(blocks[current].get() + fill, bytes, n);
+            fill += n;
+            bytes += n;
+            remaining -= n;
+            dataBytes += n;
+            const std::uint64_t frames = dataBytes / frameBytes;
+            ring->commitRead(static_cast<std::size_t>(frames - written.load(std::memory_order_relaxed)));
+            written.store(frames, std::memory_order_relaxed);
+            if (fill == kWriteBytes) {
+                if (!submitBlock(kWriteBytes)) failed.store(true, std::memory_order_relaxed);
+                submitted = true;
+            }
+        }
+    }
+    return submitted;
+}
+
+bool Recorder::submitBlock(const std::size_t bytes) {
+    if (bytes > fill) std::memset(blocks[current].get() + fill, 0, bytes - fill);
+    // 写入位置接近预分配的末尾时再追加一段，让文件在磁盘上尽量连续
+    if (writeOffset + bytes + kWriteBytes > reserved) {
+        reserved += kReserveBytes;
+        file->reserve(reserved);
+    }
+    const bool ok = file->write(current, writeOffset, blocks[current].get(), bytes);
+    writeOffset += bytes;
+    throttle(bytes);
+    // 换到另一块：它上一次的写入必须已经完成
+    current ^= 1;
+    fill = 0;
+    return ok && file->wait(current);
+}
+
+bool Recorder::writeHeader(const std::uint64_t bytes) {
+    buildHeader(header.get(), kAlignBytes, opts.container, format, bytes);
+    // 头部用单独的槽位同步写入，不影响正在进行的数据块
+    return file->write(2, 0, header.get(), kAlignBytes) && file->wait(2);
+}
+
+void Recorder::throttle(const std::uint64_t bytes) {
+    if (opts.throttleBytesPerSecond == 0) return;
+    throttledBytes += bytes;
+    const auto dueNs = throttleStartNs + static_cast<std::uint64_t>(1e9 * static_cast<double>(throttledBytes) / static_cast<double>(opts.throttleBytesPerSecond));
+    const std::uint64_t now = steadyNs();
+    if (dueNs > now) std::this_thread::sleep_for(std::chrono::nanoseconds(dueNs - now));
+}
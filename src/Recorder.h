@@ -0,0 +1,123 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "AudioBackend.h"
+#include "SpscRing.h"
+
+// 录音文件的容器（样本均为 float32）
+enum class RecordContainer {
+    Wav,   // RIFF WAVE；超过 4 GiB 时在关闭时改写为 RF64（EBU Tech 3306）
+    W64,   // Sony Wave64，64 位长度
+};
+
+const char* recordContainerName(RecordContainer container);
+
+struct RecorderOptions {
+    RecordContainer container = RecordContainer::Wav;
+    // 音频线程与写入线程之间的 ring 容量：磁盘暂时跟不上时先积压在这里
+    std::uint32_t bufferMs = 4000;
+    // 仅用于测试：把写入速度限制在该字节数 / 秒以内，模拟慢速磁盘（0 为不限制）
+    std::uint64_t throttleBytesPerSecond = 0;
+};
+
+struct RecorderStatus {
+    bool active = false;
+    std::filesystem::path path;
+    std::uint64_t framesWritten = 0;   // 已交给文件的帧（含补的静音）
+    std::uint64_t framesDropped = 0;   // ring 满时没能送进去、在文件中补成静音的帧
+    double backlogMs = 0.0;            // ring 中等待写入的数据
+    double peakBacklogMs = 0.0;
+    bool unbuffered = false;           // 是否绕过了系统文件缓存
+    bool failed = false;               // 写入出错（磁盘满等），此后的数据被丢弃
+};
+
+// 录音：音频线程只把帧推进无锁 ring，后台写入线程攒成大块按扇区对齐写入。
+// 文件按块预先分配空间，能绕过系统缓存时直接写盘（Linux O_DIRECT、Windows 无缓冲 + 重叠 I/O）；
+// 数据从 4 KiB 处开始，头部也是一个对齐的块，运行中每隔几秒回写一次长度，进程意外退出时文件仍可读。
+// 磁盘跟不上时音频线程也不等待：ring 满了就记下缺口，之后在原位置补静音，文件的时间轴保持连续
+class Recorder {
+public:
+    Recorder();
+    ~Recorder();
+
+    Recorder(const Recorder&) = delete;
+    Recorder& operator=(const Recorder&) = delete;
+
+    // 创建文件并启动写入线程；format 只用到采样率与声道数
+    bool start(const std::filesystem::path& path, const StreamFormat& format, const RecorderOptions& options, std::string& error);
+    // 写完 ring 中剩余的数据，回填头部并关闭文件（音频线程此后不能再调用 push）
+    void finish();
+
+    // ---- 音频线程 ----
+
+    // 送入 frames 帧交错 float32；不分配内存、不加锁、不等待
+    void push(const float* frames, std::size_t count);
+
+    // ---- 任意线程 ----
+
+    RecorderStatus status() const;
+    std::uint32_t channels() const { return format.channels; }
+
+private:
+    class File;
+
+    // 每次写入的字节数，对齐单位（扇区与数据起点）
+    static constexpr std::size_t kWriteBytes = 1 << 20;
+    static constexpr std::size_t kAlignBytes = 4096;
+    // 预分配的步长：写入位置接近已分配的末尾时再追加一段
+    static constexpr std::uint64_t kReserveBytes = 64ull << 20;
+    // 写入线程没有攒满一块时的轮询间隔、运行中回写头部的间隔
+    static constexpr std::uint32_t kPollMs = 20;
+    static constexpr std::uint32_t kHeaderRefreshMs = 5000;
+
+    void writerLoop();
+    // 从 ring 取出数据追加到当前块；攒满一块就提交写入。返回是否提交过
+    bool drain();
+    // 提交当前块（满块或 final 时的尾块）并换到另一块
+    bool submitBlock(std::size_t bytes);
+    // 按当前写入的数据长度生成头部块并写到文件开头
+    bool writeHeader(std::uint64_t dataBytes);
+    void throttle(std::uint64_t bytes);
+
+    StreamFormat format;
+    RecorderOptions opts;
+    std::filesystem::path filePath;
+    std::unique_ptr<SpscRing<float>> ring;
+    std::unique_ptr<File> file;
+    std::thread writer;
+
+    // 写入线程持有：两块对齐的缓冲轮流填充与写入
+    struct AlignedDelete {
+        void operator()(unsigned char* p) const;
+    };
+    std::unique_ptr<unsigned char[], AlignedDelete> blocks[2];
+    std::unique_ptr<unsigned char[], AlignedDelete> header;
+    std::size_t current = 0;
+    std::size_t fill = 0;
+    std::uint64_t writeOffset = 0;     // 下一块在文件中的偏移
+    std::uint64_t reserved = 0;        // 已预分配到的偏移
+    std::uint64_t dataBytes = 0;       // 已进入块缓冲的数据字节
+    std::uint64_t throttleStartNs = 0;
+    std::uint64_t throttledBytes = 0;
+
+    // 音频线程持有：ring 满时没能送进去的帧，之后先补成静音
+    std::uint64_t gap = 0;
+
+    std::mutex wakeMutex;
+    std::condition_variable wake;
+    bool stopping = false;
+
+    std::atomic<bool> running{ false };
+    std::atomic<bool> failed{ false };
+    std::atomic<std::uint64_t> written{ 0 };
+    std::atomic<std::uint64_t> dropped{ 0 };
+    std::atomic<std::uint64_t> peakBacklog{ 0 };
+};
@@ -0,0 +1,209 @@
+#include "Resampler.h"
+#include "CpuFeatures.h"
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <mutex>
+#include <numeric>
+#include <utility>
+
+#if AR_X86
+#include <immintrin.h>
+#endif
+
+namespace {
+    constexpr std::uint64_t kOne = 1ull << 32;
+    constexpr double kPi = 3.14159265358979323846;
+
+    // 第一类零阶修正贝塞尔函数（Kaiser 窗）
+    double besselI0(double x) {
+        double sum = 1.0, term = 1.0;
+        for (int k = 1; k < 32; ++k) {
+            term *= (x / (2.0 * k)) * (x / (2.0 * k));
+            sum += term;
+        }
+        return sum;
+    }
+
+    // ---- 点积内核 ----
+
+    float dotScalar(const float *a, const float *b, std::size_t n) {
+        float acc = 0.0f;
+        for (std::size_t i = 0; i < n; ++i) acc += a[i] * b[i];
+        return acc;
+    }
+
+#if AR_X86
+    float dotSse2(const float *a, const float *b, std::size_t n) {
+        __m128 acc0 = _mm_setzero_ps();
+        __m128 acc1 = _mm_setzero_ps();
+        std::size_t i = 0;
+        for (; i + 8 <= n; i += 8) {
+            acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+            acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+        }
+        __m128 acc = _mm_add_ps(acc0, acc1);
+        acc = _mm_add_ps(acc, _mm_movehl_ps(acc, acc));
+        acc = _mm_add_ss(acc, _mm_shuffle_ps(acc, acc, 1));
+        return _mm_cvtss_f32(acc) + dotScalar(a + i, b + i, n - i);
+    }
+
+    AR_TARGET_AVX2 float dotAvx2(const float *a, const float *b, std::size_t n) {
+        __m256 acc0 = _mm256_setzero_ps();
+        __m256 acc1 = _mm256_setzero_ps();
+        std::size_t i = 0;
+        for (; i + 16 <= n; i += 16) {
+            acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), acc0);
+            acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8), acc1);
+        }
+        __m256 acc8 = _mm256_add_ps(acc0, acc1);
+        __m128 acc = _mm_add_ps(_mm256_castps256_ps128(acc8), _mm256_extractf128_ps(acc8, 1));
+        acc = _mm_add_ps(acc, _mm_movehl_ps(acc, acc));
+        acc = _mm_add_ss(acc, _mm_shuffle_ps(acc, acc, 1));
+        return _mm_cvtss_f32(acc) + dotScalar(a + i, b + i, n - i);
+    }
+#endif
+
+    using DotFn = float (*)(const float *, const float *, std::size_t);
+
+    DotFn selectDot() {
+#if AR_X86
+        if (cpuFeatures().fma) return dotAvx2;
+        if (cpuFeatures().sse2) return dotSse2;
+#endif
+        return dotScalar;
+    }
+
+    const DotFn dot = selectDot();
+}
+
+std::shared_ptr<const PolyphaseFilterBank> PolyphaseFilterBank::forRates(std::uint32_t inRate, std::uint32_t outRate) {
+    static std::mutex cacheMutex;
+    static std::map<std::pair<std::uint32_t, std::uint32_t>, std::shared_ptr<const PolyphaseFilterBank>> cache;
+
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    if (cache.empty()) {
+        // 预计算常用比例
+        constexpr std::uint32_t common[] = { 44100, 48000, 96000 };
+        for (auto a : common) {
+            for (auto b : common) {
+                if (a != b) cache[{ a, b }] = std::make_shared<PolyphaseFilterBank>(a, b);
+            }
+        }
+    }
+    auto &entry = cache[{ inRate, outRate }];
+    if (!entry) entry = std::make_shared<PolyphaseFilterBank>(inRate, outRate);
+    return entry;
+}
+
+PolyphaseFilterBank::PolyphaseFilterBank(std::uint32_t inRate, std::uint32_t outRate) {
+    // 有理比例 L/M：L 个相位即可覆盖所有输出位置；相位太少时按整数倍加密，
+    // 保证漂移微调时插值足够精细；分母过大的比例退化为 256 相位 + 插值
+    const std::uint32_t g = std::gcd(inRate, outRate);
+    const std::size_t L = g ? outRate / g : 1;
+    if (L <= 1024) {
+        phaseCount = L * std::max<std::size_t>(1, (128 + L - 1) / L);
+    } else {
+        phaseCount = 256;
+    }
+
+    // 截止频率（单位：周期/输入样本）：取输入、输出奈奎斯特中较低者，留出过渡带
+    const double ratio = std::min(1.0, static_cast<double>(outRate) / inRate);
+    const double cutoff = 0.5 * ratio * 0.92;
+    const double beta = 7.0; // 约 70 dB 阻带衰减
+    const double half = kTaps / 2.0;
+    const double i0Beta = besselI0(beta);
+
+    coefs.assign((phaseCount + 1) * kTaps, 0.0f);
+    std::vector<double> row(kTaps);
+    for (std::size_t p = 0; p <= phaseCount; ++p) {
+        const double f = static_cast<double>(p) / phaseCount;
+        double sum = 0.0;
+        for (std::size_t j = 0; j < kTaps; ++j) {
+            // 历史窗口中 j=taps-1 为最新样本；输出位置位于 half-1+f
+            const double x = (half - 1.0 - static_cast<double>(j)) + f;
+            const double t = 2.0 * cutoff * x;
+            const double sinc = std::abs(t) < 1e-12 ? 1.0 : std::sin(kPi * t) / (kPi * t);
+            const double r = x / half;
+            const double w = std::abs(r) >= 1.0 ? 0.0 : besselI0(beta * std::sqrt(1.0 - r * r)) / i0Beta;
+            row[j] = 2.0 * cutoff * sinc * w;
+            sum += row[j];
+        }
+        // 每个相位归一化为单位直流增益
+        for (std::size_t j = 0; j < kTaps; ++j) {
+            coefs[p * kTaps + j] = static_cast<float>(row[j] / sum);
+        }
+    }
+}
+
+Resampler::Resampler(std::uint32_t inRate, std::uint32_t outRate, std::size_t channels)
+    : inRate(inRate), outRate(outRate), chans(channels ? channels : 1),
+      bank(PolyphaseFilterBank::forRates(inRate, outRate)) {
+    nominalStep = (static_cast<std::uint64_t>(inRate) << 32) / outRate;
+    step = nominalStep;
+    history.assign(chans * PolyphaseFilterBank::kTaps * 2, 0.0f);
+    reset();
+}
+
+void Resampler::setRatioAdjust(double value) {
+    adjust = value;
+    step = static_cast<std::uint64_t>(static_cast<double>(nominalStep) * value + 0.5);
+}
+
+void Resampler::reset() {
+    std::fill(history.begin(), history.end(), 0.0f);
+    writePos = 0;
+    frac = kOne; // 先读入一帧再产生输出
+}
+
+std::size_t Resampler::maxOutputFor(std::size_t inFrames) const {
+    // 每消耗 1 输入帧最多产生 ceil(1/step) 帧，再留 1 帧余量
+    return static_cast<std::size_t>((static_cast<double>(inFrames) * kOne) / static_cast<double>(step)) + 2;
+}
+
+void Resampler::pushFrame(const float *frame) {
+    constexpr std::size_t taps = PolyphaseFilterBank::kTaps;
+    for (std::size_t c = 0; c < chans; ++c) {
+        float *h = history.data() + c * taps * 2;
+        h[writePos] = frame[c];
+        h[writePos + taps] = frame[c];
+    }
+    writePos = (writePos + 1) % taps;
+}
+
+std::size_t Resampler::process(const float *in, std::size_t inFrames, std::size_t &consumed,
+                               float *out, std::size_t maxOutFrames) {
+    constexpr std::size_t taps = PolyphaseFilterBank::kTaps;
+    const std::size_t phases = bank->phases();
+    consumed = 0;
+    std::size_t produced = 0;
+
+    while (produced < maxOutFrames) {
+        // 补足输入，直到当前位置落在历史窗口内
+        while (frac >= kOne) {
+            if (consumed == inFrames) return produced;
+            pushFrame(in + consumed * chans);
+            ++consumed;
+            frac -= kOne;
+        }
+
+        // 相位索引与相位间插值权重
+        const std::uint64_t scaled = frac * phases;
+        const std::size_t p = static_cast<std::size_t>(scaled >> 32);
+        const float w = static_cast<float>(scaled & 0xffffffffull) * (1.0f / 4294967296.0f);
+        const float *c0 = bank->phase(p);
+        const float *c1 = bank->phase(p + 1);
+
+        float *o = out + produced * chans;
+        for (std::size_t c = 0; c < chans; ++c) {
+            // writePos 指向最旧样本，镜像缓冲保证 [writePos, writePos+taps) 连续
+            const float *window = history.data() + c * taps * 2 + writePos;
+            const float y0 = dot(window, c0, taps);
+            o[c] = (w == 0.0f) ? y0 : y0 + w * (dot(window, c1, taps) - y0);
+        }
+        ++produced;
+        frac += step;
+    }
+    return produced;
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// 多相滤波器组：Kaiser 窗 sinc 原型按 phases 个相位预先采样
+// 每个相位 taps 个系数，额外多存一个相位便于相邻相位间插值
+class PolyphaseFilterBank {
+public:
+    static constexpr std::size_t kTaps = 64;
+
+    // 取得（必要时构建）某个转换比的滤波器组；44.1k/48k/96k 之间的常用比例在首次调用时一并预计算
+    // 只应在非实时线程中调用
+    static std::shared_ptr<const PolyphaseFilterBank> forRates(std::uint32_t inRate, std::uint32_t outRate);
+
+    PolyphaseFilterBank(std::uint32_t inRate, std::uint32_t outRate);
+
+    std::size_t phases() const { return phaseCount; }
+    const float *phase(std::size_t p) const { return coefs.data() + p * kTaps; }
+
+private:
+    std::size_t phaseCount = 0;
+    std::vector<float> coefs; // (phaseCount + 1) * kTaps
+};
+
+// 流式多相重采样器（交错 float32）
+// - 构造时完成全部分配，process() 内不再分配，每个输出帧的开销固定
+// - 相位用 32.32 定点累加；有理比例（如 160/147）时正好落在预计算相位上，
+//   微调比例（时钟漂移补偿）时在相邻相位间线性插值
+class Resampler {
+public:
+    Resampler(std::uint32_t inRate, std::uint32_t outRate, std::size_t channels);
+
+    std::uint32_t inputRate() const { return inRate; }
+    std::uint32_t outputRate() const { return outRate; }
+    std::size_t channels() const { return chans; }
+
+    // 群延迟（以输入帧计）
+    static constexpr std::size_t latencyFrames() { return PolyphaseFilterBank::kTaps / 2; }
+
+    // 在名义比例上叠加的微调系数（1.0 = 不调整；>1 消耗输入更快）
+    void setRatioAdjust(double adjust);
+    double ratioAdjust() const { return adjust; }
+
+    // 处理交错输入，最多写 maxOutFrames 帧到 out；consumed 返回实际消耗的输入帧数
+    std::size_t process(const float *in, std::size_t inFrames, std::size_t &consumed,
+                        float *out, std::size_t maxOutFrames);
+
+    // 输入 inFrames 帧时最多能产生的输出帧数（用于预留空间）
+    std::size_t maxOutputFor(std::size_t inFrames) const;
+
+    // 清空历史
+    void reset();
+
+private:
+    void pushFrame(const float *frame);
+
+    std::uint32_t inRate;
+    std::uint32_t outRate;
+    std::size_t chans;
+    std::shared_ptr<const PolyphaseFilterBank> bank;
+
+    double adjust = 1.0;
+    std::uint64_t nominalStep = 0; // 每个输出帧前进的输入帧数（32.32 定点）
+    std::uint64_t step = 0;
+    std::uint64_t frac = 0;        // 当前位置的小数部分（32.32 定点，>= 1.0 表示需要新的输入帧）
+
+    // 每声道的输入历史：长度 2*taps 的镜像缓冲，保证任意时刻最近 taps 个样本连续
+    std::vector<float> history;
+    std::size_t writePos = 0;
+};
@@ -0,0 +1,49 @@
+#include "RoutingMatrix.h"
+
+#include <algorithm>
+#include <thread>
+
+RoutingMatrix::RoutingMatrix(std::size_t rows, std::size_t columns)
+    : rowCount(rows ? rows : 1), columnCount(columns ? columns : 1) {
+    edit.assign(rowCount * columnCount, Route{});
+    for (auto &snapshot : snapshots) snapshot = edit;
+}
+
+void RoutingMatrix::setRoute(std::size_t row, std::size_t column, const Route &route) {
+    if (row >= rowCount || column >= columnCount) return;
+    edit[row * columnCount + column] = route;
+}
+
+void RoutingMatrix::resetRow(std::size_t row) {
+    if (row >= rowCount) return;
+    std::fill_n(edit.begin() + static_cast<std::ptrdiff_t>(row * columnCount), columnCount, Route{});
+}
+
+void RoutingMatrix::resetColumn(std::size_t column) {
+    if (column >= columnCount) return;
+    for (std::size_t row = 0; row < rowCount; ++row) edit[row * columnCount + column] = Route{};
+}
+
+void RoutingMatrix::resetAll() {
+    std::fill(edit.begin(), edit.end(), Route{});
+}
+
+void RoutingMatrix::publish() {
+    // 写入未发布的那一份；读者若还拿着它（上上次发布的快照），等它处理完这个周期
+    const int target = 1 - published.load(std::memory_order_relaxed);
+    while (reading.load(std::memory_order_seq_cst) == target) std::this_thread::yield();
+    std::copy(edit.begin(), edit.end(), snapshots[target].begin());
+    published.store(target, std::memory_order_seq_cst);
+}
+
+RouteTable RoutingMatrix::acquire() {
+    // 先登记要读的快照再确认它仍是发布的那一份：确认之后写入端不会再覆盖它
+    int index = published.load(std::memory_order_seq_cst);
+    while (true) {
+        reading.store(index, std::memory_order_seq_cst);
+        const int now = published.load(std::memory_order_seq_cst);
+        if (now == index) break;
+        index = now;
+    }
+    return RouteTable{ snapshots[index].data(), columnCount };
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// 一条路由（来源 -> 输出）的参数
+struct Route {
+    float gain = 1.0f;               // 线性增益（与来源自身的增益相乘）
+    std::uint32_t delayFrames = 0;   // 固定延迟（输出采样率下的帧数），用于与采集卡视频延迟对齐
+    bool muted = false;
+};
+
+// 某一时刻的路由表：rows × columns 个 Route 按行连续存放
+struct RouteTable {
+    const Route *cells = nullptr;
+    std::size_t columns = 0;
+
+    const Route &at(std::size_t row, std::size_t column) const { return cells[row * columns + column]; }
+};
+
+// 路由矩阵（与平台无关）：行为来源槽位，列为输出槽位
+// - 控制线程修改自己的副本，publish 时拷进空闲的一份快照再发布（RCU 式双缓冲）
+// - 音频线程每个周期 acquire 当前快照、处理完 release；它持有的快照不会被覆盖，音频线程从不等待控制线程
+// - 控制线程只在音频线程仍持有上上次发布的快照时短暂等待（至多一个音频周期）
+class RoutingMatrix {
+public:
+    RoutingMatrix(std::size_t rows, std::size_t columns);
+
+    RoutingMatrix(const RoutingMatrix &) = delete;
+    RoutingMatrix &operator=(const RoutingMatrix &) = delete;
+
+    std::size_t rows() const { return rowCount; }
+    std::size_t columns() const { return columnCount; }
+
+    // ---- 控制线程（调用方自行串行化）----
+
+    const Route &route(std::size_t row, std::size_t column) const { return edit[row * columnCount + column]; }
+    void setRoute(std::size_t row, std::size_t column, const Route &route);
+    // 整行 / 整列 / 全部恢复为默认路由（单位增益、无延迟、不静音）
+    void resetRow(std::size_t row);
+    void resetColumn(std::size_t column);
+    void resetAll();
+    // 发布当前副本
+    void publish();
+
+    // ---- 音频线程（单一读者）----
+
+    RouteTable acquire();
+    void release() { reading.store(-1, std::memory_order_release); }
+
+private:
+    std::size_t rowCount;
+    std::size_t columnCount;
+    std::vector<Route> edit;
+    std::array<std::vector<Route>, 2> snapshots;
+    // 当前发布的快照、读者正在使用的快照（-1 表示没有）
+    std::atomic<int> published{ 0 };
+    std::atomic<int> reading{ -1 };
+};
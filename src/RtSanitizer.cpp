@@ -0,0 +1,79 @@
+#include "RtSanitizer.h"
+
+#if AR_RT_SANITIZER
+
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+namespace {
+    thread_local bool realtimeFlag = false;
+}
+
+bool rtsan::inRealtime() {
+    return realtimeFlag;
+}
+
+void rtsan::check(const char *what) {
+    if (!realtimeFlag) return;
+    // 先清掉标志，避免报告本身触发递归检查
+    realtimeFlag = false;
+    std::fprintf(stderr, "RT sanitizer: %s on the audio thread\n", what);
+    std::fflush(stderr);
+    std::abort();
+}
+
+rtsan::Scope::Scope()
+    : previous(realtimeFlag) {
+    realtimeFlag = true;
+}
+
+rtsan::Scope::~Scope() {
+    realtimeFlag = previous;
+}
+
+// 替换全局 operator new / delete，在实时区间内分配或释放时报错
+// 数组与 nothrow 版本默认都转调这几个函数
+
+void *operator new(std::size_t size) {
+    rtsan::check("allocation");
+    if (void *p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void *operator new(std::size_t size, std::align_val_t alignment) {
+    rtsan::check("allocation");
+    const auto align = static_cast<std::size_t>(alignment);
+#ifdef _WIN32
+    void *p = _aligned_malloc(size ? size : 1, align);
+#else
+    void *p = std::aligned_alloc(align, ((size ? size : 1) + align - 1) / align * align);
+#endif
+    if (p) return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept {
+    if (p) rtsan::check("deallocation");
+    std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept {
+    if (p) rtsan::check("deallocation");
+    std::free(p);
+}
+
+void operator delete(void *p, std::align_val_t) noexcept {
+    if (p) rtsan::check("deallocation");
+#ifdef _WIN32
+    _aligned_free(p);
+#else
+    std::free(p);
+#endif
+}
+
+void operator delete(void *p, std::size_t, std::align_val_t alignment) noexcept {
+    operator delete(p, alignment);
+}
+
+#endif
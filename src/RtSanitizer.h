@@ -0,0 +1,56 @@
+#pragma once
+
+#include <mutex>
+
+// 实时线程检查（调试用）：定义 AR_RT_SANITIZER 时，音频线程在处理区间内
+// 分配 / 释放内存、对 CheckedMutex 加锁或调用阻塞等待都会立即报错并中止，
+// 未定义时这里的一切都是空操作
+namespace rtsan {
+#if AR_RT_SANITIZER
+    // 当前线程是否处于实时处理区间
+    bool inRealtime();
+    // 在实时区间内调用时报告 what 并中止
+    void check(const char *what);
+
+    // 标记一段实时处理区间（音频线程每次被唤醒后的处理过程）
+    class Scope {
+    public:
+        Scope();
+        ~Scope();
+
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+
+    private:
+        bool previous;
+    };
+#else
+    inline bool inRealtime() { return false; }
+    inline void check(const char *) {}
+
+    class Scope {
+    public:
+        Scope() {}
+        ~Scope() {}
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+    };
+#endif
+}
+
+// 只在非实时路径使用的互斥量；实时区间内加锁会被 rtsan 检查出来
+class CheckedMutex {
+public:
+    void lock() {
+        rtsan::check("mutex lock");
+        mutex.lock();
+    }
+    bool try_lock() {
+        rtsan::check("mutex lock");
+        return mutex.try_lock();
+    }
+    void unlock() { mutex.unlock(); }
+
+private:
+    std::mutex mutex;
+};
@@ -0,0 +1,489 @@
+#include "SampleConvert.h"
+#include "CpuFeatures.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+
+#if AR_X86
+#include <immintrin.h>
+#endif
+
+namespace {
+    // ---- 样本类型的编译期描述 ----
+
+    template <SampleType T>
+    struct SampleTraits;
+
+    template <>
+    struct SampleTraits<SampleType::Int16> {
+        static constexpr std::size_t bytes = 2;
+        static constexpr float scale = 32768.0f;
+        static constexpr float maxValue = 32767.0f;
+        static std::int32_t load(const unsigned char *p) {
+            std::int16_t v;
+            std::memcpy(&v, p, 2);
+            return v;
+        }
+        static void store(unsigned char *p, std::int32_t v) {
+            const auto s = static_cast<std::int16_t>(v);
+            std::memcpy(p, &s, 2);
+        }
+    };
+
+    template <>
+    struct SampleTraits<SampleType::Int24> {
+        static constexpr std::size_t bytes = 3;
+        static constexpr float scale = 8388608.0f;
+        static constexpr float maxValue = 8388607.0f;
+        static std::int32_t load(const unsigned char *p) {
+            // 放到高 24 位再算术右移，完成符号扩展
+            const auto u = static_cast<std::uint32_t>(p[0]) << 8 | static_cast<std::uint32_t>(p[1]) << 16 |
+                           static_cast<std::uint32_t>(p[2]) << 24;
+            return static_cast<std::int32_t>(u) >> 8;
+        }
+        static void store(unsigned char *p, std::int32_t v) {
+            const auto u = static_cast<std::uint32_t>(v);
+            p[0] = static_cast<unsigned char>(u);
+            p[1] = static_cast<unsigned char>(u >> 8);
+            p[2] = static_cast<unsigned char>(u >> 16);
+        }
+    };
+
+    template <>
+    struct SampleTraits<SampleType::Int32> {
+        static constexpr std::size_t bytes = 4;
+        static constexpr float scale = 2147483648.0f;
+        // 小于 2^31 的最大 float，饱和后转换不会溢出
+        static constexpr float maxValue = 2147483520.0f;
+        static std::int32_t load(const unsigned char *p) {
+            std::int32_t v;
+            std::memcpy(&v, p, 4);
+            return v;
+        }
+        static void store(unsigned char *p, std::int32_t v) { std::memcpy(p, &v, 4); }
+    };
+
+    // ---- 标量实现（按样本类型在编译期展开）----
+
+    void copyFloat(const void *src, float *dst, std::size_t samples) {
+        std::memcpy(dst, src, samples * sizeof(float));
+    }
+
+    void storeFloat(const float *src, void *dst, std::size_t samples) {
+        std::memcpy(dst, src, samples * sizeof(float));
+    }
+
+    template <SampleType T>
+    void decodeScalar(const void *src, float *dst, std::size_t samples) {
+        using Traits = SampleTraits<T>;
+        const auto *p = static_cast<const unsigned char *>(src);
+        constexpr float k = 1.0f / Traits::scale;
+        for (std::size_t i = 0; i < samples; ++i) {
+            dst[i] = static_cast<float>(Traits::load(p + i * Traits::bytes)) * k;
+        }
+    }
+
+    template <SampleType T>
+    void encodeScalar(const float *src, void *dst, std::size_t samples) {
+        using Traits = SampleTraits<T>;
+        auto *p = static_cast<unsigned char *>(dst);
+        for (std::size_t i = 0; i < samples; ++i) {
+            // 与 SIMD 版本相同的运算顺序：NaN 置 0，先缩放再饱和（±Inf 饱和到满幅），按当前舍入模式（就近偶数）取整
+            // 非有限值直接转换为整数是未定义行为，必须在转换前处理掉
+            const float x = std::isnan(src[i]) ? 0.0f : src[i];
+            const float v = std::min(std::max(x * Traits::scale, -Traits::scale), Traits::maxValue);
+            Traits::store(p + i * Traits::bytes, static_cast<std::int32_t>(std::nearbyint(v)));
+        }
+    }
+
+#if AR_X86
+    // NaN 置 0（与标量版本一致；否则 max / min 按操作数顺序把 NaN 变成负满幅）
+    inline __m128 zeroNanSse2(const __m128 v) { return _mm_and_ps(v, _mm_cmpord_ps(v, v)); }
+    AR_TARGET_AVX2 inline __m256 zeroNanAvx2(const __m256 v) { return _mm256_and_ps(v, _mm256_cmp_ps(v, v, _CMP_ORD_Q)); }
+
+    // ---- SSE2 ----
+
+    void decodeInt16Sse2(const void *src, float *dst, std::size_t samples) {
+        const auto *s = static_cast<const std::int16_t *>(src);
+        const __m128 k = _mm_set1_ps(1.0f / 32768.0f);
+        std::size_t i = 0;
+        for (; i + 8 <= samples; i += 8) {
+            const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(s + i));
+            // 放到每个 32 位的高半部分再算术右移，完成符号扩展
+            const __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+            const __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+            _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), k));
+            _mm_storeu_ps(dst + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), k));
+        }
+        decodeScalar<SampleType::Int16>(s + i, dst + i, samples - i);
+    }
+
+    void encodeInt16Sse2(const float *src, void *dst, std::size_t samples) {
+        auto *d = static_cast<std::int16_t *>(dst);
+        const __m128 scale = _mm_set1_ps(32768.0f);
+        const __m128 lo = _mm_set1_ps(-32768.0f);
+        const __m128 hi = _mm_set1_ps(32767.0f);
+        std::size_t i = 0;
+        for (; i + 8 <= samples; i += 8) {
+            const __m128 a = _mm_min_ps(_mm_max_ps(_mm_mul_ps(zeroNanSse2(_mm_loadu_ps(src + i)), scale), lo), hi);
+            const __m128 b = _mm_min_ps(_mm_max_ps(_mm_mul_ps(zeroNanSse2(_mm_loadu_ps(src + i + 4)), scale), lo), hi);
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(d + i), _mm_packs_epi32(_mm_cvtps_epi32(a), _mm_cvtps_epi32(b)));
+        }
+        encodeScalar<SampleType::Int16>(src + i, d + i, samples - i);
+    }
+
+    void decodeInt32Sse2(const void *src, float *dst, std::size_t samples) {
+        const auto *s = static_cast<const std::int32_t *>(src);
+        const __m128 k = _mm_set1_ps(1.0f / 2147483648.0f);
+        std::size_t i = 0;
+        for (; i + 4 <= samples; i += 4) {
+            const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(s + i));
+            _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(v), k));
+        }
+        decodeScalar<SampleType::Int32>(s + i, dst + i, samples - i);
+    }
+
+    void encodeInt32Sse2(const float *src, void *dst, std::size_t samples) {
+        auto *d = static_cast<std::int32_t *>(dst);
+        const __m128 scale = _mm_set1_ps(2147483648.0f);
+        const __m128 lo = _mm_set1_ps(-2147483648.0f);
+        const __m128 hi = _mm_set1_ps(2147483520.0f);
+        std::size_t i = 0;
+        for (; i + 4 <= samples; i += 4) {
+            const __m128 v = _mm_min_ps(_mm_max_ps(_mm_mul_ps(zeroNanSse2(_mm_loadu_ps(src + i)), scale), lo), hi);
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(d + i), _mm_cvtps_epi32(v));
+        }
+        encodeScalar<SampleType::Int32>(src + i, d + i, samples - i);
+    }
+
+    // ---- AVX2 ----
+
+    AR_TARGET_AVX2 void decodeInt16Avx2(const void *src, float *dst, std::size_t samples) {
+        const auto *s = static_cast<const std::int16_t *>(src);
+        const __m256 k = _mm256_set1_ps(1.0f / 32768.0f);
+        std::size_t i = 0;
+        for (; i + 16 <= samples; i += 16) {
+            const __m256i a = _mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(s + i)));
+            const __m256i b = _mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(s + i + 8)));
+            _mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_cvtepi32_ps(a), k));
+            _mm256_storeu_ps(dst + i + 8, _mm256_mul_ps(_mm256_cvtepi32_ps(b), k));
+        }
+        decodeScalar<SampleType::Int16>(s + i, dst + i, samples - i);
+    }
+
+    AR_TARGET_AVX2 void encodeInt16Avx2(const float *src, void *dst, std::size_t samples) {
+        auto *d = static_cast<std::int16_t *>(dst);
+        const __m256 scale = _mm256_set1_ps(32768.0f);
+        const __m256 lo = _mm256_set1_ps(-32768.0f);
+        const __m256 hi = _mm256_set1_ps(32767.0f);
+        std::size_t i = 0;
+        for (; i + 16 <= samples; i += 16) {
+            const __m256 a = _mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(zeroNanAvx2(_mm256_loadu_ps(src + i)), scale), lo), hi);
+            const __m256 b = _mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(zeroNanAvx2(_mm256_loadu_ps(src + i + 8)), scale), lo), hi);
+            // packs 按 128 位分段交错，再把 64 位块排回原来的顺序
+            const __m256i packed = _mm256_packs_epi32(_mm256_cvtps_epi32(a), _mm256_cvtps_epi32(b));
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(d + i), _mm256_permute4x64_epi64(packed, 0xD8));
+        }
+        encodeScalar<SampleType::Int16>(src + i, d + i, samples - i);
+    }
+
+    AR_TARGET_AVX2 void decodeInt32Avx2(const void *src, float *dst, std::size_t samples) {
+        const auto *s = static_cast<const std::int32_t *>(src);
+        const __m256 k = _mm256_set1_ps(1.0f / 2147483648.0f);
+        std::size_t i = 0;
+        for (; i + 8 <= samples; i += 8) {
+            const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(s + i));
+            _mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_cvtepi32_ps(v), k));
+        }
+        decodeScalar<SampleType::Int32>(s + i, dst + i, samples - i);
+    }
+
+    AR_TARGET_AVX2 void encodeInt32Avx2(const float *src, void *dst, std::size_t samples) {
+        auto *d = static_cast<std::int32_t *>(dst);
+        const __m256 scale = _mm256_set1_ps(2147483648.0f);
+        const __m256 lo = _mm256_set1_ps(-2147483648.0f);
+        const __m256 hi = _mm256_set1_ps(2147483520.0f);
+        std::size_t i = 0;
+        for (; i + 8 <= samples; i += 8) {
+            const __m256 v = _mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(zeroNanAvx2(_mm256_loadu_ps(src + i)), scale), lo), hi);
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(d + i), _mm256_cvtps_epi32(v));
+        }
+        encodeScalar<SampleType::Int32>(src + i, d + i, samples - i);
+    }
+#endif
+
+    // 下标与 SampleType 的取值一致：Float32, Int16, Int24, Int32
+    const ConvertKernels kScalar{
+        { copyFloat, decodeScalar<SampleType::Int16>, decodeScalar<SampleType::Int24>, decodeScalar<SampleType::Int32> },
+        { storeFloat, encodeScalar<SampleType::Int16>, encodeScalar<SampleType::Int24>, encodeScalar<SampleType::Int32> },
+        "scalar"
+    };
+#if AR_X86
+    const ConvertKernels kSse2{
+        { copyFloat, decodeInt16Sse2, decodeScalar<SampleType::Int24>, decodeInt32Sse2 },
+        { storeFloat, encodeInt16Sse2, encodeScalar<SampleType::Int24>, encodeInt32Sse2 },
+        "sse2"
+    };
+    const ConvertKernels kAvx2{
+        { copyFloat, decodeInt16Avx2, decodeScalar<SampleType::Int24>, decodeInt32Avx2 },
+        { storeFloat, encodeInt16Avx2, encodeScalar<SampleType::Int24>, encodeInt32Avx2 },
+        "avx2"
+    };
+#endif
+
+    // ---- 声道映射 ----
+
+    // 标准排列中用到的扬声器位置（与 WAVEFORMATEXTENSIBLE 默认声道掩码的顺序一致）
+    enum Speaker { FL, FR, FC, LFE, BL, BR, SL, SR, SpeakerCount };
+
+    // 按声道数取标准排列，不认识的声道数返回空
+    std::vector<Speaker> standardLayout(const std::uint32_t channels) {
+        switch (channels) {
+        case 1: return { FC };
+        case 2: return { FL, FR };
+        case 4: return { FL, FR, BL, BR };
+        case 6: return { FL, FR, FC, LFE, BL, BR };
+        case 8: return { FL, FR, FC, LFE, BL, BR, SL, SR };
+        default: return {};
+        }
+    }
+
+    struct Route {
+        Speaker to;
+        float gain;
+    };
+
+    constexpr float kMinus3dB = 0.70710678f;
+
+    // 输出中没有某个扬声器时，它的信号分给哪些位置（目标也不存在时继续向下分）
+    std::vector<Route> fallbackRoutes(const Speaker s) {
+        switch (s) {
+        case FL: return { { FC, kMinus3dB } };
+        case FR: return { { FC, kMinus3dB } };
+        case FC: return { { FL, kMinus3dB }, { FR, kMinus3dB } };
+        case BL: return { { SL, 1.0f }, { FL, kMinus3dB } };
+        case BR: return { { SR, 1.0f }, { FR, kMinus3dB } };
+        case SL: return { { BL, 1.0f }, { FL, kMinus3dB } };
+        case SR: return { { BR, 1.0f }, { FR, kMinus3dB } };
+        default: return {};   // LFE 下混时丢弃
+        }
+    }
+
+    // 把扬声器 s 的信号按 gain 分配到 layout 中，结果累加到 row（按输出扬声器位置）
+    void routeSpeaker(const Speaker s, const float gain, const std::array<int, SpeakerCount> &index,
+                      std::array<float, SpeakerCount> &row, const int depth) {
+        if (index[s] >= 0) {
+            row[s] += gain;
+            return;
+        }
+        if (depth > 3) return;
+        // 后 / 侧环绕互为替代（整体搬过去），都没有时再按 -3 dB 分到前方
+        for (const Route &r : fallbackRoutes(s)) {
+            if (r.gain == 1.0f) {
+                if (index[r.to] >= 0) {
+                    row[r.to] += gain;
+                    return;
+                }
+                continue;
+            }
+            routeSpeaker(r.to, gain * r.gain, index, row, depth + 1);
+        }
+    }
+
+    // 编译期已知声道数的矩阵内核：循环完全展开，系数为 0 的项也照常计算（无分支）
+    template <int In, int Out>
+    void matrixFixed(const float *coeffs, const float *src, float *dst, const std::size_t frames, std::uint32_t, std::uint32_t) {
+        for (std::size_t f = 0; f < frames; ++f) {
+            const float *s = src + f * In;
+            float *d = dst + f * Out;
+            for (int o = 0; o < Out; ++o) {
+                float acc = 0.0f;
+                for (int i = 0; i < In; ++i) acc += coeffs[o * In + i] * s[i];
+                d[o] = acc;
+            }
+        }
+    }
+
+    void matrixGeneric(const float *coeffs, const float *src, float *dst, const std::size_t frames,
+                       const std::uint32_t in, const std::uint32_t out) {
+        for (std::size_t f = 0; f < frames; ++f) {
+            const float *s = src + f * in;
+            float *d = dst + f * out;
+            for (std::uint32_t o = 0; o < out; ++o) {
+                float acc = 0.0f;
+                for (std::uint32_t i = 0; i < in; ++i) acc += coeffs[o * in + i] * s[i];
+                d[o] = acc;
+            }
+        }
+    }
+
+    template <int In>
+    ChannelMatrix::Kernel pickOutput(const std::uint32_t out) {
+        switch (out) {
+        case 1: return matrixFixed<In, 1>;
+        case 2: return matrixFixed<In, 2>;
+        case 4: return matrixFixed<In, 4>;
+        case 6: return matrixFixed<In, 6>;
+        case 8: return matrixFixed<In, 8>;
+        default: return matrixGeneric;
+        }
+    }
+
+    ChannelMatrix::Kernel pickKernel(const std::uint32_t in, const std::uint32_t out) {
+        switch (in) {
+        case 1: return pickOutput<1>(out);
+        case 2: return pickOutput<2>(out);
+        case 4: return pickOutput<4>(out);
+        case 6: return pickOutput<6>(out);
+        case 8: return pickOutput<8>(out);
+        default: return matrixGeneric;
+        }
+    }
+}
+
+std::size_t sampleBytes(const SampleType type) {
+    switch (type) {
+    case SampleType::Int16: return 2;
+    case SampleType::Int24: return 3;
+    default: return 4;
+    }
+}
+
+const char *sampleTypeName(const SampleType type) {
+    switch (type) {
+    case SampleType::Int16: return "int16";
+    case SampleType::Int24: return "int24";
+    case SampleType::Int32: return "int32";
+    default: return "float32";
+    }
+}
+
+const ConvertKernels &scalarConvertKernels() { return kScalar; }
+
+const ConvertKernels &sse2ConvertKernels() {
+#if AR_X86
+    return kSse2;
+#else
+    return kScalar;
+#endif
+}
+
+const ConvertKernels &avx2ConvertKernels() {
+#if AR_X86
+    return cpuFeatures().avx2 ? kAvx2 : sse2ConvertKernels();
+#else
+    return kScalar;
+#endif
+}
+
+const ConvertKernels &convertKernels() {
+    static const ConvertKernels &selected = cpuFeatures().avx2 ? avx2ConvertKernels()
+                                           : cpuFeatures().sse2 ? sse2ConvertKernels()
+                                           : scalarConvertKernels();
+    return selected;
+}
+
+// ---- TpdfDither ----
+
+TpdfDither::TpdfDither(const std::uint32_t seed)
+    : state(seed ? seed : 1) {
+}
+
+std::uint32_t TpdfDither::next() {
+    // xorshift32：足够做抖动噪声，状态只有一个字
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+void TpdfDither::apply(float *samples, const std::size_t count, const SampleType type) {
+    const float lsb = type == SampleType::Int16 ? 1.0f / 32768.0f : 1.0f / 8388608.0f;
+    // 两个 [0, 1) 均匀分布之差即为 [-1, 1) 上的三角分布
+    const float k = lsb / 4294967296.0f;
+    for (std::size_t i = 0; i < count; ++i) {
+        const float r1 = static_cast<float>(next());
+        const float r2 = static_cast<float>(next());
+        samples[i] += (r1 - r2) * k;
+    }
+}
+
+// ---- ChannelMatrix ----
+
+ChannelMatrix::ChannelMatrix(const std::uint32_t inputChannels, const std::uint32_t outputChannels)
+    : in(inputChannels), out(outputChannels), coeffs(static_cast<std::size_t>(inputChannels) * outputChannels, 0.0f),
+      kernel(pickKernel(inputChannels, outputChannels)) {
+    const std::vector<Speaker> inLayout = standardLayout(in);
+    const std::vector<Speaker> outLayout = standardLayout(out);
+
+    if (inLayout.empty() || outLayout.empty()) {
+        // 不认识的排列：按下标一一对应；输出为单声道时取平均
+        for (std::uint32_t o = 0; o < out; ++o) {
+            for (std::uint32_t i = 0; i < in; ++i) {
+                if (out == 1) coeffs[i] = 1.0f / static_cast<float>(in);
+                else if (i == o) coeffs[static_cast<std::size_t>(o) * in + i] = 1.0f;
+            }
+        }
+        return;
+    }
+
+    std::array<int, SpeakerCount> outIndex;
+    outIndex.fill(-1);
+    for (std::size_t o = 0; o < outLayout.size(); ++o) outIndex[outLayout[o]] = static_cast<int>(o);
+
+    for (std::uint32_t i = 0; i < in; ++i) {
+        std::array<float, SpeakerCount> row{};
+        routeSpeaker(inLayout[i], 1.0f, outIndex, row, 0);
+        for (std::size_t s = 0; s < SpeakerCount; ++s) {
+            if (row[s] != 0.0f) coeffs[static_cast<std::size_t>(outIndex[s]) * in + i] += row[s];
+        }
+    }
+
+    // 每个输出声道的系数和不超过 1：各输入满幅同相时也不会削波
+    for (std::uint32_t o = 0; o < out; ++o) {
+        float sum = 0.0f;
+        for (std::uint32_t i = 0; i < in; ++i) sum += coeffs[static_cast<std::size_t>(o) * in + i];
+        if (sum > 1.0f) {
+            for (std::uint32_t i = 0; i < in; ++i) coeffs[static_cast<std::size_t>(o) * in + i] /= sum;
+        }
+    }
+}
+
+void ChannelMatrix::apply(const float *src, float *dst, const std::size_t frames) const {
+    if (identity()) {
+        std::memcpy(dst, src, frames * in * sizeof(float));
+        return;
+    }
+    kernel(coeffs.data(), src, dst, frames, in, out);
+}
+
+// ---- SampleConverter ----
+
+SampleConverter::SampleConverter(const SampleType type, const std::uint32_t channels, const std::uint32_t maxFrames, const bool dither)
+    : sample(type), chans(channels), capacity(maxFrames), ditherEnabled(dither && TpdfDither::needed(type)) {
+    if (!passthrough()) scratch.assign(static_cast<std::size_t>(maxFrames) * channels, 0.0f);
+}
+
+const float *SampleConverter::decode(const void *src, const std::uint32_t frames) {
+    if (passthrough()) return static_cast<const float *>(src);
+    if (frames > capacity) return nullptr;
+    convertKernels().decode[static_cast<std::size_t>(sample)](src, scratch.data(), static_cast<std::size_t>(frames) * chans);
+    return scratch.data();
+}
+
+float *SampleConverter::renderBuffer(void *device, const std::uint32_t frames) {
+    if (passthrough()) return static_cast<float *>(device);
+    if (frames > capacity) return nullptr;
+    pendingDevice = device;
+    return scratch.data();
+}
+
+void SampleConverter::encode(const std::uint32_t frames) {
+    if (passthrough() || !pendingDevice) return;
+    const std::size_t samples = static_cast<std::size_t>(std::min(frames, capacity)) * chans;
+    if (ditherEnabled) dither.apply(scratch.data(), samples, sample);
+    convertKernels().encode[static_cast<std::size_t>(sample)](scratch.data(), pendingDevice, samples);
+    pendingDevice = nullptr;
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// 设备侧的样本编码：核心内部统一为交错 float32，进出设备时在流内部转换
+enum class SampleType : std::uint8_t {
+    Float32,
+    Int16,
+    Int24,   // 3 字节紧凑存放
+    Int32,   // 也用于 32 位容器中的 24 位有效位
+};
+
+constexpr std::size_t kSampleTypeCount = 4;
+
+std::size_t sampleBytes(SampleType type);
+const char *sampleTypeName(SampleType type);
+
+// 样本格式转换内核（启动时按 CPU 特性选择 AVX2 / SSE2 / 标量实现；24 位紧凑格式各实现都用标量版本）
+// 各实现的结果逐位一致：整数 -> float 乘以 2^-(位数-1)，float -> 整数先饱和到 [-1, 1) 再就近舍入（NaN 输出 0，±Inf 输出满幅）
+struct ConvertKernels {
+    // 设备字节 -> float32，samples 为样本数（帧数 * 声道数），按 SampleType 下标
+    void (*decode[kSampleTypeCount])(const void *src, float *dst, std::size_t samples);
+    // float32 -> 设备字节
+    void (*encode[kSampleTypeCount])(const float *src, void *dst, std::size_t samples);
+    const char *name;
+};
+
+const ConvertKernels &convertKernels();
+
+// 各实现单独暴露，便于对比测试与基准
+const ConvertKernels &scalarConvertKernels();
+const ConvertKernels &sse2ConvertKernels();   // 非 x86 平台上退化为标量实现
+const ConvertKernels &avx2ConvertKernels();   // 同上
+
+// TPDF 抖动：转换为 16 / 24 位之前叠加幅度为 ±1 LSB 的三角分布噪声，把截断失真变成平坦的底噪
+class TpdfDither {
+public:
+    explicit TpdfDither(std::uint32_t seed = 0x9e3779b9u);
+
+    // 需要抖动的目标格式（float32 与 32 位整数的量化误差已低于 float 精度，不需要）
+    static bool needed(SampleType type) { return type == SampleType::Int16 || type == SampleType::Int24; }
+
+    // samples[i] += (r1 - r2) * lsb，r1、r2 在 [0, 1) 上均匀分布
+    void apply(float *samples, std::size_t count, SampleType type);
+
+private:
+    std::uint32_t next();
+
+    std::uint32_t state;
+};
+
+// 交错声道的上 / 下混矩阵：按声道数对应的标准排列（单声道、立体声、四声道、5.1、7.1）建立，
+// 缺少的扬声器按 -3 dB 分到相邻位置，LFE 下混时丢弃，每一行的系数和不超过 1（不会因下混而削波）
+// 其他声道数按下标一一对应。常用组合的内核按声道数在编译期展开
+class ChannelMatrix {
+public:
+    ChannelMatrix() = default;
+    ChannelMatrix(std::uint32_t inputChannels, std::uint32_t outputChannels);
+
+    std::uint32_t inputChannels() const { return in; }
+    std::uint32_t outputChannels() const { return out; }
+    // 声道数相同：不需要混合
+    bool identity() const { return in == out; }
+    // 输出声道 o 中输入声道 i 的系数
+    float coefficient(std::uint32_t o, std::uint32_t i) const { return coeffs[static_cast<std::size_t>(o) * in + i]; }
+
+    // src 为 frames 帧 inputChannels 声道，dst 为 frames 帧 outputChannels 声道（两者不能重叠）
+    void apply(const float *src, float *dst, std::size_t frames) const;
+
+    using Kernel = void (*)(const float *coeffs, const float *src, float *dst, std::size_t frames,
+                            std::uint32_t in, std::uint32_t out);
+
+private:
+    std::uint32_t in = 0;
+    std::uint32_t out = 0;
+    std::vector<float> coeffs;   // out 行 in 列
+    Kernel kernel = nullptr;
+};
+
+// 一条流在设备样本格式与 float32 之间的转换：缓冲在构造时按最大帧数分配，音频线程内不再分配
+// float32 设备直接透传，不经过中间缓冲
+class SampleConverter {
+public:
+    SampleConverter() = default;
+    SampleConverter(SampleType type, std::uint32_t channels, std::uint32_t maxFrames, bool dither);
+
+    SampleType type() const { return sample; }
+    bool passthrough() const { return sample == SampleType::Float32; }
+
+    // capture：设备数据 -> float32；返回的指针在下一次调用前有效（float32 设备直接返回 src）
+    const float *decode(const void *src, std::uint32_t frames);
+
+    // render：取得写给设备的 float32 缓冲（float32 设备直接返回 device），写完后 encode 到 device
+    float *renderBuffer(void *device, std::uint32_t frames);
+    void encode(std::uint32_t frames);
+
+private:
+    SampleType sample = SampleType::Float32;
+    std::uint32_t chans = 0;
+    std::uint32_t capacity = 0;
+    bool ditherEnabled = false;
+    std::vector<float> scratch;
+    void *pendingDevice = nullptr;
+    TpdfDither dither;
+};
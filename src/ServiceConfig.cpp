@@ -0,0 +1,418 @@
+#include "ServiceConfig.h"
+#include "Utf8.h"
+
+#include <charconv>
+#include <fstream>
+#include <limits>
+
+namespace {
+    std::string trim(const std::string &text) {
+        const auto begin = text.find_first_not_of(" \t\r\n");
+        if (begin == std::string::npos) return {};
+        const auto end = text.find_last_not_of(" \t\r\n");
+        return text.substr(begin, end - begin + 1);
+    }
+
+    bool parseBool(const std::string &value, bool &out) {
+        if (value == "true" || value == "yes" || value == "on" || value == "1") {
+            out = true;
+            return true;
+        }
+        if (value == "false" || value == "no" || value == "off" || value == "0") {
+            out = false;
+            return true;
+        }
+        return false;
+    }
+
+    bool parseDouble(const std::string &value, double &out) {
+        const char *end = value.data() + value.size();
+        const auto result = std::from_chars(value.data(), end, out);
+        return result.ec == std::errc() && result.ptr == end;
+    }
+
+    template <typename T>
+    bool parseUnsigned(const std::string &value, T &out) {
+        std::uint64_t parsed = 0;
+        const char *end = value.data() + value.size();
+        const auto result = std::from_chars(value.data(), end, parsed);
+        if (result.ec != std::errc() || result.ptr != end || parsed > std::numeric_limits<T>::max()) return false;
+        out = static_cast<T>(parsed);
+        return true;
+    }
+
+    bool parseSampleType(const std::string &value, SampleType &out) {
+        for (const SampleType type : { SampleType::Float32, SampleType::Int16, SampleType::Int24, SampleType::Int32 }) {
+            if (value == sampleTypeName(type)) {
+                out = type;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // band = type,hz,gain_db,q（后三项可省略）
+    bool parseEqBand(const std::string &value, EqBand &band) {
+        std::vector<std::string> fields;
+        std::size_t begin = 0;
+        while (true) {
+            const std::size_t comma = value.find(',', begin);
+            fields.push_back(trim(value.substr(begin, comma == std::string::npos ? std::string::npos : comma - begin)));
+            if (comma == std::string::npos) break;
+            begin = comma + 1;
+        }
+        if (fields.size() > 4) return false;
+        bool known = false;
+        for (const EqBand::Type type : { EqBand::Type::Off, EqBand::Type::Peak, EqBand::Type::LowShelf, EqBand::Type::HighShelf }) {
+            if (fields[0] == eqBandTypeName(type)) {
+                band.type = type;
+                known = true;
+            }
+        }
+        if (!known) return false;
+        float *targets[] = { &band.hz, &band.gainDb, &band.q };
+        for (std::size_t i = 1; i < fields.size(); ++i) {
+            double parsed = 0.0;
+            if (!parseDouble(fields[i], parsed)) return false;
+            *targets[i - 1] = static_cast<float>(parsed);
+        }
+        return band.hz > 0.0f && band.q > 0.0f;
+    }
+
+    bool parseFloat(const std::string &value, float &out) {
+        double parsed = 0.0;
+        if (!parseDouble(value, parsed)) return false;
+        out = static_cast<float>(parsed);
+        return true;
+    }
+
+    enum class Section { None, Engine, Source, Output, Route, Insert, Record, Stats, Control, VirtualDevice, VirtualProcess };
+
+    // 逐行解析；value 已去掉首尾空白。返回 false 表示取值无效，未知的键写入 unknown
+    class Parser {
+    public:
+        explicit Parser(ServiceConfig &config) : config(config) {}
+
+        bool beginSection(const std::string &name) {
+            if (name == "engine") section = Section::Engine;
+            else if (name == "source") {
+                section = Section::Source;
+                config.sources.emplace_back();
+            } else if (name == "output") {
+                section = Section::Output;
+                outputs.emplace_back();
+            } else if (name == "route") {
+                section = Section::Route;
+                config.routes.emplace_back();
+            } else if (name == "insert") {
+                section = Section::Insert;
+                config.inserts.emplace_back();
+            } else if (name == "record") {
+                section = Section::Record;
+                config.recordings.emplace_back();
+            } else if (name == "stats") section = Section::Stats;
+            else if (name == "control") section = Section::Control;
+            else if (name == "virtual_device") {
+                section = Section::VirtualDevice;
+                config.virtualDevices.emplace_back();
+            } else if (name == "virtual_process") {
+                section = Section::VirtualProcess;
+                config.virtualProcesses.emplace_back();
+            } else return false;
+            return true;
+        }
+
+        bool set(const std::string &key, const std::string &value, bool &unknown) {
+            unknown = false;
+            switch (section) {
+            case Section::Engine: return setEngine(key, value, unknown);
+            case Section::Source: return setSource(key, value, unknown);
+            case Section::Output:
+                if (key != "id") break;
+                outputs.back() = widenUtf8(value);
+                return true;
+            case Section::Route: return setRoute(key, value, unknown);
+            case Section::Insert: return setInsert(key, value, unknown);
+            case Section::Record: return setRecord(key, value, unknown);
+            case Section::Stats: return setStats(key, value, unknown);
+            case Section::Control:
+                if (key != "socket") break;
+                config.controlSocket = std::filesystem::path(widenUtf8(value));
+                return true;
+            case Section::VirtualDevice: return setVirtualDevice(key, value, unknown);
+            case Section::VirtualProcess: return setVirtualProcess(key, value, unknown);
+            case Section::None: break;
+            }
+            unknown = true;
+            return true;
+        }
+
+        // 全部读完后检查各项是否完整
+        bool finish(std::string &error) {
+            for (const auto &source : config.sources) {
+                if (source.id.empty()) {
+                    error = "[source] 缺少 id";
+                    return false;
+                }
+            }
+            for (const auto &output : outputs) {
+                if (output.empty()) {
+                    error = "[output] 缺少 id";
+                    return false;
+                }
+            }
+            for (const auto &device : config.virtualDevices) {
+                if (device.id.empty()) {
+                    error = "[virtual_device] 缺少 id";
+                    return false;
+                }
+            }
+            for (const auto &process : config.virtualProcesses) {
+                if (process.processId == 0) {
+                    error = "[virtual_process] 缺少 pid";
+                    return false;
+                }
+            }
+            if (config.sources.empty()) {
+                error = "至少需要一个 [source]";
+                return false;
+            }
+            if (outputs.empty()) {
+                error = "至少需要一个 [output]";
+                return false;
+            }
+            config.output = outputs.front();
+            config.extraOutputs.assign(outputs.begin() + 1, outputs.end());
+            for (const auto &route : config.routes) {
+                if (route.source >= config.sources.size() || route.output >= outputs.size()) {
+                    error = "[route] 的 source / output 超出范围";
+                    return false;
+                }
+            }
+            for (const auto &insert : config.inserts) {
+                if (insert.source >= config.sources.size() || insert.output >= outputs.size()) {
+                    error = "[insert] 的 source / output 超出范围";
+                    return false;
+                }
+            }
+            for (const auto &recording : config.recordings) {
+                if (recording.path.empty()) {
+                    error = "[record] 缺少 path";
+                    return false;
+                }
+                if (recording.output >= outputs.size()) {
+                    error = "[record] 的 output 超出范围";
+                    return false;
+                }
+            }
+            if (!config.virtualDevices.empty() || !config.virtualProcesses.empty()) config.virtualBackend = true;
+            return true;
+        }
+
+    private:
+        bool setEngine(const std::string &key, const std::string &value, bool &unknown) {
+            if (key == "backend") {
+                if (value == "platform") config.virtualBackend = false;
+                else if (value == "virtual") config.virtualBackend = true;
+                else return false;
+                return true;
+            }
+            if (key == "clock_speed") return parseDouble(value, config.clockSpeed);
+            if (key == "buffer_ms") return parseUnsigned(value, config.stream.bufferMs);
+            if (key == "low_latency") return parseBool(value, config.stream.lowLatency);
+            if (key == "allow_exclusive") return parseBool(value, config.stream.allowExclusive);
+            if (key == "dither") return parseBool(value, config.stream.dither);
+            if (key == "adaptive_buffer") return parseBool(value, config.stream.adaptiveBuffer);
+            if (key == "wait_devices_ms") return parseUnsigned(value, config.waitDevicesMs);
+            if (key == "fail_timeout_ms") return parseUnsigned(value, config.failTimeoutMs);
+            unknown = true;
+            return true;
+        }
+
+        bool setSource(const std::string &key, const std::string &value, bool &unknown) {
+            ServiceSource &source = config.sources.back();
+            if (key == "id") {
+                source.id = widenUtf8(value);
+                return true;
+            }
+            if (key == "gain_db") {
+                double db = 0.0;
+                if (!parseDouble(value, db)) return false;
+                source.gainDb = static_cast<float>(db);
+                return true;
+            }
+            unknown = true;
+            return true;
+        }
+
+        bool setRoute(const std::string &key, const std::string &value, bool &unknown) {
+            ServiceRoute &route = config.routes.back();
+            if (key == "source") return parseUnsigned(value, route.source);
+            if (key == "output") return parseUnsigned(value, route.output);
+            if (key == "gain_db") {
+                double db = 0.0;
+                if (!parseDouble(value, db)) return false;
+                route.gainDb = static_cast<float>(db);
+                return true;
+            }
+            if (key == "delay_ms") return parseDouble(value, route.delayMs) && route.delayMs >= 0.0;
+            if (key == "muted") return parseBool(value, route.muted);
+            unknown = true;
+            return true;
+        }
+
+        bool setInsert(const std::string &key, const std::string &value, bool &unknown) {
+            ServiceInsert &insert = config.inserts.back();
+            InsertSettings &s = insert.settings;
+            if (key == "source") return parseUnsigned(value, insert.source);
+            if (key == "output") return parseUnsigned(value, insert.output);
+            if (key == "hpf_hz") return parseFloat(value, s.highPassHz) && s.highPassHz >= 0.0f;
+            if (key == "band") return insert.bands < kMaxEqBands && parseEqBand(value, s.eq[insert.bands++]);
+            if (key == "gate") return parseBool(value, s.gate.enabled);
+            if (key == "gate_threshold_db") return parseFloat(value, s.gate.thresholdDb);
+            if (key == "gate_range_db") return parseFloat(value, s.gate.rangeDb) && s.gate.rangeDb <= 0.0f;
+            if (key == "gate_attack_ms") return parseFloat(value, s.gate.attackMs) && s.gate.attackMs >= 0.0f;
+            if (key == "gate_hold_ms") return parseFloat(value, s.gate.holdMs) && s.gate.holdMs >= 0.0f;
+            if (key == "gate_release_ms") return parseFloat(value, s.gate.releaseMs) && s.gate.releaseMs >= 0.0f;
+            if (key == "compressor") return parseBool(value, s.compressor.enabled);
+            if (key == "comp_threshold_db") return parseFloat(value, s.compressor.thresholdDb);
+            if (key == "comp_ratio") return parseFloat(value, s.compressor.ratio) && s.compressor.ratio >= 1.0f;
+            if (key == "comp_attack_ms") return parseFloat(value, s.compressor.attackMs) && s.compressor.attackMs >= 0.0f;
+            if (key == "comp_release_ms") return parseFloat(value, s.compressor.releaseMs) && s.compressor.releaseMs >= 0.0f;
+            if (key == "comp_lookahead_ms") {
+                return parseFloat(value, s.compressor.lookaheadMs) && s.compressor.lookaheadMs >= 0.0f &&
+                       s.compressor.lookaheadMs <= InsertChain::kMaxLookaheadMs;
+            }
+            if (key == "comp_makeup_db") return parseFloat(value, s.compressor.makeupDb);
+            unknown = true;
+            return true;
+        }
+
+        bool setRecord(const std::string &key, const std::string &value, bool &unknown) {
+            ServiceRecording &recording = config.recordings.back();
+            if (key == "output") return parseUnsigned(value, recording.output);
+            if (key == "path") {
+                recording.path = std::filesystem::path(widenUtf8(value));
+                return true;
+            }
+            if (key == "container") {
+                if (value == "wav") recording.options.container = RecordContainer::Wav;
+                else if (value == "w64") recording.options.container = RecordContainer::W64;
+                else return false;
+                return true;
+            }
+            if (key == "buffer_ms") return parseUnsigned(value, recording.options.bufferMs) && recording.options.bufferMs > 0;
+            if (key == "throttle_kbps") {
+                std::uint64_t kbps = 0;
+                if (!parseUnsigned(value, kbps)) return false;
+                recording.options.throttleBytesPerSecond = kbps * 1024;
+                return true;
+            }
+            unknown = true;
+            return true;
+        }
+
+        bool setStats(const std::string &key, const std::string &value, bool &unknown) {
+            if (key == "csv") {
+                config.statsCsv = std::filesystem::path(widenUtf8(value));
+                return true;
+            }
+            if (key == "interval_ms") return parseUnsigned(value, config.statsIntervalMs) && config.statsIntervalMs > 0;
+            if (key == "log") return parseBool(value, config.statsLog);
+            unknown = true;
+            return true;
+        }
+
+        bool setVirtualDevice(const std::string &key, const std::string &value, bool &unknown) {
+            VirtualDeviceSpec &device = config.virtualDevices.back();
+            if (key == "id") device.id = widenUtf8(value);
+            else if (key == "name") device.name = widenUtf8(value);
+            else if (key == "render") return parseBool(value, device.isRender);
+            else if (key == "rate") return parseUnsigned(value, device.format.sampleRate) && device.format.sampleRate > 0;
+            else if (key == "channels") return parseUnsigned(value, device.format.channels) && device.format.channels > 0;
+            else if (key == "sample") return parseSampleType(value, device.format.sample);
+            else if (key == "period_frames") return parseUnsigned(value, device.periodFrames) && device.periodFrames > 0;
+            else if (key == "ppm") return parseDouble(value, device.ppm);
+            else if (key == "tone_hz") return parseDouble(value, device.toneHz);
+            else if (key == "tone_level") {
+                double level = 0.0;
+                if (!parseDouble(value, level)) return false;
+                device.toneLevel = static_cast<float>(level);
+            } else if (key == "jitter_ms") return parseDouble(value, device.jitterMs) && device.jitterMs >= 0.0;
+            else if (key == "drop_rate") return parseDouble(value, device.dropRate) && device.dropRate >= 0.0 && device.dropRate < 1.0;
+            else if (key == "seed") return parseUnsigned(value, device.seed);
+            else if (key == "arrival_trace") {
+                std::string traceError;
+                return loadArrivalTrace(std::filesystem::path(widenUtf8(value)), device.arrivalTraceMs, traceError);
+            }
+            else if (key == "input_wav") device.inputWav = std::filesystem::path(widenUtf8(value));
+            else if (key == "output_wav") device.outputWav = std::filesystem::path(widenUtf8(value));
+            else unknown = true;
+            return true;
+        }
+
+        bool setVirtualProcess(const std::string &key, const std::string &value, bool &unknown) {
+            VirtualProcessSpec &process = config.virtualProcesses.back();
+            if (key == "pid") return parseUnsigned(value, process.processId) && process.processId > 0;
+            else if (key == "parent") return parseUnsigned(value, process.parentId);
+            else if (key == "name") process.name = widenUtf8(value);
+            else if (key == "tone_hz") return parseDouble(value, process.toneHz);
+            else if (key == "tone_level") {
+                double level = 0.0;
+                if (!parseDouble(value, level)) return false;
+                process.toneLevel = static_cast<float>(level);
+            } else unknown = true;
+            return true;
+        }
+
+        ServiceConfig &config;
+        Section section = Section::None;
+        std::vector<std::wstring> outputs;
+    };
+}
+
+bool loadServiceConfig(const std::filesystem::path &path, ServiceConfig &config, std::string &error) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        error = "无法打开配置文件";
+        return false;
+    }
+
+    config = ServiceConfig{};
+    Parser parser(config);
+    std::string line;
+    for (std::size_t lineNumber = 1; std::getline(in, line); ++lineNumber) {
+        // 跳过 UTF-8 BOM
+        if (lineNumber == 1 && line.rfind("\xEF\xBB\xBF", 0) == 0) line.erase(0, 3);
+        line = trim(line);
+        if (line.empty() || line[0] == '#' || line[0] == ';') continue;
+
+        const std::string where = "第 " + std::to_string(lineNumber) + " 行：";
+        if (line.front() == '[') {
+            if (line.back() != ']' || !parser.beginSection(trim(line.substr(1, line.size() - 2)))) {
+                error = where + "未知的节 " + line;
+                return false;
+            }
+            continue;
+        }
+
+        const auto eq = line.find('=');
+        if (eq == std::string::npos) {
+            error = where + "应为 key = value";
+            return false;
+        }
+        const std::string key = trim(line.substr(0, eq));
+        const std::string value = trim(line.substr(eq + 1));
+        bool unknown = false;
+        if (!parser.set(key, value, unknown)) {
+            error = where + key + " 的取值无效：" + value;
+            return false;
+        }
+        if (unknown) {
+            error = where + "未知的键 " + key;
+            return false;
+        }
+    }
+
+    return parser.finish(error);
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "AudioBackend.h"
+#include "InsertChain.h"
+#include "Recorder.h"
+#include "RoutingMatrix.h"
+#include "VirtualBackend.h"
+
+// 无界面模式的配置（与平台无关，不依赖 Qt）
+// 文件为 UTF-8 的 INI 格式：# 或 ; 开头为注释，[section] 可重复出现，重复的节各自构成一项
+//
+//   [engine]            backend = platform | virtual，clock_speed（虚拟后端，<= 0 为离散事件模式），
+//                       buffer_ms，low_latency，allow_exclusive，dither，adaptive_buffer（按到达抖动自动调整排队量，buffer_ms 为上限），
+//                       wait_devices_ms（启动时等待设备出现），fail_timeout_ms（流失效超过该时长即退出，0 为一直等待恢复）
+//   [source]            id（端点 ID，或进程来源 process:<pid> / process:<pid>:exclude），gain_db
+//   [output]            id；第一个为主输出，其余为附加输出
+//   [route]             source，output（下标，与上面出现的顺序一致），gain_db，delay_ms，muted
+//   [insert]            source，output（同上）；路由上的插入效果：hpf_hz（0 为关闭），
+//                       band = type,hz,gain_db,q（可重复，最多 4 段；type 为 peak | low_shelf | high_shelf），
+//                       gate，gate_threshold_db，gate_range_db，gate_attack_ms，gate_hold_ms，gate_release_ms，
+//                       compressor，comp_threshold_db，comp_ratio（>= 20 为限幅），comp_attack_ms，comp_release_ms，
+//                       comp_lookahead_ms（只延后这条路由，同一输出上的其他路由需用 [route] delay_ms 对齐），comp_makeup_db
+//   [stats]             csv（按间隔追加一行），interval_ms，log（同时在标准错误输出一行摘要）
+//   [record]            output（下标），path，container = wav | w64，buffer_ms，
+//                       throttle_kbps（仅用于测试：限制写盘速度，模拟慢速磁盘）
+//   [control]           socket（本地控制接口的套接字路径，见 ControlServer.h；为空则不开启）
+//   [virtual_device]    id，name，render，rate，channels，sample，period_frames，ppm，
+//                       tone_hz，tone_level，input_wav，output_wav，
+//                       jitter_ms，drop_rate，seed（作为来源时模拟投递抖动与丢包），
+//                       arrival_trace（回放录下的包到达时刻，格式见 loadArrivalTrace）（仅 virtual 后端）
+//   [virtual_process]   pid，parent，name，tone_hz，tone_level（正在播放声音的虚拟进程，作为进程来源；仅 virtual 后端）
+
+struct ServiceSource {
+    std::wstring id;
+    float gainDb = 0.0f;
+};
+
+struct ServiceRoute {
+    std::size_t source = 0;
+    std::size_t output = 0;
+    float gainDb = 0.0f;
+    double delayMs = 0.0;   // 启动后按输出采样率换算成帧
+    bool muted = false;
+};
+
+// 路由上的插入效果
+struct ServiceInsert {
+    std::size_t source = 0;
+    std::size_t output = 0;
+    InsertSettings settings;
+    std::size_t bands = 0;   // 已读到的 band 个数
+};
+
+// 启动后开始录制的输出
+struct ServiceRecording {
+    std::size_t output = 0;
+    std::filesystem::path path;
+    RecorderOptions options;
+};
+
+struct ServiceConfig {
+    // 后端：platform 为当前平台的默认后端；virtual 使用 virtualDevices（为空时使用默认的虚拟设备）与 virtualProcesses
+    bool virtualBackend = false;
+    double clockSpeed = 1.0;
+    std::vector<VirtualDeviceSpec> virtualDevices;
+    std::vector<VirtualProcessSpec> virtualProcesses;
+
+    std::vector<ServiceSource> sources;
+    std::wstring output;
+    std::vector<std::wstring> extraOutputs;
+    std::vector<ServiceRoute> routes;
+    std::vector<ServiceInsert> inserts;
+    std::vector<ServiceRecording> recordings;
+    StreamConfig stream;
+
+    std::uint32_t waitDevicesMs = 0;
+    std::uint32_t failTimeoutMs = 0;
+
+    std::filesystem::path statsCsv;
+    std::uint32_t statsIntervalMs = 1000;
+    bool statsLog = false;
+
+    std::filesystem::path controlSocket;
+};
+
+// 读取配置文件；失败时返回 false，error 为带行号的说明
+bool loadServiceConfig(const std::filesystem::path &path, ServiceConfig &config, std::string &error);
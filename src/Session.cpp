@@ -0,0 +1,386 @@
+#include "Session.h"
+#include "Utf8.h"
+
+#include <cmath>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <sstream>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace {
+    // 文件格式版本：不认识的版本按无效处理，不去猜测旧字段的含义
+    constexpr int kSessionVersion = 1;
+
+    const char *modeName(const StreamMode mode) {
+        switch (mode) {
+        case StreamMode::SharedLowLatency: return "shared_low_latency";
+        case StreamMode::Exclusive: return "exclusive";
+        default: return "shared";
+        }
+    }
+
+    bool parseMode(const std::string &name, StreamMode &mode) {
+        for (const StreamMode m : { StreamMode::Shared, StreamMode::SharedLowLatency, StreamMode::Exclusive }) {
+            if (name == modeName(m)) {
+                mode = m;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool parseSample(const std::string &name, SampleType &type) {
+        for (const SampleType t : { SampleType::Float32, SampleType::Int16, SampleType::Int24, SampleType::Int32 }) {
+            if (name == sampleTypeName(t)) {
+                type = t;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // 对象中存在的成员写入 out，其余保持不变
+    void readNumber(const JsonValue &object, const char *key, float &out) {
+        if (const JsonValue *v = object.find(key); v && v->isNumber()) out = static_cast<float>(v->number());
+    }
+
+    void readFlag(const JsonValue &object, const char *key, bool &out) {
+        if (const JsonValue *v = object.find(key); v && v->isBool()) out = v->boolean();
+    }
+
+    // 非负整数；不存在时保持不变，类型或取值不对时返回 false
+    bool readUnsigned(const JsonValue &object, const char *key, std::uint32_t &out) {
+        const JsonValue *v = object.find(key);
+        if (!v) return true;
+        if (!v->isNumber() || v->number() < 0 || v->number() > std::numeric_limits<std::uint32_t>::max() ||
+            v->number() != std::floor(v->number())) {
+            return false;
+        }
+        out = static_cast<std::uint32_t>(v->number());
+        return true;
+    }
+
+    // 写入整个文件并等数据落盘后才返回：之后的 rename 不会换上一个掉电后内容为空的文件
+    bool writeFileSynced(const std::filesystem::path &path, const std::string &data) {
+#ifdef _WIN32
+        const HANDLE file = CreateFileW(path.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE) return false;
+        DWORD written = 0;
+        const bool ok = WriteFile(file, data.data(), static_cast<DWORD>(data.size()), &written, nullptr) &&
+                        written == data.size() && FlushFileBuffers(file);
+        CloseHandle(file);
+        return ok;
+#else
+        const int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd < 0) return false;
+        bool ok = true;
+        for (std::size_t done = 0; ok && done < data.size();) {
+            const ssize_t n = ::write(fd, data.data() + done, data.size() - done);
+            if (n < 0 && errno == EINTR) continue;
+            ok = n > 0;
+            if (ok) done += static_cast<std::size_t>(n);
+        }
+        ok = ok && ::fsync(fd) == 0;
+        return ::close(fd) == 0 && ok;
+#endif
+    }
+
+    // rename 之后同步所在目录，让新的目录项本身也落盘（Windows 上 MoveFileEx 不需要，也无法这样做）
+    void syncDirectory([[maybe_unused]] const std::filesystem::path &path) {
+#ifndef _WIN32
+        const std::filesystem::path parent = path.has_parent_path() ? path.parent_path() : std::filesystem::path(".");
+        const int fd = ::open(parent.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (fd < 0) return;
+        ::fsync(fd);
+        ::close(fd);
+#endif
+    }
+
+    void writeFlag(std::ostream &out, const char *key, const bool value) {
+        out << '"' << key << "\":" << (value ? "true" : "false");
+    }
+
+    void writeEndpoint(std::ostream &out, const SessionEndpoint &endpoint) {
+        out << "{\"id\":";
+        writeJsonString(out, narrowUtf8(endpoint.id));
+        out << ",\"rate\":" << endpoint.format.sampleRate << ",\"channels\":" << endpoint.format.channels
+            << ",\"sample\":\"" << sampleTypeName(endpoint.format.sample) << "\",\"mode\":\"" << modeName(endpoint.mode) << '"';
+        if (!endpoint.processName.empty()) {
+            out << ",\"process_name\":";
+            writeJsonString(out, narrowUtf8(endpoint.processName));
+        }
+    }
+
+    bool readEndpoint(const JsonValue &object, SessionEndpoint &endpoint, std::string &error) {
+        const JsonValue *id = object.find("id");
+        if (!object.isObject() || !id || !id->isString() || id->string().empty()) {
+            error = "端点缺少 id";
+            return false;
+        }
+        endpoint.id = widenUtf8(id->string());
+        if (!readUnsigned(object, "rate", endpoint.format.sampleRate) || !readUnsigned(object, "channels", endpoint.format.channels)) {
+            error = "端点的 rate / channels 无效";
+            return false;
+        }
+        // 格式不完整就当作未知，打开时重新协商
+        if (endpoint.format.sampleRate == 0 || endpoint.format.channels == 0) endpoint.format = StreamFormat{};
+        const JsonValue *sample = object.find("sample");
+        const JsonValue *mode = object.find("mode");
+        if ((sample && (!sample->isString() || !parseSample(sample->string(), endpoint.format.sample))) ||
+            (mode && (!mode->isString() || !parseMode(mode->string(), endpoint.mode)))) {
+            error = "端点的 sample / mode 无效";
+            return false;
+        }
+        if (const JsonValue *processName = object.find("process_name")) {
+            if (!processName->isString()) {
+                error = "端点的 process_name 无效";
+                return false;
+            }
+            endpoint.processName = widenUtf8(processName->string());
+        }
+        return true;
+    }
+}
+
+bool readInsertJson(const JsonValue &object, InsertSettings &settings, std::string &error) {
+    readNumber(object, "hpf_hz", settings.highPassHz);
+    if (const JsonValue *eq = object.find("eq")) {
+        if (!eq->isArray() || eq->array().size() > kMaxEqBands) {
+            error = "eq 必须是最多 4 段的数组";
+            return false;
+        }
+        for (std::size_t i = 0; i < eq->array().size(); ++i) {
+            const JsonValue &item = eq->array()[i];
+            EqBand &band = settings.eq[i];
+            if (!item.isObject()) {
+                error = "eq 的每一段必须是对象";
+                return false;
+            }
+            if (const JsonValue *type = item.find("type")) {
+                bool known = false;
+                for (const EqBand::Type t : { EqBand::Type::Off, EqBand::Type::Peak, EqBand::Type::LowShelf, EqBand::Type::HighShelf }) {
+                    if (type->isString() && type->string() == eqBandTypeName(t)) {
+                        band.type = t;
+                        known = true;
+                    }
+                }
+                if (!known) {
+                    error = "未知的 eq 类型";
+                    return false;
+                }
+            }
+            readNumber(item, "hz", band.hz);
+            readNumber(item, "gain_db", band.gainDb);
+            readNumber(item, "q", band.q);
+        }
+    }
+    if (const JsonValue *gate = object.find("gate"); gate && gate->isObject()) {
+        readFlag(*gate, "enabled", settings.gate.enabled);
+        readNumber(*gate, "threshold_db", settings.gate.thresholdDb);
+        readNumber(*gate, "range_db", settings.gate.rangeDb);
+        readNumber(*gate, "attack_ms", settings.gate.attackMs);
+        readNumber(*gate, "hold_ms", settings.gate.holdMs);
+        readNumber(*gate, "release_ms", settings.gate.releaseMs);
+    }
+    if (const JsonValue *comp = object.find("compressor"); comp && comp->isObject()) {
+        readFlag(*comp, "enabled", settings.compressor.enabled);
+        readNumber(*comp, "threshold_db", settings.compressor.thresholdDb);
+        readNumber(*comp, "ratio", settings.compressor.ratio);
+        readNumber(*comp, "attack_ms", settings.compressor.attackMs);
+        readNumber(*comp, "release_ms", settings.compressor.releaseMs);
+        readNumber(*comp, "lookahead_ms", settings.compressor.lookaheadMs);
+        readNumber(*comp, "makeup_db", settings.compressor.makeupDb);
+    }
+    return true;
+}
+
+void writeInsertJson(std::ostream &out, const InsertSettings &settings) {
+    out << "{\"hpf_hz\":" << settings.highPassHz << ",\"eq\":[";
+    for (std::size_t i = 0; i < settings.eq.size(); ++i) {
+        const EqBand &band = settings.eq[i];
+        if (i) out << ',';
+        out << "{\"type\":\"" << eqBandTypeName(band.type) << "\",\"hz\":" << band.hz << ",\"gain_db\":" << band.gainDb
+            << ",\"q\":" << band.q << '}';
+    }
+    const GateSettings &gate = settings.gate;
+    out << "],\"gate\":{";
+    writeFlag(out, "enabled", gate.enabled);
+    out << ",\"threshold_db\":" << gate.thresholdDb << ",\"range_db\":" << gate.rangeDb << ",\"attack_ms\":" << gate.attackMs
+        << ",\"hold_ms\":" << gate.holdMs << ",\"release_ms\":" << gate.releaseMs << "},\"compressor\":{";
+    const CompressorSettings &comp = settings.compressor;
+    writeFlag(out, "enabled", comp.enabled);
+    out << ",\"threshold_db\":" << comp.thresholdDb << ",\"ratio\":" << comp.ratio << ",\"attack_ms\":" << comp.attackMs
+        << ",\"release_ms\":" << comp.releaseMs << ",\"lookahead_ms\":" << comp.lookaheadMs << ",\"makeup_db\":" << comp.makeupDb
+        << "}}";
+}
+
+bool saveSession(const std::filesystem::path &path, const EngineSession &session, std::string &error) {
+    std::ostringstream out;
+    // 增益等按 float 的全部有效位写出，读回后完全一致
+    out.precision(std::numeric_limits<float>::max_digits10);
+    out << "{\"version\":" << kSessionVersion << ',';
+    writeFlag(out, "auto_start", session.autoStart);
+
+    const StreamConfig &config = session.config;
+    out << ",\n\"config\":{\"buffer_ms\":" << config.bufferMs << ',';
+    writeFlag(out, "low_latency", config.lowLatency);
+    out << ',';
+    writeFlag(out, "allow_exclusive", config.allowExclusive);
+    out << ',';
+    writeFlag(out, "dither", config.dither);
+    out << ',';
+    writeFlag(out, "adaptive_buffer", config.adaptiveBuffer);
+    out << "},\n\"output\":";
+    writeEndpoint(out, session.output);
+    out << "},\n\"extra_outputs\":[";
+    for (std::size_t i = 0; i < session.extraOutputs.size(); ++i) {
+        if (i) out << ',';
+        writeEndpoint(out, session.extraOutputs[i]);
+        out << '}';
+    }
+    out << "],\n\"sources\":[";
+    for (std::size_t i = 0; i < session.sources.size(); ++i) {
+        if (i) out << ",\n";
+        writeEndpoint(out, session.sources[i].endpoint);
+        out << ",\"gain\":" << session.sources[i].gain << '}';
+    }
+    out << "],\n\"routes\":[";
+    for (std::size_t row = 0; row < session.routes.size(); ++row) {
+        out << (row ? ",\n[" : "[");
+        for (std::size_t column = 0; column < session.routes[row].size(); ++column) {
+            const Route &route = session.routes[row][column];
+            if (column) out << ',';
+            out << "{\"gain\":" << route.gain << ",\"delay_frames\":" << route.delayFrames << ',';
+            writeFlag(out, "muted", route.muted);
+            out << '}';
+        }
+        out << ']';
+    }
+    // 不带插入效果的格写 null，文件保持紧凑
+    out << "],\n\"inserts\":[";
+    for (std::size_t row = 0; row < session.inserts.size(); ++row) {
+        out << (row ? ",\n[" : "[");
+        for (std::size_t column = 0; column < session.inserts[row].size(); ++column) {
+            const InsertSettings &settings = session.inserts[row][column];
+            if (column) out << ',';
+            if (settings.active()) writeInsertJson(out, settings);
+            else out << "null";
+        }
+        out << ']';
+    }
+    out << "]}\n";
+
+    std::filesystem::path temporary = path;
+    temporary += ".tmp";
+    std::error_code ec;
+    if (!writeFileSynced(temporary, out.str())) {
+        std::filesystem::remove(temporary, ec);
+        error = "无法写入文件";
+        return false;
+    }
+    std::filesystem::rename(temporary, path, ec);
+    if (ec) {
+        std::filesystem::remove(temporary, ec);
+        error = "无法替换会话文件";
+        return false;
+    }
+    syncDirectory(path);
+    return true;
+}
+
+bool loadSession(const std::filesystem::path &path, EngineSession &session, std::string &error) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        error = "无法打开文件";
+        return false;
+    }
+    const std::string text((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    JsonValue root;
+    if (!parseJson(text, root) || !root.isObject()) {
+        error = "不是有效的 JSON";
+        return false;
+    }
+    const JsonValue *version = root.find("version");
+    if (!version || !version->isNumber() || version->number() != kSessionVersion) {
+        error = "不支持的会话版本";
+        return false;
+    }
+
+    EngineSession result;
+    readFlag(root, "auto_start", result.autoStart);
+    if (const JsonValue *config = root.find("config"); config && config->isObject()) {
+        if (!readUnsigned(*config, "buffer_ms", result.config.bufferMs)) {
+            error = "buffer_ms 无效";
+            return false;
+        }
+        readFlag(*config, "low_latency", result.config.lowLatency);
+        readFlag(*config, "allow_exclusive", result.config.allowExclusive);
+        readFlag(*config, "dither", result.config.dither);
+        readFlag(*config, "adaptive_buffer", result.config.adaptiveBuffer);
+    }
+
+    const JsonValue *output = root.find("output");
+    if (!output || !readEndpoint(*output, result.output, error)) {
+        if (!output) error = "缺少 output";
+        return false;
+    }
+    if (const JsonValue *extras = root.find("extra_outputs"); extras && extras->isArray()) {
+        for (const JsonValue &item : extras->array()) {
+            result.extraOutputs.emplace_back();
+            if (!readEndpoint(item, result.extraOutputs.back(), error)) return false;
+        }
+    }
+    const JsonValue *sources = root.find("sources");
+    if (!sources || !sources->isArray() || sources->array().empty()) {
+        error = "至少需要一个来源";
+        return false;
+    }
+    for (const JsonValue &item : sources->array()) {
+        SessionSource source;
+        if (!readEndpoint(item, source.endpoint, error)) return false;
+        readNumber(item, "gain", source.gain);
+        if (!(source.gain >= 0.0f)) source.gain = 1.0f;
+        result.sources.push_back(std::move(source));
+    }
+
+    if (const JsonValue *routes = root.find("routes"); routes && routes->isArray()) {
+        for (const JsonValue &row : routes->array()) {
+            auto &cells = result.routes.emplace_back();
+            if (!row.isArray()) continue;
+            for (const JsonValue &cell : row.array()) {
+                Route route;
+                if (cell.isObject()) {
+                    readNumber(cell, "gain", route.gain);
+                    readFlag(cell, "muted", route.muted);
+                    if (!readUnsigned(cell, "delay_frames", route.delayFrames)) {
+                        error = "delay_frames 无效";
+                        return false;
+                    }
+                }
+                cells.push_back(route);
+            }
+        }
+    }
+    if (const JsonValue *inserts = root.find("inserts"); inserts && inserts->isArray()) {
+        for (const JsonValue &row : inserts->array()) {
+            auto &cells = result.inserts.emplace_back();
+            if (!row.isArray()) continue;
+            for (const JsonValue &cell : row.array()) {
+                InsertSettings settings;
+                if (cell.isObject() && !readInsertJson(cell, settings, error)) return false;
+                cells.push_back(settings);
+            }
+        }
+    }
+
+    session = std::move(result);
+    return true;
+}
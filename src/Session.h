@@ -0,0 +1,50 @@
+#pragma once
+
+#include <filesystem>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+#include "AudioBackend.h"
+#include "InsertChain.h"
+#include "Json.h"
+#include "RoutingMatrix.h"
+
+// 会话：一次运行的完整设置（与平台无关，不依赖 Qt），保存为 UTF-8 JSON 文件。
+// 下次启动时按端点 ID 直接打开设备（不做完整枚举），并把上次协商到的格式交给后端先试（见 StreamConfig::cachedFormat）。
+// 进程来源的 PID 与保存时的进程对不上时才枚举一次，按进程名重新解析
+
+// 一个端点：ID 与上次实际打开时的格式、模式
+struct SessionEndpoint {
+    std::wstring id;
+    StreamFormat format;                  // sampleRate 为 0 表示未知（重新协商）
+    StreamMode mode = StreamMode::Shared;
+    // 进程来源（process:<pid>）保存时的进程名：PID 重启后多半已失效或被别的程序复用，恢复时按进程名重新找
+    std::wstring processName;
+};
+
+struct SessionSource {
+    SessionEndpoint endpoint;
+    float gain = 1.0f;   // 线性
+};
+
+struct EngineSession {
+    bool autoStart = true;   // 程序启动时直接恢复运行；为 false 时只用来预选设备与参数
+    StreamConfig config;
+    std::vector<SessionSource> sources;
+    SessionEndpoint output;
+    std::vector<SessionEndpoint> extraOutputs;
+    // [来源][输出]，输出 0 为主输出，其后依次为 extraOutputs；缺少的项按默认（接通、不带插入效果）
+    // 路由延迟按 output.format 的采样率计，恢复时主输出采样率不同会按比例换算
+    std::vector<std::vector<Route>> routes;
+    std::vector<std::vector<InsertSettings>> inserts;
+};
+
+// 读写会话文件；失败时返回 false，error 为说明。保存时先写临时文件再替换，中途失败不会留下半个文件
+bool saveSession(const std::filesystem::path &path, const EngineSession &session, std::string &error);
+bool loadSession(const std::filesystem::path &path, EngineSession &session, std::string &error);
+
+// 插入效果参数的 JSON 对象（会话文件与控制接口的 set_insert 共用同一组字段）
+// 读取时只修改对象中给出的字段；超出范围的取值由 InsertChain 截断
+bool readInsertJson(const JsonValue &object, InsertSettings &settings, std::string &error);
+void writeInsertJson(std::ostream &out, const InsertSettings &settings);
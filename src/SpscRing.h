@@ -0,0 +1,157 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+
+// 缓存行大小：生产者与消费者的索引分别独占一行，避免伪共享
+inline constexpr std::size_t kCacheLineSize = 64;
+
+// 单生产者 / 单消费者无锁帧环形缓冲（与平台无关）
+// - 容量按帧计，向上取整为 2 的幂；构造之后不再分配内存
+// - 读写索引单调递增，利用无符号回绕与掩码定位，push/pop 都是 wait-free
+// - 一帧 = channels 个 T（交错存放）
+template <typename T>
+class SpscRing {
+public:
+    // 一段连续的帧区域
+    struct Span {
+        T *data = nullptr;
+        std::size_t frames = 0;
+    };
+
+    // 环形回绕时一次可访问的区域最多分为两段
+    struct Regions {
+        Span first;
+        Span second;
+
+        std::size_t frames() const { return first.frames + second.frames; }
+    };
+
+    SpscRing(std::size_t minCapacityFrames, std::size_t channels)
+        : chans(channels ? channels : 1) {
+        std::size_t cap = 1;
+        while (cap < minCapacityFrames) cap <<= 1;
+        mask = cap - 1;
+        buffer.assign(cap * chans, T{});
+    }
+
+    SpscRing(const SpscRing &) = delete;
+    SpscRing &operator=(const SpscRing &) = delete;
+
+    std::size_t capacity() const { return mask + 1; }
+    std::size_t channels() const { return chans; }
+
+    // 消费者视角：可读帧数
+    std::size_t readAvailable() const {
+        return writeIndex.load(std::memory_order_acquire) - readIndex.load(std::memory_order_relaxed);
+    }
+
+    // 生产者视角：可写帧数
+    std::size_t writeAvailable() const {
+        return capacity() - (writeIndex.load(std::memory_order_relaxed) - readIndex.load(std::memory_order_acquire));
+    }
+
+    // ---- 生产者 ----
+
+    // 取得最多 frames 帧的可写区域（不提交）
+    Regions prepareWrite(std::size_t frames) {
+        const std::size_t w = writeIndex.load(std::memory_order_relaxed);
+        if (capacity() - (w - cachedRead) < frames) {
+            cachedRead = readIndex.load(std::memory_order_acquire);
+        }
+        const std::size_t space = capacity() - (w - cachedRead);
+        return regionsAt(w, frames < space ? frames : space);
+    }
+
+    void commitWrite(std::size_t frames) {
+        writeIndex.store(writeIndex.load(std::memory_order_relaxed) + frames, std::memory_order_release);
+    }
+
+    // 拷入最多 frames 帧，返回实际写入帧数
+    std::size_t push(const T *src, std::size_t frames) {
+        Regions r = prepareWrite(frames);
+        copyFrames(r.first.data, src, r.first.frames);
+        copyFrames(r.second.data, src + r.first.frames * chans, r.second.frames);
+        commitWrite(r.frames());
+        return r.frames();
+    }
+
+    // 写入静音帧（对应 AUDCLNT_BUFFERFLAGS_SILENT）
+    std::size_t pushSilence(std::size_t frames) {
+        Regions r = prepareWrite(frames);
+        std::fill_n(r.first.data, r.first.frames * chans, T{});
+        std::fill_n(r.second.data, r.second.frames * chans, T{});
+        commitWrite(r.frames());
+        return r.frames();
+    }
+
+    // ---- 消费者 ----
+
+    // 取得最多 frames 帧的可读区域（不提交）
+    Regions prepareRead(std::size_t frames) {
+        const std::size_t rd = readIndex.load(std::memory_order_relaxed);
+        if (cachedWrite - rd < frames) {
+            cachedWrite = writeIndex.load(std::memory_order_acquire);
+        }
+        const std::size_t avail = cachedWrite - rd;
+        return regionsAt(rd, frames < avail ? frames : avail);
+    }
+
+    void commitRead(std::size_t frames) {
+        readIndex.store(readIndex.load(std::memory_order_relaxed) + frames, std::memory_order_release);
+    }
+
+    // 拷出最多 frames 帧，返回实际读出帧数
+    std::size_t pop(T *dst, std::size_t frames) {
+        Regions r = prepareRead(frames);
+        copyFrames(dst, r.first.data, r.first.frames);
+        copyFrames(dst + r.first.frames * chans, r.second.data, r.second.frames);
+        commitRead(r.frames());
+        return r.frames();
+    }
+
+    // 丢弃最多 frames 帧，返回实际丢弃帧数
+    std::size_t discard(std::size_t frames) {
+        Regions r = prepareRead(frames);
+        commitRead(r.frames());
+        return r.frames();
+    }
+
+    // 清空：仅在生产者和消费者都已停止时调用
+    void reset() {
+        writeIndex.store(0, std::memory_order_relaxed);
+        readIndex.store(0, std::memory_order_relaxed);
+        cachedRead = 0;
+        cachedWrite = 0;
+    }
+
+private:
+    Regions regionsAt(std::size_t index, std::size_t frames) {
+        const std::size_t pos = index & mask;
+        const std::size_t firstFrames = std::min(frames, capacity() - pos);
+        Regions r;
+        r.first = { buffer.data() + pos * chans, firstFrames };
+        r.second = { buffer.data(), frames - firstFrames };
+        return r;
+    }
+
+    void copyFrames(T *dst, const T *src, std::size_t frames) const {
+        if (frames) std::memcpy(dst, src, frames * chans * sizeof(T));
+    }
+
+    // 生产者独占的缓存行：写索引 + 对读索引的本地缓存
+    alignas(kCacheLineSize) std::atomic<std::size_t> writeIndex{ 0 };
+    std::size_t cachedRead = 0;
+
+    // 消费者独占的缓存行：读索引 + 对写索引的本地缓存
+    alignas(kCacheLineSize) std::atomic<std::size_t> readIndex{ 0 };
+    std::size_t cachedWrite = 0;
+
+    // 只读成员放在单独的缓存行
+    alignas(kCacheLineSize) std::size_t mask = 0;
+    std::size_t chans = 1;
+    std::vector<T> buffer;
+};
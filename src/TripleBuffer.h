@@ -0,0 +1,40 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+// 无锁三缓冲（单一写入者、单一读者）：写入端总有一份空闲的可写，读者总能拿到最近发布的一份，
+// 两边都不等待对方。用于音频线程把电平等小块状态交给界面，中间的版本可以被跳过
+template <typename T>
+class TripleBuffer {
+public:
+    // ---- 写入端 ----
+
+    // 当前可写的一份（发布前读者看不到）
+    T &back() { return slots[backIndex]; }
+    // 发布 back()，并换到另一份空闲的继续写
+    void publish() { backIndex = state.exchange(static_cast<std::uint8_t>(backIndex | kDirty), std::memory_order_acq_rel) & kIndexMask; }
+
+    // ---- 读者 ----
+
+    // 有新发布的数据时换到它并返回 true
+    bool update() {
+        if ((state.load(std::memory_order_relaxed) & kDirty) == 0) return false;
+        frontIndex = state.exchange(frontIndex, std::memory_order_acq_rel) & kIndexMask;
+        return true;
+    }
+    // 读者当前持有的一份（最近一次 update 换到的）
+    const T &front() const { return slots[frontIndex]; }
+
+private:
+    static constexpr std::uint8_t kIndexMask = 0x3;
+    static constexpr std::uint8_t kDirty = 0x4;
+
+    std::array<T, 3> slots{};
+    // 中间那一份的下标，kDirty 表示它比读者手里的新
+    std::atomic<std::uint8_t> state{ 1 };
+    // 写入端、读者各自持有的下标（只由各自一方访问），分开放避免伪共享
+    alignas(64) std::uint8_t backIndex = 0;
+    alignas(64) std::uint8_t frontIndex = 2;
+};
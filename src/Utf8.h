@@ -0,0 +1,8 @@
+#pragma once
+
+#include <string>
+
+// UTF-8 与端点 ID、路径使用的宽字符串互转（Windows 上为 UTF-16，其他平台为 UTF-32）
+// 配置文件、会话文件与控制接口都以 UTF-8 读写
+std::wstring widenUtf8(const std::string &text);
+std::string narrowUtf8(const std::wstring &text);
@@ -0,0 +1,717 @@
+#include "VirtualBackend.h"
+#include "SpscRing.h"
+#include "WavFile.h"
+
+#include <charconv>
+#include <cmath>
+#include <fstream>
+#include <limits>
+
+namespace {
+    constexpr double kPi = 3.14159265358979323846;
+    constexpr std::uint64_t kNever = std::numeric_limits<std::uint64_t>::max();
+
+    // 来源播放的一个正弦
+    struct Tone {
+        double hz;
+        float level;
+    };
+
+    // capture / render 共用：设备时钟与事件
+    class VirtualStream {
+    public:
+        VirtualStream(std::shared_ptr<VirtualClock> clock, const VirtualDeviceSpec &spec, const StreamConfig &config, bool loopback,
+                      std::shared_ptr<VirtualDeviceState> state)
+            : clock(std::move(clock)), spec(spec), fmt(spec.format), state(std::move(state)),
+              generation(this->state->generation.load(std::memory_order_acquire)) {
+            if (config.lowLatency) {
+                // 与 WASAPI 后端一致：独占只对 render 生效，否则使用最小共享周期，缓冲为两个周期
+                period = std::max<std::uint32_t>(1, spec.minPeriodFrames);
+                streamMode = (!loopback && config.allowExclusive && spec.supportsExclusive) ? StreamMode::Exclusive
+                                                                                          : StreamMode::SharedLowLatency;
+                deviceBuffer = period * 2;
+            } else {
+                period = std::max<std::uint32_t>(1, spec.periodFrames);
+                deviceBuffer = std::max<std::uint32_t>(period * 2,
+                                                       static_cast<std::uint32_t>(std::uint64_t(config.bufferMs) * fmt.sampleRate / 1000));
+            }
+        }
+
+        virtual ~VirtualStream() = default;
+
+        // 当前是否有事件待处理（已经触发但还没被 waitAny 取走）
+        virtual bool eventPending(std::uint64_t now) = 0;
+        // 下一次事件的虚拟时间
+        virtual std::uint64_t nextEventNs(std::uint64_t now) = 0;
+        // waitAny 返回该流时调用（模拟自动复位事件）
+        virtual void consumeEvent(std::uint64_t now) = 0;
+
+        bool takeSignal() { return signaled.exchange(false, std::memory_order_acq_rel); }
+        bool signaledFlag() const { return signaled.load(std::memory_order_acquire); }
+
+        void raiseSignal() {
+            signaled.store(true, std::memory_order_release);
+            clock->wake();
+        }
+
+        // 设备在打开之后被移除、修改或重置
+        bool lost() const { return state->generation.load(std::memory_order_acquire) != generation; }
+
+    protected:
+        double deviceRate() const { return fmt.sampleRate * (1.0 + spec.ppm * 1e-6); }
+
+        // 自 start 起设备时钟走过的帧数
+        std::uint64_t deviceFrames(std::uint64_t now) const {
+            if (!started || now < startNs) return 0;
+            return static_cast<std::uint64_t>(static_cast<double>(now - startNs) * deviceRate() / 1e9);
+        }
+
+        // 设备时钟走到第 frames 帧时的虚拟时间
+        std::uint64_t timeOfFrame(std::uint64_t frames) const {
+            return startNs + static_cast<std::uint64_t>(std::ceil(static_cast<double>(frames) * 1e9 / deviceRate()));
+        }
+
+        void markStarted() {
+            startNs = clock->nowNs();
+            started = true;
+        }
+
+        std::shared_ptr<VirtualClock> clock;
+        VirtualDeviceSpec spec;
+        StreamFormat fmt;
+        std::uint32_t period = 480;
+        std::uint32_t deviceBuffer = 0;
+        StreamMode streamMode = StreamMode::Shared;
+        std::shared_ptr<VirtualDeviceState> state;
+        std::uint32_t generation = 0;
+        bool started = false;
+        std::uint64_t startNs = 0;
+        std::atomic<bool> signaled{ false };
+    };
+
+    class VirtualCaptureStream final : public CaptureStream, public VirtualStream {
+    public:
+        VirtualCaptureStream(std::shared_ptr<VirtualClock> clock, const VirtualDeviceSpec &spec, const StreamConfig &config,
+                             std::shared_ptr<VirtualDeviceState> state, std::vector<float> wav, std::vector<Tone> tones)
+            : VirtualStream(std::move(clock), spec, config, true, std::move(state)), wavSamples(std::move(wav)),
+              tones(std::move(tones)), random(0x9E3779B97F4A7C15ull * (spec.seed + 1ull)) {
+            packet.assign(static_cast<std::size_t>(period) * fmt.channels, 0.0f);
+            if (fmt.sample != SampleType::Float32) {
+                deviceBytes.resize(packet.size() * sampleBytes(fmt.sample));
+                converter = SampleConverter(fmt.sample, fmt.channels, period, false);
+            }
+            if (!spec.arrivalTraceMs.empty()) {
+                // 到达时刻减去按周期的理想时刻即为投递延迟；整体平移到最早的包没有延迟
+                const double periodMs = period * 1000.0 / fmt.sampleRate;
+                double offset = std::numeric_limits<double>::infinity();
+                for (std::size_t i = 0; i < spec.arrivalTraceMs.size(); ++i) {
+                    if (!std::isnan(spec.arrivalTraceMs[i])) offset = std::min(offset, spec.arrivalTraceMs[i] - i * periodMs);
+                }
+                traceDelaysMs.reserve(spec.arrivalTraceMs.size());
+                for (std::size_t i = 0; i < spec.arrivalTraceMs.size(); ++i) {
+                    const double arrival = spec.arrivalTraceMs[i];
+                    traceDelaysMs.push_back(std::isnan(arrival) ? -1.0 : arrival - i * periodMs - offset);
+                }
+            }
+            nextPacket();
+        }
+
+        StreamFormat format() const override { return fmt; }
+        std::uint32_t bufferFrames() const override { return deviceBuffer; }
+        std::uint32_t periodFrames() const override { return period; }
+        StreamMode mode() const override { return streamMode; }
+        bool start() override {
+            if (lost()) return false;
+            markStarted();
+            return true;
+        }
+        void stop() override { started = false; }
+        void signal() override { raiseSignal(); }
+        bool invalidated() const override { return lost(); }
+
+        bool readPacket(CapturePacket &out) override {
+            out = CapturePacket{};
+            if (lost()) return false;
+            if (!started) return true;
+            const std::uint64_t now = clock->nowNs();
+            std::uint64_t available = deviceFrames(now) - produced;
+
+            // 模拟丢包：轮到的包整个丢掉，下一个包带不连续标志（设备位置照常前进）
+            while (headDropped && available >= period && now >= dueNs()) {
+                produced += period;
+                sourcePosition += period;
+                available -= period;
+                pendingDiscontinuity = true;
+                nextPacket();
+            }
+
+            // 长时间没有读取：像真实设备一样丢掉溢出的部分并标记不连续
+            if (available > deviceBuffer) {
+                produced += available - period;
+                sourcePosition += available - period;
+                pendingDiscontinuity = true;
+            } else if (available < period || now < dueNs()) {
+                return true;
+            }
+
+            generate();
+            out.data = packet.data();
+            if (!converter.passthrough()) {
+                // 模拟整数格式的设备：先量化成设备字节，再像真实后端一样转换回 float32
+                scalarConvertKernels().encode[static_cast<std::size_t>(fmt.sample)](packet.data(), deviceBytes.data(), packet.size());
+                out.data = converter.decode(deviceBytes.data(), period);
+            }
+            out.frames = period;
+            out.silent = wavSamples.empty() && tones.empty();
+            out.discontinuity = pendingDiscontinuity;
+            out.devicePosition = produced;
+            out.timestampNs = timeOfFrame(produced);
+            pendingDiscontinuity = false;
+            return true;
+        }
+
+        void releasePacket(std::uint32_t frames) override {
+            produced += frames;
+            sourcePosition += frames;
+            nextPacket();
+        }
+
+        bool eventPending(std::uint64_t now) override {
+            return started && !lost() && deviceFrames(now) - produced >= period && now >= dueNs();
+        }
+
+        std::uint64_t nextEventNs(std::uint64_t) override {
+            return started && !lost() ? dueNs() : kNever;
+        }
+
+        void consumeEvent(std::uint64_t) override {}
+
+    private:
+        // 下一个包满一个周期、再加上它的投递延迟后才可读
+        std::uint64_t dueNs() const { return timeOfFrame(produced + period) + headDelayNs; }
+
+        // 为下一个包取投递延迟与是否丢失：回放记录，或随机抽取（xorshift64*）；只由音频线程调用
+        void nextPacket() {
+            if (!traceDelaysMs.empty()) {
+                const double delay = traceDelaysMs[traceIndex];
+                if (++traceIndex == traceDelaysMs.size()) traceIndex = 0;
+                headDelayNs = delay > 0.0 ? static_cast<std::uint64_t>(delay * 1e6) : 0;
+                headDropped = delay < 0.0;
+                return;
+            }
+            auto uniform = [this] {
+                random ^= random >> 12;
+                random ^= random << 25;
+                random ^= random >> 27;
+                return static_cast<double>((random * 0x2545F4914F6CDD1Dull) >> 11) / 9007199254740992.0;
+            };
+            headDelayNs = spec.jitterMs > 0.0 ? static_cast<std::uint64_t>(uniform() * spec.jitterMs * 1e6) : 0;
+            headDropped = spec.dropRate > 0.0 && uniform() < spec.dropRate;
+        }
+
+        void generate() {
+            const std::size_t ch = fmt.channels;
+            if (!wavSamples.empty()) {
+                const std::uint64_t total = wavSamples.size() / ch;
+                for (std::uint32_t i = 0; i < period; ++i) {
+                    const std::size_t src = static_cast<std::size_t>((sourcePosition + i) % total) * ch;
+                    std::copy_n(wavSamples.data() + src, ch, packet.data() + i * ch);
+                }
+                return;
+            }
+            for (std::uint32_t i = 0; i < period; ++i) {
+                const double t = static_cast<double>(sourcePosition + i) / fmt.sampleRate;
+                float v = 0.0f;
+                for (const Tone &tone : tones) v += tone.level * static_cast<float>(std::sin(2.0 * kPi * tone.hz * t));
+                std::fill_n(packet.data() + i * ch, ch, v);
+            }
+        }
+
+        std::vector<float> wavSamples;
+        std::vector<Tone> tones;   // 没有 WAV 时的内容（为空即静音）
+        std::vector<float> packet;
+        // 设备为整数格式时的原始字节与转换
+        std::vector<unsigned char> deviceBytes;
+        SampleConverter converter;
+        std::uint64_t produced = 0;
+        std::uint64_t sourcePosition = 0;
+        bool pendingDiscontinuity = false;
+        std::uint64_t random;
+        std::uint64_t headDelayNs = 0;
+        bool headDropped = false;
+        // 各包的投递延迟（毫秒，负数为丢失）
+        std::vector<double> traceDelaysMs;
+        std::size_t traceIndex = 0;
+    };
+
+    class VirtualRenderStream final : public RenderStream, public VirtualStream {
+    public:
+        VirtualRenderStream(std::shared_ptr<VirtualClock> clock, const VirtualDeviceSpec &spec, const StreamConfig &config,
+                            VirtualBackend::RenderTap tap, VirtualBackend::RefillTap refillTap,
+                            std::shared_ptr<VirtualDeviceState> state)
+            : VirtualStream(std::move(clock), spec, config, false, std::move(state)), pending(deviceBuffer, fmt.channels),
+              tap(std::move(tap)), refillTap(std::move(refillTap)) {
+            writeBuffer.assign(static_cast<std::size_t>(deviceBuffer) * fmt.channels, 0.0f);
+            playBuffer.assign(static_cast<std::size_t>(period) * fmt.channels, 0.0f);
+            if (fmt.sample != SampleType::Float32) {
+                deviceBytes.resize(writeBuffer.size() * sampleBytes(fmt.sample));
+                converter = SampleConverter(fmt.sample, fmt.channels, deviceBuffer, config.dither);
+            }
+            if (!spec.outputWav.empty()) wav.open(spec.outputWav, fmt);
+        }
+
+        StreamFormat format() const override { return fmt; }
+        std::uint32_t bufferFrames() const override { return deviceBuffer; }
+        std::uint32_t periodFrames() const override { return period; }
+        StreamMode mode() const override { return streamMode; }
+        bool start() override {
+            if (lost()) return false;
+            markStarted();
+            state->renderStartNs.store(startNs, std::memory_order_relaxed);
+            consumed = 0;
+            lastEventPeriod = 0;
+            return true;
+        }
+        void stop() override { advance(clock->nowNs()); started = false; }
+        void signal() override { raiseSignal(); }
+        bool invalidated() const override { return lost(); }
+
+        bool padding(std::uint32_t &frames) override {
+            if (lost()) return false;
+            advance(clock->nowNs());
+            frames = static_cast<std::uint32_t>(pending.readAvailable());
+            return true;
+        }
+
+        float *acquire(std::uint32_t frames) override {
+            if (lost()) return nullptr;
+            advance(clock->nowNs());
+            if (frames > pending.writeAvailable()) return nullptr;
+            if (!converter.passthrough()) return converter.renderBuffer(deviceBytes.data(), frames);
+            return writeBuffer.data();
+        }
+
+        bool commit(std::uint32_t frames) override {
+            if (lost()) return false;
+            if (refillTap) refillTap(spec.id, clock->nowNs(), frames);
+            if (!converter.passthrough()) {
+                // 写入设备字节后再还原成"播放"出去的 float32，量化与抖动的效果都会体现在输出中
+                converter.encode(frames);
+                scalarConvertKernels().decode[static_cast<std::size_t>(fmt.sample)](deviceBytes.data(), writeBuffer.data(),
+                                                                                      static_cast<std::size_t>(frames) * fmt.channels);
+            }
+            return pending.push(writeBuffer.data(), frames) == frames;
+        }
+
+        bool eventPending(std::uint64_t now) override {
+            return started && !lost() && deviceFrames(now) / period > lastEventPeriod;
+        }
+
+        std::uint64_t nextEventNs(std::uint64_t) override {
+            return started && !lost() ? timeOfFrame((lastEventPeriod + 1) * period) : kNever;
+        }
+
+        void consumeEvent(std::uint64_t now) override {
+            lastEventPeriod = deviceFrames(now) / period;
+        }
+
+    private:
+        // 按设备时钟"播放"掉应该已经播放的帧（设备失效后不再播放）
+        void advance(std::uint64_t now) {
+            if (!started || lost()) return;
+            const std::uint64_t target = deviceFrames(now);
+            while (consumed < target) {
+                const std::uint32_t chunk = static_cast<std::uint32_t>(std::min<std::uint64_t>(target - consumed, period));
+                const std::uint32_t got = static_cast<std::uint32_t>(pending.pop(playBuffer.data(), chunk));
+                if (got < chunk) {
+                    // 欠载：设备播放静音
+                    std::fill(playBuffer.begin() + static_cast<std::ptrdiff_t>(got) * fmt.channels,
+                              playBuffer.begin() + static_cast<std::ptrdiff_t>(chunk) * fmt.channels, 0.0f);
+                    state->underrunFrames.fetch_add(chunk - got, std::memory_order_relaxed);
+                }
+                if (tap) tap(spec.id, playBuffer.data(), chunk);
+                if (wav.isOpen()) wav.write(playBuffer.data(), chunk);
+                consumed += chunk;
+            }
+        }
+
+        SpscRing<float> pending;
+        std::vector<float> writeBuffer;
+        std::vector<unsigned char> deviceBytes;
+        SampleConverter converter;
+        std::vector<float> playBuffer;
+        VirtualBackend::RenderTap tap;
+        VirtualBackend::RefillTap refillTap;
+        WavWriter wav;
+        std::uint64_t consumed = 0;
+        std::uint64_t lastEventPeriod = 0;
+    };
+}
+
+bool loadArrivalTrace(const std::filesystem::path &path, std::vector<double> &arrivalsMs, std::string &error) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        error = "无法打开文件";
+        return false;
+    }
+    arrivalsMs.clear();
+    std::string line;
+    for (std::size_t lineNo = 1; std::getline(in, line); ++lineNo) {
+        // 取第一项（之后可以跟其他列，以空白或逗号分隔）
+        const std::size_t begin = line.find_first_not_of(" \t\r");
+        if (begin == std::string::npos || line[begin] == '#') continue;
+        const std::size_t end = std::min(line.find_first_of(" \t\r,", begin), line.size());
+        const std::string field = line.substr(begin, end - begin);
+        if (field == "lost" || field == "-") {
+            arrivalsMs.push_back(std::numeric_limits<double>::quiet_NaN());
+            continue;
+        }
+        double value = 0.0;
+        const auto result = std::from_chars(field.data(), field.data() + field.size(), value);
+        if (result.ec != std::errc() || result.ptr != field.data() + field.size() || !std::isfinite(value)) {
+            error = "第 " + std::to_string(lineNo) + " 行：无效的到达时刻";
+            return false;
+        }
+        arrivalsMs.push_back(value);
+    }
+    if (arrivalsMs.empty()) {
+        error = "没有记录";
+        return false;
+    }
+    return true;
+}
+
+// ---- VirtualClock ----
+
+VirtualClock::VirtualClock(double speed)
+    : speed(speed), origin(std::chrono::steady_clock::now()) {
+}
+
+std::uint64_t VirtualClock::nowNs() const {
+    if (realtime()) {
+        const auto elapsed = std::chrono::steady_clock::now() - origin;
+        return static_cast<std::uint64_t>(std::chrono::duration<double, std::nano>(elapsed).count() * speed);
+    }
+    return virtualNow.load(std::memory_order_acquire);
+}
+
+void VirtualClock::attach() {
+    std::lock_guard<std::mutex> lock(mutex);
+    ++participants;
+}
+
+void VirtualClock::detach() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        --participants;
+    }
+    cv.notify_all();
+}
+
+void VirtualClock::wake() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+    }
+    cv.notify_all();
+}
+
+void VirtualClock::advanceTo(std::uint64_t ns) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        virtualNow.store(std::max(virtualNow.load(std::memory_order_relaxed), ns), std::memory_order_release);
+    }
+    cv.notify_all();
+}
+
+// ---- VirtualBackend ----
+
+VirtualBackend::VirtualBackend(std::shared_ptr<VirtualClock> clock)
+    : virtualClock(std::move(clock)) {
+}
+
+std::unique_ptr<VirtualBackend> VirtualBackend::withDefaultDevices() {
+    auto backend = std::make_unique<VirtualBackend>();
+
+    VirtualDeviceSpec out;
+    out.id = L"virtual:output";
+    out.name = L"Virtual Output";
+    out.toneHz = 0.0;
+    backend->addDevice(out);
+
+    VirtualDeviceSpec tone;
+    tone.id = L"virtual:tone-440";
+    tone.name = L"Virtual Tone 440 Hz";
+    backend->addDevice(tone);
+
+    // 44.1 kHz 且时钟略快，用于覆盖重采样与漂移补偿路径
+    VirtualDeviceSpec tone441;
+    tone441.id = L"virtual:tone-1k-44k1";
+    tone441.name = L"Virtual Tone 1 kHz (44.1 kHz)";
+    tone441.format = { 44100, 2 };
+    tone441.periodFrames = 441;
+    tone441.toneHz = 1000.0;
+    tone441.ppm = 150.0;
+    backend->addDevice(tone441);
+
+    // 一个带子进程的播放器，用于覆盖进程 loopback 来源
+    VirtualProcessSpec player;
+    player.processId = 4100;
+    player.name = L"virtual-player";
+    player.toneHz = 660.0;
+    backend->addProcess(player);
+    VirtualProcessSpec helper;
+    helper.processId = 4101;
+    helper.parentId = player.processId;
+    helper.name = L"virtual-player-helper";
+    helper.toneHz = 880.0;
+    helper.toneLevel = 0.1f;
+    backend->addProcess(helper);
+
+    return backend;
+}
+
+void VirtualBackend::addDevice(const VirtualDeviceSpec &spec) {
+    {
+        std::lock_guard<std::mutex> lock(deviceMutex);
+        auto it = std::find_if(devices.begin(), devices.end(), [&](const auto &d) { return d.id == spec.id; });
+        if (it != devices.end()) {
+            *it = spec;
+            deviceState(spec.id)->generation.fetch_add(1, std::memory_order_acq_rel);
+        } else {
+            devices.push_back(spec);
+        }
+        std::wstring &defaultId = spec.isRender ? defaultRender : defaultCapture;
+        if (defaultId.empty()) defaultId = spec.id;
+    }
+    notify(DeviceChange::Type::Added, spec.id, spec.isRender);
+}
+
+void VirtualBackend::removeDevice(const std::wstring &id) {
+    bool isRender = true;
+    bool wasDefault = false;
+    {
+        std::lock_guard<std::mutex> lock(deviceMutex);
+        auto it = std::find_if(devices.begin(), devices.end(), [&](const auto &d) { return d.id == id; });
+        if (it == devices.end()) return;
+        isRender = it->isRender;
+        devices.erase(it);
+        deviceState(id)->generation.fetch_add(1, std::memory_order_acq_rel);
+        std::wstring &defaultId = isRender ? defaultRender : defaultCapture;
+        wasDefault = defaultId == id;
+        if (wasDefault) defaultId.clear();
+    }
+    notify(DeviceChange::Type::Removed, id, isRender);
+    if (wasDefault) notify(DeviceChange::Type::DefaultChanged, L"", isRender);
+}
+
+void VirtualBackend::setDefaultDevice(const std::wstring &id) {
+    bool isRender = true;
+    {
+        std::lock_guard<std::mutex> lock(deviceMutex);
+        const VirtualDeviceSpec *spec = findDevice(id);
+        if (!spec) return;
+        isRender = spec->isRender;
+        (isRender ? defaultRender : defaultCapture) = id;
+    }
+    notify(DeviceChange::Type::DefaultChanged, id, isRender);
+}
+
+void VirtualBackend::invalidateDevice(const std::wstring &id) {
+    std::lock_guard<std::mutex> lock(deviceMutex);
+    deviceState(id)->generation.fetch_add(1, std::memory_order_acq_rel);
+}
+
+void VirtualBackend::addProcess(const VirtualProcessSpec &spec) {
+    if (spec.processId == 0) return;
+    {
+        std::lock_guard<std::mutex> lock(deviceMutex);
+        auto it = std::find_if(processes.begin(), processes.end(), [&](const auto &p) { return p.processId == spec.processId; });
+        if (it != processes.end()) *it = spec;
+        else processes.push_back(spec);
+    }
+    notify(DeviceChange::Type::Added, processLoopbackId(spec.processId, false), false);
+}
+
+void VirtualBackend::removeProcess(const std::uint32_t processId) {
+    {
+        std::lock_guard<std::mutex> lock(deviceMutex);
+        auto it = std::find_if(processes.begin(), processes.end(), [&](const auto &p) { return p.processId == processId; });
+        if (it == processes.end()) return;
+        processes.erase(it);
+    }
+    notify(DeviceChange::Type::Removed, processLoopbackId(processId, false), false);
+}
+
+void VirtualBackend::notify(DeviceChange::Type type, const std::wstring &id, bool isRender) {
+    std::lock_guard<std::mutex> lock(callbackMutex);
+    if (deviceChanged) deviceChanged(DeviceChange{ type, id, isRender });
+}
+
+void VirtualBackend::setDeviceChangeCallback(DeviceChangeCallback callback) {
+    std::lock_guard<std::mutex> lock(callbackMutex);
+    deviceChanged = std::move(callback);
+}
+
+const VirtualDeviceSpec *VirtualBackend::findDevice(const std::wstring &id) const {
+    for (const auto &d : devices) {
+        if (d.id == id) return &d;
+    }
+    return nullptr;
+}
+
+const VirtualProcessSpec *VirtualBackend::findProcess(const std::uint32_t processId) const {
+    for (const auto &p : processes) {
+        if (p.processId == processId) return &p;
+    }
+    return nullptr;
+}
+
+bool VirtualBackend::inProcessTree(std::uint32_t processId, const std::uint32_t root) const {
+    // 沿父进程向上找；父子关系可能成环，最多走进程个数步
+    for (std::size_t steps = 0; steps <= processes.size() && processId != 0; ++steps) {
+        if (processId == root) return true;
+        const VirtualProcessSpec *p = findProcess(processId);
+        if (!p) return false;
+        processId = p->parentId;
+    }
+    return false;
+}
+
+std::shared_ptr<VirtualDeviceState> &VirtualBackend::deviceState(const std::wstring &id) {
+    auto &state = states[id];
+    if (!state) state = std::make_shared<VirtualDeviceState>();
+    return state;
+}
+
+DeviceInfo VirtualBackend::info(const VirtualDeviceSpec &spec) const {
+    return { spec.id, spec.name, spec.isRender, spec.id == (spec.isRender ? defaultRender : defaultCapture) };
+}
+
+std::uint64_t VirtualBackend::underrunFrames(const std::wstring &deviceId) const {
+    std::lock_guard<std::mutex> lock(deviceMutex);
+    auto it = states.find(deviceId);
+    return it == states.end() ? 0 : it->second->underrunFrames.load(std::memory_order_relaxed);
+}
+
+std::uint64_t VirtualBackend::renderStartNs(const std::wstring &deviceId) const {
+    std::lock_guard<std::mutex> lock(deviceMutex);
+    auto it = states.find(deviceId);
+    return it == states.end() ? 0 : it->second->renderStartNs.load(std::memory_order_relaxed);
+}
+
+std::vector<DeviceInfo> VirtualBackend::enumerate() {
+    enumerateCount.fetch_add(1, std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lock(deviceMutex);
+    std::vector<DeviceInfo> list;
+    for (const auto &d : devices) {
+        list.push_back(info(d));
+    }
+    for (const auto &p : processes) {
+        DeviceInfo process;
+        process.id = processLoopbackId(p.processId, false);
+        process.name = p.name;
+        process.isRender = false;
+        process.processId = p.processId;
+        list.push_back(std::move(process));
+    }
+    return list;
+}
+
+bool VirtualBackend::describe(const std::wstring &deviceId, DeviceInfo &result) {
+    std::lock_guard<std::mutex> lock(deviceMutex);
+    std::uint32_t processId = 0;
+    bool excludeTree = false;
+    if (parseProcessLoopbackId(deviceId, processId, excludeTree)) {
+        const VirtualProcessSpec *process = findProcess(processId);
+        if (!process) return false;
+        result = DeviceInfo{ deviceId, process->name, false, false, processId, excludeTree };
+        return true;
+    }
+    const VirtualDeviceSpec *spec = findDevice(deviceId);
+    if (!spec) return false;
+    result = info(*spec);
+    return true;
+}
+
+std::unique_ptr<CaptureStream> VirtualBackend::openLoopback(const std::wstring &deviceId, const StreamConfig &config) {
+    VirtualDeviceSpec effective;
+    std::shared_ptr<VirtualDeviceState> state;
+    {
+        std::lock_guard<std::mutex> lock(deviceMutex);
+        const VirtualDeviceSpec *spec = findDevice(deviceId);
+        if (!spec || !spec->isRender) return nullptr;
+        effective = *spec;
+        state = deviceState(deviceId);
+    }
+    std::vector<float> wav;
+    if (!effective.inputWav.empty()) {
+        // WAV 文件决定该来源的格式
+        if (!readWavFile(effective.inputWav, wav, effective.format) || wav.empty()) return nullptr;
+    }
+    std::vector<Tone> tones;
+    if (effective.toneHz > 0.0) tones.push_back({ effective.toneHz, effective.toneLevel });
+    return std::make_unique<VirtualCaptureStream>(virtualClock, effective, config, std::move(state), std::move(wav), std::move(tones));
+}
+
+std::unique_ptr<CaptureStream> VirtualBackend::openProcessLoopback(const std::uint32_t processId, const bool excludeTree,
+                                                                   const StreamFormat &format, const StreamConfig &config) {
+    VirtualDeviceSpec effective;
+    std::vector<Tone> tones;
+    std::shared_ptr<VirtualDeviceState> state;
+    {
+        std::lock_guard<std::mutex> lock(deviceMutex);
+        const VirtualProcessSpec *target = findProcess(processId);
+        if (!target) return nullptr;
+        for (const auto &p : processes) {
+            if (inProcessTree(p.processId, processId) != excludeTree && p.toneHz > 0.0) tones.push_back({ p.toneHz, p.toneLevel });
+        }
+        effective.id = processLoopbackId(processId, excludeTree);
+        effective.name = target->name;
+        state = deviceState(effective.id);
+    }
+    // 与 WASAPI 一样按请求的采样率与声道数交付 float32，周期跟随引擎的 10 ms
+    effective.format = { format.sampleRate > 0 ? format.sampleRate : 48000, format.channels > 0 ? format.channels : 2 };
+    effective.periodFrames = std::max<std::uint32_t>(1, effective.format.sampleRate / 100);
+    effective.minPeriodFrames = effective.periodFrames;
+    return std::make_unique<VirtualCaptureStream>(virtualClock, effective, config, std::move(state), std::vector<float>{}, std::move(tones));
+}
+
+std::unique_ptr<RenderStream> VirtualBackend::openRender(const std::wstring &deviceId, const StreamConfig &config) {
+    std::lock_guard<std::mutex> lock(deviceMutex);
+    const VirtualDeviceSpec *spec = findDevice(deviceId);
+    if (!spec || !spec->isRender) return nullptr;
+    return std::make_unique<VirtualRenderStream>(virtualClock, *spec, config, renderTap, refillTap, deviceState(deviceId));
+}
+
+int VirtualBackend::waitAny(AudioStream *const *streams, std::size_t count, std::uint32_t timeoutMs) {
+    // 与 WASAPI 一样限制为 64 个，避免在音频线程中分配
+    constexpr std::size_t kMaxStreams = 64;
+    if (count == 0 || count > kMaxStreams) return kWaitFailed;
+    VirtualStream *vs[kMaxStreams];
+    for (std::size_t i = 0; i < count; ++i) {
+        vs[i] = dynamic_cast<VirtualStream *>(streams[i]);
+        if (!vs[i]) return kWaitFailed;
+    }
+
+    const std::uint64_t timeoutAt = virtualClock->nowNs() + std::uint64_t(timeoutMs) * 1000000ull;
+    while (true) {
+        const std::uint64_t now = virtualClock->nowNs();
+        std::uint64_t deadline = timeoutAt;
+        for (std::size_t i = 0; i < count; ++i) {
+            if (vs[i]->takeSignal()) return static_cast<int>(i);
+            if (vs[i]->eventPending(now)) {
+                vs[i]->consumeEvent(now);
+                return static_cast<int>(i);
+            }
+            deadline = std::min(deadline, vs[i]->nextEventNs(now));
+        }
+        if (now >= timeoutAt) return kWaitTimeout;
+
+        virtualClock->waitUntil(deadline, [&] {
+            for (std::size_t i = 0; i < count; ++i) {
+                if (vs[i]->signaledFlag()) return true;
+            }
+            return false;
+        });
+    }
+}
@@ -0,0 +1,212 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "AudioBackend.h"
+#include "RtSanitizer.h"
+
+// 虚拟时钟（纳秒）
+// - speed > 0：实时模式，虚拟时间 = 真实流逝时间 * speed
+// - speed <= 0：离散事件模式，所有登记的音频线程都在等待时，时间直接跳到最早的截止时间，
+//   结果与机器快慢、线程调度无关，可重复
+class VirtualClock {
+public:
+    explicit VirtualClock(double speed = 1.0);
+
+    bool realtime() const { return speed > 0.0; }
+    std::uint64_t nowNs() const;
+
+    // 登记 / 注销一个参与离散事件推进的线程
+    void attach();
+    void detach();
+
+    // 等待虚拟时间到达 deadlineNs，或在 wake() 之后 interrupted() 为真
+    template <typename Pred>
+    void waitUntil(std::uint64_t deadlineNs, Pred interrupted);
+
+    // 唤醒等待者重新检查条件
+    void wake();
+
+    // 离散事件模式下由外部推进时间（没有音频线程时使用）
+    void advanceTo(std::uint64_t ns);
+
+private:
+    double speed;
+    std::chrono::steady_clock::time_point origin;
+
+    mutable std::mutex mutex;
+    std::condition_variable cv;
+    // 只在持有 mutex 时修改；读取不加锁，音频线程可以随时取当前时间
+    std::atomic<std::uint64_t> virtualNow{ 0 };
+    int participants = 0;
+    int waiting = 0;
+    std::multiset<std::uint64_t> deadlines;
+};
+
+template <typename Pred>
+void VirtualClock::waitUntil(std::uint64_t deadlineNs, Pred interrupted) {
+    rtsan::check("blocking wait");
+    std::unique_lock<std::mutex> lock(mutex);
+    if (realtime()) {
+        const auto realDeadline = origin + std::chrono::nanoseconds(static_cast<std::int64_t>(deadlineNs / speed));
+        cv.wait_until(lock, realDeadline, [&] { return interrupted(); });
+        return;
+    }
+
+    ++waiting;
+    auto it = deadlines.insert(deadlineNs);
+    while (!interrupted() && virtualNow < deadlineNs) {
+        if (waiting >= participants && *deadlines.begin() > virtualNow) {
+            // 所有参与者都在等待：跳到最早的截止时间
+            virtualNow.store(*deadlines.begin(), std::memory_order_release);
+            cv.notify_all();
+            continue;
+        }
+        cv.wait(lock);
+    }
+    deadlines.erase(it);
+    --waiting;
+}
+
+// 一个虚拟端点
+struct VirtualDeviceSpec {
+    std::wstring id;
+    std::wstring name;
+    bool isRender = true;
+    StreamFormat format{ 48000, 2 };  // format.sample 为整数格式时模拟对应位深的设备（数据经过量化）
+    std::uint32_t periodFrames = 480;   // 设备周期（事件间隔），默认 10 ms
+    std::uint32_t minPeriodFrames = 128; // 低延迟模式下可用的最小周期
+    bool supportsExclusive = false;     // 低延迟模式下是否可以进入独占模式（仅 render）
+    double ppm = 0.0;                   // 设备时钟相对虚拟时钟的偏差
+
+    // 作为 loopback 来源时的内容：优先读取 WAV 文件（循环播放），否则生成正弦；toneHz 为 0 表示静音
+    std::filesystem::path inputWav;
+    double toneHz = 440.0;
+    float toneLevel = 0.25f;
+    // 作为 loopback 来源时模拟不稳定的投递（用于测试抖动缓冲与丢包补偿）：每个包额外推迟 0..jitterMs 的随机时长
+    // （仍按顺序投递），并以 dropRate 的概率整包丢失（下一个包带不连续标志）；seed 决定随机序列，结果可重复
+    double jitterMs = 0.0;
+    double dropRate = 0.0;
+    std::uint32_t seed = 1;
+    // 回放录下的到达时刻（毫秒，每个包一项，NaN 为丢失的包，循环使用）：按设备周期换算成各包的投递延迟，
+    // 不为空时代替 jitterMs / dropRate（读取见 loadArrivalTrace）
+    std::vector<double> arrivalTraceMs;
+
+    // 作为输出时，把实际"播放"出去的帧写入该 WAV 文件（为空则不写）
+    std::filesystem::path outputWav;
+};
+
+// 一个正在播放声音的虚拟进程（作为进程 loopback 来源，用于在没有 Windows 的环境下测试按进程捕获）
+struct VirtualProcessSpec {
+    std::uint32_t processId = 0;   // 不能为 0
+    std::uint32_t parentId = 0;    // 父进程（0 为没有）；进程树按它展开
+    std::wstring name;             // 进程名
+    // 该进程播放的正弦（与它在哪个端点上播放无关）；toneHz 为 0 表示有音频会话但当前静音
+    double toneHz = 440.0;
+    float toneLevel = 0.25f;
+};
+
+// 每个虚拟端点在流之间共享的状态
+struct VirtualDeviceState {
+    std::atomic<std::uint64_t> underrunFrames{ 0 };
+    // render 流最近一次 start 的虚拟时间
+    std::atomic<std::uint64_t> renderStartNs{ 0 };
+    // 每次失效加一；流记住打开时的值，不一致即为失效
+    std::atomic<std::uint32_t> generation{ 0 };
+};
+
+// 读取到达时刻记录（UTF-8 文本）：每行第一项为一个包的到达时刻（毫秒，原点任意），lost 或 - 表示丢失的包，
+// # 开头为注释。失败时返回 false，error 为带行号的说明
+bool loadArrivalTrace(const std::filesystem::path &path, std::vector<double> &arrivalsMs, std::string &error);
+
+// 虚拟后端：按虚拟时钟生成 / 消耗数据，不依赖任何音频设备，用于无界面环境下的回归与基准
+class VirtualBackend final : public AudioBackend {
+public:
+    explicit VirtualBackend(std::shared_ptr<VirtualClock> clock = std::make_shared<VirtualClock>());
+
+    // 带几个默认虚拟设备（非 Windows 平台的默认后端）
+    static std::unique_ptr<VirtualBackend> withDefaultDevices();
+
+    // 设备增删与默认端点切换：注册了变化回调时会像系统一样发出通知（用于测试设备缓存与热插拔）
+    // 每个方向第一个加入的设备为默认端点
+    // 以已有的 ID 再次加入即为修改该设备（例如格式），与移除一样会让已打开的流失效
+    void addDevice(const VirtualDeviceSpec &spec);
+    void removeDevice(const std::wstring &id);
+    void setDefaultDevice(const std::wstring &id);
+    // 让设备上已打开的流失效（设备保持可用，可以立即重新打开），模拟驱动重置
+    void invalidateDevice(const std::wstring &id);
+    // 进程的出现与退出：以 processLoopbackId(pid, false) 为 ID 发出通知；以已有的 pid 再次加入即为修改
+    // 已打开的进程 loopback 流的内容在打开时确定，不受之后进程增删的影响
+    void addProcess(const VirtualProcessSpec &spec);
+    void removeProcess(std::uint32_t processId);
+    VirtualClock &clock() { return *virtualClock; }
+
+    // render 端点每"播放"一段数据都会回调（在音频线程中调用）
+    using RenderTap = std::function<void(const std::wstring &deviceId, const float *frames, std::uint32_t count)>;
+    void setRenderTap(RenderTap tap) { renderTap = std::move(tap); }
+    // render 端点每次被写入（commit）都会回调：当时的虚拟时间与写入的帧数（在音频线程中调用），用于核对补充数据的时机
+    using RefillTap = std::function<void(const std::wstring &deviceId, std::uint64_t nowNs, std::uint32_t frames)>;
+    void setRefillTap(RefillTap tap) { refillTap = std::move(tap); }
+
+    // 某个 render 端点累计欠载（无数据可播）的帧数
+    std::uint64_t underrunFrames(const std::wstring &deviceId) const;
+    // 某个 render 端点最近一次开始播放的虚拟时间：RenderTap 累计的第 n 帧在 start + n / (采样率 × (1 + ppm)) 时播放
+    std::uint64_t renderStartNs(const std::wstring &deviceId) const;
+
+    std::vector<DeviceInfo> enumerate() override;
+    bool describe(const std::wstring &deviceId, DeviceInfo &info) override;
+    void setDeviceChangeCallback(DeviceChangeCallback callback) override;
+    // 已调用 enumerate 的次数
+    std::uint64_t enumerateCalls() const { return enumerateCount.load(std::memory_order_relaxed); }
+
+    std::unique_ptr<CaptureStream> openLoopback(const std::wstring &deviceId, const StreamConfig &config) override;
+    std::unique_ptr<RenderStream> openRender(const std::wstring &deviceId, const StreamConfig &config) override;
+    // 内容为进程树内（或 excludeTree 时进程树以外）全部虚拟进程的正弦之和，按 format 交付，周期 10 ms
+    std::unique_ptr<CaptureStream> openProcessLoopback(std::uint32_t processId, bool excludeTree, const StreamFormat &format,
+                                                       const StreamConfig &config) override;
+
+    int waitAny(AudioStream *const *streams, std::size_t count, std::uint32_t timeoutMs) override;
+    std::uint64_t nowNs() const override { return virtualClock->nowNs(); }
+
+    void enterAudioThread() override { virtualClock->attach(); }
+    void leaveAudioThread() override { virtualClock->detach(); }
+
+private:
+    // 持有 deviceMutex 时调用
+    const VirtualDeviceSpec *findDevice(const std::wstring &id) const;
+    std::shared_ptr<VirtualDeviceState> &deviceState(const std::wstring &id);
+    DeviceInfo info(const VirtualDeviceSpec &spec) const;
+    const VirtualProcessSpec *findProcess(std::uint32_t processId) const;
+    // processId 是否在以 root 为根的进程树中
+    bool inProcessTree(std::uint32_t processId, std::uint32_t root) const;
+    void notify(DeviceChange::Type type, const std::wstring &id, bool isRender);
+
+    std::shared_ptr<VirtualClock> virtualClock;
+    RenderTap renderTap;
+    RefillTap refillTap;
+
+    // 设备表可能在测试线程中变化，与打开流、查询互斥
+    mutable std::mutex deviceMutex;
+    std::vector<VirtualDeviceSpec> devices;
+    std::wstring defaultRender;
+    std::wstring defaultCapture;
+    std::vector<VirtualProcessSpec> processes;
+    std::map<std::wstring, std::shared_ptr<VirtualDeviceState>> states;
+    std::atomic<std::uint64_t> enumerateCount{ 0 };
+
+    // 回调在持有 callbackMutex 时执行，取消监听时等待正在执行的回调结束
+    std::mutex callbackMutex;
+    DeviceChangeCallback deviceChanged;
+};
@@ -0,0 +1,768 @@
+#include "WasapiBackend.h"
+#include "RtSanitizer.h"
+
+#include <windows.h>
+#include <wrl/client.h>
+#include <Mmdeviceapi.h>
+#include <Audioclient.h>
+#include <audioclientactivationparams.h>   // 进程 loopback 的激活参数
+#include <Audiopolicy.h>                   // IAudioSessionManager2：列出有音频会话的进程
+#include <Functiondiscoverykeys_devpkey.h>
+#include <avrt.h>            // AvSetMmThreadCharacteristics
+#include <mmreg.h>
+#include <ksmedia.h>
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <mutex>
+
+#pragma comment(lib, "Avrt.lib")
+#pragma comment(lib, "Mmdevapi.lib")     // ActivateAudioInterfaceAsync
+
+using Microsoft::WRL::ComPtr;
+
+namespace {
+    // 设备格式对应的样本编码（32 位容器中的 24 位有效位左对齐，按 32 位整数处理）；不支持的格式返回 false
+    bool sampleTypeOf(const WAVEFORMATEX* fmt, SampleType& type) {
+        if (!fmt) return false;
+        bool isFloat = fmt->wFormatTag == WAVE_FORMAT_IEEE_FLOAT;
+        bool isPcm = fmt->wFormatTag == WAVE_FORMAT_PCM;
+        if (fmt->wFormatTag == WAVE_FORMAT_EXTENSIBLE && fmt->cbSize >= 22) {
+            auto ext = reinterpret_cast<const WAVEFORMATEXTENSIBLE*>(fmt);
+            isFloat = IsEqualGUID(ext->SubFormat, KSDATAFORMAT_SUBTYPE_IEEE_FLOAT);
+            isPcm = IsEqualGUID(ext->SubFormat, KSDATAFORMAT_SUBTYPE_PCM);
+        }
+        if (isFloat && fmt->wBitsPerSample == 32) {
+            type = SampleType::Float32;
+            return true;
+        }
+        if (!isPcm) return false;
+        switch (fmt->wBitsPerSample) {
+        case 16: type = SampleType::Int16; return true;
+        case 24: type = SampleType::Int24; return true;
+        case 32: type = SampleType::Int32; return true;
+        default: return false;
+        }
+    }
+
+    // 与 mix format 采样率、声道排列相同，样本编码为 type 的格式（独占模式下逐个尝试）
+    WAVEFORMATEXTENSIBLE formatWithSample(const WAVEFORMATEX* mix, SampleType type) {
+        WAVEFORMATEXTENSIBLE f{};
+        const WORD bytes = static_cast<WORD>(sampleBytes(type));
+        f.Format.wFormatTag = WAVE_FORMAT_EXTENSIBLE;
+        f.Format.nChannels = mix->nChannels;
+        f.Format.nSamplesPerSec = mix->nSamplesPerSec;
+        f.Format.wBitsPerSample = bytes * 8;
+        f.Format.nBlockAlign = mix->nChannels * bytes;
+        f.Format.nAvgBytesPerSec = mix->nSamplesPerSec * f.Format.nBlockAlign;
+        f.Format.cbSize = sizeof(WAVEFORMATEXTENSIBLE) - sizeof(WAVEFORMATEX);
+        f.Samples.wValidBitsPerSample = f.Format.wBitsPerSample;
+        if (mix->wFormatTag == WAVE_FORMAT_EXTENSIBLE && mix->cbSize >= 22) {
+            f.dwChannelMask = reinterpret_cast<const WAVEFORMATEXTENSIBLE*>(mix)->dwChannelMask;
+        }
+        f.SubFormat = type == SampleType::Float32 ? KSDATAFORMAT_SUBTYPE_IEEE_FLOAT : KSDATAFORMAT_SUBTYPE_PCM;
+        return f;
+    }
+
+    std::wstring friendlyName(IMMDevice* dev) {
+        std::wstring name;
+        ComPtr<IPropertyStore> props;
+        if (SUCCEEDED(dev->OpenPropertyStore(STGM_READ, &props))) {
+            PROPVARIANT varName;
+            PropVariantInit(&varName);
+            if (SUCCEEDED(props->GetValue(PKEY_Device_FriendlyName, &varName)) && varName.pwszVal) {
+                name = varName.pwszVal;
+            }
+            PropVariantClear(&varName);
+        }
+        return name;
+    }
+
+    ComPtr<IMMDeviceEnumerator> createEnumerator() {
+        ComPtr<IMMDeviceEnumerator> enumerator;
+        if (FAILED(CoCreateInstance(__uuidof(MMDeviceEnumerator), nullptr, CLSCTX_ALL, IID_PPV_ARGS(&enumerator)))) return nullptr;
+        return enumerator;
+    }
+
+    ComPtr<IMMDevice> deviceById(const std::wstring& id) {
+        ComPtr<IMMDeviceEnumerator> enumerator = createEnumerator();
+        if (!enumerator) return nullptr;
+        ComPtr<IMMDevice> dev;
+        if (FAILED(enumerator->GetDevice(id.c_str(), &dev))) return nullptr;
+        return dev;
+    }
+
+    std::wstring deviceId(IMMDevice* dev) {
+        LPWSTR id = nullptr;
+        if (FAILED(dev->GetId(&id))) return {};
+        std::wstring result = id;
+        CoTaskMemFree(id);
+        return result;
+    }
+
+    // 某个方向在控制台角色下的默认端点 ID
+    std::wstring defaultDeviceId(IMMDeviceEnumerator* enumerator, EDataFlow flow) {
+        ComPtr<IMMDevice> dev;
+        if (FAILED(enumerator->GetDefaultAudioEndpoint(flow, eConsole, &dev))) return {};
+        return deviceId(dev.Get());
+    }
+
+    // 仍在运行的进程的可执行文件名（不含路径）；进程不存在、已退出或无权查询时为空
+    std::wstring processName(DWORD pid) {
+        HANDLE process = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, pid);
+        if (!process) return {};
+        std::wstring name;
+        DWORD exitCode = 0;
+        wchar_t path[MAX_PATH];
+        DWORD length = MAX_PATH;
+        if (GetExitCodeProcess(process, &exitCode) && exitCode == STILL_ACTIVE && QueryFullProcessImageNameW(process, 0, path, &length)) {
+            name.assign(path, length);
+            const std::size_t slash = name.find_last_of(L"\\/");
+            if (slash != std::wstring::npos) name.erase(0, slash + 1);
+        }
+        CloseHandle(process);
+        return name;
+    }
+
+    // 各 render 端点上当前有音频会话的进程（不含系统声音、已过期的会话与本进程，按首次出现的顺序）
+    std::vector<DWORD> audioSessionProcesses(IMMDeviceEnumerator* enumerator) {
+        std::vector<DWORD> pids;
+        ComPtr<IMMDeviceCollection> collection;
+        if (FAILED(enumerator->EnumAudioEndpoints(eRender, DEVICE_STATE_ACTIVE, &collection))) return pids;
+        const DWORD self = GetCurrentProcessId();
+        UINT count = 0;
+        collection->GetCount(&count);
+        for (UINT i = 0; i < count; ++i) {
+            ComPtr<IMMDevice> dev;
+            ComPtr<IAudioSessionManager2> manager;
+            ComPtr<IAudioSessionEnumerator> sessions;
+            if (FAILED(collection->Item(i, &dev)) ||
+                FAILED(dev->Activate(__uuidof(IAudioSessionManager2), CLSCTX_ALL, nullptr, &manager)) ||
+                FAILED(manager->GetSessionEnumerator(&sessions))) {
+                continue;
+            }
+            int sessionCount = 0;
+            sessions->GetCount(&sessionCount);
+            for (int j = 0; j < sessionCount; ++j) {
+                ComPtr<IAudioSessionControl> control;
+                ComPtr<IAudioSessionControl2> control2;
+                if (FAILED(sessions->GetSession(j, &control)) || FAILED(control.As(&control2))) continue;
+                AudioSessionState state = AudioSessionStateExpired;
+                DWORD pid = 0;
+                if (control2->IsSystemSoundsSession() == S_OK || FAILED(control2->GetState(&state)) ||
+                    state == AudioSessionStateExpired || FAILED(control2->GetProcessId(&pid)) || pid == 0 || pid == self) {
+                    continue;
+                }
+                if (std::find(pids.begin(), pids.end(), pid) == pids.end()) pids.push_back(pid);
+            }
+        }
+        return pids;
+    }
+
+    // ActivateAudioInterfaceAsync 的完成回调：系统要求它是 agile 对象（可在任意线程上调用）
+    class ActivationHandler final : public IActivateAudioInterfaceCompletionHandler, public IAgileObject {
+    public:
+        ActivationHandler() : done(CreateEvent(nullptr, TRUE, FALSE, nullptr)) {}
+
+        ULONG STDMETHODCALLTYPE AddRef() override { return InterlockedIncrement(&refs); }
+
+        ULONG STDMETHODCALLTYPE Release() override {
+            const ULONG count = InterlockedDecrement(&refs);
+            if (count == 0) delete this;
+            return count;
+        }
+
+        HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** object) override {
+            if (riid == __uuidof(IUnknown) || riid == __uuidof(IActivateAudioInterfaceCompletionHandler)) {
+                *object = static_cast<IActivateAudioInterfaceCompletionHandler*>(this);
+            } else if (riid == __uuidof(IAgileObject)) {
+                *object = static_cast<IAgileObject*>(this);
+            } else {
+                *object = nullptr;
+                return E_NOINTERFACE;
+            }
+            AddRef();
+            return S_OK;
+        }
+
+        HRESULT STDMETHODCALLTYPE ActivateCompleted(IActivateAudioInterfaceAsyncOperation* operation) override {
+            HRESULT activateResult = E_FAIL;
+            ComPtr<IUnknown> unknown;
+            HRESULT hr = operation->GetActivateResult(&activateResult, &unknown);
+            if (SUCCEEDED(hr)) hr = activateResult;
+            if (SUCCEEDED(hr)) hr = unknown.As(&client);
+            result = hr;
+            SetEvent(done);
+            return S_OK;
+        }
+
+        // 等待激活完成；超时或失败返回空（超时后回调仍可能到来，对象由异步操作继续持有）
+        ComPtr<IAudioClient> wait(DWORD timeoutMs) {
+            if (!done || WaitForSingleObject(done, timeoutMs) != WAIT_OBJECT_0 || FAILED(result)) return nullptr;
+            return client;
+        }
+
+    private:
+        ~ActivationHandler() {
+            if (done) CloseHandle(done);
+        }
+
+        LONG refs = 1;
+        HANDLE done;
+        // 回调线程写入后置位 done，等待方在 done 之后读取
+        HRESULT result = E_FAIL;
+        ComPtr<IAudioClient> client;
+    };
+
+    // 激活进程 loopback 的 IAudioClient（需要 Windows 10 build 20348 及以上，更早的系统上激活失败）
+    ComPtr<IAudioClient> activateProcessLoopback(DWORD pid, bool excludeTree) {
+        constexpr DWORD kActivateTimeoutMs = 2000;
+        AUDIOCLIENT_ACTIVATION_PARAMS params{};
+        params.ActivationType = AUDIOCLIENT_ACTIVATION_TYPE_PROCESS_LOOPBACK;
+        params.ProcessLoopbackParams.TargetProcessId = pid;
+        params.ProcessLoopbackParams.ProcessLoopbackMode = excludeTree ? PROCESS_LOOPBACK_MODE_EXCLUDE_TARGET_PROCESS_TREE
+                                                                       : PROCESS_LOOPBACK_MODE_INCLUDE_TARGET_PROCESS_TREE;
+        PROPVARIANT activateParams{};
+        activateParams.vt = VT_BLOB;
+        activateParams.blob.cbSize = sizeof(params);
+        activateParams.blob.pBlobData = reinterpret_cast<BYTE*>(&params);
+
+        auto* handler = new ActivationHandler();
+        ComPtr<IActivateAudioInterfaceAsyncOperation> operation;
+        ComPtr<IAudioClient> client;
+        if (SUCCEEDED(ActivateAudioInterfaceAsync(VIRTUAL_AUDIO_DEVICE_PROCESS_LOOPBACK, __uuidof(IAudioClient), &activateParams,
+                                                  handler, &operation))) {
+            client = handler->wait(kActivateTimeoutMs);
+        }
+        handler->Release();
+        return client;
+    }
+
+    // capture / render 流共用的部分：IAudioClient、事件与格式
+    class WasapiStream {
+    public:
+        virtual ~WasapiStream() {
+            if (client) client->Stop();
+            if (event) CloseHandle(event);
+        }
+
+        HANDLE eventHandle() const { return event; }
+
+    protected:
+        // 音频线程中的调用都经过这里：客户端失效时记下来，由引擎重新打开（不在音频线程里打印）
+        bool check(HRESULT hr) {
+            if (hr == AUDCLNT_E_DEVICE_INVALIDATED || hr == AUDCLNT_E_RESOURCES_INVALIDATED || hr == AUDCLNT_E_SERVICE_NOT_RUNNING) {
+                lost.store(true, std::memory_order_relaxed);
+            }
+            return SUCCEEDED(hr);
+        }
+
+        // 以设备 mix format 初始化（event callback）；低延迟模式依次尝试独占、IAudioClient3、普通共享
+        bool initialize(IMMDevice* dev, DWORD streamFlags, const StreamConfig& config) {
+            if (!activate(dev)) return false;
+
+            WAVEFORMATEX* mixFormat = nullptr;
+            HRESULT hr = client->GetMixFormat(&mixFormat);
+            if (FAILED(hr) || !mixFormat) return false;
+            SampleType sample = SampleType::Float32;
+            const bool usable = sampleTypeOf(mixFormat, sample);
+            fmt.sampleRate = mixFormat->nSamplesPerSec;
+            fmt.channels = mixFormat->nChannels;
+            fmt.sample = sample;
+
+            bool ok = false;
+            if (usable) {
+                const bool loopback = (streamFlags & AUDCLNT_STREAMFLAGS_LOOPBACK) != 0;
+                StreamConfig sharedConfig = config;
+                if (config.lowLatency && loopback) {
+                    // loopback 不支持独占与 IAudioClient3，跟随 render 引擎周期；缓冲取最小值
+                    sharedConfig.bufferMs = 0;
+                } else if (config.lowLatency) {
+                    // 上次在独占模式下协商到的样本格式仍与 mix format 一致时先直接试它，省去逐个格式的试探。
+                    // 缓存只决定第一次尝试：失败时、或上次的模式较弱（例如当时不允许独占）时照常按
+                    // 独占 -> IAudioClient3 共享 -> 普通共享 的顺序协商，不会因此跳过更强的模式
+                    const bool cachedExclusive = config.allowExclusive && config.cachedMode == StreamMode::Exclusive &&
+                                                 config.cachedFormat.sampleRate == fmt.sampleRate &&
+                                                 config.cachedFormat.channels == fmt.channels;
+                    if (cachedExclusive) {
+                        const WAVEFORMATEXTENSIBLE candidate = formatWithSample(mixFormat, config.cachedFormat.sample);
+                        ok = initializeExclusive(dev, &candidate.Format);
+                        if (ok) fmt.sample = config.cachedFormat.sample;
+                    }
+                    if (!ok && config.allowExclusive) ok = initializeExclusiveAnyFormat(dev, mixFormat);
+                    if (!ok) ok = initializeLowLatencyShared(dev, mixFormat);
+                }
+                if (!ok) {
+                    ok = initializeShared(streamFlags, sharedConfig, mixFormat);
+                }
+            }
+            CoTaskMemFree(mixFormat);
+            if (!usable) {
+                std::cerr << "Unsupported mix format (float32 or 16/24/32-bit PCM required)" << std::endl;
+                return false;
+            }
+            if (!ok) return false;
+            if (FAILED(client->GetBufferSize(&deviceBufferFrames))) return false;
+            // 设备不是 float32 时读写都经过转换缓冲（按整个设备缓冲预先分配）
+            converter = SampleConverter(fmt.sample, fmt.channels, deviceBufferFrames, config.dither);
+            return attachEvent();
+        }
+
+        // 进程 loopback：客户端已经激活，没有 mix format 可取，按请求的采样率与声道数以 float32 初始化（由系统转换）
+        bool initializeProcessLoopback(ComPtr<IAudioClient> activated, const StreamFormat& format, const StreamConfig& config) {
+            client = std::move(activated);
+            fmt.sampleRate = format.sampleRate > 0 ? format.sampleRate : 48000;
+            fmt.channels = format.channels > 0 ? format.channels : 2;
+            fmt.sample = SampleType::Float32;
+
+            WAVEFORMATEX waveFormat{};
+            waveFormat.wFormatTag = WAVE_FORMAT_IEEE_FLOAT;
+            waveFormat.nChannels = static_cast<WORD>(fmt.channels);
+            waveFormat.nSamplesPerSec = fmt.sampleRate;
+            waveFormat.wBitsPerSample = 32;
+            waveFormat.nBlockAlign = static_cast<WORD>(waveFormat.nChannels * 4);
+            waveFormat.nAvgBytesPerSec = waveFormat.nSamplesPerSec * waveFormat.nBlockAlign;
+            // 与端点 loopback 一样：低延迟模式下缓冲取最小值，跟随 render 引擎周期
+            const REFERENCE_TIME hnsBufferDuration = config.lowLatency ? 0 : 10000 * static_cast<REFERENCE_TIME>(config.bufferMs);
+            HRESULT hr = client->Initialize(AUDCLNT_SHAREMODE_SHARED,
+                                            AUDCLNT_STREAMFLAGS_LOOPBACK | AUDCLNT_STREAMFLAGS_EVENTCALLBACK |
+                                                AUDCLNT_STREAMFLAGS_AUTOCONVERTPCM | AUDCLNT_STREAMFLAGS_SRC_DEFAULT_QUALITY,
+                                            hnsBufferDuration, 0, &waveFormat, nullptr);
+            if (FAILED(hr)) return false;
+            streamMode = StreamMode::Shared;
+            if (FAILED(client->GetBufferSize(&deviceBufferFrames))) return false;
+            // 进程 loopback 的客户端不一定提供设备周期，取不到时按共享模式的 10 ms 计
+            REFERENCE_TIME defaultPeriod = 0, minimumPeriod = 0;
+            devicePeriodFrames = SUCCEEDED(client->GetDevicePeriod(&defaultPeriod, &minimumPeriod)) && defaultPeriod > 0
+                                     ? framesFor(defaultPeriod)
+                                     : fmt.sampleRate / 100;
+            converter = SampleConverter(fmt.sample, fmt.channels, deviceBufferFrames, config.dither);
+            return attachEvent();
+        }
+
+        ComPtr<IAudioClient> client;
+        HANDLE event = nullptr;
+        StreamFormat fmt;
+        UINT32 deviceBufferFrames = 0;
+        UINT32 devicePeriodFrames = 0;
+        StreamMode streamMode = StreamMode::Shared;
+        std::atomic<bool> lost{ false };
+        SampleConverter converter;
+
+    private:
+        bool attachEvent() {
+            event = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+            if (!event) return false;
+            return SUCCEEDED(client->SetEventHandle(event));
+        }
+
+        // IAudioClient 初始化失败后不能再次 Initialize，需要重新激活
+        bool activate(IMMDevice* dev) {
+            client.Reset();
+            return SUCCEEDED(dev->Activate(__uuidof(IAudioClient), CLSCTX_ALL, nullptr, &client));
+        }
+
+        UINT32 framesFor(REFERENCE_TIME hns) const {
+            return static_cast<UINT32>((static_cast<double>(hns) * fmt.sampleRate) / 10000000.0 + 0.5);
+        }
+
+        bool initializeShared(DWORD streamFlags, const StreamConfig& config, const WAVEFORMATEX* format) {
+            streamMode = StreamMode::Shared;
+            REFERENCE_TIME hnsBufferDuration = 10000 * static_cast<REFERENCE_TIME>(config.bufferMs); // ms -> 100-ns units
+            HRESULT hr = client->Initialize(AUDCLNT_SHAREMODE_SHARED, streamFlags | AUDCLNT_STREAMFLAGS_EVENTCALLBACK,
+                                            hnsBufferDuration, 0, format, nullptr);
+            if (FAILED(hr)) return false;
+            REFERENCE_TIME defaultPeriod = 0, minimumPeriod = 0;
+            client->GetDevicePeriod(&defaultPeriod, &minimumPeriod);
+            devicePeriodFrames = framesFor(defaultPeriod);
+            return true;
+        }
+
+        // 共享模式下使用音频引擎支持的最小周期（Windows 10 起的 IAudioClient3）
+        bool initializeLowLatencyShared(IMMDevice* dev, const WAVEFORMATEX* format) {
+            ComPtr<IAudioClient3> client3;
+            if (FAILED(client.As(&client3))) return false;
+            UINT32 defaultPeriod = 0, fundamentalPeriod = 0, minPeriod = 0, maxPeriod = 0;
+            HRESULT hr = client3->GetSharedModeEnginePeriod(format, &defaultPeriod, &fundamentalPeriod, &minPeriod, &maxPeriod);
+            if (FAILED(hr) || minPeriod == 0) return false;
+            hr = client3->InitializeSharedAudioStream(AUDCLNT_STREAMFLAGS_EVENTCALLBACK, minPeriod, format, nullptr);
+            if (FAILED(hr)) {
+                activate(dev);
+                return false;
+            }
+            devicePeriodFrames = minPeriod;
+            streamMode = StreamMode::SharedLowLatency;
+            return true;
+        }
+
+        // 独占模式直接使用设备格式：先试 mix format，再按 float32、32 / 24 / 16 位整数依次尝试
+        bool initializeExclusiveAnyFormat(IMMDevice* dev, const WAVEFORMATEX* mixFormat) {
+            if (initializeExclusive(dev, mixFormat)) return true;
+            for (SampleType type : { SampleType::Float32, SampleType::Int32, SampleType::Int24, SampleType::Int16 }) {
+                if (type == fmt.sample) continue;
+                const WAVEFORMATEXTENSIBLE candidate = formatWithSample(mixFormat, type);
+                if (initializeExclusive(dev, &candidate.Format)) {
+                    fmt.sample = type;
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        // 独占模式（仅 render）：周期与缓冲都取设备最小周期
+        bool initializeExclusive(IMMDevice* dev, const WAVEFORMATEX* format) {
+            if (client->IsFormatSupported(AUDCLNT_SHAREMODE_EXCLUSIVE, format, nullptr) != S_OK) return false;
+            REFERENCE_TIME defaultPeriod = 0, minimumPeriod = 0;
+            if (FAILED(client->GetDevicePeriod(&defaultPeriod, &minimumPeriod))) return false;
+
+            HRESULT hr = client->Initialize(AUDCLNT_SHAREMODE_EXCLUSIVE, AUDCLNT_STREAMFLAGS_EVENTCALLBACK,
+                                            minimumPeriod, minimumPeriod, format, nullptr);
+            if (hr == AUDCLNT_E_BUFFER_SIZE_NOT_ALIGNED) {
+                // 按设备要求的对齐帧数重新计算周期后重试
+                UINT32 alignedFrames = 0;
+                client->GetBufferSize(&alignedFrames);
+                minimumPeriod = static_cast<REFERENCE_TIME>(10000000.0 * alignedFrames / fmt.sampleRate + 0.5);
+                if (!activate(dev)) return false;
+                hr = client->Initialize(AUDCLNT_SHAREMODE_EXCLUSIVE, AUDCLNT_STREAMFLAGS_EVENTCALLBACK,
+                                        minimumPeriod, minimumPeriod, format, nullptr);
+            }
+            if (FAILED(hr)) {
+                activate(dev);
+                return false;
+            }
+            devicePeriodFrames = framesFor(minimumPeriod);
+            streamMode = StreamMode::Exclusive;
+            return true;
+        }
+    };
+
+    class WasapiCaptureStream final : public CaptureStream, public WasapiStream {
+    public:
+        bool open(IMMDevice* dev, const StreamConfig& config) {
+            if (!initialize(dev, AUDCLNT_STREAMFLAGS_LOOPBACK, config)) return false;
+            return SUCCEEDED(client->GetService(IID_PPV_ARGS(&captureClient)));
+        }
+
+        bool openProcess(ComPtr<IAudioClient> activated, const StreamFormat& format, const StreamConfig& config) {
+            if (!initializeProcessLoopback(std::move(activated), format, config)) return false;
+            return SUCCEEDED(client->GetService(IID_PPV_ARGS(&captureClient)));
+        }
+
+        StreamFormat format() const override { return fmt; }
+        std::uint32_t bufferFrames() const override { return deviceBufferFrames; }
+        std::uint32_t periodFrames() const override { return devicePeriodFrames; }
+        StreamMode mode() const override { return streamMode; }
+        bool start() override { return SUCCEEDED(client->Start()); }
+        void stop() override { client->Stop(); }
+        void signal() override { SetEvent(event); }
+        bool invalidated() const override { return lost.load(std::memory_order_relaxed); }
+
+        bool readPacket(CapturePacket& packet) override {
+            packet = CapturePacket{};
+            UINT32 packetLength = 0;
+            if (!check(captureClient->GetNextPacketSize(&packetLength))) return false;
+            if (packetLength == 0) return true;
+
+            BYTE* data = nullptr;
+            UINT32 framesAvailable = 0;
+            DWORD flags = 0;
+            UINT64 position = 0;
+            UINT64 qpcPosition = 0;
+            if (!check(captureClient->GetBuffer(&data, &framesAvailable, &flags, &position, &qpcPosition))) return false;
+            packet.data = converter.decode(data, framesAvailable);
+            packet.frames = framesAvailable;
+            packet.silent = (flags & AUDCLNT_BUFFERFLAGS_SILENT) != 0;
+            packet.discontinuity = (flags & AUDCLNT_BUFFERFLAGS_DATA_DISCONTINUITY) != 0;
+            packet.devicePosition = position;
+            packet.timestampNs = qpcPosition * 100; // 已换算为 100 ns 单位
+            return true;
+        }
+
+        void releasePacket(std::uint32_t frames) override {
+            captureClient->ReleaseBuffer(frames);
+        }
+
+    private:
+        ComPtr<IAudioCaptureClient> captureClient;
+    };
+
+    class WasapiRenderStream final : public RenderStream, public WasapiStream {
+    public:
+        bool open(IMMDevice* dev, const StreamConfig& config) {
+            if (!initialize(dev, 0, config)) return false;
+            return SUCCEEDED(client->GetService(IID_PPV_ARGS(&renderClient)));
+        }
+
+        StreamFormat format() const override { return fmt; }
+        std::uint32_t bufferFrames() const override { return deviceBufferFrames; }
+        std::uint32_t periodFrames() const override { return devicePeriodFrames; }
+        StreamMode mode() const override { return streamMode; }
+        bool start() override { return SUCCEEDED(client->Start()); }
+        void stop() override { client->Stop(); }
+        void signal() override { SetEvent(event); }
+        bool invalidated() const override { return lost.load(std::memory_order_relaxed); }
+
+        bool padding(std::uint32_t& frames) override {
+            UINT32 value = 0;
+            if (!check(client->GetCurrentPadding(&value))) return false;
+            frames = value;
+            return true;
+        }
+
+        float* acquire(std::uint32_t frames) override {
+            BYTE* buf = nullptr;
+            if (!check(renderClient->GetBuffer(frames, &buf))) return nullptr;
+            return converter.renderBuffer(buf, frames);
+        }
+
+        bool commit(std::uint32_t frames) override {
+            converter.encode(frames);
+            return check(renderClient->ReleaseBuffer(frames, 0));
+        }
+
+    private:
+        ComPtr<IAudioRenderClient> renderClient;
+    };
+
+    // MMCSS 句柄按线程保存
+    thread_local HANDLE mmHandle = nullptr;
+}
+
+WasapiBackend::WasapiBackend() {
+    comInitialized = SUCCEEDED(CoInitializeEx(nullptr, COINIT_MULTITHREADED));
+    LARGE_INTEGER freq;
+    QueryPerformanceFrequency(&freq);
+    qpcFrequency = freq.QuadPart;
+}
+
+WasapiBackend::~WasapiBackend() {
+    setDeviceChangeCallback(nullptr);
+    if (comInitialized) CoUninitialize();
+}
+
+std::vector<DeviceInfo> WasapiBackend::enumerate() {
+    std::vector<DeviceInfo> devices;
+    ComPtr<IMMDeviceEnumerator> enumerator = createEnumerator();
+    if (!enumerator) return devices;
+
+    // render 设备既是播放目标，也可以作为 loopback 源；capture 为物理输入设备
+    for (EDataFlow flow : { eRender, eCapture }) {
+        ComPtr<IMMDeviceCollection> collection;
+        if (FAILED(enumerator->EnumAudioEndpoints(flow, DEVICE_STATE_ACTIVE, &collection))) continue;
+        const std::wstring defaultId = defaultDeviceId(enumerator.Get(), flow);
+        UINT count = 0;
+        collection->GetCount(&count);
+        for (UINT i = 0; i < count; ++i) {
+            ComPtr<IMMDevice> dev;
+            if (FAILED(collection->Item(i, &dev))) continue;
+            DeviceInfo info;
+            info.id = deviceId(dev.Get());
+            if (info.id.empty()) continue;
+            info.name = friendlyName(dev.Get());
+            info.isRender = flow == eRender;
+            info.isDefault = info.id == defaultId;
+            if (!info.name.empty()) devices.push_back(std::move(info));
+        }
+    }
+
+    // 当前有音频会话的进程作为进程 loopback 来源（进程的出现与退出没有通知，手动刷新时重新枚举）
+    for (const DWORD pid : audioSessionProcesses(enumerator.Get())) {
+        DeviceInfo info;
+        info.name = processName(pid);
+        if (info.name.empty()) continue;
+        info.id = processLoopbackId(pid, false);
+        info.isRender = false;
+        info.processId = pid;
+        devices.push_back(std::move(info));
+    }
+    return devices;
+}
+
+bool WasapiBackend::describe(const std::wstring& id, DeviceInfo& info) {
+    std::uint32_t processId = 0;
+    bool excludeTree = false;
+    if (parseProcessLoopbackId(id, processId, excludeTree)) {
+        // 进程仍在运行即可：还没有音频会话的进程同样可以捕获，之后开始播放的声音都会进来
+        const std::wstring name = processName(processId);
+        if (name.empty()) return false;
+        info = DeviceInfo{ id, name, false, false, processId, excludeTree };
+        return true;
+    }
+
+    ComPtr<IMMDeviceEnumerator> enumerator = createEnumerator();
+    if (!enumerator) return false;
+    ComPtr<IMMDevice> dev;
+    if (FAILED(enumerator->GetDevice(id.c_str(), &dev))) return false;
+    DWORD state = 0;
+    if (FAILED(dev->GetState(&state)) || state != DEVICE_STATE_ACTIVE) return false;
+    ComPtr<IMMEndpoint> endpoint;
+    EDataFlow flow = eRender;
+    if (FAILED(dev.As(&endpoint)) || FAILED(endpoint->GetDataFlow(&flow))) return false;
+
+    info.id = id;
+    info.name = friendlyName(dev.Get());
+    info.isRender = flow == eRender;
+    info.isDefault = defaultDeviceId(enumerator.Get(), flow) == id;
+    return !info.name.empty();
+}
+
+// IMMNotificationClient：把端点变化转成 DeviceChange 交给回调（在系统的通知线程上调用）
+class WasapiBackend::DeviceNotifier final : public IMMNotificationClient {
+public:
+    DeviceNotifier(ComPtr<IMMDeviceEnumerator> enumerator, DeviceChangeCallback callback)
+        : enumerator(std::move(enumerator)), callback(std::move(callback)) {
+    }
+
+    bool registerClient() { return SUCCEEDED(enumerator->RegisterEndpointNotificationCallback(this)); }
+
+    // 注销并等待正在执行的回调结束，之后不会再回调
+    void unregisterClient() {
+        enumerator->UnregisterEndpointNotificationCallback(this);
+        std::lock_guard<std::mutex> lock(mutex);
+        callback = nullptr;
+    }
+
+    ULONG STDMETHODCALLTYPE AddRef() override { return InterlockedIncrement(&refs); }
+
+    ULONG STDMETHODCALLTYPE Release() override {
+        const ULONG count = InterlockedDecrement(&refs);
+        if (count == 0) delete this;
+        return count;
+    }
+
+    HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** object) override {
+        if (riid == __uuidof(IUnknown) || riid == __uuidof(IMMNotificationClient)) {
+            *object = static_cast<IMMNotificationClient*>(this);
+            AddRef();
+            return S_OK;
+        }
+        *object = nullptr;
+        return E_NOINTERFACE;
+    }
+
+    HRESULT STDMETHODCALLTYPE OnDeviceStateChanged(LPCWSTR id, DWORD state) override {
+        notify(state == DEVICE_STATE_ACTIVE ? DeviceChange::Type::Added : DeviceChange::Type::Removed, id, true);
+        return S_OK;
+    }
+
+    HRESULT STDMETHODCALLTYPE OnDeviceAdded(LPCWSTR id) override {
+        notify(DeviceChange::Type::Added, id, true);
+        return S_OK;
+    }
+
+    HRESULT STDMETHODCALLTYPE OnDeviceRemoved(LPCWSTR id) override {
+        notify(DeviceChange::Type::Removed, id, true);
+        return S_OK;
+    }
+
+    HRESULT STDMETHODCALLTYPE OnDefaultDeviceChanged(EDataFlow flow, ERole role, LPCWSTR id) override {
+        // 只跟踪控制台角色，与 enumerate 中的默认端点一致
+        if (role == eConsole && flow != eAll) notify(DeviceChange::Type::DefaultChanged, id, flow == eRender);
+        return S_OK;
+    }
+
+    HRESULT STDMETHODCALLTYPE OnPropertyValueChanged(LPCWSTR id, const PROPERTYKEY key) override {
+        // 友好名称变化时让接收方重新查询该端点
+        if (IsEqualGUID(key.fmtid, PKEY_Device_FriendlyName.fmtid) && key.pid == PKEY_Device_FriendlyName.pid) {
+            notify(DeviceChange::Type::Added, id, true);
+        }
+        return S_OK;
+    }
+
+private:
+    ~DeviceNotifier() = default;
+
+    void notify(DeviceChange::Type type, LPCWSTR id, bool isRender) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (callback) callback(DeviceChange{ type, id ? id : L"", isRender });
+    }
+
+    LONG refs = 1;
+    ComPtr<IMMDeviceEnumerator> enumerator;
+    std::mutex mutex;
+    DeviceChangeCallback callback;
+};
+
+void WasapiBackend::setDeviceChangeCallback(DeviceChangeCallback callback) {
+    if (notifier) {
+        notifier->unregisterClient();
+        notifier->Release();
+        notifier = nullptr;
+    }
+    if (!callback) return;
+
+    ComPtr<IMMDeviceEnumerator> enumerator = createEnumerator();
+    if (!enumerator) return;
+    auto* client = new DeviceNotifier(std::move(enumerator), std::move(callback));
+    if (!client->registerClient()) {
+        client->Release();
+        return;
+    }
+    notifier = client;
+}
+
+std::unique_ptr<CaptureStream> WasapiBackend::openLoopback(const std::wstring& deviceId, const StreamConfig& config) {
+    ComPtr<IMMDevice> dev = deviceById(deviceId);
+    if (!dev) return nullptr;
+    auto stream = std::make_unique<WasapiCaptureStream>();
+    if (!stream->open(dev.Get(), config)) return nullptr;
+    return stream;
+}
+
+std::unique_ptr<CaptureStream> WasapiBackend::openProcessLoopback(std::uint32_t processId, bool excludeTree, const StreamFormat& format,
+                                                                  const StreamConfig& config) {
+    ComPtr<IAudioClient> client = activateProcessLoopback(processId, excludeTree);
+    if (!client) return nullptr;
+    auto stream = std::make_unique<WasapiCaptureStream>();
+    if (!stream->openProcess(std::move(client), format, config)) return nullptr;
+    return stream;
+}
+
+std::unique_ptr<RenderStream> WasapiBackend::openRender(const std::wstring& deviceId, const StreamConfig& config) {
+    ComPtr<IMMDevice> dev = deviceById(deviceId);
+    if (!dev) return nullptr;
+    auto stream = std::make_unique<WasapiRenderStream>();
+    if (!stream->open(dev.Get(), config)) return nullptr;
+    return stream;
+}
+
+int WasapiBackend::waitAny(AudioStream* const* streams, std::size_t count, std::uint32_t timeoutMs) {
+    rtsan::check("blocking wait");
+    // WaitForMultipleObjects 最多等待 MAXIMUM_WAIT_OBJECTS 个事件
+    HANDLE handles[MAXIMUM_WAIT_OBJECTS];
+    if (count == 0 || count > MAXIMUM_WAIT_OBJECTS) return kWaitFailed;
+    for (std::size_t i = 0; i < count; ++i) {
+        auto* ws = dynamic_cast<WasapiStream*>(streams[i]);
+        if (!ws) return kWaitFailed;
+        handles[i] = ws->eventHandle();
+    }
+
+    DWORD waitResult = WaitForMultipleObjects(static_cast<DWORD>(count), handles, FALSE, timeoutMs);
+    if (waitResult == WAIT_TIMEOUT) return kWaitTimeout;
+    if (waitResult >= WAIT_OBJECT_0 + count) return kWaitFailed;
+    return static_cast<int>(waitResult - WAIT_OBJECT_0);
+}
+
+std::uint64_t WasapiBackend::nowNs() const {
+    LARGE_INTEGER counter;
+    QueryPerformanceCounter(&counter);
+    // 分成整秒与余数两部分换算，避免乘法溢出
+    const auto ticks = static_cast<std::uint64_t>(counter.QuadPart);
+    const auto freq = static_cast<std::uint64_t>(qpcFrequency);
+    return (ticks / freq) * 1000000000ull + (ticks % freq) * 1000000000ull / freq;
+}
+
+void WasapiBackend::enterAudioThread() {
+    DWORD mmcssTaskIndex = 0;
+    mmHandle = AvSetMmThreadCharacteristicsA("Pro Audio", &mmcssTaskIndex);
+    if (!mmHandle) {
+        // 备用策略：设置线程为实时优先
+        SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL);
+    }
+}
+
+void WasapiBackend::leaveAudioThread() {
+    if (mmHandle) AvRevertMmThreadCharacteristics(mmHandle);
+    else SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_NORMAL);
+    mmHandle = nullptr;
+}
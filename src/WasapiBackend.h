@@ -0,0 +1,37 @@
+#pragma once
+
+#include "AudioBackend.h"
+
+// Windows WASAPI 后端（共享模式 + 事件驱动）
+class WasapiBackend final : public AudioBackend {
+public:
+    WasapiBackend();
+    ~WasapiBackend() override;
+
+    // 端点之外还列出当前有音频会话的进程（IAudioSessionManager2）
+    std::vector<DeviceInfo> enumerate() override;
+    bool describe(const std::wstring &deviceId, DeviceInfo &info) override;
+    // 经 IMMNotificationClient 接收端点增删、状态与默认设备变化
+    void setDeviceChangeCallback(DeviceChangeCallback callback) override;
+
+    std::unique_ptr<CaptureStream> openLoopback(const std::wstring &deviceId, const StreamConfig &config) override;
+    std::unique_ptr<RenderStream> openRender(const std::wstring &deviceId, const StreamConfig &config) override;
+    // ActivateAudioInterfaceAsync + AUDIOCLIENT_ACTIVATION_TYPE_PROCESS_LOOPBACK（Windows 10 build 20348 起）
+    std::unique_ptr<CaptureStream> openProcessLoopback(std::uint32_t processId, bool excludeTree, const StreamFormat &format,
+                                                       const StreamConfig &config) override;
+
+    int waitAny(AudioStream *const *streams, std::size_t count, std::uint32_t timeoutMs) override;
+    // QueryPerformanceCounter 时基，与 IAudioCaptureClient::GetBuffer 返回的 QPC 位置一致
+    std::uint64_t nowNs() const override;
+
+    // 提升线程优先级（MMCSS "Pro Audio"）
+    void enterAudioThread() override;
+    void leaveAudioThread() override;
+
+private:
+    class DeviceNotifier;
+
+    bool comInitialized = false;
+    DeviceNotifier *notifier = nullptr;
+    std::int64_t qpcFrequency = 0;
+};
@@ -0,0 +1,139 @@
+#include "WavFile.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+namespace {
+    constexpr std::uint16_t kFormatPcm = 1;
+    constexpr std::uint16_t kFormatFloat = 3;
+    constexpr std::uint16_t kFormatExtensible = 0xFFFE;
+
+    std::uint32_t readLe32(const unsigned char *p) {
+        return p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<std::uint32_t>(p[3]) << 24);
+    }
+
+    std::uint16_t readLe16(const unsigned char *p) {
+        return static_cast<std::uint16_t>(p[0] | (p[1] << 8));
+    }
+
+    void putLe32(unsigned char *p, std::uint32_t v) {
+        p[0] = v & 0xff; p[1] = (v >> 8) & 0xff; p[2] = (v >> 16) & 0xff; p[3] = (v >> 24) & 0xff;
+    }
+
+    void putLe16(unsigned char *p, std::uint16_t v) {
+        p[0] = v & 0xff; p[1] = (v >> 8) & 0xff;
+    }
+
+    FILE *openFile(const std::filesystem::path &path, const char *mode) {
+#ifdef _WIN32
+        std::wstring wmode(mode, mode + std::strlen(mode));
+        return _wfopen(path.c_str(), wmode.c_str());
+#else
+        return std::fopen(path.c_str(), mode);
+#endif
+    }
+}
+
+bool readWavFile(const std::filesystem::path &path, std::vector<float> &samples, StreamFormat &format) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return false;
+    std::vector<unsigned char> bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    if (bytes.size() < 12 || std::memcmp(bytes.data(), "RIFF", 4) != 0 || std::memcmp(bytes.data() + 8, "WAVE", 4) != 0) {
+        return false;
+    }
+
+    std::uint16_t tag = 0, channels = 0, bits = 0;
+    std::uint32_t rate = 0;
+    const unsigned char *data = nullptr;
+    std::size_t dataSize = 0;
+
+    // 遍历 chunk，只关心 fmt 与 data
+    std::size_t pos = 12;
+    while (pos + 8 <= bytes.size()) {
+        const unsigned char *chunk = bytes.data() + pos;
+        const std::uint32_t size = readLe32(chunk + 4);
+        const std::size_t bodySize = std::min<std::size_t>(size, bytes.size() - pos - 8);
+        if (std::memcmp(chunk, "fmt ", 4) == 0 && bodySize >= 16) {
+            tag = readLe16(chunk + 8);
+            channels = readLe16(chunk + 10);
+            rate = readLe32(chunk + 12);
+            bits = readLe16(chunk + 22);
+            if (tag == kFormatExtensible && bodySize >= 26) tag = readLe16(chunk + 8 + 24); // SubFormat 的前两个字节
+        } else if (std::memcmp(chunk, "data", 4) == 0) {
+            data = chunk + 8;
+            dataSize = bodySize;
+        }
+        pos += 8 + size + (size & 1);
+    }
+    if (!data || channels == 0 || rate == 0) return false;
+
+    const std::size_t bytesPerSample = bits / 8;
+    if (bytesPerSample == 0) return false;
+    const std::size_t count = dataSize / bytesPerSample;
+    samples.resize(count - count % channels);
+
+    for (std::size_t i = 0; i < samples.size(); ++i) {
+        const unsigned char *p = data + i * bytesPerSample;
+        if (tag == kFormatFloat && bits == 32) {
+            std::memcpy(&samples[i], p, 4);
+        } else if (tag == kFormatPcm && bits == 16) {
+            samples[i] = static_cast<std::int16_t>(readLe16(p)) / 32768.0f;
+        } else if (tag == kFormatPcm && bits == 24) {
+            const std::int32_t v = static_cast<std::int32_t>((p[0] << 8) | (p[1] << 16) | (static_cast<std::uint32_t>(p[2]) << 24)) >> 8;
+            samples[i] = v / 8388608.0f;
+        } else if (tag == kFormatPcm && bits == 32) {
+            samples[i] = static_cast<float>(static_cast<std::int32_t>(readLe32(p)) / 2147483648.0);
+        } else {
+            return false;
+        }
+    }
+
+    format.sampleRate = rate;
+    format.channels = channels;
+    return true;
+}
+
+WavWriter::~WavWriter() {
+    close();
+}
+
+bool WavWriter::open(const std::filesystem::path &path, const StreamFormat &format) {
+    close();
+    file = openFile(path, "wb");
+    if (!file) return false;
+    fmt = format;
+    dataBytes = 0;
+    // 先写占位头，close 时回填
+    unsigned char header[44] = {};
+    std::fwrite(header, 1, sizeof(header), file);
+    return true;
+}
+
+void WavWriter::write(const float *frames, std::size_t frameCount) {
+    if (!file) return;
+    dataBytes += std::fwrite(frames, sizeof(float), frameCount * fmt.channels, file) * sizeof(float);
+}
+
+void WavWriter::close() {
+    if (!file) return;
+    const std::uint32_t dataSize = static_cast<std::uint32_t>(std::min<std::uint64_t>(dataBytes, 0xFFFFFFFFull - 36));
+    unsigned char h[44];
+    std::memcpy(h, "RIFF", 4);
+    putLe32(h + 4, 36 + dataSize);
+    std::memcpy(h + 8, "WAVEfmt ", 8);
+    putLe32(h + 16, 16);
+    putLe16(h + 20, kFormatFloat);
+    putLe16(h + 22, static_cast<std::uint16_t>(fmt.channels));
+    putLe32(h + 24, fmt.sampleRate);
+    putLe32(h + 28, fmt.sampleRate * fmt.channels * 4);
+    putLe16(h + 32, static_cast<std::uint16_t>(fmt.channels * 4));
+    putLe16(h + 34, 32);
+    std::memcpy(h + 36, "data", 4);
+    putLe32(h + 40, dataSize);
+    std::fseek(file, 0, SEEK_SET);
+    std::fwrite(h, 1, sizeof(h), file);
+    std::fclose(file);
+    file = nullptr;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <vector>
+
+#include "AudioBackend.h"
+
+// 读取整个 WAV 文件为交错 float32（支持 PCM 16/24/32 位与 IEEE float32）
+bool readWavFile(const std::filesystem::path &path, std::vector<float> &samples, StreamFormat &format);
+
+// 流式写入 float32 WAV，close() 时回填长度
+class WavWriter {
+public:
+    WavWriter() = default;
+    ~WavWriter();
+
+    WavWriter(const WavWriter &) = delete;
+    WavWriter &operator=(const WavWriter &) = delete;
+
+    bool open(const std::filesystem::path &path, const StreamFormat &format);
+    bool isOpen() const { return file != nullptr; }
+    void write(const float *frames, std::size_t frameCount);
+    void close();
+
+private:
+    std::FILE *file = nullptr;
+    StreamFormat fmt;
+    std::uint64_t dataBytes = 0;
+};
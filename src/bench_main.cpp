@@ -0,0 +1,755 @@
+// 基准与回归：逐个处理环节的微基准（ring、格式转换、混音与路由矩阵、重采样、电平表、丢包补偿、插入效果），
+// 加上用离散事件虚拟时钟跑完整引擎的端到端场景（可回放录下的包到达时刻），结果写成 JSON，
+// 并可与上一次构建的结果对比，变慢超过容差时以非零退出码结束。不依赖 Qt 与外部服务
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+#include "AudioEngine.h"
+#include "Concealer.h"
+#include "CpuFeatures.h"
+#include "FanoutRing.h"
+#include "InsertChain.h"
+#include "Json.h"
+#include "LevelMeter.h"
+#include "Mixer.h"
+#include "Resampler.h"
+#include "RoutingMatrix.h"
+#include "SampleConvert.h"
+#include "SpscRing.h"
+#include "Utf8.h"
+#include "VirtualBackend.h"
+
+namespace {
+    enum ExitCode : int {
+        kExitOk = 0,
+        kExitRegression = 1,    // 与基线相比有项目变慢超过容差
+        kExitUsage = 64,
+        kExitSoftware = 70,     // 场景启动失败
+        kExitIoError = 74,      // 结果或基线文件无法读写
+    };
+
+    // 微基准统一按一个 10 ms 周期（48 kHz 立体声）处理
+    constexpr std::uint32_t kRate = 48000;
+    constexpr std::size_t kChannels = 2;
+    constexpr std::size_t kFrames = 480;
+    // 每项测几轮，取中位数与最小值
+    constexpr int kRepeats = 5;
+
+    void printUsage() {
+        std::cerr << "用法: AudioRepeaterBench [--filter 子串] [--min-time-ms N] [--scenario-s N] [--trace 文件]\n"
+                     "                          [--out 文件] [--baseline 文件] [--tolerance 比例] [--no-micro] [--no-scenarios]\n"
+                     "  --filter        只运行名称含该子串的项目\n"
+                     "  --min-time-ms   每个微基准的最短测量时间（默认 200）\n"
+                     "  --scenario-s    每个端到端场景的音频时长（虚拟时间，默认 20 秒）\n"
+                     "  --trace         追加一个场景：按该文件回放来源的包到达时刻（格式见 loadArrivalTrace）\n"
+                     "  --out           结果 JSON 写到文件（默认写到标准输出）\n"
+                     "  --baseline      与之前的结果对比，变慢超过容差（默认 0.1）时退出码为 1\n";
+    }
+
+    std::uint64_t processCpuNs() {
+#ifdef _WIN32
+        FILETIME creation, exit, kernel, user;
+        if (!GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user)) return 0;
+        const auto ticks = [](const FILETIME &t) { return (std::uint64_t(t.dwHighDateTime) << 32) | t.dwLowDateTime; };
+        return (ticks(kernel) + ticks(user)) * 100;
+#else
+        timespec ts{};
+        clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+        return std::uint64_t(ts.tv_sec) * 1000000000ull + std::uint64_t(ts.tv_nsec);
+#endif
+    }
+
+    // 防止被测代码的结果被优化掉
+    volatile float sink = 0.0f;
+
+    // 测试信号：两个声道各一个正弦，幅度不到满刻度
+    std::vector<float> testSignal(std::size_t frames, std::size_t channels, std::uint32_t rate = kRate) {
+        std::vector<float> signal(frames * channels);
+        for (std::size_t i = 0; i < frames; ++i) {
+            for (std::size_t c = 0; c < channels; ++c) {
+                signal[i * channels + c] = 0.5f * static_cast<float>(std::sin(2.0 * 3.14159265358979323846 * (220.0 + 110.0 * c) * i / rate));
+            }
+        }
+        return signal;
+    }
+
+    // ---- 微基准 ----
+
+    struct BenchResult {
+        std::string name;
+        std::uint64_t iterations = 0;   // 每轮的迭代次数
+        double nsPerOp = 0.0;           // 各轮的中位数
+        double nsMinPerOp = 0.0;
+        std::size_t framesPerOp = 0;
+    };
+
+    class BenchRunner {
+    public:
+        BenchRunner(std::string filter, double minTimeMs) : filter(std::move(filter)), minTimeNs(minTimeMs * 1e6) {}
+
+        bool selected(const std::string &name) const { return filter.empty() || name.find(filter) != std::string::npos; }
+
+        // 先把每轮的迭代次数加到足够长，再测 kRepeats 轮
+        template <typename Body>
+        void run(const std::string &name, std::size_t framesPerOp, Body &&body) {
+            if (!selected(name)) return;
+            const double roundNs = minTimeNs / kRepeats;
+            std::uint64_t iterations = 1;
+            while (true) {
+                const double elapsed = time(iterations, body);
+                if (elapsed >= roundNs || iterations >= (1ull << 40)) break;
+                const double scale = elapsed > 0.0 ? roundNs / elapsed * 1.2 : 10.0;
+                iterations = std::max(iterations * 2, static_cast<std::uint64_t>(double(iterations) * std::min(scale, 100.0)));
+            }
+
+            std::vector<double> perOp;
+            for (int r = 0; r < kRepeats; ++r) perOp.push_back(time(iterations, body) / double(iterations));
+            std::sort(perOp.begin(), perOp.end());
+
+            BenchResult result;
+            result.name = name;
+            result.iterations = iterations;
+            result.nsPerOp = perOp[perOp.size() / 2];
+            result.nsMinPerOp = perOp.front();
+            result.framesPerOp = framesPerOp;
+            char line[256];
+            std::snprintf(line, sizeof(line), "%-40s %12.1f ns/op %10.3f ns/frame\n", name.c_str(), result.nsPerOp,
+                          framesPerOp ? result.nsPerOp / double(framesPerOp) : 0.0);
+            std::cerr << line;
+            results.push_back(std::move(result));
+        }
+
+        const std::vector<BenchResult> &all() const { return results; }
+
+    private:
+        template <typename Body>
+        static double time(std::uint64_t iterations, Body &body) {
+            const auto start = std::chrono::steady_clock::now();
+            for (std::uint64_t i = 0; i < iterations; ++i) body();
+            return static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+        }
+
+        std::string filter;
+        double minTimeNs;
+        std::vector<BenchResult> results;
+    };
+
+    // 要对比的各实现（AVX2 只在 CPU 支持时测）
+    template <typename Kernels>
+    std::vector<const Kernels *> implementations(const Kernels &scalar, const Kernels &sse2, const Kernels &avx2) {
+        std::vector<const Kernels *> list{ &scalar };
+        if (AR_X86 && cpuFeatures().sse2) list.push_back(&sse2);
+        if (AR_X86 && cpuFeatures().avx2) list.push_back(&avx2);
+        return list;
+    }
+
+    // 与引擎相同的混音图：sources 个来源（ring + 延迟线历史）按路由矩阵混到 buses 条 bus
+    class RoutedMixBench {
+    public:
+        RoutedMixBench(std::size_t sources, std::size_t buses)
+            : matrix(sources, buses), mixer(kChannels, kFrames * 2), out(kFrames * 4, kChannels, buses), inputs(sources) {
+            for (std::size_t i = 0; i < sources; ++i) {
+                rings.push_back(std::make_unique<SpscRing<float>>(kFrames * 8, kChannels));
+                // 历史与引擎一样留出最长延迟加一块的余量，开始时填满静音
+                histories.push_back(std::make_unique<FanoutRing>(kRate + kFrames * 2, kChannels));
+                histories.back()->commitWrite(histories.back()->capacity());
+                inputs[i] = MixInput{ rings.back().get(), 0.5f, histories.back().get(), i };
+            }
+            for (std::size_t b = 0; b < buses; ++b) busList.push_back(b);
+            matrix.publish();
+        }
+
+        RoutingMatrix &routes() { return matrix; }
+
+        // 一个周期：各来源推入 in，再按当前快照混音
+        void run(const std::vector<float> &in) {
+            for (auto &ring : rings) ring->push(in.data(), kFrames);
+            const RouteTable table = matrix.acquire();
+            mixer.mixRouted(inputs.data(), inputs.size(), table, busList.data(), busList.size(), out, kFrames);
+            matrix.release();
+            sink = out.readRegions(out.writePosition() - kFrames, 1).first.data[0];
+        }
+
+    private:
+        RoutingMatrix matrix;
+        Mixer mixer;
+        FanoutRing out;
+        std::vector<std::unique_ptr<SpscRing<float>>> rings;
+        std::vector<std::unique_ptr<FanoutRing>> histories;
+        std::vector<MixInput> inputs;
+        std::vector<std::size_t> busList;
+    };
+
+    void benchRing(BenchRunner &runner) {
+        SpscRing<float> ring(kFrames * 8, kChannels);
+        const std::vector<float> in = testSignal(kFrames, kChannels);
+        std::vector<float> out(in.size());
+        runner.run("ring/push_pop", kFrames, [&] {
+            ring.push(in.data(), kFrames);
+            ring.pop(out.data(), kFrames);
+            sink = out[0];
+        });
+    }
+
+    void benchConvert(BenchRunner &runner) {
+        const std::vector<float> in = testSignal(kFrames, kChannels);
+        const std::size_t samples = in.size();
+        std::vector<unsigned char> bytes(samples * 4);
+        std::vector<float> out(samples);
+        for (const ConvertKernels *kernels : implementations(scalarConvertKernels(), sse2ConvertKernels(), avx2ConvertKernels())) {
+            for (const SampleType type : { SampleType::Int16, SampleType::Int24, SampleType::Int32 }) {
+                const auto index = static_cast<std::size_t>(type);
+                const std::string suffix = std::string(sampleTypeName(type)) + "/" + kernels->name;
+                kernels->encode[index](in.data(), bytes.data(), samples);
+                runner.run("convert/decode/" + suffix, kFrames, [&] {
+                    kernels->decode[index](bytes.data(), out.data(), samples);
+                    sink = out[0];
+                });
+                runner.run("convert/encode/" + suffix, kFrames, [&] {
+                    kernels->encode[index](in.data(), bytes.data(), samples);
+                    sink = bytes[0];
+                });
+            }
+        }
+        // render 到 16 位设备的完整路径：TPDF 抖动 + 编码
+        SampleConverter converter(SampleType::Int16, kChannels, kFrames, true);
+        runner.run("convert/render/int16_dither", kFrames, [&] {
+            float *buffer = converter.renderBuffer(bytes.data(), kFrames);
+            std::copy(in.begin(), in.end(), buffer);
+            converter.encode(kFrames);
+            sink = bytes[0];
+        });
+    }
+
+    void benchMix(BenchRunner &runner) {
+        const std::vector<float> in = testSignal(kFrames, kChannels);
+        std::vector<float> out(in.size());
+        for (const MixKernels *kernels : implementations(scalarMixKernels(), sse2MixKernels(), avx2MixKernels())) {
+            runner.run(std::string("mix/accumulate/") + kernels->name, kFrames, [&] {
+                kernels->accumulate(out.data(), in.data(), in.size(), 0.5f);
+                kernels->saturate(out.data(), out.size());
+                sink = out[0];
+            });
+        }
+        // 引擎实际走的路径（Mixer::mixRouted）：每个来源先推入一个周期，再经历史按路由混到主输出一条 bus
+        for (const std::size_t sources : { 1, 2, 4, 8, 16 }) {
+            RoutedMixBench bench(sources, 1);
+            runner.run("mix/sources:" + std::to_string(sources), kFrames, [&] { bench.run(in); });
+        }
+        // 8 个来源 × 8 条 bus 的完整路由矩阵：各路由增益与延迟各不相同，每个来源有一条静音路由
+        RoutedMixBench matrix(8, 8);
+        for (std::size_t row = 0; row < 8; ++row) {
+            for (std::size_t column = 0; column < 8; ++column) {
+                Route route;
+                route.gain = 0.25f + 0.05f * float(column);
+                route.delayFrames = static_cast<std::uint32_t>((row * 8 + column) * 37);
+                route.muted = column == row;
+                matrix.routes().setRoute(row, column, route);
+            }
+        }
+        matrix.routes().publish();
+        runner.run("mix/routed:8x8", kFrames, [&] { matrix.run(in); });
+    }
+
+    void benchResample(BenchRunner &runner) {
+        struct Case {
+            std::uint32_t in;
+            std::uint32_t out;
+            double adjust;
+            const char *name;
+        };
+        const Case cases[] = {
+            { 44100, 48000, 1.0, "resample/44100-48000" },
+            { 48000, 44100, 1.0, "resample/48000-44100" },
+            { 96000, 48000, 1.0, "resample/96000-48000" },
+            { 48000, 48000, 1.0005, "resample/48000-48000_drift" },
+        };
+        for (const Case &c : cases) {
+            if (!runner.selected(c.name)) continue;
+            // 每次产生一个输出周期
+            const std::size_t inFrames = kFrames * c.in / c.out + 2;
+            const std::vector<float> in = testSignal(inFrames, kChannels, c.in);
+            std::vector<float> out(kFrames * kChannels);
+            Resampler resampler(c.in, c.out, kChannels);
+            resampler.setRatioAdjust(c.adjust);
+            runner.run(c.name, kFrames, [&] {
+                std::size_t consumed = 0;
+                resampler.process(in.data(), inFrames, consumed, out.data(), kFrames);
+                sink = out[0];
+            });
+        }
+    }
+
+    void benchMeter(BenchRunner &runner) {
+        const std::vector<float> in = testSignal(kFrames, kChannels);
+        LevelMeter meter(kChannels, kRate);
+        std::uint64_t now = 0;
+        runner.run("meter/process", kFrames, [&] {
+            now += 10000000;
+            meter.process(in.data(), kFrames, now);
+        });
+        // 单声道过采样峰值需要前面 kTruePeakTaps - 1 个历史样本
+        const std::size_t history = LevelMeter::kTruePeakTaps - 1;
+        const std::vector<float> mono = testSignal(kFrames + history, 1);
+        for (const MeterKernels *kernels : implementations(scalarMeterKernels(), sse2MeterKernels(), avx2MeterKernels())) {
+            runner.run(std::string("meter/reduce/") + kernels->name, kFrames, [&] {
+                float peak[kChannels] = {};
+                float sumSquares[kChannels] = {};
+                kernels->reduce(in.data(), kFrames, kChannels, peak, sumSquares);
+                sink = peak[0] + sumSquares[0];
+            });
+            runner.run(std::string("meter/true_peak/") + kernels->name, kFrames, [&] {
+                sink = kernels->truePeak(mono.data() + history, kFrames);
+            });
+        }
+    }
+
+    void benchConceal(BenchRunner &runner) {
+        const std::vector<float> in = testSignal(kFrames * 4, kChannels);
+        std::vector<float> out(kFrames * kChannels);
+        PacketLossConcealer concealer(kChannels, kRate);
+        // 每次：收到一段真实数据，接着丢一个周期（含基音搜索）
+        runner.run("conceal/gap", kFrames, [&] {
+            concealer.observe(in.data(), kFrames * 4);
+            sink = static_cast<float>(concealer.conceal(out.data(), kFrames));
+        });
+    }
+
+    // 一条路由上全部打开的插入效果（高通 + 4 段均衡 + 噪声门 + 压缩）
+    InsertSettings fullInsert() {
+        InsertSettings settings;
+        settings.highPassHz = 80.0f;
+        settings.eq[0] = EqBand{ EqBand::Type::LowShelf, 200.0f, -3.0f, 0.707f };
+        settings.eq[1] = EqBand{ EqBand::Type::Peak, 1000.0f, 4.0f, 1.0f };
+        settings.eq[2] = EqBand{ EqBand::Type::Peak, 3500.0f, -2.0f, 2.0f };
+        settings.eq[3] = EqBand{ EqBand::Type::HighShelf, 8000.0f, 2.0f, 0.707f };
+        settings.gate.enabled = true;
+        settings.compressor.enabled = true;
+        return settings;
+    }
+
+    void benchInsert(BenchRunner &runner) {
+        // 级联 5 节的内核本身：立体声与 8 声道（后者 AVX2 一个向量装下整帧）
+        const BiquadCoefficients section{ 0.9f, -1.6f, 0.75f, -1.6f, 0.65f };
+        const std::array<BiquadCoefficients, kMaxBiquadSections> coefs{ section, section, section, section, section };
+        for (const std::size_t channels : { kChannels, kMaxInsertChannels }) {
+            // 每次从同一段输入开始（原地处理的结果不再喂回去）
+            const std::vector<float> in = testSignal(kFrames, channels);
+            std::vector<float> buffer(in.size());
+            for (const BiquadKernels *kernels : implementations(scalarBiquadKernels(), sse2BiquadKernels(), avx2BiquadKernels())) {
+                alignas(32) std::array<float, kMaxBiquadSections * 2 * kMaxInsertChannels> state{};
+                const std::string name = "insert/biquad5/" + std::to_string(channels) + "ch/" + kernels->name;
+                runner.run(name, kFrames, [&] {
+                    std::copy(in.begin(), in.end(), buffer.begin());
+                    kernels->process(coefs.data(), coefs.size(), state.data(), buffer.data(), kFrames, channels, channels);
+                    sink = buffer[0];
+                });
+            }
+        }
+
+        // 整条效果链（选中的内核）：各节点单独打开与全部打开
+        struct Case {
+            const char *name;
+            InsertSettings settings;
+        };
+        std::vector<Case> cases;
+        InsertSettings settings;
+        settings.highPassHz = 80.0f;
+        cases.push_back({ "insert/chain/hpf", settings });
+        settings = fullInsert();
+        settings.highPassHz = 0.0f;
+        settings.gate.enabled = false;
+        settings.compressor.enabled = false;
+        cases.push_back({ "insert/chain/eq4", settings });
+        settings = InsertSettings{};
+        settings.gate.enabled = true;
+        cases.push_back({ "insert/chain/gate", settings });
+        settings = InsertSettings{};
+        settings.compressor.enabled = true;
+        cases.push_back({ "insert/chain/compressor", settings });
+        settings.compressor.ratio = InsertChain::kLimiterRatio;
+        settings.compressor.thresholdDb = -6.0f;
+        cases.push_back({ "insert/chain/limiter", settings });
+        cases.push_back({ "insert/chain/full", fullInsert() });
+        const std::vector<float> in = testSignal(kFrames, kChannels);
+        std::vector<float> buffer(in.size());
+        for (const Case &c : cases) {
+            if (!runner.selected(c.name)) continue;
+            InsertChain chain(kChannels, kRate, kFrames);
+            chain.post(c.settings);
+            chain.update();
+            runner.run(c.name, kFrames, [&] {
+                std::copy(in.begin(), in.end(), buffer.begin());
+                chain.process(buffer.data(), kFrames);
+                sink = buffer[0];
+            });
+        }
+    }
+
+    // ---- 端到端场景 ----
+
+    struct ScenarioSpec {
+        std::string name;
+        std::size_t sources = 1;
+        std::uint32_t sourceRate = kRate;
+        double jitterMs = 0.0;
+        double dropRate = 0.0;
+        std::vector<double> arrivalTraceMs;
+        bool adaptive = false;
+        bool record = false;
+        bool inserts = false;   // 每个来源到主输出的路由上打开全部插入效果
+        float sourceGain = 1.0f; // 各来源的增益；不为 1 时单来源的图也不能走直通
+    };
+
+    struct ScenarioResult {
+        std::string name;
+        double audioSec = 0.0;
+        double cpuMsPerSec = 0.0;          // 音频线程处理耗时之和 / 音频时长
+        double processCpuMsPerSec = 0.0;   // 整个进程的 CPU 时间 / 音频时长（含离散事件时钟的线程同步）
+        EngineStatsSnapshot stats;
+        std::uint64_t recorderDropped = 0;
+    };
+
+    // 离散事件时钟下跑 seconds 秒（虚拟时间）；输出设备与各来源都是虚拟端点
+    bool runScenario(const ScenarioSpec &spec, double seconds, const std::filesystem::path &tempDir, ScenarioResult &result) {
+        auto backend = std::make_unique<VirtualBackend>(std::make_shared<VirtualClock>(0.0));
+        VirtualDeviceSpec output;
+        output.id = L"bench-out";
+        output.name = L"Bench output";
+        backend->addDevice(output);
+        std::vector<std::wstring> ids;
+        for (std::size_t i = 0; i < spec.sources; ++i) {
+            VirtualDeviceSpec source;
+            source.id = L"bench-src-" + std::to_wstring(i);
+            source.name = L"Bench source " + std::to_wstring(i);
+            source.format = StreamFormat{ spec.sourceRate, 2 };
+            source.periodFrames = spec.sourceRate / 100;
+            source.toneHz = 220.0 + 55.0 * double(i);
+            source.toneLevel = 0.5f / float(spec.sources);
+            source.jitterMs = spec.jitterMs;
+            source.dropRate = spec.dropRate;
+            source.seed = static_cast<std::uint32_t>(i + 1);
+            source.arrivalTraceMs = spec.arrivalTraceMs;
+            backend->addDevice(source);
+            ids.push_back(source.id);
+        }
+
+        AudioEngine engine(std::move(backend));
+        StreamConfig config;
+        config.adaptiveBuffer = spec.adaptive;
+        if (!engine.startCopy(ids, output.id, config)) {
+            std::cerr << spec.name << ": 启动失败\n";
+            return false;
+        }
+        for (std::size_t i = 0; spec.sourceGain != 1.0f && i < spec.sources; ++i) engine.setSourceGain(i, spec.sourceGain);
+        for (std::size_t i = 0; spec.inserts && i < spec.sources; ++i) {
+            if (!engine.setInsert(i, 0, fullInsert())) {
+                std::cerr << spec.name << ": 无法设置插入效果\n";
+                engine.stopCopy();
+                return false;
+            }
+        }
+        std::filesystem::path recording;
+        if (spec.record) {
+            recording = tempDir / ("AudioRepeaterBench-" + std::to_string(processCpuNs()) + ".wav");
+            if (!engine.startRecording(0, recording)) {
+                std::cerr << spec.name << ": 无法录制到 " << recording.string() << '\n';
+                engine.stopCopy();
+                return false;
+            }
+        }
+
+        AudioBackend &clock = engine.backend();
+        const std::uint64_t startNs = clock.nowNs();
+        const std::uint64_t cpuStart = processCpuNs();
+        const auto durationNs = static_cast<std::uint64_t>(seconds * 1e9);
+        while (clock.nowNs() - startNs < durationNs) std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        const std::uint64_t cpuNs = processCpuNs() - cpuStart;
+
+        result.name = spec.name;
+        result.stats = engine.statsSnapshot();
+        result.audioSec = double(clock.nowNs() - startNs) / 1e9;
+        result.cpuMsPerSec = result.stats.wakeupMeanUs * double(result.stats.wakeups) / 1000.0 / result.audioSec;
+        result.processCpuMsPerSec = double(cpuNs) / 1e6 / result.audioSec;
+        if (spec.record) {
+            for (const RecorderStatus &status : engine.recordingStatus()) result.recorderDropped += status.framesDropped;
+        }
+        engine.stopCopy();
+        if (!recording.empty()) {
+            std::error_code ec;
+            std::filesystem::remove(recording, ec);
+        }
+
+        char line[256];
+        std::snprintf(line, sizeof(line), "%-40s %8.3f ms/s  峰值 %7.1f us  延迟 p50 %.2f p99 %.2f p99.9 %.2f ms  欠载 %llu\n",
+                      spec.name.c_str(), result.cpuMsPerSec, result.stats.wakeupPeakUs, result.stats.latencyP50Ms,
+                      result.stats.latencyP99Ms, result.stats.latencyP999Ms,
+                      static_cast<unsigned long long>(result.stats.underruns));
+        std::cerr << line;
+        return true;
+    }
+
+    std::vector<ScenarioSpec> defaultScenarios() {
+        std::vector<ScenarioSpec> list;
+        ScenarioSpec spec;
+        spec.name = "pipeline/passthrough";
+        list.push_back(spec);
+        // 同一张图（一个来源、一个输出、同格式），增益 0.999 迫使走混音路径，与上一项直接对比
+        spec.name = "pipeline/passthrough_general";
+        spec.sourceGain = 0.999f;
+        list.push_back(spec);
+        spec = ScenarioSpec{};
+        spec.name = "pipeline/mix:4";
+        spec.sources = 4;
+        list.push_back(spec);
+        spec.name = "pipeline/mix:16";
+        spec.sources = 16;
+        list.push_back(spec);
+        spec.name = "pipeline/mix:4_record";
+        spec.sources = 4;
+        spec.record = true;
+        list.push_back(spec);
+        spec = ScenarioSpec{};
+        spec.name = "pipeline/mix:4_insert";
+        spec.sources = 4;
+        spec.inserts = true;
+        list.push_back(spec);
+        spec = ScenarioSpec{};
+        spec.name = "pipeline/resample_44100";
+        spec.sourceRate = 44100;
+        list.push_back(spec);
+        spec = ScenarioSpec{};
+        spec.name = "pipeline/jitter_adaptive";
+        spec.jitterMs = 20.0;
+        spec.dropRate = 0.02;
+        spec.adaptive = true;
+        list.push_back(spec);
+        return list;
+    }
+
+    // ---- 结果输出与对比 ----
+
+    void writeNumberField(std::ostream &out, const char *key, double value, bool last = false) {
+        out << "\"" << key << "\": " << (std::isfinite(value) ? value : 0.0) << (last ? "" : ", ");
+    }
+
+    void writeResults(std::ostream &out, const std::vector<BenchResult> &benches, const std::vector<ScenarioResult> &scenarios,
+                      double minTimeMs, double scenarioSec) {
+        out << std::setprecision(6);
+        out << "{\n  \"context\": {";
+        out << "\"mix_kernels\": ";
+        writeJsonString(out, mixKernels().name);
+        out << ", \"convert_kernels\": ";
+        writeJsonString(out, convertKernels().name);
+        out << ", \"meter_kernels\": ";
+        writeJsonString(out, meterKernels().name);
+        out << ", ";
+        writeNumberField(out, "min_time_ms", minTimeMs);
+        writeNumberField(out, "scenario_s", scenarioSec, true);
+        out << "},\n  \"benchmarks\": [";
+        for (std::size_t i = 0; i < benches.size(); ++i) {
+            const BenchResult &b = benches[i];
+            out << (i ? ",\n    {" : "\n    {") << "\"name\": ";
+            writeJsonString(out, b.name);
+            out << ", ";
+            writeNumberField(out, "iterations", double(b.iterations));
+            writeNumberField(out, "ns_per_op", b.nsPerOp);
+            writeNumberField(out, "ns_min_per_op", b.nsMinPerOp);
+            writeNumberField(out, "frames_per_op", double(b.framesPerOp));
+            writeNumberField(out, "ns_per_frame", b.framesPerOp ? b.nsPerOp / double(b.framesPerOp) : 0.0, true);
+            out << "}";
+        }
+        out << (benches.empty() ? "],\n" : "\n  ],\n") << "  \"scenarios\": [";
+        for (std::size_t i = 0; i < scenarios.size(); ++i) {
+            const ScenarioResult &s = scenarios[i];
+            out << (i ? ",\n    {" : "\n    {") << "\"name\": ";
+            writeJsonString(out, s.name);
+            out << ", ";
+            writeNumberField(out, "audio_s", s.audioSec);
+            writeNumberField(out, "cpu_ms_per_s", s.cpuMsPerSec);
+            writeNumberField(out, "process_cpu_ms_per_s", s.processCpuMsPerSec);
+            writeNumberField(out, "wakeups", double(s.stats.wakeups));
+            writeNumberField(out, "wakeup_mean_us", s.stats.wakeupMeanUs);
+            writeNumberField(out, "wakeup_p99_us", s.stats.wakeupP99Us);
+            writeNumberField(out, "wakeup_peak_us", s.stats.wakeupPeakUs);
+            writeNumberField(out, "latency_p50_ms", s.stats.latencyP50Ms);
+            writeNumberField(out, "latency_p99_ms", s.stats.latencyP99Ms);
+            writeNumberField(out, "latency_p999_ms", s.stats.latencyP999Ms);
+            writeNumberField(out, "latency_max_ms", s.stats.latencyMaxMs);
+            writeNumberField(out, "underruns", double(s.stats.underruns));
+            writeNumberField(out, "overruns", double(s.stats.overruns));
+            writeNumberField(out, "concealments", double(s.stats.concealments));
+            writeNumberField(out, "passthrough_frames", double(s.stats.passthroughFrames));
+            writeNumberField(out, "recorder_dropped_frames", double(s.recorderDropped), true);
+            out << "}";
+        }
+        out << (scenarios.empty() ? "]\n}\n" : "\n  ]\n}\n");
+    }
+
+    // 与基线对比：微基准比较 ns_per_op，场景比较 cpu_ms_per_s 与 latency_p99_ms；
+    // 两边都有的项目才比较。返回变慢超过容差的项目数，基线无法读取时返回 -1
+    int compareBaseline(const std::filesystem::path &path, const std::vector<BenchResult> &benches,
+                        const std::vector<ScenarioResult> &scenarios, double tolerance) {
+        std::ifstream in(path, std::ios::binary);
+        std::stringstream text;
+        text << in.rdbuf();
+        JsonValue baseline;
+        if (!in || !parseJson(text.str(), baseline) || !baseline.isObject()) {
+            std::cerr << "无法读取基线 " << path.string() << '\n';
+            return -1;
+        }
+
+        int regressions = 0;
+        const auto check = [&](const std::string &name, const char *metric, double before, double now) {
+            if (!(before > 0.0)) return;
+            const double change = now / before - 1.0;
+            const bool regressed = change > tolerance;
+            regressions += regressed ? 1 : 0;
+            char line[256];
+            std::snprintf(line, sizeof(line), "%s %-40s %-16s %12.3f -> %12.3f (%+.1f%%)\n", regressed ? "!!" : "  ",
+                          name.c_str(), metric, before, now, change * 100.0);
+            std::cerr << line;
+        };
+        const auto find = [](const JsonValue &root, const char *list, const std::string &name) -> const JsonValue * {
+            const JsonValue *items = root.find(list);
+            if (!items || !items->isArray()) return nullptr;
+            for (const JsonValue &item : items->array()) {
+                const JsonValue *n = item.find("name");
+                if (n && n->isString() && n->string() == name) return &item;
+            }
+            return nullptr;
+        };
+        const auto number = [](const JsonValue *item, const char *key) {
+            const JsonValue *v = item ? item->find(key) : nullptr;
+            return v && v->isNumber() ? v->number() : 0.0;
+        };
+
+        std::cerr << "\n与基线对比（容差 " << tolerance * 100.0 << "%）:\n";
+        for (const BenchResult &b : benches) {
+            if (const JsonValue *item = find(baseline, "benchmarks", b.name)) check(b.name, "ns_per_op", number(item, "ns_per_op"), b.nsPerOp);
+        }
+        for (const ScenarioResult &s : scenarios) {
+            if (const JsonValue *item = find(baseline, "scenarios", s.name)) {
+                check(s.name, "cpu_ms_per_s", number(item, "cpu_ms_per_s"), s.cpuMsPerSec);
+                check(s.name, "latency_p99_ms", number(item, "latency_p99_ms"), s.stats.latencyP99Ms);
+            }
+        }
+        return regressions;
+    }
+}
+
+int main(int argc, char *argv[]) {
+#ifdef _WIN32
+    SetConsoleOutputCP(CP_UTF8);
+#endif
+
+    std::string filter;
+    double minTimeMs = 200.0;
+    double scenarioSec = 20.0;
+    double tolerance = 0.1;
+    std::string tracePath;
+    std::string outPath;
+    std::string baselinePath;
+    bool micro = true;
+    bool scenarios = true;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        const bool hasValue = i + 1 < argc;
+        if (arg == "--filter" && hasValue) filter = argv[++i];
+        else if (arg == "--min-time-ms" && hasValue) minTimeMs = std::atof(argv[++i]);
+        else if (arg == "--scenario-s" && hasValue) scenarioSec = std::atof(argv[++i]);
+        else if (arg == "--trace" && hasValue) tracePath = argv[++i];
+        else if (arg == "--out" && hasValue) outPath = argv[++i];
+        else if (arg == "--baseline" && hasValue) baselinePath = argv[++i];
+        else if (arg == "--tolerance" && hasValue) tolerance = std::atof(argv[++i]);
+        else if (arg == "--no-micro") micro = false;
+        else if (arg == "--no-scenarios") scenarios = false;
+        else if (arg == "--help" || arg == "-h") {
+            printUsage();
+            return kExitOk;
+        } else {
+            printUsage();
+            return kExitUsage;
+        }
+    }
+    if (minTimeMs <= 0.0 || scenarioSec <= 0.0 || tolerance < 0.0) {
+        printUsage();
+        return kExitUsage;
+    }
+
+    std::vector<ScenarioSpec> scenarioSpecs = defaultScenarios();
+    if (!tracePath.empty()) {
+        ScenarioSpec spec;
+        spec.name = "trace/" + std::filesystem::path(tracePath).filename().string();
+        spec.adaptive = true;
+        std::string error;
+        if (!loadArrivalTrace(std::filesystem::path(widenUtf8(tracePath)), spec.arrivalTraceMs, error)) {
+            std::cerr << tracePath << ": " << error << '\n';
+            return kExitIoError;
+        }
+        scenarioSpecs.push_back(std::move(spec));
+    }
+
+    BenchRunner runner(filter, minTimeMs);
+    if (micro) {
+        benchRing(runner);
+        benchConvert(runner);
+        benchMix(runner);
+        benchResample(runner);
+        benchMeter(runner);
+        benchConceal(runner);
+        benchInsert(runner);
+    }
+
+    std::vector<ScenarioResult> scenarioResults;
+    if (scenarios) {
+        std::error_code ec;
+        std::filesystem::path tempDir = std::filesystem::temp_directory_path(ec);
+        if (ec) tempDir = ".";
+        for (const ScenarioSpec &spec : scenarioSpecs) {
+            if (!runner.selected(spec.name)) continue;
+            ScenarioResult result;
+            if (!runScenario(spec, scenarioSec, tempDir, result)) return kExitSoftware;
+            scenarioResults.push_back(std::move(result));
+        }
+    }
+
+    if (outPath.empty()) {
+        writeResults(std::cout, runner.all(), scenarioResults, minTimeMs, scenarioSec);
+    } else {
+        std::ofstream out(std::filesystem::path(widenUtf8(outPath)));
+        writeResults(out, runner.all(), scenarioResults, minTimeMs, scenarioSec);
+        if (!out) {
+            std::cerr << "无法写入 " << outPath << '\n';
+            return kExitIoError;
+        }
+    }
+
+    if (!baselinePath.empty()) {
+        const int regressions = compareBaseline(std::filesystem::path(widenUtf8(baselinePath)), runner.all(), scenarioResults, tolerance);
+        if (regressions < 0) return kExitIoError;
+        if (regressions > 0) {
+            std::cerr << regressions << " 项变慢超过容差\n";
+            return kExitRegression;
+        }
+    }
+    return kExitOk;
+}
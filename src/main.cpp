@@ -1,9 +1,35 @@
 #include <QApplication>
+#include <QStandardPaths>
+
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+
+#include "AudioEngine.h"
 #include "MainWindow.h"
+#include "Session.h"
 
 int main(int argc, char *argv[]) {
+    // 启动计时的起点：自动恢复会话时，界面显示从这里到第一帧交给输出设备的时间
+    const auto launched = std::chrono::steady_clock::now();
     QApplication a(argc, argv);
-    MainWindow w;
+
+    // 引擎先于界面构造：上次的会话按端点 ID 直接打开设备，界面还没建好就已经开始播放
+    AudioEngine engine;
+    const std::filesystem::path sessionPath =
+        (QStandardPaths::writableLocation(QStandardPaths::AppConfigLocation) + "/session.json").toStdWString();
+    EngineSession session;
+    std::string error;
+    if (std::filesystem::exists(sessionPath)) {
+        if (!loadSession(sessionPath, session, error)) {
+            std::cerr << "Failed to load session: " << error << std::endl;
+            session = EngineSession{};
+        } else if (session.autoStart && !engine.startSession(session)) {
+            std::cerr << "Failed to restore session" << std::endl;
+        }
+    }
+
+    MainWindow w(engine, session, sessionPath, launched);
     w.show();
     return a.exec();
-}
\ No newline at end of file
+}
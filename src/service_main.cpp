@@ -0,0 +1,308 @@
+// 无界面模式：按配置文件打开来源与输出并一直运行，直到收到 SIGINT / SIGTERM（或 --duration-ms 到时）
+// 不依赖 Qt，可由 systemd、任务计划程序或服务包装器在开机时启动；退出码见 ExitCode
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+#include "AudioEngine.h"
+#include "ControlServer.h"
+#include "ServiceConfig.h"
+#include "Utf8.h"
+#include "VirtualBackend.h"
+
+namespace {
+    // 与 BSD sysexits 一致，便于服务管理器区分"配置错误不必重试"与"暂时失败可以重启"
+    enum ExitCode : int {
+        kExitOk = 0,
+        kExitUsage = 64,        // 命令行参数错误
+        kExitUnavailable = 69,  // 配置中的设备不存在或打不开
+        kExitSoftware = 70,     // 启动失败（格式不支持等）
+        kExitIoError = 74,      // 统计文件无法写入、录音文件无法创建或控制接口无法监听
+        kExitTempFail = 75,     // 运行中流失效且在 fail_timeout_ms 内没有恢复
+        kExitConfig = 78,       // 配置文件无法读取或内容无效
+    };
+
+    std::atomic<bool> stopRequested{ false };
+
+    void onSignal(int) { stopRequested.store(true, std::memory_order_relaxed); }
+
+    void printUsage() {
+        std::cerr << "用法: AudioRepeaterService [--config] <配置文件> [--duration-ms N] [--check]\n"
+                     "      AudioRepeaterService --list-devices [--config <配置文件>]\n"
+                     "  --check          只检查配置与设备，不启动\n"
+                     "  --duration-ms N  运行 N 毫秒（后端时基）后正常退出\n"
+                     "  --list-devices   列出端点 ID（用于填写配置）\n";
+    }
+
+    float dbToGain(const float db) { return std::pow(10.0f, db / 20.0f); }
+
+    std::unique_ptr<AudioBackend> createBackend(const ServiceConfig &config) {
+        if (!config.virtualBackend) return createPlatformBackend();
+        std::unique_ptr<VirtualBackend> backend;
+        if (config.virtualDevices.empty()) {
+            backend = VirtualBackend::withDefaultDevices();
+        } else {
+            backend = std::make_unique<VirtualBackend>(std::make_shared<VirtualClock>(config.clockSpeed));
+            for (const auto &device : config.virtualDevices) backend->addDevice(device);
+        }
+        for (const auto &process : config.virtualProcesses) backend->addProcess(process);
+        return backend;
+    }
+
+    void listDevices(AudioEngine &engine) {
+        for (const auto &device : engine.deviceRegistry().devices()) {
+            std::cout << (device.processId != 0 ? "process" : device.isRender ? "render " : "capture") << (device.isDefault ? " * " : "   ")
+                      << narrowUtf8(device.id) << "  " << narrowUtf8(device.name) << '\n';
+        }
+    }
+
+    // 等待配置中的设备全部可用；返回找不到的第一个设备 ID（全部可用时为空）
+    std::wstring waitForDevices(AudioEngine &engine, const ServiceConfig &config) {
+        const auto missing = [&]() -> std::wstring {
+            DeviceRegistry &registry = engine.deviceRegistry();
+            for (const auto &source : config.sources) {
+                if (!registry.find(source.id)) return source.id;
+            }
+            if (!registry.find(config.output)) return config.output;
+            for (const auto &id : config.extraOutputs) {
+                if (!registry.find(id)) return id;
+            }
+            return {};
+        };
+
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(config.waitDevicesMs);
+        while (true) {
+            std::wstring id = missing();
+            if (id.empty() || stopRequested.load(std::memory_order_relaxed) ||
+                std::chrono::steady_clock::now() >= deadline) return id;
+            std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        }
+    }
+
+    // 启动后应用增益、附加输出、路由、插入效果与录音；失败时返回对应的退出码
+    int applyConfig(AudioEngine &engine, const ServiceConfig &config) {
+        for (size_t i = 0; i < config.sources.size(); ++i) {
+            if (config.sources[i].gainDb != 0.0f) engine.setSourceGain(i, dbToGain(config.sources[i].gainDb));
+        }
+        for (const auto &id : config.extraOutputs) {
+            if (!engine.addOutput(id)) {
+                std::cerr << "无法打开附加输出 " << narrowUtf8(id) << '\n';
+                return kExitUnavailable;
+            }
+        }
+        const std::uint32_t rate = engine.latencyReport().sampleRate;
+        for (const auto &route : config.routes) {
+            Route r;
+            r.gain = dbToGain(route.gainDb);
+            r.delayFrames = static_cast<std::uint32_t>(std::lround(route.delayMs * rate / 1000.0));
+            r.muted = route.muted;
+            if (!engine.setRoute(route.source, route.output, r)) {
+                std::cerr << "无法设置路由 " << route.source << " -> " << route.output << '\n';
+                return kExitSoftware;
+            }
+        }
+        for (const auto &insert : config.inserts) {
+            if (!engine.setInsert(insert.source, insert.output, insert.settings)) {
+                std::cerr << "无法设置插入效果 " << insert.source << " -> " << insert.output << '\n';
+                return kExitSoftware;
+            }
+        }
+        for (const auto &recording : config.recordings) {
+            if (!engine.startRecording(recording.output, recording.path, recording.options)) {
+                std::cerr << "无法开始录制到 " << narrowUtf8(recording.path.wstring()) << '\n';
+                return kExitIoError;
+            }
+        }
+        return kExitOk;
+    }
+
+    // 按配置启动并应用增益、附加输出、路由、插入效果与录音（启动时与控制接口的 start 请求共用）
+    int startEngine(AudioEngine &engine, const ServiceConfig &config) {
+        std::vector<std::wstring> sourceIds;
+        for (const auto &source : config.sources) sourceIds.push_back(source.id);
+        if (!engine.startCopy(sourceIds, config.output, config.stream)) {
+            std::cerr << "启动失败\n";
+            return kExitSoftware;
+        }
+        if (const int code = applyConfig(engine, config); code != kExitOk) {
+            engine.stopCopy();
+            return code;
+        }
+
+        const LatencyReport latency = engine.latencyReport();
+        std::cerr << "已启动: " << sourceIds.size() << " 个来源 -> " << narrowUtf8(config.output)
+                  << (config.extraOutputs.empty() ? "" : " 等 " + std::to_string(config.extraOutputs.size() + 1) + " 个输出")
+                  << "，" << latency.sampleRate << " Hz，周期 " << latency.renderPeriodFrames
+                  << " 帧，估算延迟 " << latency.estimatedLatencyMs << " ms\n";
+        return kExitOk;
+    }
+
+    void logStats(const EngineStatsSnapshot &stats, const std::size_t failed) {
+        char line[256];
+        std::snprintf(line, sizeof(line),
+                      "t=%.1fs 延迟 %.1f ms 缓冲 %.1f ms 欠载 %llu 溢出 %llu 丢帧 %llu 处理 p99 %.0f us%s%s\n",
+                      stats.timeSec, stats.latencyMs, stats.ringFillMs,
+                      static_cast<unsigned long long>(stats.underruns),
+                      static_cast<unsigned long long>(stats.overruns),
+                      static_cast<unsigned long long>(stats.framesDropped),
+                      stats.wakeupP99Us, stats.passthrough ? " 直通" : "", failed ? " 恢复中" : "");
+        std::cerr << line;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    // 启动计时的起点：进程开始执行
+    const auto launched = std::chrono::steady_clock::now();
+#ifdef _WIN32
+    SetConsoleOutputCP(CP_UTF8);
+#endif
+
+    std::string configPath;
+    bool check = false;
+    bool list = false;
+    long long durationMs = -1;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--config" && i + 1 < argc) configPath = argv[++i];
+        else if (arg == "--duration-ms" && i + 1 < argc) durationMs = std::atoll(argv[++i]);
+        else if (arg == "--check") check = true;
+        else if (arg == "--list-devices") list = true;
+        else if (arg == "--help" || arg == "-h") {
+            printUsage();
+            return kExitOk;
+        } else if (arg.rfind("--", 0) != 0 && configPath.empty()) configPath = arg;
+        else {
+            printUsage();
+            return kExitUsage;
+        }
+    }
+    if (configPath.empty() && !list) {
+        printUsage();
+        return kExitUsage;
+    }
+
+    ServiceConfig config;
+    if (!configPath.empty()) {
+        std::string error;
+        if (!loadServiceConfig(std::filesystem::path(widenUtf8(configPath)), config, error)) {
+            std::cerr << configPath << ": " << error << '\n';
+            return kExitConfig;
+        }
+    }
+
+    std::signal(SIGINT, onSignal);
+    std::signal(SIGTERM, onSignal);
+#ifdef SIGBREAK
+    std::signal(SIGBREAK, onSignal);
+#endif
+
+    AudioEngine engine(createBackend(config));
+    if (list) {
+        listDevices(engine);
+        return kExitOk;
+    }
+
+    // 按保存的端点 ID 逐个查询（不完整枚举）；开机时设备可能稍后才出现
+    if (const std::wstring missing = waitForDevices(engine, config); !missing.empty()) {
+        if (stopRequested.load(std::memory_order_relaxed)) return kExitOk;
+        std::cerr << "设备不可用: " << narrowUtf8(missing) << '\n';
+        return kExitUnavailable;
+    }
+    if (check) return kExitOk;
+
+    std::ofstream csv;
+    if (!config.statsCsv.empty()) {
+        const bool fresh = !std::filesystem::exists(config.statsCsv) || std::filesystem::file_size(config.statsCsv) == 0;
+        csv.open(config.statsCsv, std::ios::app);
+        if (!csv) {
+            std::cerr << "无法写入统计文件 " << narrowUtf8(config.statsCsv.wstring()) << '\n';
+            return kExitIoError;
+        }
+        if (fresh) writeStatsCsvHeader(csv);
+    }
+
+    if (const int code = startEngine(engine, config); code != kExitOk) return code;
+
+    // 控制接口：stop 之后引擎停着，进程继续运行，直到 start 或收到退出信号
+    ControlServer control(engine);
+    control.setStartHandler([&] { return startEngine(engine, config) == kExitOk; });
+    if (!config.controlSocket.empty()) {
+        std::string error;
+        if (!control.start(config.controlSocket, error)) {
+            std::cerr << "控制接口: " << error << '\n';
+            engine.stopCopy();
+            return kExitIoError;
+        }
+    }
+
+    // 时长与统计间隔按后端时基计算，虚拟后端的加速 / 离散事件模式下与音频数据一致
+    AudioBackend &backend = engine.backend();
+    const std::uint64_t startNs = backend.nowNs();
+    const std::uint64_t intervalNs = std::uint64_t(config.statsIntervalMs) * 1000000ull;
+    std::uint64_t nextStatsNs = startNs + intervalNs;
+    std::uint64_t failedSinceNs = 0;
+    bool firstFrameLogged = false;
+    int code = kExitOk;
+    while (!stopRequested.load(std::memory_order_relaxed)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        const std::uint64_t now = backend.nowNs();
+
+        // 从进程启动（与 startCopy 被调用）到第一帧真实数据交给输出设备的时间（实际时间，与后端时基无关）
+        if (!firstFrameLogged) {
+            if (const AudioEngine::StartupTiming timing = engine.startupTiming(); timing.rendered) {
+                firstFrameLogged = true;
+                const auto ms = [](const std::chrono::steady_clock::duration d) {
+                    return std::chrono::duration<double, std::milli>(d).count();
+                };
+                char line[128];
+                std::snprintf(line, sizeof(line), "首帧: 进程启动后 %.1f ms（启动请求后 %.1f ms）\n",
+                              ms(timing.firstFrame - launched), ms(timing.firstFrame - timing.requested));
+                std::cerr << line;
+            }
+        }
+
+        // 监督线程在后台恢复失效的流；长时间恢复不了时交给服务管理器重启整个进程
+        const std::size_t failed = engine.failedStreams();
+        if (failed == 0) failedSinceNs = 0;
+        else if (failedSinceNs == 0) failedSinceNs = now;
+        if (config.failTimeoutMs > 0 && failedSinceNs != 0 &&
+            now - failedSinceNs >= std::uint64_t(config.failTimeoutMs) * 1000000ull) {
+            std::cerr << failed << " 个流在 " << config.failTimeoutMs << " ms 内未能恢复\n";
+            code = kExitTempFail;
+            break;
+        }
+
+        if (now >= nextStatsNs) {
+            nextStatsNs = now + intervalNs;
+            const EngineStatsSnapshot stats = engine.statsSnapshot();
+            if (csv.is_open()) {
+                writeStatsCsvRow(csv, stats);
+                csv.flush();
+                if (!csv) {
+                    std::cerr << "写入统计文件失败\n";
+                    code = kExitIoError;
+                    break;
+                }
+            }
+            if (config.statsLog) logStats(stats, failed);
+        }
+
+        if (durationMs >= 0 && now - startNs >= std::uint64_t(durationMs) * 1000000ull) break;
+    }
+
+    control.stop();
+    if (csv.is_open()) writeStatsCsvRow(csv, engine.statsSnapshot());
+    engine.stopCopy();
+    return code;
+}
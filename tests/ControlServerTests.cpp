@@ -0,0 +1,296 @@
+// 控制接口：在虚拟后端上启动引擎，经本地 Unix 域套接字按一行一个 JSON 收发请求
+// 客户端只用 POSIX 套接字，Windows 上不构建（见 CMakeLists.txt）
+
+#include <chrono>
+#include <filesystem>
+#include <memory>
+#include <string>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "AudioEngine.h"
+#include "ControlServer.h"
+#include "Json.h"
+#include "TestSupport.h"
+#include "VirtualBackend.h"
+
+namespace {
+    // 阻塞式的测试客户端：一次发一行，按行取应答或推送
+    class LocalClient {
+    public:
+        explicit LocalClient(const std::filesystem::path &path) {
+            sockaddr_un address{};
+            address.sun_family = AF_UNIX;
+            const std::string native = path.string();
+            if (native.size() >= sizeof(address.sun_path)) return;
+            native.copy(address.sun_path, native.size());
+            fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+            if (fd >= 0 && ::connect(fd, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) != 0) {
+                ::close(fd);
+                fd = -1;
+            }
+        }
+        ~LocalClient() {
+            if (fd >= 0) ::close(fd);
+        }
+        LocalClient(const LocalClient &) = delete;
+        LocalClient &operator=(const LocalClient &) = delete;
+
+        bool connected() const { return fd >= 0; }
+
+        bool send(const std::string &line) {
+            const std::string data = line + "\n";
+            return ::send(fd, data.data(), data.size(), MSG_NOSIGNAL) == static_cast<ssize_t>(data.size());
+        }
+
+        // 取下一行；timeoutMs 内没有完整的一行时返回 false
+        bool readLine(std::string &line, const int timeoutMs = 2000) {
+            const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+            while (true) {
+                if (const std::size_t newline = pending.find('\n'); newline != std::string::npos) {
+                    line = pending.substr(0, newline);
+                    pending.erase(0, newline + 1);
+                    return true;
+                }
+                const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+                if (left <= 0) return false;
+                pollfd entry{ fd, POLLIN, 0 };
+                if (::poll(&entry, 1, static_cast<int>(left)) <= 0) return false;
+                char buffer[4096];
+                const ssize_t received = ::recv(fd, buffer, sizeof(buffer), 0);
+                if (received <= 0) return false;
+                pending.append(buffer, static_cast<std::size_t>(received));
+            }
+        }
+
+        // 发送请求并解析应答
+        bool request(const std::string &line, JsonValue &reply) {
+            std::string text;
+            return send(line) && readLine(text) && parseJson(text, reply) && reply.isObject();
+        }
+
+    private:
+        int fd = -1;
+        std::string pending;
+    };
+
+    bool replyOk(const JsonValue &reply) {
+        const JsonValue *ok = reply.find("ok");
+        return ok && ok->isBool() && ok->boolean();
+    }
+
+    std::string replyError(const JsonValue &reply) {
+        const JsonValue *error = reply.find("error");
+        return error && error->isString() ? error->string() : std::string();
+    }
+
+    // 虚拟后端上的一个来源与一个输出，外加监听在临时目录中的控制接口
+    struct ControlFixture {
+        AudioEngine engine;
+        ControlServer server;
+        std::filesystem::path socketPath;
+        bool started = false;
+
+        ControlFixture()
+            : engine(makeBackend()), server(engine) {
+            socketPath = std::filesystem::temp_directory_path() /
+                         ("ar-control-test-" + std::to_string(::getpid()) + ".sock");
+            std::string error;
+            started = server.start(socketPath, error);
+        }
+        ~ControlFixture() {
+            server.stop();
+            engine.stopCopy();
+        }
+
+        static std::unique_ptr<AudioBackend> makeBackend() {
+            auto backend = std::make_unique<VirtualBackend>(std::make_shared<VirtualClock>(0.0));
+            VirtualDeviceSpec output;
+            output.id = L"out";
+            backend->addDevice(output);
+            VirtualDeviceSpec source;
+            source.id = L"src";
+            backend->addDevice(source);
+            return backend;
+        }
+    };
+
+    const char *kStartRequest = R"({"id":1,"cmd":"start","sources":["src"],"output":"out","buffer_ms":40})";
+}
+
+TEST_CASE(ControlServer, StartStopAndStats) {
+    ControlFixture fixture;
+    REQUIRE(fixture.started);
+    CHECK(fixture.server.isRunning());
+    LocalClient client(fixture.socketPath);
+    REQUIRE(client.connected());
+
+    JsonValue reply;
+    REQUIRE(client.request(kStartRequest, reply));
+    CHECK(replyOk(reply));
+    // id 原样回显
+    REQUIRE(reply.find("id") != nullptr);
+    CHECK_EQ(reply.find("id")->number(), 1.0);
+    CHECK(fixture.engine.isRunning());
+
+    // 已在运行时再次 start 被拒绝
+    REQUIRE(client.request(kStartRequest, reply));
+    CHECK(!replyOk(reply));
+    CHECK_EQ(replyError(reply), std::string("already running"));
+
+    REQUIRE(client.request(R"({"id":"s","cmd":"get_stats"})", reply));
+    REQUIRE(replyOk(reply));
+    const JsonValue *result = reply.find("result");
+    REQUIRE(result != nullptr);
+    CHECK(result->find("running") && result->find("running")->boolean());
+    const JsonValue *sources = result->find("sources");
+    REQUIRE(sources != nullptr && sources->isArray());
+    REQUIRE(sources->array().size() == 1u);
+    CHECK_EQ(sources->array()[0].string(), std::string("src"));
+    const JsonValue *outputs = result->find("outputs");
+    REQUIRE(outputs != nullptr && outputs->isArray());
+    CHECK_EQ(outputs->array().size(), 1u);
+    CHECK(result->find("stats") && result->find("stats")->isObject());
+    CHECK(result->find("meters") && result->find("meters")->isObject());
+    REQUIRE(result->find("error_count") != nullptr);
+    CHECK_EQ(result->find("error_count")->number(), 0.0);
+
+    // 引擎记下的错误（这里是在运行中直接再启动一次）经 get_stats 轮询得到
+    CHECK(!fixture.engine.startCopy({ L"src" }, L"out", StreamConfig{}));
+    REQUIRE(client.request(R"({"id":"e","cmd":"get_stats"})", reply));
+    result = reply.find("result");
+    REQUIRE(result != nullptr && result->find("error_count") != nullptr && result->find("last_error") != nullptr);
+    CHECK_EQ(result->find("error_count")->number(), 1.0);
+    CHECK(!result->find("last_error")->string().empty());
+    CHECK_EQ(fixture.engine.lastError().message, result->find("last_error")->string());
+
+    REQUIRE(client.request(R"({"id":2,"cmd":"stop"})", reply));
+    CHECK(replyOk(reply));
+    CHECK(!fixture.engine.isRunning());
+    REQUIRE(client.request(R"({"id":3,"cmd":"get_stats"})", reply));
+    CHECK(reply.find("result") && !reply.find("result")->find("running")->boolean());
+}
+
+TEST_CASE(ControlServer, GainRouteAndInsertReachEngine) {
+    ControlFixture fixture;
+    REQUIRE(fixture.started);
+    LocalClient client(fixture.socketPath);
+    REQUIRE(client.connected());
+    JsonValue reply;
+    REQUIRE(client.request(kStartRequest, reply));
+    REQUIRE(replyOk(reply));
+
+    REQUIRE(client.request(R"({"id":1,"cmd":"set_gain","source":0,"gain_db":-6})", reply));
+    CHECK(replyOk(reply));
+    // 不存在的来源与缺少参数
+    REQUIRE(client.request(R"({"id":2,"cmd":"set_gain","source":5,"gain":0.5})", reply));
+    CHECK(!replyOk(reply));
+    REQUIRE(client.request(R"({"id":3,"cmd":"set_gain","source":0})", reply));
+    CHECK(!replyOk(reply));
+
+    REQUIRE(client.request(R"({"id":4,"cmd":"set_route","source":0,"output":0,"gain":0.25,"muted":true})", reply));
+    CHECK(replyOk(reply));
+    Route route = fixture.engine.route(0, 0);
+    CHECK_NEAR(route.gain, 0.25, 1e-6);
+    CHECK(route.muted);
+    // 未给出的字段保持不变
+    REQUIRE(client.request(R"({"id":5,"cmd":"set_route","source":0,"output":0,"muted":false})", reply));
+    CHECK(replyOk(reply));
+    route = fixture.engine.route(0, 0);
+    CHECK_NEAR(route.gain, 0.25, 1e-6);
+    CHECK(!route.muted);
+    REQUIRE(client.request(R"({"id":6,"cmd":"set_route","source":0,"output":3})", reply));
+    CHECK(!replyOk(reply));
+
+    REQUIRE(client.request(R"({"id":7,"cmd":"set_insert","source":0,"output":0,"hpf_hz":80,)"
+                           R"("compressor":{"enabled":true,"threshold_db":-12,"lookahead_ms":2}})", reply));
+    CHECK(replyOk(reply));
+    const InsertSettings insert = fixture.engine.insert(0, 0);
+    CHECK_NEAR(insert.highPassHz, 80.0, 1e-6);
+    CHECK(insert.compressor.enabled);
+    CHECK_NEAR(insert.compressor.thresholdDb, -12.0, 1e-6);
+    CHECK_NEAR(insert.compressor.lookaheadMs, 2.0, 1e-6);
+}
+
+TEST_CASE(ControlServer, SubscribePushesStats) {
+    ControlFixture fixture;
+    REQUIRE(fixture.started);
+    LocalClient client(fixture.socketPath);
+    REQUIRE(client.connected());
+    JsonValue reply;
+    REQUIRE(client.request(kStartRequest, reply));
+    REQUIRE(replyOk(reply));
+
+    // 间隔按 kMinIntervalMs 取下限
+    REQUIRE(client.request(R"({"id":1,"cmd":"subscribe","interval_ms":1})", reply));
+    REQUIRE(replyOk(reply));
+    CHECK_EQ(reply.find("result")->find("interval_ms")->number(), static_cast<double>(ControlServer::kMinIntervalMs));
+
+    int events = 0;
+    std::string line;
+    while (events < 3 && client.readLine(line)) {
+        JsonValue event;
+        REQUIRE(parseJson(line, event));
+        const JsonValue *name = event.find("event");
+        if (!name) continue;
+        CHECK_EQ(name->string(), std::string("stats"));
+        CHECK(event.find("data") && event.find("data")->find("running")->boolean());
+        ++events;
+    }
+    CHECK_EQ(events, 3);
+
+    // 取消订阅后（应答之前可能还有在途的推送）不再推送
+    REQUIRE(client.send(R"({"id":"u","cmd":"unsubscribe"})"));
+    bool acknowledged = false;
+    while (!acknowledged && client.readLine(line)) {
+        JsonValue message;
+        REQUIRE(parseJson(line, message));
+        acknowledged = message.find("id") != nullptr;
+    }
+    REQUIRE(acknowledged);
+    CHECK(!client.readLine(line, 100));
+}
+
+TEST_CASE(ControlServer, RejectsMalformedRequests) {
+    ControlFixture fixture;
+    REQUIRE(fixture.started);
+    LocalClient client(fixture.socketPath);
+    REQUIRE(client.connected());
+    JsonValue reply;
+
+    REQUIRE(client.request("{not json", reply));
+    CHECK(!replyOk(reply));
+    CHECK_EQ(replyError(reply), std::string("invalid json"));
+    REQUIRE(client.request(R"({"id":1})", reply));
+    CHECK_EQ(replyError(reply), std::string("missing cmd"));
+    REQUIRE(client.request(R"({"id":2,"cmd":"reboot"})", reply));
+    CHECK_EQ(replyError(reply), std::string("unknown cmd"));
+    REQUIRE(client.request(R"({"id":3,"cmd":"start","sources":"src","output":"out"})", reply));
+    CHECK(!replyOk(reply));
+    CHECK(!fixture.engine.isRunning());
+
+    // 孤立的低位 / 高位代理不是合法的 UTF-8，整行按无效 JSON 处理；成对的代理照常解码
+    REQUIRE(client.request(R"({"id":4,"cmd":"get_stats","x":"\udc00"})", reply));
+    CHECK_EQ(replyError(reply), std::string("invalid json"));
+    REQUIRE(client.request(R"({"id":5,"cmd":"get_stats","x":"\ud83d"})", reply));
+    CHECK_EQ(replyError(reply), std::string("invalid json"));
+    REQUIRE(client.request(R"({"id":6,"cmd":"get_stats","x":"\ud83d\ude00"})", reply));
+    CHECK(replyOk(reply));
+
+    JsonValue parsed;
+    REQUIRE(parseJson(R"("\ud83d\ude00")", parsed));
+    CHECK_EQ(parsed.string(), std::string("\xF0\x9F\x98\x80"));
+    CHECK(!parseJson(R"("\udfff")", parsed));
+    CHECK(!parseJson(R"("a\udc00b")", parsed));
+
+    // 一个连接断开不影响其他连接
+    {
+        LocalClient other(fixture.socketPath);
+        REQUIRE(other.connected());
+    }
+    REQUIRE(client.request(R"({"id":7,"cmd":"get_stats"})", reply));
+    CHECK(replyOk(reply));
+}
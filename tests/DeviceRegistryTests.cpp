@@ -0,0 +1,313 @@
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <thread>
+
+#include "DeviceRegistry.h"
+#include "TestSupport.h"
+
+namespace {
+    // 假后端：端点表在内存中，测试直接改表并经 notify 发出变化通知（相当于 IMMNotificationClient），
+    // 同时统计 enumerate / describe 的调用次数
+    class FakeNotifierBackend final : public AudioBackend {
+    public:
+        void set(const DeviceInfo &info) {
+            std::lock_guard<std::mutex> lock(mutex);
+            devices[info.id] = info;
+            if (std::find(order.begin(), order.end(), info.id) == order.end()) order.push_back(info.id);
+        }
+        // 可以 describe 但不出现在枚举结果中（与排除进程树的进程来源一样）
+        void setHidden(const DeviceInfo &info) {
+            std::lock_guard<std::mutex> lock(mutex);
+            devices[info.id] = info;
+        }
+        void erase(const std::wstring &id) {
+            std::lock_guard<std::mutex> lock(mutex);
+            devices.erase(id);
+            order.erase(std::remove(order.begin(), order.end(), id), order.end());
+        }
+        void setDefault(const std::wstring &id, bool isRender) {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (auto &[key, device] : devices) {
+                if (device.isRender == isRender) device.isDefault = key == id;
+            }
+        }
+        void notify(DeviceChange::Type type, const std::wstring &id, bool isRender = true) {
+            DeviceChangeCallback copy;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                copy = callback;
+            }
+            if (copy) copy(DeviceChange{ type, id, isRender });
+        }
+
+        std::vector<DeviceInfo> enumerate() override {
+            std::lock_guard<std::mutex> lock(mutex);
+            ++enumerateCalls;
+            std::vector<DeviceInfo> list;
+            for (const auto &id : order) list.push_back(devices.at(id));
+            return list;
+        }
+        bool describe(const std::wstring &deviceId, DeviceInfo &info) override {
+            std::lock_guard<std::mutex> lock(mutex);
+            ++describeCalls;
+            const auto it = devices.find(deviceId);
+            if (it == devices.end()) return false;
+            info = it->second;
+            return true;
+        }
+        void setDeviceChangeCallback(DeviceChangeCallback cb) override {
+            std::lock_guard<std::mutex> lock(mutex);
+            callback = std::move(cb);
+        }
+        bool hasCallback() {
+            std::lock_guard<std::mutex> lock(mutex);
+            return static_cast<bool>(callback);
+        }
+
+        std::unique_ptr<CaptureStream> openLoopback(const std::wstring &, const StreamConfig &) override { return nullptr; }
+        std::unique_ptr<RenderStream> openRender(const std::wstring &, const StreamConfig &) override { return nullptr; }
+        int waitAny(AudioStream *const *, std::size_t, std::uint32_t) override { return kWaitFailed; }
+        std::uint64_t nowNs() const override { return 0; }
+
+        std::atomic<int> enumerateCalls{ 0 };
+        std::atomic<int> describeCalls{ 0 };
+
+    private:
+        std::mutex mutex;
+        std::map<std::wstring, DeviceInfo> devices;
+        std::vector<std::wstring> order;
+        DeviceChangeCallback callback;
+    };
+
+    DeviceInfo render(const std::wstring &id, const std::wstring &name, bool isDefault = false) {
+        DeviceInfo info;
+        info.id = id;
+        info.name = name;
+        info.isDefault = isDefault;
+        return info;
+    }
+
+    DeviceInfo capture(const std::wstring &id, const std::wstring &name) {
+        DeviceInfo info = render(id, name);
+        info.isRender = false;
+        return info;
+    }
+
+    bool contains(const std::vector<DeviceInfo> &list, const std::wstring &id) {
+        return std::any_of(list.begin(), list.end(), [&](const DeviceInfo &d) { return d.id == id; });
+    }
+}
+
+TEST_CASE(DeviceRegistry, FindByIdBeforeEnumerationOnlyDescribes) {
+    FakeNotifierBackend backend;
+    backend.set(render(L"spk", L"Speakers"));
+    DeviceRegistry registry(backend);
+    CHECK(backend.hasCallback());
+
+    // 按保存的 ID 启动：只查询这一个端点
+    const auto found = registry.find(L"spk");
+    REQUIRE(found.has_value());
+    CHECK(found->name == L"Speakers");
+    CHECK(!registry.find(L"missing").has_value());
+    CHECK_EQ(backend.enumerateCalls.load(), 0);
+    CHECK_EQ(registry.enumerations(), 0u);
+}
+
+TEST_CASE(DeviceRegistry, EnumeratesOnceAndKeysByEndpointId) {
+    FakeNotifierBackend backend;
+    // 同型号的两个设备：友好名称相同，按 ID 区分
+    backend.set(render(L"usb-1", L"USB Audio", true));
+    backend.set(render(L"usb-2", L"USB Audio"));
+    backend.set(capture(L"mic", L"Microphone"));
+    DeviceRegistry registry(backend);
+
+    for (int i = 0; i < 10; ++i) {
+        const auto list = registry.devices();
+        CHECK_EQ(list.size(), 3u);
+        CHECK(registry.find(L"usb-2").has_value());
+        CHECK(registry.defaultDevice(true) == L"usb-1");
+    }
+    CHECK_EQ(backend.enumerateCalls.load(), 1);
+    CHECK(registry.find(L"usb-1")->id != registry.find(L"usb-2")->id);
+    CHECK(registry.defaultDevice(false).empty());
+}
+
+TEST_CASE(DeviceRegistry, AppliesNotificationsIncrementally) {
+    FakeNotifierBackend backend;
+    backend.set(render(L"a", L"A", true));
+    backend.set(render(L"b", L"B"));
+    backend.set(capture(L"mic", L"Mic"));
+    DeviceRegistry registry(backend);
+    std::atomic<int> callbacks{ 0 };
+    registry.setChangedCallback([&] { ++callbacks; });
+    registry.devices();
+    const int describesBefore = backend.describeCalls.load();
+    const std::uint64_t generation = registry.generation();
+
+    // 新增：只查询新端点
+    backend.set(render(L"c", L"C"));
+    backend.notify(DeviceChange::Type::Added, L"c");
+    CHECK_EQ(callbacks.load(), 1);
+    CHECK(registry.generation() > generation);
+    CHECK(contains(registry.devices(), L"c"));
+    CHECK_EQ(backend.describeCalls.load(), describesBefore + 1);
+
+    // 属性变化也按 Added 上报：更新原来的条目而不是重复加入
+    backend.set(render(L"c", L"C renamed"));
+    backend.notify(DeviceChange::Type::Added, L"c");
+    const auto list = registry.devices();
+    CHECK_EQ(std::count_if(list.begin(), list.end(), [](const DeviceInfo &d) { return d.id == L"c"; }), 1);
+    CHECK(registry.find(L"c")->name == L"C renamed");
+
+    // 移除
+    backend.erase(L"b");
+    backend.notify(DeviceChange::Type::Removed, L"b");
+    CHECK(!contains(registry.devices(), L"b"));
+    CHECK(!registry.find(L"b").has_value());
+
+    // 默认设备变化只影响同一方向
+    backend.setDefault(L"c", true);
+    backend.notify(DeviceChange::Type::DefaultChanged, L"c", true);
+    CHECK(registry.defaultDevice(true) == L"c");
+    CHECK(!registry.find(L"a")->isDefault);
+    backend.notify(DeviceChange::Type::DefaultChanged, L"mic", false);
+    CHECK(registry.defaultDevice(false) == L"mic");
+    CHECK(registry.defaultDevice(true) == L"c");
+
+    CHECK_EQ(backend.enumerateCalls.load(), 1);
+    CHECK_EQ(callbacks.load(), 5);
+}
+
+TEST_CASE(DeviceRegistry, AddedButAlreadyGoneIsTreatedAsRemoval) {
+    FakeNotifierBackend backend;
+    backend.set(render(L"a", L"A"));
+    backend.set(render(L"flaky", L"Flaky"));
+    DeviceRegistry registry(backend);
+    CHECK(contains(registry.devices(), L"flaky"));
+    // 通知到达之前设备又被拔掉：describe 失败时按移除处理
+    backend.erase(L"flaky");
+    backend.notify(DeviceChange::Type::Added, L"flaky");
+    CHECK(!contains(registry.devices(), L"flaky"));
+}
+
+TEST_CASE(DeviceRegistry, NotificationsBeforeFirstEnumerationAreNotLost) {
+    FakeNotifierBackend backend;
+    backend.set(render(L"a", L"A"));
+    DeviceRegistry registry(backend);
+    // 缓存建立之前收到的变化：枚举之后按顺序再应用一遍
+    backend.set(render(L"b", L"B"));
+    backend.notify(DeviceChange::Type::Added, L"b");
+    backend.erase(L"a");
+    backend.notify(DeviceChange::Type::Removed, L"a");
+    const auto list = registry.devices();
+    CHECK_EQ(list.size(), 1u);
+    CHECK(contains(list, L"b"));
+}
+
+TEST_CASE(DeviceRegistry, RefreshReenumerates) {
+    FakeNotifierBackend backend;
+    backend.set(render(L"a", L"A"));
+    DeviceRegistry registry(backend);
+    registry.devices();
+    // 没有发出通知的变化（例如通知丢失）：手动刷新后才看得到
+    backend.set(render(L"silent", L"Silent"));
+    CHECK(!contains(registry.devices(), L"silent"));
+    registry.refresh();
+    CHECK(contains(registry.devices(), L"silent"));
+    CHECK_EQ(backend.enumerateCalls.load(), 2);
+}
+
+TEST_CASE(DeviceRegistry, ProcessSourcesResolveThroughDescribe) {
+    FakeNotifierBackend backend;
+    backend.set(render(L"a", L"A"));
+    DeviceInfo process;
+    process.id = processLoopbackId(42, true);
+    process.name = L"player";
+    process.isRender = false;
+    process.processId = 42;
+    process.excludeProcessTree = true;
+    DeviceRegistry registry(backend);
+    registry.devices();
+    // 缓存中没有的进程来源直接向后端查询，普通端点不会
+    CHECK(!registry.find(process.id).has_value());
+    backend.setHidden(process);
+    const auto found = registry.find(process.id);
+    REQUIRE(found.has_value());
+    CHECK_EQ(found->processId, 42u);
+    CHECK(found->excludeProcessTree);
+    backend.setHidden(render(L"hidden-endpoint", L"Hidden"));
+    CHECK(!registry.find(L"hidden-endpoint").has_value());
+    CHECK_EQ(backend.enumerateCalls.load(), 1);
+}
+
+TEST_CASE(DeviceRegistry, ProcessLookupsPreferDescribeOverTheCache) {
+    FakeNotifierBackend backend;
+    backend.set(render(L"a", L"A"));
+    for (const std::uint32_t pid : { 7u, 9u }) {
+        DeviceInfo process = capture(processLoopbackId(pid, false), L"player");
+        process.processId = pid;
+        backend.set(process);
+    }
+    DeviceRegistry registry(backend);
+    registry.devices();
+
+    // 进程 7 已退出但还没有通知：按 ID 查询直接问后端，不会拿到缓存中过时的条目
+    backend.erase(processLoopbackId(7, false));
+    const int describes = backend.describeCalls.load();
+    CHECK(!registry.find(processLoopbackId(7, false)).has_value());
+    CHECK(backend.describeCalls.load() > describes);
+    // 按进程名在缓存中找、逐个向后端确认，不重新枚举：跳过已退出的 7，取仍在运行的 9
+    const auto byName = registry.findProcess(L"player");
+    REQUIRE(byName.has_value());
+    CHECK_EQ(byName->processId, 9u);
+    CHECK(!registry.findProcess(L"A").has_value());
+    CHECK(!registry.findProcess(L"missing").has_value());
+    CHECK_EQ(backend.enumerateCalls.load(), 1);
+}
+
+TEST_CASE(DeviceRegistry, CallbackCanBeCancelled) {
+    FakeNotifierBackend backend;
+    std::atomic<int> callbacks{ 0 };
+    {
+        DeviceRegistry registry(backend);
+        registry.setChangedCallback([&] { ++callbacks; });
+        backend.notify(DeviceChange::Type::Added, L"x");
+        registry.setChangedCallback(nullptr);
+        backend.notify(DeviceChange::Type::Added, L"y");
+        CHECK_EQ(callbacks.load(), 1);
+    }
+    // 析构时注销后端回调
+    CHECK(!backend.hasCallback());
+}
+
+TEST_CASE(DeviceRegistry, ConcurrentNotificationsAndQueries) {
+    // 通知线程不停地增删设备，查询线程同时读取；结束后缓存与后端的最终状态一致
+    FakeNotifierBackend backend;
+    backend.set(render(L"fixed", L"Fixed"));
+    DeviceRegistry registry(backend);
+    registry.devices();
+    std::thread notifier([&] {
+        for (int i = 0; i < 2000; ++i) {
+            const std::wstring id = L"dev-" + std::to_wstring(i % 16);
+            if ((i / 16) % 2 == 0) {
+                backend.set(render(id, id));
+                backend.notify(DeviceChange::Type::Added, id);
+            } else {
+                backend.erase(id);
+                backend.notify(DeviceChange::Type::Removed, id);
+            }
+        }
+    });
+    for (int i = 0; i < 2000; ++i) {
+        const auto list = registry.devices();
+        CHECK(contains(list, L"fixed"));
+    }
+    notifier.join();
+    const auto cached = registry.devices();
+    const auto actual = backend.enumerate();
+    CHECK_EQ(cached.size(), actual.size());
+    for (const auto &d : actual) CHECK(contains(cached, d.id));
+    CHECK_EQ(registry.enumerations(), 1u);
+}
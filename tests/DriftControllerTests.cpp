@@ -0,0 +1,114 @@
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <thread>
+
+#include "AudioEngine.h"
+#include "DriftController.h"
+#include "TestSupport.h"
+#include "VirtualBackend.h"
+
+namespace {
+    // 两个独立时钟：生产者按 (1 + producerPpm) 的速率写入，消费者按 (1 + consumerPpm) 的速率、乘以控制器给出的比例读出
+    struct ClockSimulation {
+        double maxErrorFrames = 0.0;   // 稳定后排队量偏离目标的最大值
+        double finalAdjust = 1.0;
+        double minQueue = 1e18;
+        double maxQueue = -1e18;
+    };
+
+    ClockSimulation simulateClocks(const double producerPpm, const double consumerPpm, const double seconds) {
+        constexpr double kRate = 48000.0;
+        constexpr double kTarget = 4800.0;   // 100 ms
+        constexpr double kTick = 0.01;       // 每 10 ms 更新一次
+        DriftController controller(kRate, kTarget);
+        double queue = kTarget;
+        double adjust = 1.0;
+        ClockSimulation result;
+        const auto ticks = static_cast<long>(seconds / kTick);
+        for (long i = 0; i < ticks; ++i) {
+            queue += kRate * (1.0 + producerPpm * 1e-6) * kTick;
+            queue -= kRate * (1.0 + consumerPpm * 1e-6) * adjust * kTick;
+            adjust = controller.update(queue, kRate * kTick);
+            result.minQueue = std::min(result.minQueue, queue);
+            result.maxQueue = std::max(result.maxQueue, queue);
+            // 前 5 分钟为收敛期（大偏差时积分项需要几分钟才能追上）
+            if (i * kTick > 300.0) result.maxErrorFrames = std::max(result.maxErrorFrames, std::fabs(queue - kTarget));
+        }
+        result.finalAdjust = adjust;
+        return result;
+    }
+}
+
+TEST_CASE(DriftController, TracksPpmOffsetBetweenTwoClocks) {
+    // 一小时的模拟：稳定后排队量偏离目标不到 1 帧，比例收敛到两个时钟之比；收敛期间排队量也不会读空或偏离超过 25 ms
+    const double offsets[][2] = { { 0, 0 }, { 100, -100 }, { -250, 250 }, { 500, 0 }, { 0, -1000 }, { 2000, -1500 } };
+    for (const auto &offset : offsets) {
+        const ClockSimulation r = simulateClocks(offset[0], offset[1], 3600.0);
+        const double expected = (1.0 + offset[0] * 1e-6) / (1.0 + offset[1] * 1e-6);
+        std::cout << "  producer " << offset[0] << " ppm, consumer " << offset[1] << " ppm: max error " << r.maxErrorFrames
+                  << " frames, adjust " << (r.finalAdjust - 1.0) * 1e6 << " ppm, queue " << r.minQueue << " .. " << r.maxQueue << '\n';
+        CHECK(r.maxErrorFrames < 1.0);
+        CHECK_NEAR(r.finalAdjust, expected, 2e-6);
+        CHECK(r.minQueue > 4800.0 - 1200.0);
+        CHECK(r.maxQueue < 4800.0 + 1200.0);
+    }
+}
+
+TEST_CASE(DriftController, AdjustIsClampedForImpossibleOffsets) {
+    // 超出 maxAdjust 的偏差无法补偿：比例停在上限，而不是发散
+    const ClockSimulation r = simulateClocks(8000, 0, 600.0);
+    CHECK_NEAR(r.finalAdjust, 1.005, 1e-9);
+}
+
+TEST_CASE(DriftController, SlewsToNewTarget) {
+    constexpr double kRate = 48000.0;
+    DriftController controller(kRate, 4800.0);
+    controller.update(4800.0, 480.0);
+    controller.setTarget(9600.0);
+    // 目标按 targetSlew（每秒 4 ms）移动：0.5 秒后最多移动 96 帧
+    for (int i = 0; i < 50; ++i) controller.update(4800.0, 480.0);
+    CHECK(controller.targetFrames() > 4800.0);
+    CHECK(controller.targetFrames() <= 4800.0 + 0.004 * kRate * 0.5 + 1.0);
+    for (int i = 0; i < 50 * 60; ++i) controller.update(4800.0, 480.0);
+    CHECK_NEAR(controller.targetFrames(), 9600.0, 1e-6);
+}
+
+TEST_CASE(DriftController, EngineHoldsLatencyWithDriftingDevices) {
+    // 端到端：离散事件虚拟时钟下来源快 300 ppm、输出慢 200 ppm，跑 10 分钟（虚拟时间）
+    // 稳态下不丢帧、不欠载，实测延迟的波动不超过几毫秒
+    auto backend = std::make_unique<VirtualBackend>(std::make_shared<VirtualClock>(0.0));
+    VirtualDeviceSpec output;
+    output.id = L"out";
+    output.ppm = -200.0;
+    backend->addDevice(output);
+    VirtualDeviceSpec source;
+    source.id = L"src";
+    source.ppm = 300.0;
+    backend->addDevice(source);
+
+    AudioEngine engine(std::move(backend));
+    StreamConfig config;
+    config.bufferMs = 60;
+    REQUIRE(engine.startCopy({ L"src" }, L"out", config));
+    AudioBackend &clock = engine.backend();
+    const std::uint64_t startNs = clock.nowNs();
+    const auto waitUntil = [&](double seconds) {
+        while (clock.nowNs() - startNs < static_cast<std::uint64_t>(seconds * 1e9)) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    };
+    // 收敛后记下基线，再跑到结束
+    waitUntil(30.0);
+    const EngineStatsSnapshot settled = engine.statsSnapshot();
+    waitUntil(600.0);
+    const EngineStatsSnapshot end = engine.statsSnapshot();
+    engine.stopCopy();
+
+    std::cout << "  dropped " << end.framesDropped - settled.framesDropped << ", underruns " << end.underruns - settled.underruns
+              << ", latency p50 " << end.latencyP50Ms << " min " << end.latencyMinMs << " max " << end.latencyMaxMs
+              << " ms, ring " << end.ringFillMs << " ms\n";
+    CHECK_EQ(end.framesDropped - settled.framesDropped, 0u);
+    CHECK_EQ(end.underruns - settled.underruns, 0u);
+    CHECK_EQ(end.overruns - settled.overruns, 0u);
+    CHECK(end.latencyP99Ms - end.latencyP50Ms < 5.0);
+    CHECK_NEAR(end.ringFillMs, settled.ringFillMs, 10.0);
+}
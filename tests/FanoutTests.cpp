@@ -0,0 +1,142 @@
+// 多路输出：主输出与附加输出的设备时钟各有偏差（其中一路采样率也不同），来源每秒一个脉冲；
+// 对齐之后同一个脉冲在各输出上的播放时刻只差漂移控制的残余（两帧以内），各附加输出的漂移控制收敛到与主输出相同的播放速度
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "AudioEngine.h"
+#include "TestSupport.h"
+#include "VirtualBackend.h"
+#include "WavFile.h"
+
+namespace {
+    constexpr std::uint32_t kRate = 48000;
+    constexpr float kImpulse = 0.8f;
+
+    struct SinkSpec {
+        const wchar_t *id;
+        std::uint32_t rate;
+        double ppm;
+    };
+    // 第一个为主输出
+    const SinkSpec kSinks[] = { { L"out", 48000, 40.0 }, { L"out2", 48000, 300.0 }, { L"out3", 44100, -250.0 } };
+    constexpr std::size_t kSinkCount = sizeof(kSinks) / sizeof(kSinks[0]);
+
+    // 每秒一个脉冲的来源内容，写到本次运行独有的临时文件
+    class ImpulseWav {
+    public:
+        ImpulseWav() {
+            std::random_device random;
+            path = std::filesystem::temp_directory_path() / ("audiorepeater-fanout-" + std::to_string(random()) + ".wav");
+            std::vector<float> samples(static_cast<std::size_t>(kRate) * 2, 0.0f);
+            samples[0] = samples[1] = kImpulse;
+            WavWriter writer;
+            if (writer.open(path, StreamFormat{ kRate, 2 })) writer.write(samples.data(), kRate);
+        }
+        ~ImpulseWav() {
+            std::error_code ignored;
+            std::filesystem::remove(path, ignored);
+        }
+
+        std::filesystem::path path;
+    };
+
+    // 各输出播放出的左声道
+    struct Played {
+        std::mutex mutex;
+        std::vector<std::vector<float>> frames = std::vector<std::vector<float>>(kSinkCount);
+    };
+
+    // 脉冲的播放时刻（纳秒，以峰值附近三点的抛物线插值到帧以下）
+    std::vector<double> impulseTimes(const std::vector<float> &left, const SinkSpec &sink, const std::uint64_t startNs) {
+        const double framesPerNs = sink.rate * (1.0 + sink.ppm * 1e-6) / 1e9;
+        std::vector<double> times;
+        for (std::size_t i = 1; i + 1 < left.size(); ++i) {
+            if (left[i] < 0.5f * kImpulse || left[i] < left[i - 1] || left[i] < left[i + 1]) continue;
+            const double curvature = left[i - 1] - 2.0 * left[i] + left[i + 1];
+            const double offset = curvature != 0.0 ? 0.5 * (left[i - 1] - left[i + 1]) / curvature : 0.0;
+            times.push_back(static_cast<double>(startNs) + (static_cast<double>(i) + offset) / framesPerNs);
+            i += sink.rate / 2;
+        }
+        return times;
+    }
+}
+
+TEST_CASE(Fanout, ImpulseAlignedAcrossDriftingSinks) {
+    const ImpulseWav wav;
+    auto backend = std::make_unique<VirtualBackend>(std::make_shared<VirtualClock>(0.0));
+    VirtualBackend &virtualBackend = *backend;
+    for (const SinkSpec &sink : kSinks) {
+        VirtualDeviceSpec device;
+        device.id = sink.id;
+        device.format = StreamFormat{ sink.rate, 2 };
+        device.periodFrames = sink.rate / 100;
+        device.ppm = sink.ppm;
+        backend->addDevice(device);
+    }
+    VirtualDeviceSpec source;
+    source.id = L"src";
+    source.inputWav = wav.path;
+    source.ppm = -100.0;
+    backend->addDevice(source);
+    Played played;
+    backend->setRenderTap([&played](const std::wstring &deviceId, const float *frames, const std::uint32_t count) {
+        for (std::size_t s = 0; s < kSinkCount; ++s) {
+            if (deviceId != kSinks[s].id) continue;
+            std::lock_guard<std::mutex> lock(played.mutex);
+            for (std::uint32_t i = 0; i < count; ++i) played.frames[s].push_back(frames[i * 2]);
+        }
+    });
+
+    AudioEngine engine(std::move(backend));
+    REQUIRE(engine.startCopy({ L"src" }, L"out", StreamConfig{}));
+    for (std::size_t s = 1; s < kSinkCount; ++s) REQUIRE(engine.addOutput(kSinks[s].id));
+    const std::uint64_t start = engine.backend().nowNs();
+    while (engine.backend().nowNs() - start < 40000000000ull) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    engine.stopCopy();
+    CHECK_EQ(engine.statsSnapshot().underruns, 0u);
+
+    std::lock_guard<std::mutex> lock(played.mutex);
+    std::vector<std::vector<double>> times;
+    for (std::size_t s = 0; s < kSinkCount; ++s) {
+        times.push_back(impulseTimes(played.frames[s], kSinks[s], virtualBackend.renderStartNs(kSinks[s].id)));
+        REQUIRE(times.back().size() > 30u);
+    }
+
+    constexpr double kFrameNs = 1e9 / kRate;
+    constexpr double kSettleNs = 12e9;
+    for (std::size_t s = 1; s < kSinkCount; ++s) {
+        // 与主输出上同一个脉冲（半秒之内最近的一个）比较：启动时相差约 10 帧，收敛之后只剩漂移控制的残余抖动（两帧以内）
+        double worstFrames = 0.0;
+        std::size_t compared = 0;
+        for (const double t : times[s]) {
+            if (t < times[0].front() + kSettleNs) continue;
+            double nearest = times[0].front();
+            for (const double p : times[0]) {
+                if (std::fabs(p - t) < std::fabs(nearest - t)) nearest = p;
+            }
+            if (std::fabs(nearest - t) > 0.5e9) continue;
+            worstFrames = std::max(worstFrames, std::fabs(t - nearest) / kFrameNs);
+            ++compared;
+        }
+        // 漂移控制收敛：最后 20 个脉冲的平均间隔与主输出一致（不补偿时每秒相差两路时钟偏差之差，这里为 10 帧以上）
+        const std::vector<double> &own = times[s];
+        const double spacing = (own.back() - own[own.size() - 21]) / 20.0;
+        const double spacingPrimary = (times[0].back() - times[0][times[0].size() - 21]) / 20.0;
+        std::cout << "  sink " << s << ": worst offset " << worstFrames << " frames over " << compared
+                  << " impulses, spacing error " << (spacing - spacingPrimary) / kFrameNs << " frames\n";
+        CHECK(compared >= 25u);
+        CHECK(worstFrames < 2.0);
+        CHECK_NEAR(spacing, spacingPrimary, 0.25 * kFrameNs);
+    }
+}
@@ -0,0 +1,138 @@
+// 自适应抖动缓冲与丢包补偿：虚拟来源按到达时刻记录投递（先平稳、再一段随机抖动加丢包、再长时间平稳），
+// 检查目标排队量随抖动升高并在抖动消失后回落、补偿与恢复处没有阶跃、欠载次数有上限
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "AudioEngine.h"
+#include "TestSupport.h"
+#include "VirtualBackend.h"
+
+namespace {
+    constexpr double kPi = 3.14159265358979323846;
+    constexpr std::uint32_t kRate = 48000;
+    constexpr double kToneHz = 300.0;
+    constexpr float kToneLevel = 0.25f;
+    constexpr double kPeriodMs = 10.0;
+
+    // 平稳 → 抖动 → 平稳 的到达时刻（毫秒，NaN 为丢失的包）
+    constexpr std::size_t kSteadyPackets = 200;   // 2 秒
+    constexpr std::size_t kJitterPackets = 300;   // 3 秒
+    constexpr std::size_t kCalmPackets = 4000;    // 40 秒（记录循环使用，须长于整个测试）
+    constexpr double kJitterMs = 25.0;
+    constexpr double kDropRate = 0.03;
+
+    std::vector<double> arrivalTrace() {
+        std::mt19937 rng(42);
+        std::uniform_real_distribution<double> delay(0.0, kJitterMs);
+        std::uniform_real_distribution<double> unit(0.0, 1.0);
+        std::vector<double> arrivals;
+        double last = 0.0;
+        for (std::size_t i = 0; i < kSteadyPackets + kJitterPackets + kCalmPackets; ++i) {
+            const double ideal = static_cast<double>(i) * kPeriodMs;
+            const bool jittery = i >= kSteadyPackets && i < kSteadyPackets + kJitterPackets;
+            if (jittery && unit(rng) < kDropRate) {
+                arrivals.push_back(std::numeric_limits<double>::quiet_NaN());
+                continue;
+            }
+            // 仍按顺序投递：晚到的包之后的包不会更早
+            last = std::max(last, ideal + (jittery ? delay(rng) : 0.0));
+            arrivals.push_back(last);
+        }
+        return arrivals;
+    }
+
+    struct Fixture {
+        std::mutex mutex;
+        std::vector<float> played;   // 主输出的左声道
+        std::unique_ptr<AudioEngine> engine;
+
+        Fixture() {
+            auto backend = std::make_unique<VirtualBackend>(std::make_shared<VirtualClock>(0.0));
+            VirtualDeviceSpec output;
+            output.id = L"out";
+            output.toneHz = 0.0;
+            backend->addDevice(output);
+            VirtualDeviceSpec source;
+            source.id = L"src";
+            source.toneHz = kToneHz;
+            source.toneLevel = kToneLevel;
+            source.arrivalTraceMs = arrivalTrace();   // 同一个种子，与用例中数出的丢包一致
+            backend->addDevice(source);
+            backend->setRenderTap([this](const std::wstring &deviceId, const float *frames, std::uint32_t count) {
+                if (deviceId != L"out") return;
+                std::lock_guard<std::mutex> lock(mutex);
+                for (std::uint32_t i = 0; i < count; ++i) played.push_back(frames[i * 2]);
+            });
+            engine = std::make_unique<AudioEngine>(std::move(backend));
+        }
+
+        // 从启动起跑到虚拟时间 ms 毫秒
+        void runUntil(const std::uint64_t ms) {
+            AudioBackend &clock = engine->backend();
+            while (clock.nowNs() - startNs < ms * 1000000ull) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        std::uint64_t startNs = 0;
+    };
+}
+
+TEST_CASE(JitterBuffer, AdaptsToJitterAndConcealsSmoothly) {
+    Fixture fixture;
+    const std::vector<double> trace = arrivalTrace();
+    const auto dropped = static_cast<std::uint64_t>(std::count_if(trace.begin(), trace.end(), [](double t) { return std::isnan(t); }));
+    StreamConfig config;
+    config.bufferMs = 200;
+    config.adaptiveBuffer = true;
+    REQUIRE(fixture.engine->startCopy({ L"src" }, L"out", config));
+    fixture.startNs = fixture.engine->backend().nowNs();
+
+    // 平稳阶段：目标停在下限附近
+    fixture.runUntil(1800);
+    const EngineStatsSnapshot steady = fixture.engine->statsSnapshot();
+    // 抖动阶段：目标随抖动升高，丢包由补偿填上
+    double peakTargetMs = 0.0;
+    for (std::uint64_t ms = 2100; ms <= 5100; ms += 100) {
+        fixture.runUntil(ms);
+        peakTargetMs = std::max(peakTargetMs, fixture.engine->statsSnapshot().queueTargetMs);
+    }
+    const EngineStatsSnapshot jittered = fixture.engine->statsSnapshot();
+    // 抖动消失后按 kJitterReleaseMs 的时间常数回落（30 秒约为 3 个时间常数）
+    fixture.runUntil(35000);
+    const EngineStatsSnapshot calm = fixture.engine->statsSnapshot();
+    fixture.engine->stopCopy();
+
+    std::cout << "  target " << steady.queueTargetMs << " -> " << peakTargetMs << " -> " << calm.queueTargetMs
+              << " ms, dropped " << dropped << ", concealments " << jittered.concealments << ", underruns " << calm.underruns << '\n';
+    CHECK(jittered.jitterMs > steady.jitterMs);
+    CHECK(peakTargetMs > steady.queueTargetMs + 10.0);
+    CHECK(calm.queueTargetMs < peakTargetMs);
+    CHECK(calm.queueTargetMs - steady.queueTargetMs < 0.25 * (peakTargetMs - steady.queueTargetMs));
+    CHECK(calm.queueTargetMs <= config.bufferMs);
+
+    // 每个丢失的包都被补偿；欠载只出现在目标还没跟上抖动的时候（远少于晚到的包），之后的平稳阶段没有
+    CHECK(dropped > 0u);
+    CHECK(jittered.concealments - steady.concealments >= dropped);
+    CHECK(jittered.underruns <= 5u);
+    CHECK_EQ(calm.underruns, jittered.underruns);
+
+    // 补偿信号与真实数据之间交叉淡化：相邻样本之差不超过正弦本身最大斜率的几倍（硬切换会跳到满幅的量级）
+    std::lock_guard<std::mutex> lock(fixture.mutex);
+    REQUIRE(fixture.played.size() > kRate * 30);
+    const double naturalStep = kToneLevel * 2.0 * kPi * kToneHz / kRate;
+    double maxStep = 0.0;
+    for (std::size_t i = kRate; i < fixture.played.size(); ++i) {
+        maxStep = std::max(maxStep, static_cast<double>(std::fabs(fixture.played[i] - fixture.played[i - 1])));
+    }
+    std::cout << "  max step " << maxStep << " (sine " << naturalStep << ")\n";
+    CHECK(maxStep < 3.0 * naturalStep);
+}
@@ -0,0 +1,123 @@
+// 低延迟模式：render 线程按 render 设备自己的事件补充数据（不跟随 capture 事件），
+// 周期为协商到的最小周期；引擎报告实际得到的周期与模式
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "AudioEngine.h"
+#include "TestSupport.h"
+#include "VirtualBackend.h"
+
+namespace {
+    constexpr std::uint32_t kRate = 48000;
+
+    struct Refill {
+        std::uint64_t ns;
+        std::uint32_t frames;
+    };
+
+    struct RefillLog {
+        std::mutex mutex;
+        std::vector<Refill> refills;
+        LatencyReport report;
+    };
+
+    // 来源的周期固定为 10 ms（与 render 周期不同），跑 1 秒（虚拟时间），记下主输出每次被写入的时刻
+    void run(RefillLog &log, const StreamConfig &config, const bool supportsExclusive) {
+        auto backend = std::make_unique<VirtualBackend>(std::make_shared<VirtualClock>(0.0));
+        VirtualDeviceSpec output;
+        output.id = L"out";
+        output.periodFrames = 480;
+        output.minPeriodFrames = 128;
+        output.supportsExclusive = supportsExclusive;
+        backend->addDevice(output);
+        VirtualDeviceSpec source;
+        source.id = L"src";
+        source.periodFrames = 480;
+        source.minPeriodFrames = 480;
+        backend->addDevice(source);
+        backend->setRefillTap([&log](const std::wstring &deviceId, const std::uint64_t nowNs, const std::uint32_t frames) {
+            if (deviceId != L"out") return;
+            std::lock_guard<std::mutex> lock(log.mutex);
+            log.refills.push_back({ nowNs, frames });
+        });
+
+        AudioEngine engine(std::move(backend));
+        if (!engine.startCopy({ L"src" }, L"out", config)) return;
+        log.report = engine.latencyReport();
+        AudioBackend &clock = engine.backend();
+        const std::uint64_t start = clock.nowNs();
+        while (clock.nowNs() - start < 1000000000ull) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        engine.stopCopy();
+    }
+
+    // 启动 100 ms 之后，相邻两次补充的间隔都是整数个 render 周期，且绝大多数正好一个周期
+    void checkRefillCadence(RefillLog &log, const std::uint32_t periodFrames) {
+        std::lock_guard<std::mutex> lock(log.mutex);
+        REQUIRE(log.refills.size() > 10u);
+        const double periodNs = 1e9 * periodFrames / kRate;
+        const std::uint64_t settleNs = log.refills.front().ns + 100000000ull;
+        std::size_t intervals = 0;
+        std::size_t single = 0;
+        std::uint64_t firstNs = 0;
+        for (std::size_t i = 1; i < log.refills.size(); ++i) {
+            if (log.refills[i - 1].ns < settleNs) continue;
+            if (intervals == 0) firstNs = log.refills[i - 1].ns;
+            const double periods = static_cast<double>(log.refills[i].ns - log.refills[i - 1].ns) / periodNs;
+            const double whole = std::round(periods);
+            CHECK(whole >= 1.0);
+            CHECK_NEAR(periods, whole, 0.001);
+            CHECK(log.refills[i].frames <= log.report.renderBufferFrames);
+            ++intervals;
+            single += whole == 1.0 ? 1 : 0;
+        }
+        // 每个周期都补充了一次（没有漏掉的事件）
+        REQUIRE(intervals > 0u);
+        CHECK_NEAR(static_cast<double>(intervals), static_cast<double>(log.refills.back().ns - firstNs) / periodNs, 1.0);
+        CHECK(single * 10 >= intervals * 9);
+    }
+}
+
+TEST_CASE(LowLatency, RefillsOnRenderEventAtMinimumPeriod) {
+    RefillLog log;
+    StreamConfig config;
+    config.lowLatency = true;
+    run(log, config, false);
+    CHECK(log.report.renderMode == StreamMode::SharedLowLatency);
+    CHECK_EQ(log.report.renderPeriodFrames, 128u);
+    CHECK_EQ(log.report.renderBufferFrames, 256u);
+    CHECK_EQ(log.report.sampleRate, kRate);
+    // 来源每 10 ms 才来一个包，render 仍按自己的 2.67 ms 周期补充
+    CHECK_EQ(log.report.capturePeriodFrames, 480u);
+    checkRefillCadence(log, 128);
+}
+
+TEST_CASE(LowLatency, ExclusiveWhenAllowedAndSupported) {
+    RefillLog log;
+    StreamConfig config;
+    config.lowLatency = true;
+    config.allowExclusive = true;
+    run(log, config, true);
+    CHECK(log.report.renderMode == StreamMode::Exclusive);
+    CHECK_EQ(log.report.renderPeriodFrames, 128u);
+    checkRefillCadence(log, 128);
+
+    // 设备不支持独占时退回最小共享周期
+    RefillLog shared;
+    run(shared, config, false);
+    CHECK(shared.report.renderMode == StreamMode::SharedLowLatency);
+    CHECK_EQ(shared.report.renderPeriodFrames, 128u);
+}
+
+TEST_CASE(LowLatency, NormalModeUsesDefaultPeriod) {
+    RefillLog log;
+    run(log, StreamConfig{}, true);
+    CHECK(log.report.renderMode == StreamMode::Shared);
+    CHECK_EQ(log.report.renderPeriodFrames, 480u);
+    checkRefillCadence(log, 480);
+}
@@ -0,0 +1,136 @@
+// 混音：各 SIMD 内核与标量实现一致，增益与饱和正确；Mixer::mixRouted 按来源增益求和并饱和
+
+#include <cstddef>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "FanoutRing.h"
+#include "Mixer.h"
+#include "RoutingMatrix.h"
+#include "SpscRing.h"
+#include "TestSupport.h"
+
+namespace {
+    constexpr std::size_t kChannels = 2;
+
+    std::vector<float> randomSamples(const std::size_t count, const unsigned seed, const float range) {
+        std::mt19937 rng(seed);
+        std::uniform_real_distribution<float> uniform(-range, range);
+        std::vector<float> samples(count);
+        for (float &s : samples) s = uniform(rng);
+        return samples;
+    }
+
+    const MixKernels *const kKernels[] = { &sse2MixKernels(), &avx2MixKernels(), &mixKernels() };
+}
+
+TEST_CASE(Mixer, AccumulateKernelsMatchScalar) {
+    // 长度覆盖各向量宽度的主循环与标量收尾；AVX2 用 FMA（只舍入一次），与先乘后加差在一个舍入误差内
+    for (std::size_t samples = 0; samples <= 67; ++samples) {
+        const std::vector<float> src = randomSamples(samples, 1 + static_cast<unsigned>(samples), 1.0f);
+        const std::vector<float> base = randomSamples(samples, 100 + static_cast<unsigned>(samples), 1.0f);
+        std::vector<float> expected = base;
+        scalarMixKernels().accumulate(expected.data(), src.data(), samples, 0.37f);
+        for (const MixKernels *kernels : kKernels) {
+            std::vector<float> out = base;
+            kernels->accumulate(out.data(), src.data(), samples, 0.37f);
+            for (std::size_t i = 0; i < samples; ++i) CHECK_NEAR(out[i], expected[i], 1e-6);
+        }
+    }
+}
+
+TEST_CASE(Mixer, SaturateKernelsMatchScalar) {
+    for (std::size_t samples = 0; samples <= 67; ++samples) {
+        const std::vector<float> base = randomSamples(samples, 7 + static_cast<unsigned>(samples), 2.0f);
+        std::vector<float> expected = base;
+        scalarMixKernels().saturate(expected.data(), samples);
+        for (const MixKernels *kernels : kKernels) {
+            std::vector<float> out = base;
+            kernels->saturate(out.data(), samples);
+            for (std::size_t i = 0; i < samples; ++i) CHECK_EQ(out[i], expected[i]);
+        }
+    }
+}
+
+TEST_CASE(Mixer, GainAndSaturation) {
+    const MixKernels *const all[] = { &scalarMixKernels(), &sse2MixKernels(), &avx2MixKernels() };
+    for (const MixKernels *kernels : all) {
+        // 20 个样本：各宽度的主循环与收尾都走到
+        std::vector<float> dst(20, 0.25f);
+        const std::vector<float> src(20, 0.5f);
+        kernels->accumulate(dst.data(), src.data(), dst.size(), 0.5f);
+        for (const float v : dst) CHECK_EQ(v, 0.5f);
+        kernels->accumulate(dst.data(), src.data(), dst.size(), -3.0f);
+        for (const float v : dst) CHECK_EQ(v, -1.0f);
+        // 零增益不改变累加结果
+        kernels->accumulate(dst.data(), src.data(), dst.size(), 0.0f);
+        for (const float v : dst) CHECK_EQ(v, -1.0f);
+
+        std::vector<float> values;
+        for (int round = 0; round < 3; ++round) {
+            for (const float v : { 2.0f, -2.0f, 0.5f, -1.0f, 1.0f, 1.0000001f, -1e30f, 0.0f }) values.push_back(v);
+        }
+        kernels->saturate(values.data(), values.size());
+        for (std::size_t i = 0; i < values.size(); i += 8) {
+            CHECK_EQ(values[i], 1.0f);
+            CHECK_EQ(values[i + 1], -1.0f);
+            CHECK_EQ(values[i + 2], 0.5f);
+            CHECK_EQ(values[i + 3], -1.0f);
+            CHECK_EQ(values[i + 4], 1.0f);
+            CHECK_EQ(values[i + 5], 1.0f);
+            CHECK_EQ(values[i + 6], -1.0f);
+            CHECK_EQ(values[i + 7], 0.0f);
+        }
+    }
+}
+
+TEST_CASE(Mixer, RoutedMixSumsSourcesWithGain) {
+    constexpr std::size_t kFrames = 64;
+    RoutingMatrix matrix(2, 1);
+    Route route;
+    route.gain = 0.5f;
+    matrix.setRoute(1, 0, route);
+    matrix.publish();
+
+    std::vector<std::unique_ptr<SpscRing<float>>> rings;
+    std::vector<std::unique_ptr<FanoutRing>> histories;
+    MixInput inputs[2];
+    for (std::size_t i = 0; i < 2; ++i) {
+        rings.push_back(std::make_unique<SpscRing<float>>(kFrames * 4, kChannels));
+        histories.push_back(std::make_unique<FanoutRing>(kFrames * 4, kChannels));
+        histories.back()->commitWrite(histories.back()->capacity());
+        inputs[i] = MixInput{ rings.back().get(), 1.0f, histories.back().get(), i };
+    }
+    inputs[0].gain = 0.5f;
+    const Mixer mixer(kChannels, kFrames);
+    FanoutRing out(kFrames * 4, kChannels);
+    const std::size_t bus = 0;
+
+    // 来源 0：0.6 × 来源增益 0.5；来源 1：0.8 × 路由增益 0.5，只有前一半的数据（其余按静音）
+    const std::vector<float> a(kFrames * kChannels, 0.6f);
+    const std::vector<float> b(kFrames / 2 * kChannels, 0.8f);
+    rings[0]->push(a.data(), kFrames);
+    rings[1]->push(b.data(), kFrames / 2);
+    RouteTable table = matrix.acquire();
+    mixer.mixRouted(inputs, 2, table, &bus, 1, out, kFrames);
+    matrix.release();
+    auto regions = out.readRegions(out.writePosition() - kFrames, kFrames);
+    REQUIRE(regions.frames() == kFrames);
+    for (std::size_t f = 0; f < kFrames; ++f) {
+        const float expected = f < kFrames / 2 ? 0.7f : 0.3f;
+        for (std::size_t c = 0; c < kChannels; ++c) CHECK_NEAR(regions.first.data[f * kChannels + c], expected, 1e-6);
+    }
+    CHECK_EQ(rings[1]->readAvailable(), 0u);
+
+    // 总和超过满幅时饱和到 ±1
+    const std::vector<float> loud(kFrames * kChannels, 1.5f);
+    rings[0]->push(loud.data(), kFrames);
+    rings[1]->push(loud.data(), kFrames);
+    table = matrix.acquire();
+    mixer.mixRouted(inputs, 2, table, &bus, 1, out, kFrames);
+    matrix.release();
+    regions = out.readRegions(out.writePosition() - kFrames, kFrames);
+    for (std::size_t i = 0; i < kFrames * kChannels; ++i) CHECK_EQ(regions.first.data[i], 1.0f);
+}
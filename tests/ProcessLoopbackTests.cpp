@@ -0,0 +1,168 @@
+// 进程来源：虚拟后端上的假进程（各自播放一个正弦，带父子关系）经进程 loopback 送到输出，
+// 按输出中各频率的幅度判断捕获到的是哪些进程
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "AudioEngine.h"
+#include "TestSupport.h"
+#include "VirtualBackend.h"
+
+namespace {
+    constexpr double kPi = 3.14159265358979323846;
+    constexpr std::uint32_t kRate = 48000;
+
+    constexpr double kPlayerHz = 1000.0;   // 进程 100
+    constexpr double kChildHz = 1500.0;    // 进程 101，父进程为 100
+    constexpr double kOtherHz = 700.0;     // 进程 200，与 100 无关
+
+    std::unique_ptr<VirtualBackend> makeBackend() {
+        auto backend = std::make_unique<VirtualBackend>(std::make_shared<VirtualClock>(0.0));
+        VirtualDeviceSpec output;
+        output.id = L"out";
+        output.name = L"Speakers";
+        output.toneHz = 0.0;
+        backend->addDevice(output);
+        backend->addProcess({ 100, 0, L"player.exe", kPlayerHz, 0.2f });
+        backend->addProcess({ 101, 100, L"player-helper.exe", kChildHz, 0.2f });
+        backend->addProcess({ 200, 0, L"other.exe", kOtherHz, 0.2f });
+        backend->addProcess({ 300, 0, L"idle.exe", 0.0, 0.2f });
+        return backend;
+    }
+
+    // 单声道序列中 hz 处正弦的幅度：按 100 ms 的窗做 Goertzel 再取平均
+    // （漂移控制会让频率偏开几百 ppm，窗太长时相位累积偏差会抵消掉幅度）
+    double toneAmplitude(const std::vector<float> &mono, const double hz) {
+        constexpr std::size_t kWindow = kRate / 10;
+        const double coeff = 2.0 * std::cos(2.0 * kPi * hz / kRate);
+        double sum = 0.0;
+        std::size_t windows = 0;
+        for (std::size_t begin = 0; begin + kWindow <= mono.size(); begin += kWindow, ++windows) {
+            double s1 = 0.0;
+            double s2 = 0.0;
+            for (std::size_t i = begin; i < begin + kWindow; ++i) {
+                const double s0 = mono[i] + coeff * s1 - s2;
+                s2 = s1;
+                s1 = s0;
+            }
+            const double power = s1 * s1 + s2 * s2 - coeff * s1 * s2;
+            sum += 2.0 * std::sqrt(std::max(power, 0.0)) / kWindow;
+        }
+        return windows ? sum / static_cast<double>(windows) : 0.0;
+    }
+
+    // 以 sourceId 为唯一来源跑 2 秒（虚拟时间），返回输出最后 1 秒的左声道
+    std::vector<float> captureThrough(const std::wstring &sourceId) {
+        auto backend = makeBackend();
+        std::mutex mutex;
+        std::vector<float> played;
+        backend->setRenderTap([&](const std::wstring &deviceId, const float *frames, std::uint32_t count) {
+            if (deviceId != L"out") return;
+            std::lock_guard<std::mutex> lock(mutex);
+            for (std::uint32_t i = 0; i < count; ++i) played.push_back(frames[i * 2]);
+        });
+        AudioEngine engine(std::move(backend));
+        StreamConfig config;
+        config.bufferMs = 40;
+        if (!engine.startCopy({ sourceId }, L"out", config)) return {};
+        AudioBackend &clock = engine.backend();
+        const std::uint64_t startNs = clock.nowNs();
+        while (clock.nowNs() - startNs < 2000000000ull) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        engine.stopCopy();
+        std::lock_guard<std::mutex> lock(mutex);
+        if (played.size() < kRate) return {};
+        return std::vector<float>(played.end() - kRate, played.end());
+    }
+}
+
+TEST_CASE(ProcessLoopback, IdsRoundTrip) {
+    CHECK(processLoopbackId(1234, false) == L"process:1234");
+    CHECK(processLoopbackId(1234, true) == L"process:1234:exclude");
+
+    std::uint32_t pid = 0;
+    bool exclude = true;
+    REQUIRE(parseProcessLoopbackId(L"process:1234", pid, exclude));
+    CHECK_EQ(pid, 1234u);
+    CHECK(!exclude);
+    REQUIRE(parseProcessLoopbackId(L"process:4294967295:exclude", pid, exclude));
+    CHECK_EQ(pid, 4294967295u);
+    CHECK(exclude);
+
+    for (const wchar_t *bad : { L"process:", L"process:0", L"process:12a", L"process:4294967296", L"process::exclude",
+                                L"process:-1", L"Process:12", L"{0.0.0.00000000}.{guid}", L"" }) {
+        CHECK(!parseProcessLoopbackId(bad, pid, exclude));
+    }
+}
+
+TEST_CASE(ProcessLoopback, EnumerateListsPlayingProcesses) {
+    auto backend = makeBackend();
+    const std::vector<DeviceInfo> devices = backend->enumerate();
+    const auto find = [&](const std::wstring &id) -> const DeviceInfo * {
+        for (const auto &d : devices) {
+            if (d.id == id) return &d;
+        }
+        return nullptr;
+    };
+    const DeviceInfo *player = find(L"process:100");
+    REQUIRE(player != nullptr);
+    CHECK_EQ(player->processId, 100u);
+    CHECK(player->name == L"player.exe");
+    CHECK(!player->isRender);
+    CHECK(!player->excludeProcessTree);
+    CHECK(isLoopbackSource(*player));
+    // 有音频会话但静音的进程也列出；排除进程树的来源不单独列出
+    CHECK(find(L"process:300") != nullptr);
+    CHECK(find(L"process:100:exclude") == nullptr);
+    const DeviceInfo *output = find(L"out");
+    REQUIRE(output != nullptr);
+    CHECK_EQ(output->processId, 0u);
+
+    DeviceInfo info;
+    REQUIRE(backend->describe(L"process:100:exclude", info));
+    CHECK_EQ(info.processId, 100u);
+    CHECK(info.excludeProcessTree);
+    CHECK(!backend->describe(L"process:999", info));
+
+    // 进程退出后不再出现，也查询不到
+    backend->removeProcess(200);
+    CHECK(!backend->describe(L"process:200", info));
+    for (const auto &d : backend->enumerate()) CHECK(d.processId != 200u);
+}
+
+TEST_CASE(ProcessLoopback, ProcessOpensAtRequestedFormat) {
+    auto backend = makeBackend();
+    StreamConfig config;
+    const auto stream = backend->openProcessLoopback(100, false, StreamFormat{ 44100, 6 }, config);
+    REQUIRE(stream != nullptr);
+    CHECK_EQ(stream->format().sampleRate, 44100u);
+    CHECK_EQ(stream->format().channels, 6u);
+    CHECK(stream->format().sample == SampleType::Float32);
+    CHECK(backend->openProcessLoopback(999, false, StreamFormat{ 48000, 2 }, config) == nullptr);
+}
+
+TEST_CASE(ProcessLoopback, IncludeTreeCapturesProcessAndChildren) {
+    const std::vector<float> played = captureThrough(L"process:100");
+    REQUIRE(!played.empty());
+    CHECK_NEAR(toneAmplitude(played, kPlayerHz), 0.2, 0.02);
+    CHECK_NEAR(toneAmplitude(played, kChildHz), 0.2, 0.02);
+    CHECK(toneAmplitude(played, kOtherHz) < 0.002);
+}
+
+TEST_CASE(ProcessLoopback, ExcludeTreeCapturesEverythingElse) {
+    const std::vector<float> played = captureThrough(L"process:100:exclude");
+    REQUIRE(!played.empty());
+    CHECK_NEAR(toneAmplitude(played, kOtherHz), 0.2, 0.02);
+    CHECK(toneAmplitude(played, kPlayerHz) < 0.002);
+    CHECK(toneAmplitude(played, kChildHz) < 0.002);
+}
+
+TEST_CASE(ProcessLoopback, UnknownProcessFailsToStart) {
+    AudioEngine engine(makeBackend());
+    CHECK(!engine.startCopy({ L"process:999" }, L"out", StreamConfig{}));
+    CHECK(!engine.isRunning());
+}
@@ -0,0 +1,140 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Recorder.h"
+#include "TestSupport.h"
+#include "WavFile.h"
+
+namespace {
+    constexpr std::uint32_t kRate = 48000;
+    constexpr std::uint32_t kChannels = 2;
+    constexpr std::size_t kBlockFrames = 480;
+
+    // 每个样本都不为 0 且由帧号唯一确定：读回时能区分原始数据与补的静音，并核对位置
+    float pattern(const std::uint64_t frame, const std::uint32_t channel) {
+        return static_cast<float>((frame * 7 + channel * 3) % 4096 + 1) / 8192.0f;
+    }
+
+    struct PushResult {
+        std::uint64_t frames = 0;
+        double maxPushMs = 0.0;
+    };
+
+    // 模拟音频线程：从第 firstFrame 帧起每 blockInterval 送一块 kBlockFrames 帧，记下单次 push 的最长耗时
+    PushResult pushBlocks(Recorder &recorder, const std::uint64_t firstFrame, const std::size_t blocks,
+                          const std::chrono::microseconds blockInterval) {
+        PushResult result;
+        std::vector<float> block(kBlockFrames * kChannels);
+        auto next = std::chrono::steady_clock::now();
+        for (std::size_t b = 0; b < blocks; ++b) {
+            for (std::size_t f = 0; f < kBlockFrames; ++f) {
+                for (std::uint32_t ch = 0; ch < kChannels; ++ch) block[f * kChannels + ch] = pattern(firstFrame + result.frames + f, ch);
+            }
+            const auto begin = std::chrono::steady_clock::now();
+            recorder.push(block.data(), kBlockFrames);
+            const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+            result.maxPushMs = std::max(result.maxPushMs, ms);
+            result.frames += kBlockFrames;
+            next += blockInterval;
+            std::this_thread::sleep_until(next);
+        }
+        return result;
+    }
+
+    std::filesystem::path tempWav(const char *name) {
+        return std::filesystem::temp_directory_path() / (std::string("ar-recorder-test-") + name + ".wav");
+    }
+
+    // 读回的文件：每帧要么是该位置的原始数据，要么整帧为静音；返回静音帧数，位置不对时返回 -1
+    std::int64_t verifyTimeline(const std::vector<float> &samples) {
+        std::int64_t silent = 0;
+        for (std::size_t frame = 0; frame < samples.size() / kChannels; ++frame) {
+            const float *s = samples.data() + frame * kChannels;
+            if (s[0] == 0.0f && s[1] == 0.0f) {
+                ++silent;
+                continue;
+            }
+            for (std::uint32_t ch = 0; ch < kChannels; ++ch) {
+                if (s[ch] != pattern(frame, ch)) return -1;
+            }
+        }
+        return silent;
+    }
+}
+
+TEST_CASE(Recorder, WritesEveryFrameWhenDiskKeepsUp) {
+    const std::filesystem::path path = tempWav("plain");
+    Recorder recorder;
+    std::string error;
+    RecorderOptions options;
+    options.bufferMs = 500;
+    REQUIRE(recorder.start(path, StreamFormat{ kRate, kChannels, SampleType::Float32 }, options, error));
+    // 4 倍实时速度送 2 秒音频
+    const PushResult pushed = pushBlocks(recorder, 0, 200, std::chrono::microseconds(2500));
+    recorder.finish();
+
+    const RecorderStatus status = recorder.status();
+    CHECK(!status.active);
+    CHECK(!status.failed);
+    CHECK_EQ(status.framesDropped, 0u);
+    CHECK_EQ(status.framesWritten, pushed.frames);
+
+    std::vector<float> samples;
+    StreamFormat format;
+    REQUIRE(readWavFile(path, samples, format));
+    CHECK_EQ(format.sampleRate, kRate);
+    CHECK_EQ(format.channels, kChannels);
+    REQUIRE(samples.size() == pushed.frames * kChannels);
+    CHECK_EQ(verifyTimeline(samples), 0);
+    std::filesystem::remove(path);
+}
+
+TEST_CASE(Recorder, ThrottledDiskDropsIntoSilenceWithoutBlocking) {
+    // 磁盘限速到 512 KiB/s，ring 只有 200 ms。先以 4 倍实时速度送 1 秒（约 1.5 MB/s）：写入线程卡在第一块上时
+    // ring 很快写满，此后的帧记为丢弃；再按实时速度送 1.5 秒，磁盘追上后缺口在文件中原位置补成静音
+    const std::filesystem::path path = tempWav("throttled");
+    Recorder recorder;
+    std::string error;
+    RecorderOptions options;
+    options.bufferMs = 200;
+    options.throttleBytesPerSecond = 512 * 1024;
+    REQUIRE(recorder.start(path, StreamFormat{ kRate, kChannels, SampleType::Float32 }, options, error));
+    PushResult pushed = pushBlocks(recorder, 0, 400, std::chrono::microseconds(2500));
+    const RecorderStatus afterBurst = recorder.status();
+    const PushResult realtime = pushBlocks(recorder, pushed.frames, 150, std::chrono::microseconds(10000));
+    pushed.frames += realtime.frames;
+    pushed.maxPushMs = std::max(pushed.maxPushMs, realtime.maxPushMs);
+    recorder.finish();
+    const RecorderStatus status = recorder.status();
+
+    std::cout << "  pushed " << pushed.frames << ", written " << status.framesWritten << ", dropped " << status.framesDropped
+              << ", peak backlog " << status.peakBacklogMs << " ms, max push " << pushed.maxPushMs << " ms\n";
+    // 音频线程从不等待磁盘（限速的写入每次要睡上百毫秒）
+    CHECK(pushed.maxPushMs < 5.0);
+    CHECK(!status.failed);
+    CHECK(afterBurst.framesDropped > 0);
+    CHECK(status.framesDropped < pushed.frames);
+    // ring 容量按 2 的幂向上取整，积压不会超过它
+    CHECK(status.peakBacklogMs < 2.0 * options.bufferMs);
+
+    std::vector<float> samples;
+    StreamFormat format;
+    REQUIRE(readWavFile(path, samples, format));
+    const std::uint64_t fileFrames = samples.size() / kChannels;
+    CHECK_EQ(fileFrames, status.framesWritten);
+    // 时间轴连续：只有最后一段还没来得及补的缺口不在文件里
+    REQUIRE(fileFrames <= pushed.frames);
+    const std::uint64_t trailingGap = pushed.frames - fileFrames;
+    CHECK(trailingGap <= status.framesDropped);
+    // 其余的数据都在原位置，丢弃的帧恰好补成了同样多的静音
+    const std::int64_t silent = verifyTimeline(samples);
+    CHECK(silent > 0);
+    CHECK_EQ(silent, static_cast<std::int64_t>(status.framesDropped - trailingGap));
+    std::filesystem::remove(path);
+}
@@ -0,0 +1,226 @@
+// 路由矩阵：每条路由的延迟按样本对齐、静音的路由不出声；音频线程读快照期间控制线程反复修改并发布
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "FanoutRing.h"
+#include "Mixer.h"
+#include "RoutingMatrix.h"
+#include "SpscRing.h"
+#include "TestSupport.h"
+
+namespace {
+    constexpr std::size_t kChannels = 2;
+    constexpr std::size_t kBlock = 128;
+
+    // 一个来源按矩阵混到若干条 bus，逐块推入数据并收集各 bus 的输出
+    class RoutedGraph {
+    public:
+        explicit RoutedGraph(std::size_t buses)
+            : matrix(1, buses), mixer(kChannels, kBlock), ring(kBlock * 4, kChannels), history(4096, kChannels),
+              out(kBlock * 4, kChannels, buses), collected(buses) {
+            history.commitWrite(history.capacity());
+            input = MixInput{ &ring, 1.0f, &history, 0 };
+            for (std::size_t b = 0; b < buses; ++b) busList.push_back(b);
+        }
+
+        RoutingMatrix matrix;
+
+        // 推入一块（左声道为 left，右声道为其相反数）并混音
+        void process(const std::vector<float> &left) {
+            std::vector<float> block(kBlock * kChannels);
+            for (std::size_t f = 0; f < kBlock; ++f) {
+                block[f * kChannels] = left[f];
+                block[f * kChannels + 1] = -left[f];
+            }
+            ring.push(block.data(), kBlock);
+            const RouteTable table = matrix.acquire();
+            mixer.mixRouted(&input, 1, table, busList.data(), busList.size(), out, kBlock);
+            matrix.release();
+            for (std::size_t b = 0; b < busList.size(); ++b) {
+                const auto regions = out.readRegions(out.writePosition() - kBlock, kBlock, b);
+                for (const auto &span : { regions.first, regions.second }) {
+                    for (std::size_t f = 0; f < span.frames; ++f) {
+                        CHECK_EQ(span.data[f * kChannels + 1], -span.data[f * kChannels]);
+                        collected[b].push_back(span.data[f * kChannels]);
+                    }
+                }
+            }
+        }
+
+        // 第 bus 条 bus 收到的左声道
+        const std::vector<float> &output(std::size_t bus) const { return collected[bus]; }
+
+    private:
+        Mixer mixer;
+        SpscRing<float> ring;
+        FanoutRing history;
+        FanoutRing out;
+        MixInput input;
+        std::vector<std::size_t> busList;
+        std::vector<std::vector<float>> collected;
+    };
+
+    // 第 at 帧为 1、其余为 0 的若干块
+    std::vector<std::vector<float>> impulseBlocks(std::size_t blocks, std::size_t at) {
+        std::vector<std::vector<float>> list(blocks, std::vector<float>(kBlock, 0.0f));
+        list[at / kBlock][at % kBlock] = 1.0f;
+        return list;
+    }
+}
+
+TEST_CASE(RoutingMatrix, DelayAlignsInSamples) {
+    // 各条 bus 的延迟：0、1 帧、跨块、不是块长整数倍
+    const std::uint32_t delays[] = { 0, 1, kBlock, 333 };
+    RoutedGraph graph(4);
+    for (std::size_t b = 0; b < 4; ++b) {
+        Route route;
+        route.delayFrames = delays[b];
+        route.gain = 0.5f;
+        graph.matrix.setRoute(0, b, route);
+    }
+    graph.matrix.publish();
+    constexpr std::size_t kImpulseAt = 50;
+    for (const auto &block : impulseBlocks(6, kImpulseAt)) graph.process(block);
+
+    for (std::size_t b = 0; b < 4; ++b) {
+        const std::vector<float> &bus = graph.output(b);
+        REQUIRE(bus.size() == 6 * kBlock);
+        for (std::size_t f = 0; f < bus.size(); ++f) {
+            CHECK_EQ(bus[f], f == kImpulseAt + delays[b] ? 0.5f : 0.0f);
+        }
+    }
+}
+
+TEST_CASE(RoutingMatrix, MuteSilencesRoute) {
+    RoutedGraph graph(2);
+    Route muted;
+    muted.muted = true;
+    graph.matrix.setRoute(0, 1, muted);
+    graph.matrix.publish();
+    const std::vector<float> tone(kBlock, 0.25f);
+    graph.process(tone);
+    for (const float v : graph.output(0)) CHECK_EQ(v, 0.25f);
+    for (const float v : graph.output(1)) CHECK_EQ(v, 0.0f);
+
+    // 恢复后立即出声；零增益与静音同样不出声
+    graph.matrix.setRoute(0, 1, Route{});
+    Route silent;
+    silent.gain = 0.0f;
+    graph.matrix.setRoute(0, 0, silent);
+    graph.matrix.publish();
+    graph.process(tone);
+    for (std::size_t f = kBlock; f < 2 * kBlock; ++f) {
+        CHECK_EQ(graph.output(0)[f], 0.0f);
+        CHECK_EQ(graph.output(1)[f], 0.25f);
+    }
+}
+
+TEST_CASE(RoutingMatrix, ResetRestoresDefaults) {
+    RoutingMatrix matrix(3, 2);
+    Route route;
+    route.gain = 0.5f;
+    route.delayFrames = 10;
+    route.muted = true;
+    for (std::size_t row = 0; row < 3; ++row) {
+        for (std::size_t column = 0; column < 2; ++column) matrix.setRoute(row, column, route);
+    }
+    // 越界的修改被忽略
+    matrix.setRoute(3, 0, route);
+    matrix.setRoute(0, 2, route);
+    matrix.resetRow(1);
+    matrix.resetColumn(1);
+    CHECK(matrix.route(0, 0).muted);
+    CHECK_EQ(matrix.route(2, 0).delayFrames, 10u);
+    CHECK(!matrix.route(1, 0).muted);
+    CHECK_EQ(matrix.route(1, 0).gain, 1.0f);
+    CHECK(!matrix.route(0, 1).muted);
+    CHECK(!matrix.route(2, 1).muted);
+
+    // 修改在发布之前对读者不可见
+    RouteTable table = matrix.acquire();
+    CHECK(!table.at(0, 0).muted);
+    matrix.release();
+    matrix.publish();
+    table = matrix.acquire();
+    CHECK(table.at(0, 0).muted);
+    CHECK(!table.at(1, 0).muted);
+    matrix.release();
+    matrix.resetAll();
+    matrix.publish();
+    table = matrix.acquire();
+    CHECK(!table.at(0, 0).muted);
+    CHECK_EQ(table.at(2, 0).delayFrames, 0u);
+    matrix.release();
+}
+
+TEST_CASE(RoutingMatrix, PublishWhileReaderHoldsSnapshot) {
+    // 读者拿着快照时发布的新表写进另一份，读者手里的内容不变，下次 acquire 才看到
+    RoutingMatrix matrix(2, 2);
+    RouteTable held = matrix.acquire();
+    Route route;
+    route.gain = 0.5f;
+    matrix.setRoute(1, 1, route);
+    matrix.publish();
+    CHECK_EQ(held.at(1, 1).gain, 1.0f);
+    matrix.release();
+    held = matrix.acquire();
+    CHECK_EQ(held.at(1, 1).gain, 0.5f);
+    matrix.release();
+}
+
+TEST_CASE(RoutingMatrix, ConcurrentEditsAreNeverTorn) {
+    // 控制线程每次把所有路由改成同一代号再发布；音频线程反复读快照，同一张表里的代号必须一致且不倒退
+    constexpr std::size_t kRows = 16;
+    constexpr std::size_t kColumns = 9;
+    constexpr std::uint32_t kGenerations = 20000;
+    RoutingMatrix matrix(kRows, kColumns);
+    const auto publishGeneration = [&](const std::uint32_t generation) {
+        Route route;
+        route.delayFrames = generation;
+        route.gain = static_cast<float>(generation);
+        for (std::size_t row = 0; row < kRows; ++row) {
+            for (std::size_t column = 0; column < kColumns; ++column) matrix.setRoute(row, column, route);
+        }
+        matrix.publish();
+    };
+    publishGeneration(0);
+    std::atomic<bool> done{ false };
+    std::atomic<std::uint64_t> torn{ 0 };
+    std::atomic<std::uint64_t> backwards{ 0 };
+    std::atomic<std::uint64_t> reads{ 0 };
+
+    std::thread reader([&] {
+        std::uint32_t last = 0;
+        while (!done.load(std::memory_order_acquire)) {
+            const RouteTable table = matrix.acquire();
+            const std::uint32_t generation = table.at(0, 0).delayFrames;
+            for (std::size_t row = 0; row < kRows; ++row) {
+                for (std::size_t column = 0; column < kColumns; ++column) {
+                    const Route &route = table.at(row, column);
+                    if (route.delayFrames != generation || route.gain != static_cast<float>(generation)) torn.fetch_add(1);
+                }
+            }
+            matrix.release();
+            if (generation < last) backwards.fetch_add(1);
+            last = generation;
+            reads.fetch_add(1, std::memory_order_relaxed);
+        }
+    });
+
+    // 等读者开始读再改，保证修改与读取确实交错
+    while (reads.load(std::memory_order_relaxed) == 0) std::this_thread::yield();
+    for (std::uint32_t generation = 1; generation <= kGenerations; ++generation) publishGeneration(generation);
+    done.store(true, std::memory_order_release);
+    reader.join();
+
+    CHECK_EQ(torn.load(), 0u);
+    CHECK_EQ(backwards.load(), 0u);
+    CHECK(reads.load() > 0u);
+    const RouteTable table = matrix.acquire();
+    CHECK_EQ(table.at(kRows - 1, kColumns - 1).delayFrames, kGenerations);
+    matrix.release();
+}
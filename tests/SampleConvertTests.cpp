@@ -0,0 +1,148 @@
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include "SampleConvert.h"
+#include "TestSupport.h"
+
+namespace {
+    constexpr SampleType kIntegerTypes[] = { SampleType::Int16, SampleType::Int24, SampleType::Int32 };
+
+    // 边界输入：非有限值、非规格化数、±满幅与越界、舍入的中点
+    std::vector<float> edgeValues() {
+        const float inf = std::numeric_limits<float>::infinity();
+        const float denormal = std::numeric_limits<float>::denorm_min();
+        return {
+            0.0f, -0.0f,
+            std::numeric_limits<float>::quiet_NaN(), -std::numeric_limits<float>::quiet_NaN(),
+            std::numeric_limits<float>::signaling_NaN(),
+            inf, -inf,
+            denormal, -denormal, std::numeric_limits<float>::min() * 0.5f, -std::numeric_limits<float>::min(),
+            1.0f, -1.0f, 0.99999994f, -0.99999994f, 1.5f, -1.5f, 1e30f, -1e30f,
+            std::numeric_limits<float>::max(), std::numeric_limits<float>::lowest(),
+            0.5f / 32768.0f, 1.5f / 32768.0f, -2.5f / 32768.0f,
+            0.5f / 8388608.0f, -1.5f / 8388608.0f,
+        };
+    }
+
+    // 边界值与随机值交错排列，长度不是向量宽度的整数倍：边界值既落在 SIMD 主循环里，也落在标量收尾里
+    std::vector<float> encodeInput() {
+        const std::vector<float> edges = edgeValues();
+        std::mt19937 rng(1234);
+        std::uniform_real_distribution<float> uniform(-1.2f, 1.2f);
+        std::vector<float> input;
+        for (int round = 0; round < 9; ++round) {
+            for (const float e : edges) {
+                input.push_back(e);
+                for (int k = 0; k < round; ++k) input.push_back(uniform(rng));
+            }
+        }
+        input.push_back(std::numeric_limits<float>::quiet_NaN());
+        return input;
+    }
+
+    std::vector<unsigned char> encodeWith(const ConvertKernels &kernels, const SampleType type, const std::vector<float> &input) {
+        std::vector<unsigned char> out(input.size() * sampleBytes(type), 0xCD);
+        kernels.encode[static_cast<std::size_t>(type)](input.data(), out.data(), input.size());
+        return out;
+    }
+
+    std::int32_t encodeOne(const SampleType type, const float value) {
+        const std::vector<float> input{ value };
+        const std::vector<unsigned char> bytes = encodeWith(scalarConvertKernels(), type, input);
+        switch (type) {
+        case SampleType::Int16: {
+            std::int16_t v;
+            std::memcpy(&v, bytes.data(), 2);
+            return v;
+        }
+        case SampleType::Int24: {
+            const auto u = static_cast<std::uint32_t>(bytes[0]) << 8 | static_cast<std::uint32_t>(bytes[1]) << 16 |
+                           static_cast<std::uint32_t>(bytes[2]) << 24;
+            return static_cast<std::int32_t>(u) >> 8;
+        }
+        default: {
+            std::int32_t v;
+            std::memcpy(&v, bytes.data(), 4);
+            return v;
+        }
+        }
+    }
+}
+
+TEST_CASE(SampleConvert, EncodeNonFiniteAndFullScale) {
+    const float inf = std::numeric_limits<float>::infinity();
+    const float nan = std::numeric_limits<float>::quiet_NaN();
+    CHECK_EQ(encodeOne(SampleType::Int16, nan), 0);
+    CHECK_EQ(encodeOne(SampleType::Int16, -nan), 0);
+    CHECK_EQ(encodeOne(SampleType::Int16, inf), 32767);
+    CHECK_EQ(encodeOne(SampleType::Int16, -inf), -32768);
+    CHECK_EQ(encodeOne(SampleType::Int16, 1.0f), 32767);
+    CHECK_EQ(encodeOne(SampleType::Int16, -1.0f), -32768);
+    CHECK_EQ(encodeOne(SampleType::Int16, std::numeric_limits<float>::denorm_min()), 0);
+    // 就近偶数
+    CHECK_EQ(encodeOne(SampleType::Int16, 0.5f / 32768.0f), 0);
+    CHECK_EQ(encodeOne(SampleType::Int16, 1.5f / 32768.0f), 2);
+
+    CHECK_EQ(encodeOne(SampleType::Int24, nan), 0);
+    CHECK_EQ(encodeOne(SampleType::Int24, inf), 8388607);
+    CHECK_EQ(encodeOne(SampleType::Int24, -inf), -8388608);
+
+    CHECK_EQ(encodeOne(SampleType::Int32, nan), 0);
+    CHECK_EQ(encodeOne(SampleType::Int32, inf), 2147483520);
+    CHECK_EQ(encodeOne(SampleType::Int32, -inf), std::numeric_limits<std::int32_t>::min());
+    CHECK_EQ(encodeOne(SampleType::Int32, 1.0f), 2147483520);
+}
+
+TEST_CASE(SampleConvert, EncodeBitExactAcrossKernels) {
+    const std::vector<float> input = encodeInput();
+    const ConvertKernels *simd[] = { &sse2ConvertKernels(), &avx2ConvertKernels(), &convertKernels() };
+    for (const SampleType type : kIntegerTypes) {
+        const std::vector<unsigned char> reference = encodeWith(scalarConvertKernels(), type, input);
+        for (const ConvertKernels *kernels : simd) {
+            const std::vector<unsigned char> out = encodeWith(*kernels, type, input);
+            CHECK(out == reference);
+            // 逐个起始偏移再比一次，覆盖主循环与收尾的每种切分
+            for (std::size_t offset = 1; offset < 17; ++offset) {
+                const std::vector<float> shifted(input.begin() + static_cast<std::ptrdiff_t>(offset), input.end());
+                CHECK(encodeWith(*kernels, type, shifted) == encodeWith(scalarConvertKernels(), type, shifted));
+            }
+        }
+    }
+}
+
+TEST_CASE(SampleConvert, DecodeBitExactAcrossKernels) {
+    std::mt19937 rng(99);
+    for (const SampleType type : kIntegerTypes) {
+        const std::size_t bytes = sampleBytes(type);
+        std::vector<unsigned char> raw;
+        if (type == SampleType::Int16) {
+            // 全部 65536 个取值
+            for (std::uint32_t v = 0; v < 65536; ++v) {
+                raw.push_back(static_cast<unsigned char>(v));
+                raw.push_back(static_cast<unsigned char>(v >> 8));
+            }
+        } else {
+            // 随机值加上 0、±1 LSB 与两端满幅
+            const unsigned char edges[][4] = {
+                { 0x00, 0x00, 0x00, 0x00 }, { 0x01, 0x00, 0x00, 0x00 }, { 0xFF, 0xFF, 0xFF, 0xFF },
+                { 0xFF, 0xFF, 0xFF, 0x7F }, { 0x00, 0x00, 0x00, 0x80 }, { 0xFF, 0xFF, 0x7F, 0x00 }, { 0x00, 0x00, 0x80, 0x00 },
+            };
+            for (const auto &e : edges) raw.insert(raw.end(), e, e + bytes);
+            for (int i = 0; i < 4099; ++i) raw.push_back(static_cast<unsigned char>(rng()));
+            raw.resize(raw.size() / bytes * bytes);
+        }
+        const std::size_t samples = raw.size() / bytes;
+        std::vector<float> reference(samples);
+        scalarConvertKernels().decode[static_cast<std::size_t>(type)](raw.data(), reference.data(), samples);
+        for (const ConvertKernels *kernels : { &sse2ConvertKernels(), &avx2ConvertKernels(), &convertKernels() }) {
+            std::vector<float> out(samples);
+            kernels->decode[static_cast<std::size_t>(type)](raw.data(), out.data(), samples);
+            CHECK(std::memcmp(out.data(), reference.data(), samples * sizeof(float)) == 0);
+        }
+        // 解码后再编码回去得到原值（整数 -> float 对 16 / 24 位无损）
+        if (type != SampleType::Int32) CHECK(encodeWith(scalarConvertKernels(), type, reference) == raw);
+    }
+}
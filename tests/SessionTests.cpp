@@ -0,0 +1,204 @@
+// 会话：引擎状态的保存、文件读写与按会话恢复，在虚拟后端上运行
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "AudioEngine.h"
+#include "Session.h"
+#include "TestSupport.h"
+#include "VirtualBackend.h"
+
+namespace {
+    std::unique_ptr<VirtualBackend> makeBackend() {
+        auto backend = std::make_unique<VirtualBackend>(std::make_shared<VirtualClock>(0.0));
+        for (const wchar_t *id : { L"out", L"out2", L"src", L"src2" }) {
+            VirtualDeviceSpec device;
+            device.id = id;
+            backend->addDevice(device);
+        }
+        return backend;
+    }
+
+    // 同一个程序重启后换了 PID，原来的 PID 被别的程序占用
+    std::unique_ptr<VirtualBackend> makeProcessBackend(const std::uint32_t playerPid, const std::uint32_t otherPid) {
+        auto backend = makeBackend();
+        backend->addProcess({ playerPid, 0, L"player.exe", 1000.0, 0.2f });
+        backend->addProcess({ otherPid, 0, L"other.exe", 700.0, 0.2f });
+        return backend;
+    }
+
+    // 本次运行独有的临时会话文件（并行运行的测试互不覆盖），离开作用域时连同写入用的 .tmp 一起删除
+    class TempSessionFile {
+    public:
+        explicit TempSessionFile(const std::string &stem) {
+            std::random_device random;
+            path = std::filesystem::temp_directory_path() / ("ar-" + stem + "-" + std::to_string(random()) + ".json");
+        }
+        ~TempSessionFile() {
+            std::error_code ignored;
+            std::filesystem::remove(path, ignored);
+            std::filesystem::remove(std::filesystem::path(path).concat(".tmp"), ignored);
+        }
+        TempSessionFile(const TempSessionFile &) = delete;
+        TempSessionFile &operator=(const TempSessionFile &) = delete;
+
+        std::filesystem::path path;
+    };
+
+    EngineSession basicSession() {
+        EngineSession session;
+        session.sources.push_back(SessionSource{ SessionEndpoint{ L"src", {}, StreamMode::Shared, {} }, 1.0f });
+        session.output = SessionEndpoint{ L"out", {}, StreamMode::Shared, {} };
+        return session;
+    }
+}
+
+TEST_CASE(Session, StartWhileRunningIsRejected) {
+    AudioEngine engine(makeBackend());
+    REQUIRE(engine.startCopy({ L"src" }, L"out", StreamConfig{}));
+    // 运行中再次启动不会替换正在使用的流
+    CHECK(!engine.startCopy({ L"src2" }, L"out2", StreamConfig{}));
+    CHECK(!engine.startSession(basicSession()));
+    CHECK(engine.isRunning());
+    REQUIRE(engine.sourceIds().size() == 1u);
+    CHECK(engine.sourceIds()[0] == L"src");
+    CHECK(engine.outputId() == L"out");
+
+    // 停止后可以重新启动
+    engine.stopCopy();
+    REQUIRE(engine.startSession(basicSession()));
+    CHECK(engine.isRunning());
+    engine.stopCopy();
+}
+
+TEST_CASE(Session, SaveAndLoadRoundTrip) {
+    AudioEngine engine(makeBackend());
+    REQUIRE(engine.startCopy({ L"src", L"src2" }, L"out", StreamConfig{}));
+    REQUIRE(engine.addOutput(L"out2"));
+    REQUIRE(engine.setSourceGain(1, 0.5f));
+    Route route;
+    route.gain = 0.25f;
+    route.delayFrames = 480;
+    REQUIRE(engine.setRoute(0, 1, route));
+    InsertSettings insert;
+    insert.highPassHz = 120.0f;
+    REQUIRE(engine.setInsert(1, 0, insert));
+    const EngineSession saved = engine.session();
+    engine.stopCopy();
+
+    const TempSessionFile file("session-test");
+    std::string error;
+    REQUIRE(saveSession(file.path, saved, error));
+    CHECK(!std::filesystem::exists(std::filesystem::path(file.path).concat(".tmp")));
+    EngineSession loaded;
+    REQUIRE(loadSession(file.path, loaded, error));
+
+    REQUIRE(loaded.sources.size() == 2u);
+    CHECK(loaded.sources[0].endpoint.id == L"src");
+    CHECK_NEAR(loaded.sources[1].gain, 0.5, 1e-6);
+    CHECK(loaded.output.id == L"out");
+    CHECK_EQ(loaded.output.format.sampleRate, 48000u);
+    REQUIRE(loaded.extraOutputs.size() == 1u);
+    CHECK(loaded.extraOutputs[0].id == L"out2");
+
+    // 恢复后各项设置与保存时一致
+    AudioEngine restored(makeBackend());
+    REQUIRE(restored.startSession(loaded));
+    REQUIRE(restored.additionalOutputIds().size() == 1u);
+    CHECK_NEAR(restored.route(0, 1).gain, 0.25, 1e-6);
+    CHECK_EQ(restored.route(0, 1).delayFrames, 480u);
+    CHECK_NEAR(restored.insert(1, 0).highPassHz, 120.0, 1e-6);
+    CHECK(!restored.insert(0, 0).active());
+    restored.stopCopy();
+}
+
+TEST_CASE(Session, ProcessSourceIsResolvedByName) {
+    AudioEngine engine(makeProcessBackend(100, 200));
+    REQUIRE(engine.startCopy({ L"process:100", L"process:100:exclude" }, L"out", StreamConfig{}));
+    const EngineSession saved = engine.session();
+    engine.stopCopy();
+    REQUIRE(saved.sources.size() == 2u);
+    CHECK(saved.sources[0].endpoint.processName == L"player.exe");
+    CHECK(saved.sources[1].endpoint.processName == L"player.exe");
+    CHECK(saved.output.processName.empty());
+
+    const TempSessionFile file("session-process-test");
+    std::string error;
+    REQUIRE(saveSession(file.path, saved, error));
+    EngineSession loaded;
+    REQUIRE(loadSession(file.path, loaded, error));
+    REQUIRE(loaded.sources.size() == 2u);
+    CHECK(loaded.sources[0].endpoint.processName == L"player.exe");
+
+    // PID 未变时照原样打开
+    {
+        AudioEngine restored(makeProcessBackend(100, 200));
+        REQUIRE(restored.startSession(loaded));
+        REQUIRE(restored.sourceIds().size() == 2u);
+        CHECK(restored.sourceIds()[0] == L"process:100");
+        restored.stopCopy();
+    }
+    // 程序换了 PID、旧 PID 被别的程序占用：按进程名找到新的 PID，包含 / 排除的方式不变
+    {
+        AudioEngine restored(makeProcessBackend(500, 100));
+        REQUIRE(restored.startSession(loaded));
+        REQUIRE(restored.sourceIds().size() == 2u);
+        CHECK(restored.sourceIds()[0] == L"process:500");
+        CHECK(restored.sourceIds()[1] == L"process:500:exclude");
+        restored.stopCopy();
+    }
+    // 没有进程名（无法确认是同一个程序）的进程来源不恢复
+    EngineSession anonymous = loaded;
+    for (auto &source : anonymous.sources) source.endpoint.processName.clear();
+    AudioEngine restored(makeProcessBackend(100, 200));
+    CHECK(!restored.startSession(anonymous));
+    CHECK(!restored.isRunning());
+}
+
+TEST_CASE(Session, UnresolvableSourcesAreSkipped) {
+    EngineSession session = basicSession();
+    session.sources.clear();
+    // 0: 正常的端点，1: 已拔掉的端点，2: 已退出的程序，3: 正常的端点
+    session.sources.push_back(SessionSource{ SessionEndpoint{ L"src", {}, StreamMode::Shared, {} }, 0.5f });
+    session.sources.push_back(SessionSource{ SessionEndpoint{ L"unplugged", {}, StreamMode::Shared, {} }, 0.75f });
+    const SessionEndpoint exited{ L"process:300", {}, StreamMode::Shared, L"exited.exe" };
+    session.sources.push_back(SessionSource{ exited, 0.75f });
+    session.sources.push_back(SessionSource{ SessionEndpoint{ L"src2", {}, StreamMode::Shared, {} }, 0.25f });
+    session.extraOutputs.push_back(SessionEndpoint{ L"out2", {}, StreamMode::Shared, {} });
+    for (size_t i = 0; i < session.sources.size(); ++i) {
+        Route route;
+        route.gain = 0.1f * static_cast<float>(i + 1);
+        session.routes.push_back({ route, route });
+        InsertSettings insert;
+        insert.highPassHz = 100.0f * static_cast<float>(i + 1);
+        session.inserts.push_back({ InsertSettings{}, insert });
+    }
+
+    AudioEngine engine(makeProcessBackend(100, 200));
+    REQUIRE(engine.startSession(session));
+    const std::vector<std::wstring> ids = engine.sourceIds();
+    REQUIRE(ids.size() == 2u);
+    CHECK(ids[0] == L"src");
+    CHECK(ids[1] == L"src2");
+    // 增益、路由与插入效果跟着各自的来源走
+    const EngineSession restored = engine.session();
+    REQUIRE(restored.sources.size() == 2u);
+    CHECK_NEAR(restored.sources[0].gain, 0.5, 1e-6);
+    CHECK_NEAR(restored.sources[1].gain, 0.25, 1e-6);
+    CHECK_NEAR(engine.route(0, 0).gain, 0.1, 1e-6);
+    CHECK_NEAR(engine.route(1, 1).gain, 0.4, 1e-6);
+    CHECK_NEAR(engine.insert(0, 1).highPassHz, 100.0, 1e-6);
+    CHECK_NEAR(engine.insert(1, 1).highPassHz, 400.0, 1e-6);
+    engine.stopCopy();
+
+    // 一个来源都找不到时不启动
+    EngineSession missing = basicSession();
+    missing.sources[0].endpoint.id = L"unplugged";
+    AudioEngine idle(makeBackend());
+    CHECK(!idle.startSession(missing));
+    CHECK(!idle.isRunning());
+}
@@ -0,0 +1,154 @@
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "SpscRing.h"
+#include "TestSupport.h"
+
+TEST_CASE(SpscRing, CapacityRoundsUpToPowerOfTwo) {
+    SpscRing<float> ring(100, 2);
+    CHECK_EQ(ring.capacity(), 128u);
+    CHECK_EQ(ring.channels(), 2u);
+    CHECK_EQ(ring.readAvailable(), 0u);
+    CHECK_EQ(ring.writeAvailable(), 128u);
+    SpscRing<float> exact(64, 1);
+    CHECK_EQ(exact.capacity(), 64u);
+}
+
+TEST_CASE(SpscRing, FullAndEmptyBoundaries) {
+    SpscRing<int> ring(8, 1);
+    int out[16] = {};
+    // 空：读不出任何帧
+    CHECK_EQ(ring.pop(out, 4), 0u);
+    CHECK_EQ(ring.discard(4), 0u);
+
+    // 写满：超出的部分被拒绝，而不是覆盖旧数据
+    int in[16];
+    for (int i = 0; i < 16; ++i) in[i] = i;
+    CHECK_EQ(ring.push(in, 16), 8u);
+    CHECK_EQ(ring.readAvailable(), 8u);
+    CHECK_EQ(ring.writeAvailable(), 0u);
+    CHECK_EQ(ring.push(in, 1), 0u);
+    CHECK_EQ(ring.pushSilence(1), 0u);
+    CHECK_EQ(ring.prepareWrite(4).frames(), 0u);
+
+    // 读空后又可以写满一整圈
+    CHECK_EQ(ring.pop(out, 16), 8u);
+    for (int i = 0; i < 8; ++i) CHECK_EQ(out[i], i);
+    CHECK_EQ(ring.readAvailable(), 0u);
+    CHECK_EQ(ring.writeAvailable(), 8u);
+    CHECK_EQ(ring.prepareRead(4).frames(), 0u);
+}
+
+TEST_CASE(SpscRing, WraparoundKeepsFrameOrder) {
+    // 每次写 3 帧、读 3 帧，读写位置反复跨过缓冲末尾
+    SpscRing<std::int32_t> ring(8, 2);
+    std::int32_t next = 0;
+    std::int32_t expected = 0;
+    for (int round = 0; round < 100; ++round) {
+        std::int32_t in[6];
+        for (auto &v : in) v = next++;
+        REQUIRE(ring.push(in, 3) == 3);
+        std::int32_t out[6] = {};
+        REQUIRE(ring.pop(out, 3) == 3);
+        for (const auto v : out) CHECK_EQ(v, expected++);
+    }
+    CHECK_EQ(ring.readAvailable(), 0u);
+}
+
+TEST_CASE(SpscRing, SplitSpansAtBufferEnd) {
+    SpscRing<float> ring(8, 2);
+    // 先把读写位置推到 6（离末尾 2 帧）
+    float filler[12] = {};
+    REQUIRE(ring.push(filler, 6) == 6);
+    REQUIRE(ring.discard(6) == 6);
+
+    // 5 帧的可写区域分为末尾 2 帧 + 开头 3 帧
+    SpscRing<float>::Regions w = ring.prepareWrite(5);
+    CHECK_EQ(w.first.frames, 2u);
+    CHECK_EQ(w.second.frames, 3u);
+    CHECK_EQ(w.frames(), 5u);
+    for (std::size_t i = 0; i < w.first.frames * 2; ++i) w.first.data[i] = static_cast<float>(i);
+    for (std::size_t i = 0; i < w.second.frames * 2; ++i) w.second.data[i] = static_cast<float>(4 + i);
+    // 提交之前读端看不到
+    CHECK_EQ(ring.readAvailable(), 0u);
+    ring.commitWrite(w.frames());
+    CHECK_EQ(ring.readAvailable(), 5u);
+
+    // 读端同样分为两段，内容按顺序接上
+    SpscRing<float>::Regions r = ring.prepareRead(8);
+    CHECK_EQ(r.first.frames, 2u);
+    CHECK_EQ(r.second.frames, 3u);
+    CHECK(r.first.data == w.first.data);
+    CHECK(r.second.data == w.second.data);
+    float out[10] = {};
+    REQUIRE(ring.pop(out, 5) == 5);
+    for (int i = 0; i < 10; ++i) CHECK_EQ(out[i], static_cast<float>(i));
+}
+
+TEST_CASE(SpscRing, PartialCommitAndSilence) {
+    SpscRing<float> ring(4, 1);
+    SpscRing<float>::Regions w = ring.prepareWrite(4);
+    w.first.data[0] = 1.0f;
+    w.first.data[1] = 2.0f;
+    // 只提交一部分
+    ring.commitWrite(2);
+    CHECK_EQ(ring.readAvailable(), 2u);
+    CHECK_EQ(ring.pushSilence(3), 2u);
+    float out[4] = { -1, -1, -1, -1 };
+    REQUIRE(ring.pop(out, 4) == 4);
+    CHECK_EQ(out[0], 1.0f);
+    CHECK_EQ(out[1], 2.0f);
+    CHECK_EQ(out[2], 0.0f);
+    CHECK_EQ(out[3], 0.0f);
+
+    ring.reset();
+    CHECK_EQ(ring.readAvailable(), 0u);
+    CHECK_EQ(ring.writeAvailable(), 4u);
+}
+
+TEST_CASE(SpscRing, TwoThreadOrderingStress) {
+    // 生产者与消费者各自按不规则的块长推进；每帧的各声道都带着同一个序号，读端逐帧核对顺序与完整性
+    constexpr std::size_t kChannels = 3;
+    constexpr std::uint32_t kFrames = 2'000'000;
+    SpscRing<std::uint32_t> ring(256, kChannels);
+
+    std::thread producer([&] {
+        std::vector<std::uint32_t> block(97 * kChannels);
+        std::uint32_t next = 0;
+        std::size_t step = 1;
+        while (next < kFrames) {
+            const std::size_t want = std::min<std::size_t>(step, kFrames - next);
+            for (std::size_t i = 0; i < want; ++i) {
+                for (std::size_t c = 0; c < kChannels; ++c) block[i * kChannels + c] = next + static_cast<std::uint32_t>(i);
+            }
+            const std::size_t pushed = ring.push(block.data(), want);
+            next += static_cast<std::uint32_t>(pushed);
+            if (pushed == 0) std::this_thread::yield();
+            step = step % 97 + 1;
+        }
+    });
+
+    std::uint32_t expected = 0;
+    std::uint32_t mismatches = 0;
+    std::size_t step = 1;
+    while (expected < kFrames) {
+        // 直接读取可读区域（零拷贝路径），回绕时分两段
+        const SpscRing<std::uint32_t>::Regions r = ring.prepareRead(step);
+        for (const auto &span : { r.first, r.second }) {
+            for (std::size_t i = 0; i < span.frames; ++i) {
+                for (std::size_t c = 0; c < kChannels; ++c) {
+                    if (span.data[i * kChannels + c] != expected) ++mismatches;
+                }
+                ++expected;
+            }
+        }
+        ring.commitRead(r.frames());
+        if (r.frames() == 0) std::this_thread::yield();
+        step = step % 61 + 1;
+    }
+    producer.join();
+    CHECK_EQ(mismatches, 0u);
+    CHECK_EQ(expected, kFrames);
+    CHECK_EQ(ring.readAvailable(), 0u);
+}
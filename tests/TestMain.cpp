@@ -0,0 +1,55 @@
+// AudioRepeaterTests：不带参数时运行全部用例，带参数时只运行这些套件；有失败时以 1 退出
+
+#include <cstring>
+#include <exception>
+#include <iostream>
+
+#include "TestSupport.h"
+
+namespace {
+    int failures = 0;
+}
+
+std::vector<TestCase> &testRegistry() {
+    static std::vector<TestCase> registry;
+    return registry;
+}
+
+void reportFailure(const char *file, const int line, const std::string &message) {
+    ++failures;
+    std::cerr << file << ':' << line << ": " << message << '\n';
+}
+
+int main(int argc, char *argv[]) {
+    const auto selected = [&](const char *suite) {
+        if (argc < 2) return true;
+        for (int i = 1; i < argc; ++i) {
+            if (std::strcmp(argv[i], suite) == 0) return true;
+        }
+        return false;
+    };
+
+    int run = 0;
+    int failedCases = 0;
+    for (const TestCase &test : testRegistry()) {
+        if (!selected(test.suite)) continue;
+        ++run;
+        const int before = failures;
+        try {
+            test.run();
+        } catch (const TestAbort &) {
+            // 已在 REQUIRE 处记录
+        } catch (const std::exception &e) {
+            reportFailure(test.suite, 0, std::string("unexpected exception: ") + e.what());
+        }
+        const bool passed = failures == before;
+        if (!passed) ++failedCases;
+        std::cout << (passed ? "[ ok ] " : "[FAIL] ") << test.suite << '.' << test.name << '\n';
+    }
+    if (run == 0) {
+        std::cerr << "no test cases matched\n";
+        return 1;
+    }
+    std::cout << run - failedCases << " / " << run << " passed\n";
+    return failedCases == 0 ? 0 : 1;
+}
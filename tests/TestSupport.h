@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cmath>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// 极简测试框架（不引入外部依赖）：TEST_CASE 把用例登记到某个套件，
+// AudioRepeaterTests <套件> 只运行该套件，CTest 每个套件注册为一个测试
+// CHECK 失败时记录位置并继续；REQUIRE 失败时结束当前用例
+
+struct TestCase {
+    const char *suite;
+    const char *name;
+    void (*run)();
+};
+
+std::vector<TestCase> &testRegistry();
+
+struct TestRegistrar {
+    TestRegistrar(const char *suite, const char *name, void (*run)()) { testRegistry().push_back({ suite, name, run }); }
+};
+
+// 记录一次失败的检查（位置与说明）
+void reportFailure(const char *file, int line, const std::string &message);
+
+// REQUIRE 失败时抛出，由运行器捕获
+struct TestAbort : std::runtime_error {
+    using std::runtime_error::runtime_error;
+};
+
+#define AR_TEST_CONCAT2(a, b) a##b
+#define AR_TEST_CONCAT(a, b) AR_TEST_CONCAT2(a, b)
+
+#define TEST_CASE(suite, name)                                                                  \
+    static void AR_TEST_CONCAT(test_, AR_TEST_CONCAT(suite, AR_TEST_CONCAT(_, name)))();        \
+    static const TestRegistrar AR_TEST_CONCAT(registrar_, AR_TEST_CONCAT(suite, AR_TEST_CONCAT(_, name))){ \
+        #suite, #name, &AR_TEST_CONCAT(test_, AR_TEST_CONCAT(suite, AR_TEST_CONCAT(_, name))) }; \
+    static void AR_TEST_CONCAT(test_, AR_TEST_CONCAT(suite, AR_TEST_CONCAT(_, name)))()
+
+#define CHECK(cond)                                                          \
+    do {                                                                     \
+        if (!(cond)) reportFailure(__FILE__, __LINE__, "CHECK(" #cond ")"); \
+    } while (0)
+
+#define REQUIRE(cond)                                                          \
+    do {                                                                       \
+        if (!(cond)) {                                                         \
+            reportFailure(__FILE__, __LINE__, "REQUIRE(" #cond ")");          \
+            throw TestAbort("REQUIRE failed");                                 \
+        }                                                                      \
+    } while (0)
+
+// 比较两个值并在失败时打印二者
+#define CHECK_EQ(a, b)                                                                  \
+    do {                                                                                \
+        const auto &checkA = (a);                                                       \
+        const auto &checkB = (b);                                                       \
+        if (!(checkA == checkB)) {                                                      \
+            std::ostringstream checkOut;                                                \
+            checkOut << "CHECK_EQ(" #a ", " #b "): " << checkA << " != " << checkB;    \
+            reportFailure(__FILE__, __LINE__, checkOut.str());                          \
+        }                                                                               \
+    } while (0)
+
+// a 与 b 之差不超过 tolerance
+#define CHECK_NEAR(a, b, tolerance)                                                                    \
+    do {                                                                                               \
+        const double checkA = static_cast<double>(a);                                                  \
+        const double checkB = static_cast<double>(b);                                                  \
+        if (!(std::fabs(checkA - checkB) <= static_cast<double>(tolerance))) {                         \
+            std::ostringstream checkOut;                                                               \
+            checkOut << "CHECK_NEAR(" #a ", " #b ", " #tolerance "): " << checkA << " vs " << checkB; \
+            reportFailure(__FILE__, __LINE__, checkOut.str());                                         \
+        }                                                                                              \
+    } while (0)